@@ -0,0 +1,81 @@
+TEMPLATE = app
+CONFIG += console c++11 release
+CONFIG -= app_bundle
+CONFIG -= qt
+
+# the wrapper sources from the C++ example, the camera library is replaced by the simulated camera
+SOURCES += \
+        ../C++/AsyncWriter.cpp \
+        ../C++/AutoExposure.cpp \
+        ../C++/BayerKernels.cpp \
+        ../C++/ByteSwap.cpp \
+        ../C++/CalibrationBuilder.cpp \
+        ../C++/Calibrator.cpp \
+        ../C++/CameraConfigTransaction.cpp \
+        ../C++/CpuFeatures.cpp \
+        ../C++/DarkLibrary.cpp \
+        ../C++/Debayer.cpp \
+        ../C++/Fft.cpp \
+        ../C++/FitsWriter.cpp \
+        ../C++/FocusMonitor.cpp \
+        ../C++/Frame.cpp \
+        ../C++/FramePool.cpp \
+        ../C++/FrameQuality.cpp \
+        ../C++/LiveStacker.cpp \
+        ../C++/LuckySelector.cpp \
+        ../C++/POACamera.cpp \
+        ../C++/ParallelRows.cpp \
+        ../C++/PhaseCorrelator.cpp \
+        ../C++/SerWriter.cpp \
+        ../C++/SoftwareBin.cpp \
+        ../C++/StarExtractor.cpp \
+        ../Simulator/PlayerOneCameraSim.cpp \
+        ../Simulator/SimScene.cpp \
+        main.cpp
+
+HEADERS += \
+    ../C++/AsyncWriter.h \
+    ../C++/AutoExposure.h \
+    ../C++/AutoExposureKernels.h \
+    ../C++/BayerKernels.h \
+    ../C++/ByteSwap.h \
+    ../C++/CalibrationBuilder.h \
+    ../C++/Calibrator.h \
+    ../C++/CalibratorKernels.h \
+    ../C++/CameraConfigTransaction.h \
+    ../C++/CpuFeatures.h \
+    ../C++/DarkLibrary.h \
+    ../C++/Debayer.h \
+    ../C++/DebayerKernels.h \
+    ../C++/Fft.h \
+    ../C++/FftKernels.h \
+    ../C++/FitsWriter.h \
+    ../C++/FocusMonitor.h \
+    ../C++/Frame.h \
+    ../C++/FramePool.h \
+    ../C++/FrameQuality.h \
+    ../C++/FrameQualityKernels.h \
+    ../C++/FrameRing.h \
+    ../C++/LiveStacker.h \
+    ../C++/LuckySelector.h \
+    ../C++/POACamera.h \
+    ../C++/ParallelRows.h \
+    ../C++/PhaseCorrelator.h \
+    ../C++/SerWriter.h \
+    ../C++/SimdOps.h \
+    ../C++/SoftwareBin.h \
+    ../C++/SoftwareBinKernels.h \
+    ../C++/StarExtractor.h \
+    ../Simulator/PlayerOneCameraSim.h \
+    ../Simulator/SimScene.h
+
+CONFIG += simd
+!msvc: QMAKE_CXXFLAGS += -ffp-contract=off # no fused multiply-add, the kernels give the same results as the scalar code
+SSE4_1_SOURCES += ../C++/ByteSwap_SSE41.cpp ../C++/Calibrator_SSE41.cpp ../C++/Debayer_SSE41.cpp ../C++/Fft_SSE41.cpp ../C++/FrameQuality_SSE41.cpp ../C++/SoftwareBin_SSE41.cpp
+AVX2_SOURCES += ../C++/ByteSwap_AVX2.cpp ../C++/Calibrator_AVX2.cpp ../C++/Debayer_AVX2.cpp ../C++/Fft_AVX2.cpp ../C++/FrameQuality_AVX2.cpp ../C++/SoftwareBin_AVX2.cpp
+AVX512BW_SOURCES += ../C++/ByteSwap_AVX512.cpp ../C++/Calibrator_AVX512.cpp ../C++/Debayer_AVX512.cpp ../C++/Fft_AVX512.cpp ../C++/FrameQuality_AVX512.cpp ../C++/SoftwareBin_AVX512.cpp
+
+unix: LIBS += -lpthread
+
+INCLUDEPATH += $$PWD/../../include $$PWD/../C++ $$PWD/../Simulator
+DEPENDPATH += $$PWD/../../include $$PWD/../C++ $$PWD/../Simulator
@@ -0,0 +1,2865 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <fstream>
+
+#include "POACamera.h"
+#include "CameraConfigTransaction.h"
+#include "Debayer.h"
+#include "ByteSwap.h"
+#include "FitsWriter.h"
+#include "SerWriter.h"
+#include "AsyncWriter.h"
+#include "CalibrationBuilder.h"
+#include "Calibrator.h"
+#include "DarkLibrary.h"
+#include "LiveStacker.h"
+#include "FrameQuality.h"
+#include "LuckySelector.h"
+#include "Fft.h"
+#include "PhaseCorrelator.h"
+#include "StarExtractor.h"
+#include "FocusMonitor.h"
+#include "SoftwareBin.h"
+#include "AutoExposure.h"
+#include "PlayerOneCameraSim.h"
+#include "ConvFuncs.h"
+
+#if defined(_WIN32)
+#include <direct.h>
+#define rmdir _rmdir
+#else
+#include <unistd.h>
+#endif
+
+/******************************************************************
+ * Benchmarks of the C++ wrapper, no camera is needed:
+ * the wrapper is linked against the simulated PlayerOneCamera library
+*******************************************************************/
+
+// count every heap allocation of the process, to check the steady state capture does not allocate
+static std::atomic<unsigned long long> g_heapAllocations(0);
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" //GCC warns when the replaced new/delete below are inlined
+#endif
+
+void *operator new(std::size_t size)
+{
+    g_heapAllocations++;
+    void *p = std::malloc(size ? size : 1);
+    if(!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+// the checks which failed, main() returns non-zero if there is any
+static int g_failures = 0;
+
+static bool checked(bool isOK)
+{
+    if(!isOK)
+    {
+        g_failures++;
+    }
+
+    return isOK;
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point beginTime)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - beginTime).count();
+}
+
+// SDK calls made by POACamera::getImageData per frame
+static void benchSdkCallsPerFrame()
+{
+    std::cout << "---- SDK calls per frame(POACamera::getImageData) ----" << std::endl;
+
+    POACamera camera(0);
+    camera.openCamera();
+    camera.initCamera();
+    camera.setImageSize(640, 480);
+    camera.setImageFormat(POACamera::RAW8);
+    camera.setExposure(1000, false);
+    camera.startExposure();
+
+    std::vector<unsigned char> buffer(640 * 480);
+    const int frameCount = 100000;
+
+    // before: the exposure was queried from the SDK on every frame, invalidating the cache does the same
+    POASimResetCallCount();
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < frameCount; i++)
+    {
+        camera.invalidateCache();
+        camera.getImageData(buffer.data(), (unsigned long)buffer.size());
+    }
+    double uncachedUs = elapsedUs(beginTime);
+    unsigned long long uncachedCalls = POASimGetCallCount();
+    unsigned long long uncachedGetConfigCalls = POASimGetConfigCallCount();
+
+    // after: the exposure comes from the state cache
+    camera.setExposure(1000, false);
+    POASimResetCallCount();
+    beginTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < frameCount; i++)
+    {
+        camera.getImageData(buffer.data(), (unsigned long)buffer.size());
+    }
+    double cachedUs = elapsedUs(beginTime);
+    unsigned long long cachedCalls = POASimGetCallCount();
+    unsigned long long cachedGetConfigCalls = POASimGetConfigCallCount();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "uncached: " << (double)uncachedCalls / frameCount << " SDK calls/frame, "
+              << (double)uncachedGetConfigCalls / frameCount << " POAGetConfig/frame, "
+              << uncachedUs / frameCount << " us/frame" << std::endl;
+    std::cout << "cached:   " << (double)cachedCalls / frameCount << " SDK calls/frame, "
+              << (double)cachedGetConfigCalls / frameCount << " POAGetConfig/frame, "
+              << cachedUs / frameCount << " us/frame" << std::endl;
+
+    camera.stopExposure();
+    camera.closeCamera();
+}
+
+// the SDK calls of the typed config calls: ConvFuncs.h takes the value type from POAConfigTraits.h, the range is asked to
+// the SDK on every call, the cache of POACamera has the range, the templates have the type at compile time
+static void benchConfigCalls()
+{
+    std::cout << "---- SDK calls per typed config call ----" << std::endl;
+
+    POACamera camera(0);
+    camera.openCamera();
+    camera.initCamera();
+
+    const int callCount = 10000;
+    long gain = 0, minGain = 0, maxGain = 0, defaultGain = 0;
+    double exposure = 0.0, minExposure = 0.0, maxExposure = 0.0, defaultExposure = 0.0;
+    POABool isAuto = POA_FALSE;
+
+    POASimResetCallCount();
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < callCount; i++)
+    {
+        GetConfigRange(0, POA_GAIN, &maxGain, &minGain, &defaultGain);
+        POASetConfig(0, POA_GAIN, std::min(maxGain, (long)(i % 200)), POA_FALSE);
+        POAGetConfig(0, POA_GAIN, &gain, &isAuto);
+        GetConfigRange(0, POA_EXP, &maxExposure, &minExposure, &defaultExposure);
+        POASetConfig(0, POA_EXP, 0.01, POA_FALSE);
+        POAGetConfig(0, POA_EXP, &exposure, &isAuto);
+    }
+    double convUs = elapsedUs(beginTime);
+    unsigned long long convCalls = POASimGetCallCount();
+
+    POASimResetCallCount();
+    beginTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < callCount; i++)
+    {
+        camera.getConfigRange(POA_GAIN, minGain, maxGain, defaultGain);
+        camera.setConfig(POA_GAIN, std::min(maxGain, (long)(i % 200)), false);
+        camera.getConfig(POA_GAIN, gain);
+        camera.getConfigRange(POA_EXP, minExposure, maxExposure, defaultExposure);
+        camera.setConfig(POA_EXP, 0.01, false);
+        camera.getConfig(POA_EXP, exposure);
+    }
+    double cachedUs = elapsedUs(beginTime);
+    unsigned long long cachedCalls = POASimGetCallCount();
+
+    POASimResetCallCount();
+    beginTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < callCount; i++)
+    {
+        POASetConfigValue<POA_GAIN>(0, std::min(maxGain, (long)(i % 200)));
+        POAGetConfigValue<POA_GAIN>(0, &gain);
+        POASetConfigValue<POA_EXP>(0, 0.01);
+        POAGetConfigValue<POA_EXP>(0, &exposure);
+    }
+    double traitsUs = elapsedUs(beginTime);
+    unsigned long long traitsCalls = POASimGetCallCount();
+
+    POASimResetCallCount();
+    beginTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < callCount; i++)
+    {
+        camera.set<POA_GAIN>(std::min(maxGain, (long)(i % 200)));
+        camera.get<POA_GAIN>(gain);
+        camera.set<POA_EXP>(0.01);
+        camera.get<POA_EXP>(exposure);
+    }
+    double typedUs = elapsedUs(beginTime);
+    unsigned long long typedCalls = POASimGetCallCount();
+
+    // the table of POAConfigTraits.h agrees with the attributes of the camera
+    bool isTableValid = true;
+    for(int confID = 0; confID <= POA_EXP; confID++)
+    {
+        const POAConfigAttributes *pAttributes = camera.getConfigAttributes((POAConfig)confID);
+        const POAConfigInfo *pConfInfo = GetConfigInfo((POAConfig)confID);
+        if(pAttributes && (pConfInfo->valueType != pAttributes->valueType || pConfInfo->isWritable != (pAttributes->isWritable == POA_TRUE)))
+        {
+            std::cout << "POAConfigTraits.h: " << pAttributes->szConfName << " differs from the camera" << std::endl;
+            isTableValid = false;
+        }
+    }
+
+    // the value out of the range and the read-only config are refused before the SDK, the calls left are the
+    // POAGetErrorString of the 2 error messages
+    POASimResetCallCount();
+    bool isRefused = !camera.setConfig(POA_GAIN, maxGain + 1, false) && !camera.setConfig(POA_TEMPERATURE, 20.0, false);
+    unsigned long long refusedCalls = POASimGetCallCount() - 2;
+
+    // the generic setters update the state cache: getExposure() and getGain() answer without SDK call,
+    // POA_EXP is in seconds, in auto mode the exposure is read from the camera again
+    long cachedGain = std::min(maxGain, 150L);
+    camera.setConfig(POA_EXPOSURE, 20000L, false);
+    camera.setConfig(POA_GAIN, cachedGain, false);
+    POASimResetCallCount();
+    bool isCacheValid = camera.getExposure() == 20000 && camera.getGain() == cachedGain && POASimGetCallCount() == 0;
+    camera.setConfig(POA_EXP, 0.5, false);
+    POASimResetCallCount();
+    isCacheValid = isCacheValid && camera.getExposure() == 500000 && POASimGetCallCount() == 0;
+    camera.setConfig(POA_EXPOSURE, 20000L, true);
+    POASimResetCallCount();
+    camera.getExposure();
+    isCacheValid = isCacheValid && POASimGetCallCount() > 0;
+    camera.setConfig(POA_EXPOSURE, 20000L, false);
+
+    // the typed setters go through the same write
+    camera.set<POA_EXP>(0.25);
+    camera.set<POA_GAIN>(cachedGain / 2);
+    camera.set<POA_OFFSET>(40);
+    POASimResetCallCount();
+    bool isTypedCacheValid = camera.getExposure() == 250000 && camera.getGain() == cachedGain / 2 && camera.getOffset() == 40
+            && POASimGetCallCount() == 0;
+    camera.set<POA_EXPOSURE>(20000);
+
+    // the auto exposure set behind the wrapper before the state is cached: the wait(and Frame::exposureUs) is the
+    // maximum of the auto exposure
+    camera.initCamera();
+    POASetConfig(0, POA_AUTOEXPO_MAX_EXPOSURE, 50L, POA_FALSE);
+    POASetConfig(0, POA_EXPOSURE, 1000L, POA_TRUE);
+    camera.initFramePool(4);
+    camera.startCapture(2);
+    Frame frame;
+    while(!camera.popFrame(frame))
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    bool isAutoMaxLoaded = frame.exposureUs == 50000;
+    frame.reset();
+    camera.stopCapture();
+    camera.set<POA_EXPOSURE>(20000);
+
+    // the camera initialized outside the wrapper: the attributes are not loaded, every call is one SDK call, the load
+    // is not retried(and doesn't print errors) by the config calls
+    camera.closeCamera();
+    camera.openCamera();
+    POAInitCamera(0);
+    POASimResetCallCount();
+    for(int i = 0; i < 3; i++)
+    {
+        camera.set<POA_GAIN>(100);
+        camera.getConfigRange(POA_GAIN, minGain, maxGain, defaultGain);
+    }
+    bool isUncached = POASimGetCallCount() == 6 && maxGain > 0 && camera.hasConfig(POA_GAIN) && !camera.getConfigAttributes(POA_GAIN);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "ConvFuncs.h:         " << (double)convCalls / callCount << " SDK calls per 2 x(range, set, get), "
+              << convUs / callCount << " us" << std::endl;
+    std::cout << "attribute cache:     " << (double)cachedCalls / callCount << " SDK calls per 2 x(range, set, get), "
+              << cachedUs / callCount << " us" << std::endl;
+    std::cout << "POASetConfigValue<>: " << (double)traitsCalls / callCount << " SDK calls per 2 x(set, get), "
+              << traitsUs / callCount << " us" << std::endl;
+    std::cout << "camera.set<>/get<>:  " << (double)typedCalls / callCount << " SDK calls per 2 x(set, get), "
+              << typedUs / callCount << " us" << std::endl;
+    std::cout << "config traits table: " << (checked(isTableValid) ? "matches the camera attributes (OK)" : "(FAILED)") << std::endl;
+    std::cout << "out of range / read-only set: " << (checked(isRefused && refusedCalls == 0) ? "refused without SDK call (OK)" : "(FAILED)") << std::endl;
+    std::cout << "setConfig() then getExposure()/getGain(): " << (checked(isCacheValid) ? "the written values from the cache (OK)" : "(FAILED)") << std::endl;
+    std::cout << "set<>() then getExposure()/getGain()/getOffset(): " << (checked(isTypedCacheValid) ? "the written values from the cache (OK)" : "(FAILED)") << std::endl;
+    std::cout << "auto exposure found by getExposure(): " << (checked(isAutoMaxLoaded) ? "waits for POA_AUTOEXPO_MAX_EXPOSURE (OK)" : "(FAILED)") << std::endl;
+    std::cout << "not loaded attributes: " << (checked(isUncached) ? "one SDK call per config call (OK)" : "(FAILED)") << std::endl;
+
+    camera.closeCamera();
+}
+
+// changing bin, ROI and format together: the setters one by one, or one CameraConfigTransaction
+static void benchReconfiguration()
+{
+    std::cout << "---- reconfiguration(bin, size, start position, format) ----" << std::endl;
+
+    POACamera camera(0);
+    camera.openCamera();
+    camera.initCamera();
+    camera.setImageSize(640, 480);
+    camera.setImageFormat(POACamera::RAW8);
+    camera.setExposure(1000, false);
+
+    const int bins[2] = {2, 1};
+    const int widths[2] = {400, 640};
+    const int heights[2] = {300, 480};
+    const POACamera::ImageFormat formats[2] = {POACamera::RAW16, POACamera::RAW8};
+    const int reconfigCount = 50;
+
+    // the SDK calls, with the exposure running(the capture thread would add its own calls)
+    camera.startExposure();
+    POASimResetCallCount();
+    for(int i = 0; i < reconfigCount; i++)
+    {
+        int k = i % 2;
+        camera.setImageBin(bins[k]);
+        camera.setImageSize(widths[k], heights[k]);
+        camera.setImageStartPos(100, 50);
+        camera.setImageFormat(formats[k]);
+        camera.startExposure(); //the setters stop the exposure, but don't restart it
+    }
+    unsigned long long setterCalls = POASimGetCallCount();
+
+    CameraConfigTransaction transaction(camera);
+    bool isExposureRestarted = true;
+    POASimResetCallCount();
+    for(int i = 0; i < reconfigCount; i++)
+    {
+        int k = i % 2;
+        transaction.setImageBin(bins[k]);
+        transaction.setImageSize(widths[k], heights[k]);
+        transaction.setImageStartPos(100, 50);
+        transaction.setImageFormat(formats[k]);
+        transaction.commit();
+        isExposureRestarted = isExposureRestarted && transaction.getStats().isStreamRestarted;
+    }
+    unsigned long long transactionCalls = POASimGetCallCount();
+    isExposureRestarted = isExposureRestarted && transaction.waitFirstFrame(1000);
+    camera.stopExposure();
+
+    // the capture thread: reconfiguration to the first frame of the new settings
+    camera.startCapture(8);
+    Frame frame;
+    double setterLatencyUs = 0.0;
+    for(int i = 0; i < reconfigCount; i++)
+    {
+        int k = i % 2;
+        std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+        camera.stopCapture();
+        camera.setImageBin(bins[k]);
+        camera.setImageSize(widths[k], heights[k]);
+        camera.setImageStartPos(100, 50);
+        camera.setImageFormat(formats[k]);
+        camera.startCapture(8);
+        while(!camera.popFrame(frame))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100)); //don't take the core of the capture thread
+        }
+        setterLatencyUs += elapsedUs(beginTime);
+    }
+
+    double commitUs = 0.0, firstFrameUs = 0.0, maxFirstFrameUs = 0.0, transactionLatencyUs = 0.0;
+    bool isFrameValid = true;
+    for(int i = 0; i < reconfigCount; i++)
+    {
+        int k = i % 2;
+        std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+        transaction.setImageBin(bins[k]);
+        transaction.setImageSize(widths[k], heights[k]);
+        transaction.setImageStartPos(100, 50);
+        transaction.setImageFormat(formats[k]);
+        transaction.commit();
+
+        // the frames of the old settings were dropped, the first frame has the new ones
+        while(!camera.popFrame(frame))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        transactionLatencyUs += elapsedUs(beginTime);
+
+        if(!transaction.waitFirstFrame(1000))
+        {
+            isFrameValid = false;
+            continue;
+        }
+
+        ReconfigStats stats = transaction.getStats();
+        commitUs += (double)stats.commitUs;
+        firstFrameUs += (double)stats.firstFrameUs;
+        maxFirstFrameUs = std::max(maxFirstFrameUs, (double)stats.firstFrameUs);
+
+        ROIArea roiArea = camera.getROIArea();
+        isFrameValid = isFrameValid && stats.isStreamRestarted && frame.seq == 1 && frame.bin == bins[k]
+                && frame.width() == widths[k] && frame.height() == heights[k] && frame.startX == roiArea.startX
+                && frame.startY == roiArea.startY && frame.imgFormat() == (k == 0 ? POA_RAW16 : POA_RAW8);
+    }
+    frame.reset();
+    camera.stopCapture();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "setters:     " << (double)setterCalls / reconfigCount << " SDK calls, "
+              << setterLatencyUs / reconfigCount << " us to the first popped frame(capture thread)" << std::endl;
+    std::cout << "transaction: " << (double)transactionCalls / reconfigCount << " SDK calls, "
+              << transactionLatencyUs / reconfigCount << " us to the first popped frame(capture thread)" << std::endl;
+    std::cout << "ReconfigStats: " << commitUs / reconfigCount << " us commit, " << firstFrameUs / reconfigCount
+              << " us(max " << maxFirstFrameUs << ") to the first frame" << std::endl;
+    std::cout << "exposure restarted once, new settings on the first frame: "
+              << (checked(isExposureRestarted && isFrameValid) ? "(OK)" : "(FAILED)") << std::endl;
+
+    camera.closeCamera();
+}
+
+// the tracking ROI mode follows a drifting target while the capture thread keeps streaming
+static void benchTrackingROI()
+{
+    std::cout << "---- tracking ROI(POASetImageStartPos while streaming) ----" << std::endl;
+
+    POASimSettings savedSettings;
+    POASimGetSettings(0, &savedSettings);
+    POASimSettings settings = savedSettings;
+    settings.isRealTime = POA_TRUE; //the frames come at the frame rate, the moves land between them
+    POASimSetSettings(0, &settings);
+
+    POACamera camera(0);
+    camera.openCamera();
+    camera.initCamera();
+    camera.setImageBin(1);
+    camera.setImageSize(320, 240);
+    camera.setImageStartPos(400, 300);
+    camera.setImageFormat(POACamera::RAW8);
+    camera.setExposure(2000, false);
+
+    TrackingSettings trackingSettings;
+    trackingSettings.deadband = 8;
+    trackingSettings.minMoveFrames = 3;
+    camera.startCapture(8);
+    camera.startTracking(trackingSettings);
+
+    // the target drifts 2 pixels per frame to the right and swings up and down, it's measured on every frame
+    const int frameCount = 600;
+    Frame frame;
+    unsigned long long lastSeq = 0, lastChangeSeq = 0;
+    int lastStartX = -1, lastStartY = -1, windowChanges = 0;
+    bool isSeqValid = true, isRateValid = true;
+    long long firstTimeUs = 0, lastTimeUs = 0;
+    for(int popped = 0; popped < frameCount;)
+    {
+        if(!camera.popFrame(frame))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        popped++;
+
+        // one stream: the seq never goes back to 1, the window changes at most once every minMoveFrames
+        isSeqValid = isSeqValid && frame.seq > lastSeq;
+        if(frame.startX != lastStartX || frame.startY != lastStartY)
+        {
+            if(lastStartX >= 0)
+            {
+                windowChanges++;
+                isRateValid = isRateValid && frame.seq - lastChangeSeq >= (unsigned long long)trackingSettings.minMoveFrames;
+            }
+            lastChangeSeq = frame.seq;
+            lastStartX = frame.startX;
+            lastStartY = frame.startY;
+        }
+        lastSeq = frame.seq;
+        firstTimeUs = firstTimeUs == 0 ? frame.timestampUs : firstTimeUs;
+        lastTimeUs = frame.timestampUs;
+
+        double targetX = 560.0 + 2.0 * frame.seq;
+        double targetY = 420.0 + 60.0 * std::sin(frame.seq * 0.02);
+        camera.updateTrackingTarget(std::min(targetX, 1800.0), targetY);
+    }
+    frame.reset();
+
+    TrackingStats stats = camera.getTrackingStats();
+    CaptureStats captureStats = camera.getCaptureStats();
+    camera.stopTracking();
+    camera.stopCapture();
+
+    // the camera has the window of the last frames
+    camera.invalidateCache();
+    ROIArea roiArea = camera.getROIArea();
+    bool isWindowValid = stats.moveErrors == 0 && roiArea.startX == stats.startX && roiArea.startY == stats.startY
+            && (lastChangeSeq < stats.firstSeq || (lastStartX == stats.startX && lastStartY == stats.startY));
+
+    double frameUs = (double)(lastTimeUs - firstTimeUs) / std::max(lastSeq - 1, 1ULL);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "frames: " << frameCount << ", " << frameUs << " us per frame, requests: " << stats.requests << ", held by the deadband: "
+              << stats.held << ", coalesced: " << stats.coalesced << ", moves: " << stats.moves << std::endl;
+    std::cout << "request to POASetImageStartPos: avg " << stats.avgMoveLatencyUs << " us, max " << stats.maxMoveLatencyUs
+              << " us, window changes seen in the frames: " << windowChanges << std::endl;
+    std::cout << "no restart, rate limit, frames tagged with their window: "
+              << (checked(isSeqValid && isRateValid && isWindowValid && captureStats.captureErrors == 0 && stats.moves > 0) ? "(OK)" : "(FAILED)") << std::endl;
+
+    camera.closeCamera();
+    POASimSetSettings(0, &savedSettings);
+}
+
+// heap allocations in the steady state of the capture thread mode, it should be 0
+static void benchSteadyStateAllocations()
+{
+    std::cout << "---- heap allocations in steady state capture ----" << std::endl;
+
+    POACamera camera(0);
+    camera.openCamera();
+    camera.initCamera();
+    camera.setImageSize(640, 480);
+    camera.setImageFormat(POACamera::RAW8);
+    camera.setExposure(1000, false);
+
+    const int ringFrames = 8;
+    camera.initFramePool(ringFrames * 2 + 1 + 1); // ring + frames held by the consumers + overrun + consumer buffer
+
+    unsigned long frameBytes = camera.getFrameBytes();
+    unsigned char *pDataBuffer = camera.getFramePool().acquire();
+
+    // after the format and ROI change, the slabs are reused
+    unsigned long long poolAllocations = camera.getFramePool().allocationCount();
+    camera.setImageFormat(POACamera::RAW16);
+    ROIArea roiArea;
+    roiArea.startX = 100;
+    roiArea.startY = 100;
+    roiArea.width = 1280;
+    roiArea.height = 720;
+    camera.setROIArea(roiArea);
+    std::cout << "pool allocations by format/ROI change: " << camera.getFramePool().allocationCount() - poolAllocations << std::endl;
+    frameBytes = camera.getFrameBytes();
+
+    if(!camera.startCapture(ringFrames))
+    {
+        camera.getFramePool().recycle(pDataBuffer);
+        camera.closeCamera();
+        return;
+    }
+
+    // warm up: the thread and the ring are created
+    int popped = 0;
+    while(popped < 100)
+    {
+        if(camera.popFrame(pDataBuffer, frameBytes))
+        {
+            popped++;
+        }
+    }
+
+    const int frameCount = 10000;
+    unsigned long long allocationsBefore = g_heapAllocations;
+    popped = 0;
+    while(popped < frameCount)
+    {
+        if(camera.popFrame(pDataBuffer, frameBytes))
+        {
+            popped++;
+        }
+    }
+
+    // zero copy, the frame and its view share the slab
+    Frame frame;
+    popped = 0;
+    while(popped < frameCount)
+    {
+        if(camera.popFrame(frame))
+        {
+            Frame view = frame.view(0, 0, frame.width() / 2, frame.height() / 2);
+            popped += view.isValid() ? 1 : 0;
+        }
+    }
+    frame.reset();
+    unsigned long long allocations = g_heapAllocations - allocationsBefore;
+
+    // the image setters are refused while the capture thread runs with the old format and window
+    ROIArea capturedROI = camera.getROIArea();
+    bool isRefused = !camera.setImageFormat(POACamera::RAW8) && !camera.setImageBin(2) && !camera.setImageStartPos(0, 0)
+            && camera.getFrameBytes() == frameBytes && camera.getROIArea().startX == capturedROI.startX;
+
+    camera.stopCapture();
+    CaptureStats stats = camera.getCaptureStats();
+
+    std::cout << "frames: " << frameCount * 2 << ", heap allocations: " << allocations
+              << (checked(allocations == 0) ? " (OK)" : " (FAILED)") << ", overrun: " << stats.framesOverrun << std::endl;
+    std::cout << "format/bin/start position setters while capturing: " << (checked(isRefused) ? "refused (OK)" : "(FAILED)") << std::endl;
+
+    // a consumer keeps popping while the capture is stopped and started again with other rings, after stopCapture()
+    // popFrame returns false and the frames not popped are back in the pool
+    std::atomic<bool> isConsuming(true);
+    std::atomic<unsigned long long> consumed(0);
+    std::thread consumer([&]()
+    {
+        Frame poppedFrame;
+        while(isConsuming)
+        {
+            if(camera.popFrame(poppedFrame))
+            {
+                poppedFrame.reset();
+                consumed++;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+    const int restartCount = 50;
+    bool isStopped = true;
+    for(int i = 0; i < restartCount; i++)
+    {
+        camera.startCapture(i % 2 == 0 ? 4 : 8);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        camera.stopCapture();
+        isStopped = isStopped && !camera.popFrame(frame);
+    }
+    isConsuming = false;
+    consumer.join();
+    bool isReturned = camera.getFramePool().freeCount() == camera.getFramePool().slabCount() - 1; //pDataBuffer is held
+    std::cout << "popFrame while the capture restarts " << restartCount << " times: " << consumed << " frames, "
+              << (checked(isStopped && isReturned) ? "no frame after stop, all returned to the pool (OK)" : "(FAILED)") << std::endl;
+
+    camera.getFramePool().recycle(pDataBuffer);
+    camera.closeCamera();
+}
+
+// every SIMD level of Debayer against the scalar reference, then the speed of each level
+static void benchDebayer()
+{
+    std::cout << "---- debayer(best SIMD level: " << CpuFeatures::levelName(CpuFeatures::bestLevel()) << ") ----" << std::endl;
+
+    const int width = 1920 + 5; //odd sizes, so the scalar tail and the mirrored borders are checked too
+    const int height = 1080 + 3;
+    std::vector<uint16_t> raw(width * height);
+    std::mt19937 random(1234);
+    for(size_t i = 0; i < raw.size(); i++)
+    {
+        raw[i] = (uint16_t)random();
+    }
+
+    std::vector<unsigned char> raw8(raw.size());
+    for(size_t i = 0; i < raw.size(); i++)
+    {
+        raw8[i] = (unsigned char)raw[i];
+    }
+
+    const char *algorithmNames[2] = { "bilinear", "edge aware" };
+    const char *formatNames[2] = { "RAW8", "RAW16" };
+    const POABayerPattern patterns[4] = { POA_BAYER_RG, POA_BAYER_BG, POA_BAYER_GR, POA_BAYER_GB };
+
+    for(int algorithm = Debayer::BILINEAR; algorithm <= Debayer::EDGE_AWARE; algorithm++)
+    {
+        for(int format = 0; format < 2; format++)
+        {
+            POAImgFormat imgFormat = format == 0 ? POA_RAW8 : POA_RAW16;
+            unsigned char *pRaw = format == 0 ? raw8.data() : (unsigned char *)raw.data();
+            size_t dstStride = width * Debayer::outputBytesPerPixel(imgFormat);
+            std::vector<unsigned char> reference(dstStride * height);
+            std::vector<unsigned char> output(dstStride * height);
+
+            Debayer debayer;
+            debayer.setAlgorithm((Debayer::Algorithm)algorithm);
+
+            // the same output for all the patterns, and for a view at an odd position(the pattern is shifted)
+            bool isSame = true;
+            for(int i = 0; i < 5; i++)
+            {
+                Frame frame = Frame::wrap(pRaw, width, height, width * FramePool::bytesPerPixel(imgFormat), imgFormat, patterns[i % 4]);
+                if(i == 4)
+                {
+                    frame = frame.view(1, 1, width - 2, height - 2);
+                }
+
+                std::memset(reference.data(), 0, reference.size());
+                debayer.setSimdLevel(SIMD_SCALAR);
+                debayer.process(frame, reference.data(), dstStride);
+
+                for(int level = SIMD_SSE41; level < SIMD_LEVEL_COUNT; level++)
+                {
+                    if(!debayer.setSimdLevel((SimdLevel)level))
+                    {
+                        continue;
+                    }
+
+                    std::memset(output.data(), 0, output.size());
+                    debayer.process(frame, output.data(), dstStride);
+                    if(std::memcmp(reference.data(), output.data(), output.size()) != 0)
+                    {
+                        std::cout << CpuFeatures::levelName((SimdLevel)level) << " differs from the scalar reference, pattern " << i << std::endl;
+                        isSame = false;
+                    }
+                }
+            }
+
+            std::cout << algorithmNames[algorithm] << " " << formatNames[format] << ": SIMD == scalar " << (checked(isSame) ? "(OK)" : "(FAILED)") << std::endl;
+
+            Frame frame = Frame::wrap(pRaw, width, height, width * FramePool::bytesPerPixel(imgFormat), imgFormat, POA_BAYER_RG);
+            for(int level = SIMD_SCALAR; level < SIMD_LEVEL_COUNT; level++)
+            {
+                if(!debayer.setSimdLevel((SimdLevel)level))
+                {
+                    continue;
+                }
+
+                debayer.process(frame, output.data(), dstStride); //warm up
+                const int frameCount = 20;
+                std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+                for(int i = 0; i < frameCount; i++)
+                {
+                    debayer.process(frame, output.data(), dstStride);
+                }
+                double us = elapsedUs(beginTime) / frameCount;
+
+                std::cout << "    " << std::left << std::setw(8) << CpuFeatures::levelName((SimdLevel)level) << std::right
+                          << std::setprecision(2) << us / 1000 << " ms/frame, " << std::setprecision(0) << (double)width * height / us << " Mpixel/s" << std::endl;
+            }
+        }
+    }
+}
+
+// the runtime branching baseline: the color of the pixel and the format are decided for every pixel
+static int baselineColorAt(POABayerPattern bayerPattern, int x, int y) //0: red, 1: green, 2: blue
+{
+    int cell = ((y & 1) << 1) | (x & 1);
+    switch (bayerPattern)
+    {
+    case POA_BAYER_RG:
+        return cell == 0 ? 0 : (cell == 3 ? 2 : 1);
+    case POA_BAYER_BG:
+        return cell == 0 ? 2 : (cell == 3 ? 0 : 1);
+    case POA_BAYER_GR:
+        return cell == 1 ? 0 : (cell == 2 ? 2 : 1);
+    case POA_BAYER_GB:
+        return cell == 1 ? 2 : (cell == 2 ? 0 : 1);
+    default:
+        return 1;
+    }
+}
+
+static int baselinePixel(const unsigned char *pRaw, int width, int height, POAImgFormat imgFormat, int x, int y)
+{
+    x = x < 0 ? -x : (x >= width ? 2 * (width - 1) - x : x);
+    y = y < 0 ? -y : (y >= height ? 2 * (height - 1) - y : y);
+    return imgFormat == POA_RAW16 ? ((const uint16_t *)pRaw)[(size_t)y * width + x] : pRaw[(size_t)y * width + x];
+}
+
+static int baselineAverage(int a, int b)
+{
+    return (a + b + 1) >> 1;
+}
+
+static void baselineBilinear(const unsigned char *pRaw, int width, int height, POAImgFormat imgFormat, POABayerPattern bayerPattern, unsigned char *pDst)
+{
+    for(int y = 0; y < height; y++)
+    {
+        for(int x = 0; x < width; x++)
+        {
+            int c = baselinePixel(pRaw, width, height, imgFormat, x, y);
+            int h = baselineAverage(baselinePixel(pRaw, width, height, imgFormat, x - 1, y), baselinePixel(pRaw, width, height, imgFormat, x + 1, y));
+            int v = baselineAverage(baselinePixel(pRaw, width, height, imgFormat, x, y - 1), baselinePixel(pRaw, width, height, imgFormat, x, y + 1));
+            int diag = baselineAverage(baselineAverage(baselinePixel(pRaw, width, height, imgFormat, x - 1, y - 1), baselinePixel(pRaw, width, height, imgFormat, x + 1, y - 1)),
+                                       baselineAverage(baselinePixel(pRaw, width, height, imgFormat, x - 1, y + 1), baselinePixel(pRaw, width, height, imgFormat, x + 1, y + 1)));
+
+            int r, g, b;
+            switch (baselineColorAt(bayerPattern, x, y))
+            {
+            case 0:
+                r = c;
+                g = baselineAverage(v, h);
+                b = diag;
+                break;
+            case 2:
+                b = c;
+                g = baselineAverage(v, h);
+                r = diag;
+                break;
+            default:
+                g = c;
+                if(baselineColorAt(bayerPattern, x + 1, y) == 0) //red row
+                {
+                    r = h;
+                    b = v;
+                }
+                else
+                {
+                    b = h;
+                    r = v;
+                }
+                break;
+            }
+
+            size_t index = ((size_t)y * width + x) * 3;
+            if(imgFormat == POA_RAW16)
+            {
+                ((uint16_t *)pDst)[index] = (uint16_t)b;
+                ((uint16_t *)pDst)[index + 1] = (uint16_t)g;
+                ((uint16_t *)pDst)[index + 2] = (uint16_t)r;
+            }
+            else
+            {
+                pDst[index] = (unsigned char)b;
+                pDst[index + 1] = (unsigned char)g;
+                pDst[index + 2] = (unsigned char)r;
+            }
+        }
+    }
+}
+
+// the kernels specialized on <POABayerPattern, PixelT> against the baseline branching per pixel
+static void benchBayerKernels()
+{
+    std::cout << "---- bayer kernels: specialized <pattern, pixel type> vs runtime branching ----" << std::endl;
+
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<uint16_t> raw(width * height);
+    std::mt19937 random(5678);
+    for(size_t i = 0; i < raw.size(); i++)
+    {
+        raw[i] = (uint16_t)random();
+    }
+
+    // the dispatch table of a color camera with RAW8 and RAW16
+    POACameraProperties cameraProp = POACameraProperties();
+    cameraProp.isColorCamera = POA_TRUE;
+    cameraProp.bayerPattern = POA_BAYER_GR;
+    cameraProp.imgFormats[0] = POA_RAW8;
+    cameraProp.imgFormats[1] = POA_RAW16;
+    cameraProp.imgFormats[2] = POA_END;
+
+    for(int format = 0; format < 2; format++)
+    {
+        POAImgFormat imgFormat = format == 0 ? POA_RAW8 : POA_RAW16;
+        size_t dstStride = width * Debayer::outputBytesPerPixel(imgFormat);
+        std::vector<unsigned char> baseline(dstStride * height);
+        std::vector<unsigned char> output(dstStride * height);
+        Frame frame = Frame::wrap((unsigned char *)raw.data(), width, height, width * FramePool::bytesPerPixel(imgFormat), imgFormat, cameraProp.bayerPattern);
+
+        const int frameCount = 10;
+        std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+        for(int i = 0; i < frameCount; i++)
+        {
+            baselineBilinear((const unsigned char *)raw.data(), width, height, imgFormat, cameraProp.bayerPattern, baseline.data());
+        }
+        double baselineUs = elapsedUs(beginTime) / frameCount;
+
+        Debayer debayer;
+        debayer.setCameraProperties(cameraProp);
+        debayer.setSimdLevel(SIMD_SCALAR);
+        debayer.process(frame, output.data(), dstStride);
+        bool isSame = std::memcmp(baseline.data(), output.data(), output.size()) == 0;
+
+        beginTime = std::chrono::steady_clock::now();
+        for(int i = 0; i < frameCount; i++)
+        {
+            debayer.process(frame, output.data(), dstStride);
+        }
+        double specializedUs = elapsedUs(beginTime) / frameCount;
+
+        debayer.setSimdLevel(CpuFeatures::bestLevel());
+        beginTime = std::chrono::steady_clock::now();
+        for(int i = 0; i < frameCount; i++)
+        {
+            debayer.process(frame, output.data(), dstStride);
+        }
+        double simdUs = elapsedUs(beginTime) / frameCount;
+
+        std::cout << (format == 0 ? "RAW8 " : "RAW16") << " bilinear: runtime branching " << std::setprecision(2) << baselineUs / 1000
+                  << " ms, specialized " << specializedUs / 1000 << " ms(" << std::setprecision(1) << baselineUs / specializedUs << "x), "
+                  << CpuFeatures::levelName(debayer.getSimdLevel()) << " " << std::setprecision(2) << simdUs / 1000 << " ms("
+                  << std::setprecision(1) << baselineUs / simdUs << "x), same output " << (checked(isSame) ? "(OK)" : "(FAILED)") << std::endl;
+    }
+}
+
+static void benchFitsWriter()
+{
+    std::cout << "---- FITS writer(USB3 is about 400 MB/s) ----" << std::endl;
+
+    const size_t count = 4144 * 2822 + 7; //a 11.7M pixels sensor, odd count for the scalar tail
+    std::vector<uint16_t> pixels(count);
+    std::mt19937 random(4321);
+    for(size_t i = 0; i < count; i++)
+    {
+        pixels[i] = (uint16_t)random();
+    }
+
+    std::vector<uint16_t> reference(count);
+    std::vector<uint16_t> output(count);
+    ByteSwap::toBigEndian16(pixels.data(), reference.data(), count, 0x8000, SIMD_SCALAR);
+
+    for(int level = SIMD_SCALAR; level < SIMD_LEVEL_COUNT; level++)
+    {
+        if(!ByteSwap::isAvailable((SimdLevel)level))
+        {
+            continue;
+        }
+
+        std::memset(output.data(), 0, count * sizeof(uint16_t));
+        ByteSwap::toBigEndian16(pixels.data(), output.data(), count, 0x8000, (SimdLevel)level);
+        bool isSame = std::memcmp(reference.data(), output.data(), count * sizeof(uint16_t)) == 0;
+
+        const int loopCount = 10;
+        std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+        for(int i = 0; i < loopCount; i++)
+        {
+            ByteSwap::toBigEndian16(pixels.data(), output.data(), count, 0x8000, (SimdLevel)level);
+        }
+        double us = elapsedUs(beginTime) / loopCount;
+
+        std::cout << "byte swap " << std::left << std::setw(8) << CpuFeatures::levelName((SimdLevel)level) << std::right
+                  << std::setprecision(0) << count * sizeof(uint16_t) / us << " MB/s" << (checked(isSame) ? "" : " (FAILED: differs from scalar)") << std::endl;
+    }
+
+    // write RAW16 and RAW8 frames, check the size and the first pixel of the file
+    const int width = 4144;
+    const int height = 2822;
+    const char *fileName = "benchmark_frame.fits";
+    FitsCameraState cameraState;
+    cameraState.instrument = "Simulator Camera";
+    cameraState.gain = 100;
+    cameraState.offset = 12;
+    cameraState.hasTemperature = true;
+    cameraState.temperature = -10.5;
+
+    FitsWriter fitsWriter;
+    fitsWriter.setCameraState(cameraState);
+
+    for(int format = 0; format < 2; format++)
+    {
+        POAImgFormat imgFormat = format == 0 ? POA_RAW16 : POA_RAW8;
+        Frame frame = Frame::wrap((unsigned char *)pixels.data(), width, height, width * FramePool::bytesPerPixel(imgFormat), imgFormat, POA_BAYER_RG);
+        frame.exposureUs = 2000;
+        frame.timestampUs = 1700000000000000LL;
+
+        fitsWriter.write(fileName, frame); //warm up, the own pool is initialized here
+
+        unsigned long long allocationsBefore = g_heapAllocations;
+        const int loopCount = 5;
+        std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+        bool isOK = true;
+        for(int i = 0; i < loopCount; i++)
+        {
+            isOK = fitsWriter.write(fileName, frame) && isOK;
+        }
+        double us = elapsedUs(beginTime) / loopCount;
+        unsigned long long allocations = g_heapAllocations - allocationsBefore;
+
+        std::ifstream inFile(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+        size_t size = (size_t)inFile.tellg();
+        unsigned char firstPixel[2] = { 0, 0 };
+        inFile.seekg(FitsWriter::BLOCK_BYTES);
+        inFile.read((char *)firstPixel, format == 0 ? 2 : 1);
+        inFile.close();
+
+        int value = format == 0 ? (int)(short)((firstPixel[0] << 8) | firstPixel[1]) + 32768 : firstPixel[0];
+        int expected = format == 0 ? pixels[0] : (pixels[0] & 0xFF);
+        isOK = isOK && size == FitsWriter::fileBytes(frame) && value == expected;
+
+        std::cout << (format == 0 ? "write RAW16 " : "write RAW8  ") << std::setprecision(1) << us / 1000 << " ms/frame, "
+                  << std::setprecision(0) << frame.sizeBytes() / us << " MB/s, allocations per frame: " << allocations / loopCount
+                  << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+    }
+
+    std::remove(fileName);
+}
+
+static void benchSerWriter()
+{
+    std::cout << "---- SER writer(640 x 480 RAW8, 500 fps needed) ----" << std::endl;
+
+    const int width = 640;
+    const int height = 480;
+    const int frameCount = 3000;
+    const char *fileName = "benchmark_capture.ser";
+
+    // the frames come from a pool, as popFrame gives them
+    FramePool pool;
+    pool.init((size_t)width * height, 4);
+    std::mt19937 random(8765);
+    for(int i = 0; i < pool.slabCount(); i++)
+    {
+        unsigned char *pSlab = pool.acquire();
+        for(int j = 0; j < width * height; j++)
+        {
+            pSlab[j] = (unsigned char)random();
+        }
+        pool.recycle(pSlab);
+    }
+
+    SerWriter serWriter;
+    serWriter.setInstrument("Simulator Camera");
+    serWriter.open(fileName, width, height, POA_RAW8, POA_BAYER_RG, frameCount);
+
+    unsigned long long allocationsBefore = g_heapAllocations;
+    bool isOK = true;
+    double maxFrameUs = 0;
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < frameCount; i++)
+    {
+        Frame frame = Frame::fromBuffer(pool.acquireBuffer(), width, height, POA_RAW8, POA_BAYER_RG);
+        frame.timestampUs = 1700000000000000LL + i * 2000LL;
+        frame.seq = i + 1;
+
+        std::chrono::steady_clock::time_point frameBeginTime = std::chrono::steady_clock::now();
+        isOK = serWriter.write(frame) && isOK;
+        maxFrameUs = std::max(maxFrameUs, elapsedUs(frameBeginTime));
+    }
+    double writeUs = elapsedUs(beginTime);
+    unsigned long long allocations = g_heapAllocations - allocationsBefore;
+
+    beginTime = std::chrono::steady_clock::now();
+    isOK = serWriter.close() && isOK;
+    double closeUs = elapsedUs(beginTime);
+
+    // check the size, the frame count of the header and the last timestamp
+    std::ifstream inFile(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+    size_t size = (size_t)inFile.tellg();
+    int headerFrameCount = 0;
+    long long lastTime = 0;
+    inFile.seekg(38);
+    inFile.read((char *)&headerFrameCount, sizeof(headerFrameCount));
+    inFile.seekg(size - sizeof(lastTime));
+    inFile.read((char *)&lastTime, sizeof(lastTime));
+    inFile.close();
+
+    long long expectedTime = (1700000000000000LL + (frameCount - 1) * 2000LL) * 10 + 621355968000000000LL;
+    isOK = isOK && headerFrameCount == frameCount && lastTime == expectedTime
+            && size == SerWriter::HEADER_BYTES + (size_t)frameCount * (width * height + sizeof(long long));
+
+    std::cout << frameCount << " frames: " << std::setprecision(0) << frameCount * 1000000.0 / writeUs << " fps, "
+              << (double)frameCount * width * height / writeUs << " MB/s, slowest frame " << std::setprecision(2) << maxFrameUs / 1000
+              << " ms, close " << closeUs / 1000 << " ms, allocations while writing: " << allocations << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+    std::cout << "(the writes go to the page cache first, the sustained rate is the one of the drive)" << std::endl;
+
+    std::remove(fileName);
+}
+
+// a disk that takes 0.5ms per frame and stalls 40ms every 250 frames
+static bool slowDiskWrite(const Frame &frame)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(frame.seq % 250 == 0 ? 40000 : 500));
+    return true;
+}
+
+// 500 fps for 2 seconds, return the frames the producer was late for(more than a frame period behind)
+static int runProducer(std::vector<unsigned char> &pixels, AsyncWriter *pAsyncWriter)
+{
+    const int frameCount = 1000;
+    const std::chrono::microseconds period(2000);
+    int lateFrames = 0;
+
+    std::chrono::steady_clock::time_point nextTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < frameCount; i++)
+    {
+        nextTime += period;
+        std::this_thread::sleep_until(nextTime);
+
+        Frame frame = Frame::wrap(pixels.data(), 640, 480, 640, POA_RAW8, POA_BAYER_MONO);
+        frame.seq = i + 1;
+
+        if(pAsyncWriter)
+        {
+            pAsyncWriter->push(frame);
+        }
+        else
+        {
+            slowDiskWrite(frame); //the synchronous write in the capture loop
+        }
+
+        if(std::chrono::steady_clock::now() > nextTime + period)
+        {
+            lateFrames++;
+        }
+    }
+
+    return lateFrames;
+}
+
+static void benchAsyncWriter()
+{
+    std::cout << "---- write-behind(500 fps, a disk with a 40ms hiccup every 250 frames) ----" << std::endl;
+
+    std::vector<unsigned char> pixels(640 * 480);
+
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    int lateFrames = runProducer(pixels, nullptr);
+    std::cout << "synchronous: " << std::setprecision(2) << elapsedUs(beginTime) / 1e6 << " s, late frames " << lateFrames << std::endl;
+
+    const char *policyNames[3] = { "BLOCK", "DROP_OLDEST", "DROP_NEWEST" };
+    const int queueFrames[2] = { 32, 8 }; //32: rides out the hiccups, 8: too short, the policy decides
+
+    for(int q = 0; q < 2; q++)
+    {
+        for(int policy = AsyncWriter::BLOCK; policy <= AsyncWriter::DROP_NEWEST; policy++)
+        {
+            AsyncWriter asyncWriter;
+            asyncWriter.start([](const Frame &frame, int) { return slowDiskWrite(frame); }, queueFrames[q], 1, (AsyncWriter::FullPolicy)policy);
+
+            beginTime = std::chrono::steady_clock::now();
+            lateFrames = runProducer(pixels, &asyncWriter);
+            asyncWriter.stop();
+
+            AsyncWriterStats stats = asyncWriter.getStats();
+            std::cout << "queue " << std::setw(2) << stats.queueCapacity << " " << std::left << std::setw(12) << policyNames[policy] << std::right
+                      << std::setprecision(2) << elapsedUs(beginTime) / 1e6 << " s, late frames " << lateFrames
+                      << ", written " << stats.framesWritten << ", dropped " << stats.framesDropped << ", max depth " << stats.maxQueueDepth
+                      << ", stalls " << stats.stalls << "(" << std::setprecision(1) << stats.stallUs / 1000.0 << " ms)" << std::endl;
+        }
+    }
+}
+
+// the frames per second of the simulated camera through POACamera, for every render mode
+static void benchSimulator()
+{
+    std::cout << "---- simulated camera(free run, POACamera::getImageData) ----" << std::endl;
+
+    const POASimRender renders[] = {POA_SIM_RENDER_FULL, POA_SIM_RENDER_CACHED, POA_SIM_RENDER_NONE};
+    const char *renderNames[] = {"full", "cached", "none"};
+    const POASimScene scenes[] = {POA_SIM_STARS, POA_SIM_PLANET};
+    const char *sceneNames[] = {"stars", "planet"};
+
+    POACamera camera(0);
+    camera.openCamera();
+    camera.initCamera();
+    camera.setExposure(1000, false);
+
+    for(int format = 0; format < 2; format++)
+    {
+        bool isRaw16 = format == 1;
+        camera.setImageBin(1);
+        if(!isRaw16)
+        {
+            camera.setImageSize(640, 480);
+        }
+        camera.setImageFormat(isRaw16 ? POACamera::RAW16 : POACamera::RAW8);
+        unsigned long frameBytes = camera.getFrameBytes();
+        std::vector<unsigned char> buffer(frameBytes);
+
+        for(int scene = 0; scene < 2; scene++)
+        {
+            for(int render = 0; render < 3; render++)
+            {
+                POASimSettings settings;
+                POASimGetSettings(0, &settings);
+                settings.scene = scenes[scene];
+                settings.render = renders[render];
+                POASimSetSettings(0, &settings);
+
+                camera.startExposure();
+                camera.getImageData(buffer.data(), frameBytes); //the scene is built
+
+                int frameCount = 0;
+                std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+                while(elapsedUs(beginTime) < 500000.0)
+                {
+                    frameCount += camera.getImageData(buffer.data(), frameBytes) ? 1 : 0;
+                }
+                double fps = frameCount / (elapsedUs(beginTime) / 1000000.0);
+                camera.stopExposure();
+
+                std::cout << (isRaw16 ? "1920x1080 RAW16 " : "640x480 RAW8    ") << std::setw(6) << sceneNames[scene] << " "
+                          << std::setw(6) << renderNames[render] << ": " << std::setprecision(0) << std::setw(8) << fps << " fps";
+                if(renders[render] != POA_SIM_RENDER_NONE) //the pixels are not written
+                {
+                    std::cout << ", " << std::setprecision(1) << fps * frameBytes / 1e6 << " MB/s";
+                }
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    camera.closeCamera();
+}
+
+// capture the frames of a scene of the simulated camera
+static void captureSimFrames(POACamera &camera, POASimScene scene, long exposureUs, int frameCount, std::vector<std::vector<unsigned char> > &frames)
+{
+    POASimSettings settings;
+    POASimGetSettings(0, &settings);
+    settings.scene = scene;
+    settings.render = POA_SIM_RENDER_FULL;
+    POASimSetSettings(0, &settings);
+
+    camera.setExposure(exposureUs, false);
+    camera.startExposure();
+    unsigned long frameBytes = camera.getFrameBytes();
+    frames.assign(frameCount, std::vector<unsigned char>(frameBytes));
+    for(int i = 0; i < frameCount; i++)
+    {
+        camera.getImageData(frames[i].data(), frameBytes);
+    }
+    camera.stopExposure();
+}
+
+static Frame wrapSimFrame(std::vector<unsigned char> &pixels, int width, int height, long exposureUs)
+{
+    Frame frame = Frame::wrap(pixels.data(), width, height, (size_t)width * 2, POA_RAW16, POA_BAYER_RG);
+    frame.bin = 1;
+    frame.exposureUs = exposureUs;
+    return frame;
+}
+
+// master bias, dark and flat from the simulated camera: the time per frame, the memory and the rejection of the cosmic rays
+static void benchCalibration()
+{
+    std::cout << "---- calibration masters(640x480 RAW16, 48 frames, 1% of the frames hit by cosmic rays) ----" << std::endl;
+
+    const int width = 640;
+    const int height = 480;
+    const int frameCount = 48;
+    const long darkExposureUs = 30000000;
+
+    POACamera camera(0);
+    camera.openCamera();
+    camera.initCamera();
+    camera.setImageBin(1);
+    camera.setImageSize(width, height);
+    camera.setImageFormat(POACamera::RAW16);
+
+    std::vector<std::vector<unsigned char> > frames;
+    captureSimFrames(camera, POA_SIM_DARK, darkExposureUs, frameCount, frames);
+
+    // the reference: the mean of the clean frames
+    std::vector<double> reference((size_t)width * height, 0.0);
+    for(int i = 0; i < frameCount; i++)
+    {
+        const unsigned short *pPixels = (const unsigned short *)frames[i].data();
+        for(size_t p = 0; p < reference.size(); p++)
+        {
+            reference[p] += pPixels[p] / (double)frameCount;
+        }
+    }
+
+    // the cosmic rays: saturated pixels in 1% of the pixels of every frame
+    std::mt19937 random(7);
+    std::vector<unsigned char> isHit(reference.size(), 0);
+    for(int i = 0; i < frameCount; i++)
+    {
+        unsigned short *pPixels = (unsigned short *)frames[i].data();
+        for(size_t n = 0; n < reference.size() / 100; n++)
+        {
+            size_t p = random() % reference.size();
+            pPixels[p] = 65535;
+            isHit[p] = 1;
+        }
+    }
+
+    const CombineMethod methods[] = {COMBINE_MEAN, COMBINE_MEDIAN, COMBINE_KAPPA_SIGMA};
+    const char *methodNames[] = {"mean", "median", "kappa-sigma"};
+    const double frameBytes = (double)width * height * 2;
+
+    CalibrationBuilder builder;
+    for(int m = 0; m < 3; m++)
+    {
+        MasterFrame master;
+        double bestUs = 1e30;
+        for(int run = 0; run < 3; run++)
+        {
+            std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+            builder.start(CALIB_DARK, methods[m], camera);
+            for(int i = 0; i < frameCount; i++)
+            {
+                builder.addFrame(wrapSimFrame(frames[i], width, height, darkExposureUs));
+            }
+            size_t memoryBytes = builder.memoryBytes();
+            builder.finish(master, &camera);
+            double us = elapsedUs(beginTime);
+            if(us < bestUs)
+            {
+                bestUs = us;
+            }
+            if(run == 0)
+            {
+                std::cout << std::left << std::setw(12) << methodNames[m] << std::right << ": memory " << std::setprecision(1)
+                          << memoryBytes / frameBytes << " frames";
+            }
+        }
+
+        // the error against the clean mean, the hit pixels and the others
+        double sumSquares = 0.0;
+        double hitError = 0.0;
+        size_t hitCount = 0;
+        for(size_t p = 0; p < reference.size(); p++)
+        {
+            double error = master.data[p] - reference[p];
+            if(isHit[p])
+            {
+                hitError += std::fabs(error);
+                hitCount++;
+            }
+            else
+            {
+                sumSquares += error * error;
+            }
+        }
+
+        std::cout << ", " << std::setprecision(2) << bestUs / 1000.0 / frameCount << " ms/frame"
+                  << ", rms error " << std::setprecision(1) << std::sqrt(sumSquares / (reference.size() - hitCount))
+                  << " ADU, mean error of the hit pixels " << hitError / hitCount << " ADU"
+                  << ", rejected " << builder.rejectedSamples() << std::endl;
+    }
+
+    // a flat with its bias
+    MasterFrame bias;
+    captureSimFrames(camera, POA_SIM_DARK, 1000, 16, frames);
+    builder.start(CALIB_BIAS, COMBINE_MEDIAN, camera);
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        builder.addFrame(wrapSimFrame(frames[i], width, height, 1000));
+    }
+    builder.finish(bias, &camera);
+
+    MasterFrame flat;
+    captureSimFrames(camera, POA_SIM_FLAT, 10000, 16, frames);
+    builder.setBiasMaster(&bias);
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    builder.start(CALIB_FLAT, COMBINE_KAPPA_SIGMA, camera);
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        builder.addFrame(wrapSimFrame(frames[i], width, height, 10000));
+    }
+    builder.finish(flat, &camera);
+    double flatUs = elapsedUs(beginTime);
+    builder.setBiasMaster(nullptr);
+
+    float minFlat = *std::min_element(flat.data.begin(), flat.data.end());
+    float maxFlat = *std::max_element(flat.data.begin(), flat.data.end());
+    std::cout << "flat(kappa-sigma, bias subtracted): " << std::setprecision(2) << flatUs / 1000.0 / frames.size() << " ms/frame, "
+              << std::setprecision(3) << "range " << minFlat << " - " << maxFlat << std::endl;
+    std::cout << "tags: exposure " << flat.tags.exposureUs << " us, gain " << flat.tags.gain << ", offset " << flat.tags.offset
+              << ", bin " << flat.tags.bin << ", temperature " << std::setprecision(1) << flat.tags.temperature
+              << ", sensor mode " << flat.tags.sensorMode << ", frames " << flat.tags.frameCount << std::endl;
+
+    camera.closeCamera();
+}
+
+// the calibration as separate passes over the frame with the float masters, the baseline of the fused kernel
+static void calibrateByPasses(uint16_t *pFrame, const MasterFrame &bias, const MasterFrame &thermal, const MasterFrame &flat,
+                              float darkScale, const std::vector<DefectPixel> &defects, int width)
+{
+    size_t count = flat.data.size();
+    for(size_t i = 0; i < count; i++)
+    {
+        pFrame[i] = (uint16_t)std::min(std::max(std::lrint(pFrame[i] - thermal.data[i] * darkScale), 0L), 65535L);
+    }
+    for(size_t i = 0; i < count; i++)
+    {
+        pFrame[i] = (uint16_t)std::min(std::max(std::lrint(pFrame[i] - bias.data[i]), 0L), 65535L);
+    }
+    for(size_t i = 0; i < count; i++)
+    {
+        pFrame[i] = (uint16_t)std::min(std::max(std::lrint(pFrame[i] / flat.data[i]), 0L), 65535L);
+    }
+    for(size_t d = 0; d < defects.size(); d++) //the mean of the pixels 2 away, the red and blue way
+    {
+        size_t i = (size_t)defects[d].y * width + defects[d].x;
+        pFrame[i] = (uint16_t)((pFrame[i - 2] + pFrame[i + 2] + pFrame[i - 2 * width] + pFrame[i + 2 * width]) / 4);
+    }
+}
+
+// the fused calibration(dark, bias, flat, defects) of a 26M pixel RAW16 frame, against the passes and the memory speed
+static void benchCalibrator()
+{
+    std::cout << "---- fused calibration(6248x4176 RAW16, best SIMD level: " << CpuFeatures::levelName(Calibrator::bestLevel()) << ") ----" << std::endl;
+
+    const int width = 6248;
+    const int height = 4176;
+    const size_t count = (size_t)width * height;
+    const float darkScale = 0.5f; //the frames have half the exposure of the dark
+
+    MasterFrame bias, dark, flat, thermal;
+    bias.width = dark.width = flat.width = thermal.width = width;
+    bias.height = dark.height = flat.height = thermal.height = height;
+    bias.data.resize(count);
+    dark.data.resize(count);
+    flat.data.resize(count);
+    std::mt19937 random(99);
+    std::uniform_real_distribution<float> noise(-8.0f, 8.0f);
+    for(int y = 0; y < height; y++)
+    {
+        for(int x = 0; x < width; x++)
+        {
+            size_t i = (size_t)y * width + x;
+            float dx = (x - width / 2) / (float)width;
+            float dy = (y - height / 2) / (float)height;
+            bias.data[i] = 480.0f + noise(random);
+            dark.data[i] = bias.data[i] + 160.0f + noise(random);
+            flat.data[i] = 1.2f - (dx * dx + dy * dy) * 1.5f;
+        }
+    }
+    std::vector<DefectPixel> hotPixels;
+    for(int n = 0; n < 2000; n++) //hot pixels, not at the borders
+    {
+        DefectPixel defect = { 2 + (int)(random() % (width - 4)), 2 + (int)(random() % (height - 4)) };
+        dark.data[(size_t)defect.y * width + defect.x] += 20000.0f;
+        hotPixels.push_back(defect);
+    }
+    thermal.data = dark.data;
+    for(size_t i = 0; i < count; i++)
+    {
+        thermal.data[i] -= bias.data[i];
+    }
+
+    std::vector<uint16_t> raw(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        raw[i] = (uint16_t)std::min(60000.0f, 8000.0f * flat.data[i] + dark.data[i] * darkScale + (bias.data[i] - bias.data[i] * darkScale) + noise(random) * 4);
+    }
+
+    Calibrator calibrator;
+    calibrator.prepare(&bias, &dark, &flat);
+    calibrator.setDarkScale(darkScale);
+    calibrator.setDefects(Calibrator::findDefects(&bias, &dark, &flat));
+    std::cout << "defects found: " << calibrator.getDefects().size() << " of " << hotPixels.size() << " hot pixels" << std::endl;
+
+    std::vector<uint16_t> output(count);
+    std::vector<uint16_t> reference(count);
+    Frame rawFrame = Frame::wrap((unsigned char *)raw.data(), width, height, width * 2, POA_RAW16, POA_BAYER_RG);
+    Frame referenceFrame = Frame::wrap((unsigned char *)reference.data(), width, height, width * 2, POA_RAW16, POA_BAYER_RG);
+    Frame outputFrame = Frame::wrap((unsigned char *)output.data(), width, height, width * 2, POA_RAW16, POA_BAYER_RG);
+
+    calibrator.apply(rawFrame, referenceFrame, SIMD_SCALAR);
+
+    // the hot pixels get the level of their neighbours: about 8000
+    double hotError = 0.0;
+    for(size_t n = 0; n < hotPixels.size(); n++)
+    {
+        hotError += std::fabs(reference[(size_t)hotPixels[n].y * width + hotPixels[n].x] - 8000.0);
+    }
+    std::cout << "mean error of the hot pixels " << std::setprecision(1) << hotError / hotPixels.size() << " ADU" << std::endl;
+
+    const int frameCount = 5;
+    double bytes = (double)count * 4 + calibrator.planeBytes(); //the frame read and written, the planes read
+
+    // the memory speed: a copy of the same bytes(read + write)
+    std::vector<unsigned char> copySrc((size_t)(bytes / 2)), copyDst((size_t)(bytes / 2));
+    double copyUs = 1e30;
+    for(int i = 0; i < frameCount; i++)
+    {
+        std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+        std::memcpy(copyDst.data(), copySrc.data(), copySrc.size());
+        copyUs = std::min(copyUs, elapsedUs(beginTime));
+    }
+    std::cout << "memcpy:     " << std::setprecision(2) << copyUs / 1000 << " ms, " << std::setprecision(1) << bytes / copyUs / 1000 << " GB/s" << std::endl;
+
+    double passesUs = 1e30;
+    for(int i = 0; i < frameCount; i++)
+    {
+        std::memcpy(output.data(), raw.data(), count * 2);
+        std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+        calibrateByPasses(output.data(), bias, thermal, flat, darkScale, hotPixels, width);
+        passesUs = std::min(passesUs, elapsedUs(beginTime));
+    }
+    std::cout << "4 passes:   " << std::setprecision(2) << passesUs / 1000 << " ms/frame(float masters)" << std::endl;
+
+    for(int level = SIMD_SCALAR; level < SIMD_LEVEL_COUNT; level++)
+    {
+        if(!Calibrator::isAvailable((SimdLevel)level))
+        {
+            continue;
+        }
+
+        double us = 1e30;
+        for(int i = 0; i < frameCount; i++)
+        {
+            std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+            calibrator.apply(rawFrame, outputFrame, (SimdLevel)level);
+            us = std::min(us, elapsedUs(beginTime));
+        }
+
+        int maxDiff = 0;
+        for(size_t i = 0; i < count; i++)
+        {
+            maxDiff = std::max(maxDiff, std::abs((int)output[i] - (int)reference[i]));
+        }
+
+        std::cout << "fused " << std::left << std::setw(8) << CpuFeatures::levelName((SimdLevel)level) << std::right
+                  << std::setprecision(2) << us / 1000 << " ms/frame, " << std::setprecision(1) << bytes / us / 1000 << " GB/s"
+                  << ", max difference to scalar " << maxDiff << (checked(maxDiff == 0) ? " (OK)" : " (FAILED)") << std::endl;
+    }
+
+    // in place, the frame of the capture is calibrated without another buffer
+    std::memcpy(output.data(), raw.data(), count * 2);
+    calibrator.apply(outputFrame, outputFrame);
+    int maxDiff = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        maxDiff = std::max(maxDiff, std::abs((int)output[i] - (int)reference[i]));
+    }
+    std::cout << "in place: max difference to scalar " << maxDiff << (checked(maxDiff == 0) ? " (OK)" : " (FAILED)") << std::endl;
+}
+
+static MasterFrame darkLibraryMaster(CalibrationType type, int width, int height, long exposureUs, long gain, int bin, int sensorMode, double temperature)
+{
+    MasterFrame master;
+    master.type = type;
+    master.width = width;
+    master.height = height;
+    master.tags.exposureUs = exposureUs;
+    master.tags.gain = gain;
+    master.tags.offset = 10;
+    master.tags.bin = bin;
+    master.tags.sensorMode = sensorMode;
+    master.tags.imgFormat = POA_RAW16;
+    master.tags.bayerPattern = POA_BAYER_RG;
+    master.tags.width = width;
+    master.tags.height = height;
+    master.tags.hasTemperature = true;
+    master.tags.temperature = temperature;
+    master.tags.frameCount = 32;
+
+    // the bias is 500, the dark current doubles every 5C: 1 ADU per second at -10C
+    float level = 500.0f;
+    if(type == CALIB_DARK)
+    {
+        level += (float)(exposureUs / 1e6 * std::pow(2.0, (temperature + 10.0) / 5.0));
+    }
+    master.data.assign((size_t)width * height, level);
+
+    return master;
+}
+
+static void benchDarkLibrary()
+{
+    std::cout << "---- dark library(2160 masters, indexed by exposure, gain, bin, sensor mode and temperature) ----" << std::endl;
+
+    const char *directory = "benchmark_darks";
+    const long exposures[] = { 1000000, 2000000, 5000000, 10000000, 30000000, 60000000, 120000000, 300000000 };
+    const double temperatures[] = { -20.0, -15.0, -10.0, -5.0, 0.0 };
+
+    DarkLibrary library;
+    library.open(directory);
+
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    for(long gain = 0; gain < 600; gain += 50)
+    {
+        for(int bin = 1; bin <= 2; bin++)
+        {
+            for(int sensorMode = 0; sensorMode < 2; sensorMode++)
+            {
+                for(int t = 0; t < 5; t++)
+                {
+                    library.add(darkLibraryMaster(CALIB_BIAS, 64, 48, 1, gain, bin, sensorMode, temperatures[t]));
+                    for(int e = 0; e < 8; e++)
+                    {
+                        library.add(darkLibraryMaster(CALIB_DARK, 64, 48, exposures[e], gain, bin, sensorMode, temperatures[t]));
+                    }
+                }
+            }
+        }
+    }
+    std::cout << "add " << library.size() << " masters: " << std::setprecision(0) << elapsedUs(beginTime) / 1000 << " ms" << std::endl;
+
+    // the index of a new session
+    double openUs = 1e30;
+    for(int i = 0; i < 5; i++)
+    {
+        DarkLibrary reopened;
+        beginTime = std::chrono::steady_clock::now();
+        reopened.open(directory);
+        openUs = std::min(openUs, elapsedUs(beginTime));
+    }
+
+    DarkLibrary session;
+    session.open(directory);
+    std::cout << "load the index: " << std::setprecision(2) << openUs / 1000 << " ms, " << session.size() << " records" << std::endl;
+
+    // random lookups, every one maps its master and unmaps it
+    std::mt19937 random(2024);
+    const int findCount = 10000;
+    int foundCount = 0;
+    beginTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < findCount; i++)
+    {
+        DarkQuery query;
+        query.exposureUs = exposures[random() % 8];
+        query.gain = (long)(random() % 12) * 50;
+        query.offset = 10;
+        query.bin = 1 + (int)(random() % 2);
+        query.sensorMode = (int)(random() % 2);
+        query.imgFormat = POA_RAW16;
+        query.width = 64;
+        query.height = 48;
+        query.hasTemperature = true;
+        query.temperature = temperatures[random() % 5] + (random() % 200) / 100.0 - 1.0;
+        foundCount += session.find(query).isValid() ? 1 : 0;
+    }
+    std::cout << "find: " << std::setprecision(1) << elapsedUs(beginTime) / findCount << " us per lookup, "
+              << foundCount << " of " << findCount << " found" << (checked(foundCount == findCount) ? " (OK)" : " (FAILED)") << std::endl;
+
+    // the nearest temperature, the band, the scaled exposure
+    DarkQuery query;
+    query.exposureUs = 30000000;
+    query.gain = 100;
+    query.offset = 10;
+    query.bin = 1;
+    query.sensorMode = 0;
+    query.imgFormat = POA_RAW16;
+    query.width = 64;
+    query.height = 48;
+    query.hasTemperature = true;
+    query.temperature = -8.9;
+    DarkMatch match = session.find(query);
+    bool isOK = match.isValid() && match.dark->tags().temperature == -10.0 && match.dark->data()[0] == 530.0f && !match.bias;
+    std::cout << "30 s at -8.9C: the dark of " << (match.isValid() ? match.dark->tags().temperature : 0.0) << "C" << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+
+    query.temperature = -12.6;
+    isOK = !session.find(query).isValid();
+    std::cout << "30 s at -12.6C: no dark in the band" << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+
+    query.temperature = -10.0;
+    query.exposureUs = 20000000;
+    query.allowScaling = true;
+    match = session.find(query);
+    isOK = match.isValid() && match.bias && match.dark->tags().exposureUs == 30000000 && std::fabs(match.darkScale - 2.0 / 3.0) < 1e-6;
+    std::cout << "20 s, scaled: the dark of " << std::setprecision(0) << (match.isValid() ? match.dark->tags().exposureUs / 1e6 : 0.0)
+              << " s, scale " << std::setprecision(3) << match.darkScale << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+
+    // a full frame master: mapping it is immediate, the pages are read when they are used
+    const int width = 6248;
+    const int height = 4176;
+    const size_t count = (size_t)width * height;
+    MasterFrame bigBias = darkLibraryMaster(CALIB_BIAS, width, height, 1, 125, 1, 0, -10.0);
+    MasterFrame bigDark = darkLibraryMaster(CALIB_DARK, width, height, 60000000, 125, 1, 0, -10.0);
+    session.add(bigBias);
+    session.add(bigDark);
+
+    query.gain = 125;
+    query.width = width;
+    query.height = height;
+    query.exposureUs = 30000000;
+    beginTime = std::chrono::steady_clock::now();
+    match = session.find(query);
+    double findUs = elapsedUs(beginTime);
+
+    beginTime = std::chrono::steady_clock::now();
+    double sum = 0.0;
+    for(size_t i = 0; i < count; i += 1024) //a float of every page
+    {
+        sum += match.dark->data()[i] + match.bias->data()[i];
+    }
+    double touchUs = elapsedUs(beginTime);
+    std::cout << "26M pixels master: find and map " << std::setprecision(2) << findUs / 1000 << " ms, first touch of the pages "
+              << touchUs / 1000 << " ms (" << (sum > 0.0 ? "read" : "empty") << ")" << std::endl;
+
+    // calibrate with the mapped masters: 30 s is half the dark of 60 s
+    Calibrator calibrator;
+    calibrator.prepare(match.bias->data(), match.dark->data(), nullptr, width, height);
+    calibrator.setDarkScale(match.darkScale);
+    std::vector<uint16_t> raw(count, (uint16_t)(500 + 60 * 0.5 + 1000));
+    Frame rawFrame = Frame::wrap((unsigned char *)raw.data(), width, height, width * 2, POA_RAW16, POA_BAYER_RG);
+    calibrator.apply(rawFrame, rawFrame);
+    isOK = raw[0] == 1000 && raw[count - 1] == 1000;
+    std::cout << "calibrated with the scaled dark: " << raw[0] << " ADU, 1000 expected" << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+
+    match = DarkMatch();
+    const std::vector<DarkLibrary::Record> &records = session.getRecords();
+    for(size_t i = 0; i < records.size(); i++)
+    {
+        char name[64];
+        std::snprintf(name, sizeof(name), "%s/master_%08u.mst", directory, records[i].fileID);
+        std::remove(name);
+    }
+    std::remove((std::string(directory) + "/index.bin").c_str());
+    rmdir(directory);
+}
+
+struct SyntheticStar
+{
+    double x;
+    double y;
+    double flux;
+};
+
+// a RAW16 RG frame of the stars moved by the rotation(about the center) and the shift, the truth maps the reference to the frame
+static void renderStarFrame(std::vector<uint16_t> &raw, int width, int height, const std::vector<SyntheticStar> &stars,
+                            double angleDegrees, double shiftX, double shiftY, unsigned int seed, StackTransform &truth, double sigma = 1.6)
+{
+    double angle = angleDegrees * 3.14159265358979323846 / 180.0;
+    truth.a = truth.d = std::cos(angle);
+    truth.c = std::sin(angle);
+    truth.b = -truth.c;
+    truth.tx = width / 2.0 + shiftX - truth.a * width / 2.0 - truth.b * height / 2.0;
+    truth.ty = height / 2.0 + shiftY - truth.c * width / 2.0 - truth.d * height / 2.0;
+
+    unsigned int state = seed * 2654435761u + 1;
+    for(size_t i = 0; i < raw.size(); i++) //the sky and the noise(xorshift, uniform +-16)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        raw[i] = (uint16_t)(1200 + (state & 31) - 16);
+    }
+
+    const float colorGain[4] = { 0.7f, 1.0f, 1.0f, 0.5f }; //R G / G B
+    const int radius = std::max(6, (int)(4.0 * sigma)); //pixels around the star
+    for(size_t n = 0; n < stars.size(); n++)
+    {
+        double x = truth.a * stars[n].x + truth.b * stars[n].y + truth.tx;
+        double y = truth.c * stars[n].x + truth.d * stars[n].y + truth.ty;
+        int cx = (int)x;
+        int cy = (int)y;
+        if(cx < radius + 2 || cy < radius + 2 || cx >= width - radius - 2 || cy >= height - radius - 2)
+        {
+            continue;
+        }
+        for(int py = cy - radius; py <= cy + radius; py++)
+        {
+            for(int px = cx - radius; px <= cx + radius; px++)
+            {
+                double r2 = ((px + 0.5 - x) * (px + 0.5 - x) + (py + 0.5 - y) * (py + 0.5 - y)) / (2 * sigma * sigma);
+                uint16_t &pixel = raw[(size_t)py * width + px];
+                pixel = (uint16_t)std::min(65535.0, pixel + stars[n].flux * colorGain[(py & 1) * 2 + (px & 1)] * std::exp(-r2));
+            }
+        }
+    }
+}
+
+static void benchLiveStacker()
+{
+    const int width = 6248;
+    const int height = 4176;
+    LiveStacker stacker;
+
+    std::cout << "---- live stacking(6248x4176 RAW16 color, 1500 stars, " << std::thread::hardware_concurrency() << " cores) ----" << std::endl;
+
+    std::mt19937 random(77);
+    std::vector<SyntheticStar> stars(1500);
+    for(size_t n = 0; n < stars.size(); n++)
+    {
+        stars[n].x = 20 + random() % (width - 40) + (random() % 1000) / 1000.0;
+        stars[n].y = 20 + random() % (height - 40) + (random() % 1000) / 1000.0;
+        stars[n].flux = 200.0 + 20000.0 * std::pow((random() % 1000 + 1) / 1000.0, 4.0);
+    }
+
+    // the drift of a mount, the field rotation of an alt-az mount
+    const double motion[][3] = { { 0.0, 0.0, 0.0 }, { 0.02, 3.4, -1.7 }, { 0.05, 7.9, -3.2 }, { 0.09, 11.6, -5.3 }, { 0.12, 15.2, -7.1 }, { -0.3, 40.0, 25.0 } };
+    std::vector<uint16_t> raw((size_t)width * height);
+    for(int i = 0; i < 6; i++)
+    {
+        StackTransform truth;
+        renderStarFrame(raw, width, height, stars, motion[i][0], motion[i][1], motion[i][2], i + 1, truth);
+        Frame frame = Frame::wrap((unsigned char *)raw.data(), width, height, width * 2, POA_RAW16, POA_BAYER_RG);
+        frame.seq = i + 1;
+
+        bool isStacked = stacker.addFrame(frame);
+        const StackFrameStats &stats = stacker.getLastStats();
+
+        // the error of the transform: the largest at the corners
+        double maxError = 0.0;
+        for(int corner = 0; corner < 4; corner++)
+        {
+            double x = (corner & 1) ? width : 0.0;
+            double y = (corner & 2) ? height : 0.0;
+            double dx = (stats.transform.a - truth.a) * x + (stats.transform.b - truth.b) * y + stats.transform.tx - truth.tx;
+            double dy = (stats.transform.c - truth.c) * x + (stats.transform.d - truth.d) * y + stats.transform.ty - truth.ty;
+            maxError = std::max(maxError, std::sqrt(dx * dx + dy * dy));
+        }
+
+        bool isOK = isStacked && maxError < 0.3;
+        std::cout << "frame " << frame.seq << ": stars " << stats.starCount << ", matched " << stats.matchCount
+                  << std::setprecision(3) << ", rotation " << stats.transform.rotationDegrees() << " deg, rms " << stats.rmsError
+                  << " px, corner error " << maxError << " px" << std::setprecision(1) << ", detect " << stats.detectUs / 1000
+                  << " ms, register " << stats.registerUs / 1000 << " ms, warp " << stats.warpUs / 1000 << " ms, total "
+                  << stats.totalUs / 1000 << " ms" << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+    }
+
+    // the stack is sharp where the frames covered it: a star of the reference keeps its peak
+    std::vector<float> image;
+    stacker.getStack(image);
+    const StackStar &brightest = stacker.getReferenceStars()[0];
+    size_t center = ((size_t)brightest.y * width + (size_t)brightest.x) * 3 + 1;
+    std::cout << "stacked " << stacker.getStackedCount() << " frames, rejected " << stacker.getRejectedCount()
+              << ", green peak of the brightest star " << std::setprecision(0) << image[center] << " ADU" << std::endl;
+}
+
+// blur the same color pixels of a bayer frame by a box of 2 * radius + 1
+static void blurBayer(const std::vector<unsigned char> &src, std::vector<unsigned char> &dst, int width, int height, int radius)
+{
+    dst = src;
+    for(int y = 0; y < height; y++)
+    {
+        for(int x = 0; x < width; x++)
+        {
+            int sum = 0, count = 0;
+            for(int dy = -radius; dy <= radius; dy++)
+            {
+                for(int dx = -radius; dx <= radius; dx++)
+                {
+                    int sx = x + dx * 2;
+                    int sy = y + dy * 2;
+                    if(sx >= 0 && sy >= 0 && sx < width && sy < height)
+                    {
+                        sum += src[(size_t)sy * width + sx];
+                        count++;
+                    }
+                }
+            }
+            dst[(size_t)y * width + x] = (unsigned char)((sum + count / 2) / count);
+        }
+    }
+}
+
+static void benchLuckyImaging()
+{
+    std::cout << "---- lucky imaging(640x480 RAW8 planet, 500 fps needed) ----" << std::endl;
+
+    const int width = 640;
+    const int height = 480;
+    const QualityMetric metrics[] = { QUALITY_LAPLACIAN, QUALITY_GRADIENT, QUALITY_LOCAL_CONTRAST };
+    const char *metricNames[] = { "laplacian     ", "gradient      ", "local contrast" };
+
+    POASimSettings savedSettings;
+    POASimGetSettings(0, &savedSettings);
+    POASimSettings settings = savedSettings;
+    settings.seeing = 0.0;
+    settings.seeingBlur = 0.0;
+    POASimSetSettings(0, &settings);
+
+    POACamera camera(0);
+    camera.openCamera();
+    camera.initCamera();
+    camera.setImageBin(1);
+    camera.setImageSize(width, height);
+    camera.setImageFormat(POACamera::RAW8);
+    POACameraProperties cameraProp;
+    camera.getCameraProperties(cameraProp);
+
+    std::vector<std::vector<unsigned char> > sharpFrames;
+    captureSimFrames(camera, POA_SIM_PLANET, 10000, 1, sharpFrames);
+
+    // the score must fall with the blur
+    std::vector<std::vector<unsigned char> > blurred(4);
+    for(int radius = 0; radius < 4; radius++)
+    {
+        blurBayer(sharpFrames[0], blurred[radius], width, height, radius);
+    }
+
+    FrameQuality quality;
+    for(int m = 0; m < 3; m++)
+    {
+        quality.setMetric(metrics[m]);
+        std::cout << metricNames[m] << ": blur 0-3:" << std::setprecision(4);
+        bool isFalling = true;
+        double lastScore = 1e300;
+        for(int radius = 0; radius < 4; radius++)
+        {
+            Frame frame = Frame::wrap(blurred[radius].data(), width, height, width, POA_RAW8, cameraProp.bayerPattern);
+            double score = quality.score(frame);
+            isFalling = isFalling && score < lastScore;
+            lastScore = score;
+            std::cout << " " << score;
+        }
+        std::cout << (checked(isFalling) ? " (OK)" : " (FAILED: not falling)") << std::endl;
+    }
+
+    // the speed of every level, the disc tracking scores a box around the planet, the SIMD levels must keep 500 fps(the
+    // scalar code is the reference)
+    Frame sharp = Frame::wrap(sharpFrames[0].data(), width, height, width, POA_RAW8, cameraProp.bayerPattern);
+    quality.setMetric(QUALITY_LAPLACIAN);
+    for(int tracking = 0; tracking < 2; tracking++)
+    {
+        quality.setDiscTracking(tracking == 1);
+        double reference = quality.score(sharp, SIMD_SCALAR);
+        for(int level = SIMD_SCALAR; level < SIMD_LEVEL_COUNT; level++)
+        {
+            if(!FrameQuality::isAvailable((SimdLevel)level))
+            {
+                continue;
+            }
+
+            const int loopCount = 2000;
+            double score = 0.0;
+            std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+            for(int i = 0; i < loopCount; i++)
+            {
+                score = quality.score(sharp, (SimdLevel)level);
+            }
+            double us = elapsedUs(beginTime) / loopCount;
+            double difference = std::fabs(score - reference) / reference;
+
+            std::cout << (tracking ? "disc box   " : "full frame ") << std::left << std::setw(8) << CpuFeatures::levelName((SimdLevel)level)
+                      << std::right << std::setprecision(1) << us << " us/frame, " << std::setprecision(0) << 1e6 / us << " fps"
+                      << ", difference to scalar " << std::scientific << std::setprecision(1) << difference << std::fixed
+                      << (checked(difference < 1e-4 && (level == SIMD_SCALAR || 1e6 / us > 500)) ? " (OK)" : " (FAILED)") << std::endl;
+        }
+    }
+    const QualityDisc &disc = quality.getDisc();
+    std::cout << "disc: " << (disc.isFound ? "found" : "not found") << " at " << disc.centerX << ", " << disc.centerY << ", radius " << disc.radius << std::endl;
+
+    // a stream of frames with random seeing at 500 fps, the best 10% of every second go on
+    settings.seeingBlur = 2.0;
+    settings.seeing = 1.0;
+    POASimSetSettings(0, &settings);
+    std::vector<std::vector<unsigned char> > frames;
+    captureSimFrames(camera, POA_SIM_PLANET, 10000, 200, frames);
+    camera.closeCamera();
+    POASimSetSettings(0, &savedSettings);
+
+    const int streamFrames = 5000;
+    const long long frameUs = 2000;
+    const long long windowUs = 1000000;
+    std::vector<double> scores(streamFrames);
+    std::vector<unsigned long long> keptSeq;
+    std::vector<double> keptScores;
+
+    LuckySelector selector;
+    selector.getQuality().setDiscTracking(true);
+    selector.start([&keptSeq, &keptScores](const Frame &frame, double score)
+    {
+        keptSeq.push_back(frame.seq);
+        keptScores.push_back(score);
+    }, 10.0, windowUs, 100, (size_t)width * height);
+
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    for(int i = 0; i < streamFrames; i++)
+    {
+        Frame frame = Frame::wrap(frames[i % frames.size()].data(), width, height, width, POA_RAW8, cameraProp.bayerPattern);
+        frame.seq = i + 1;
+        frame.timestampUs = 1700000000000000LL + i * frameUs;
+        scores[i] = selector.push(frame);
+    }
+    selector.stop();
+    double fps = streamFrames / (elapsedUs(beginTime) / 1e6);
+
+    // the reference: the best 10% of the scores of every window(the frames repeat, so the scores are compared, not the seqs)
+    std::vector<double> expectedScores;
+    int windowFrames = (int)(windowUs / frameUs);
+    for(int begin = 0; begin < streamFrames; begin += windowFrames)
+    {
+        int end = std::min(begin + windowFrames, streamFrames);
+        std::vector<int> order;
+        for(int i = begin; i < end; i++)
+        {
+            order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&scores](int left, int right) { return scores[left] > scores[right]; });
+        order.resize((size_t)std::ceil((end - begin) * 0.1));
+        for(size_t i = 0; i < order.size(); i++)
+        {
+            expectedScores.push_back(scores[order[i]]);
+        }
+    }
+    std::sort(expectedScores.begin(), expectedScores.end());
+    bool isCaptureOrder = std::is_sorted(keptSeq.begin(), keptSeq.end());
+    std::sort(keptScores.begin(), keptScores.end());
+
+    LuckyStats stats = selector.getStats();
+    bool isOK = keptScores == expectedScores && isCaptureOrder && stats.framesDropped == 0;
+    std::cout << "selector: " << std::setprecision(0) << fps << " fps, scored " << stats.framesScored << ", kept " << stats.framesKept
+              << ", discarded " << stats.framesDiscarded << ", dropped " << stats.framesDropped << ", windows " << stats.windows
+              << ", score " << std::setprecision(1) << stats.avgScoreUs << " us(max " << stats.maxScoreUs << ")"
+              << (checked(isOK) ? " (OK)" : " (FAILED: not the best 10%)") << std::endl;
+}
+
+struct SyntheticBlob
+{
+    double x;
+    double y;
+    double sigma;
+    double amplitude;
+};
+
+// a lunar like RAW16 frame: gaussian blobs(craters and maria) moved by dx, dy, with a bayer mosaic if isBayer
+static void renderBlobFrame(std::vector<uint16_t> &raw, int width, int height, const std::vector<SyntheticBlob> &blobs,
+                            double dx, double dy, bool isBayer, unsigned int seed)
+{
+    std::vector<float> plane((size_t)width * height, 8000.0f);
+    for(size_t n = 0; n < blobs.size(); n++)
+    {
+        double x = blobs[n].x + dx;
+        double y = blobs[n].y + dy;
+        int reach = (int)(blobs[n].sigma * 4.0) + 1;
+        int xBegin = std::max(0, (int)x - reach), xEnd = std::min(width, (int)x + reach);
+        int yBegin = std::max(0, (int)y - reach), yEnd = std::min(height, (int)y + reach);
+        for(int py = yBegin; py < yEnd; py++)
+        {
+            for(int px = xBegin; px < xEnd; px++)
+            {
+                double r2 = ((px + 0.5 - x) * (px + 0.5 - x) + (py + 0.5 - y) * (py + 0.5 - y)) / (2 * blobs[n].sigma * blobs[n].sigma);
+                plane[(size_t)py * width + px] += (float)(blobs[n].amplitude * std::exp(-r2));
+            }
+        }
+    }
+
+    const float colorGain[4] = { 1.0f, 0.85f, 0.85f, 0.62f }; //R G / G B
+    unsigned int state = seed * 2654435761u + 1;
+    raw.resize((size_t)width * height);
+    for(int y = 0; y < height; y++)
+    {
+        for(int x = 0; x < width; x++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            float gain = isBayer ? colorGain[(y & 1) * 2 + (x & 1)] : 1.0f;
+            float value = plane[(size_t)y * width + x] * gain + (float)(state & 63) - 32.0f; //the noise, uniform +-32
+            raw[(size_t)y * width + x] = (uint16_t)std::min(65535.0f, std::max(0.0f, value));
+        }
+    }
+}
+
+static void benchPhaseCorrelation()
+{
+    std::cout << "---- FFT and phase correlation ----" << std::endl;
+
+    // the FFT against the DFT of the definition, a mixed radix size
+    const int dftWidth = 30;
+    const int dftHeight = 20;
+    std::vector<double> image((size_t)dftWidth * dftHeight);
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for(size_t i = 0; i < image.size(); i++)
+    {
+        image[i] = uniform(random);
+    }
+    for(int level = SIMD_SCALAR; level < SIMD_LEVEL_COUNT; level++)
+    {
+        RealFft2D fft;
+        if(!RealFft2D::isAvailable((SimdLevel)level) || !fft.setSimdLevel((SimdLevel)level) || !fft.init(dftWidth, dftHeight))
+        {
+            continue;
+        }
+        for(int y = 0; y < dftHeight; y++)
+        {
+            for(int x = 0; x < dftWidth; x++)
+            {
+                fft.inputRow(y)[x] = (float)image[(size_t)y * dftWidth + x];
+            }
+        }
+        fft.forward();
+
+        double maxError = 0.0;
+        for(int u = 0; u < dftWidth; u++)
+        {
+            for(int v = 0; v < fft.spectrumColumns(); v++)
+            {
+                double re = 0.0, im = 0.0;
+                for(int y = 0; y < dftHeight; y++)
+                {
+                    for(int x = 0; x < dftWidth; x++)
+                    {
+                        double angle = -2.0 * 3.14159265358979323846 * ((double)u * x / dftWidth + (double)v * y / dftHeight);
+                        re += image[(size_t)y * dftWidth + x] * std::cos(angle);
+                        im += image[(size_t)y * dftWidth + x] * std::sin(angle);
+                    }
+                }
+                maxError = std::max(maxError, std::max(std::fabs(re - fft.spectrumRe(u)[v]), std::fabs(im - fft.spectrumIm(u)[v])));
+            }
+        }
+
+        fft.inverse();
+        double maxRoundTrip = 0.0;
+        for(int y = 0; y < dftHeight; y++)
+        {
+            for(int x = 0; x < dftWidth; x++)
+            {
+                maxRoundTrip = std::max(maxRoundTrip, std::fabs(fft.inputRow(y)[x] / (dftWidth * dftHeight) - image[(size_t)y * dftWidth + x]));
+            }
+        }
+        std::cout << std::left << std::setw(8) << CpuFeatures::levelName((SimdLevel)level) << std::right << dftWidth << "x" << dftHeight
+                  << ": error to the DFT " << std::scientific << std::setprecision(1) << maxError << ", round trip " << maxRoundTrip << std::fixed
+                  << (checked(maxError < 1e-4 && maxRoundTrip < 1e-5) ? " (OK)" : " (FAILED)") << std::endl;
+    }
+
+    // forward + inverse of the tiles at every level
+    const int tileSizes[] = { 256, 512, 1024 };
+    for(int t = 0; t < 3; t++)
+    {
+        const int size = tileSizes[t];
+        for(int level = SIMD_SCALAR; level < SIMD_LEVEL_COUNT; level++)
+        {
+            RealFft2D fft;
+            if(!RealFft2D::isAvailable((SimdLevel)level) || !fft.setSimdLevel((SimdLevel)level) || !fft.init(size, size))
+            {
+                continue;
+            }
+            // the input is written again before every round trip, it's multiplied by size^2
+            const int loopCount = std::max(2, 4 * 1024 * 1024 / (size * size));
+            double totalUs = 0.0;
+            for(int i = 0; i < loopCount; i++)
+            {
+                for(int y = 0; y < size; y++)
+                {
+                    for(int x = 0; x < size; x++)
+                    {
+                        fft.inputRow(y)[x] = (float)((x * 7 + y * 13) % 31);
+                    }
+                }
+
+                std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+                fft.forward();
+                fft.inverse();
+                totalUs += elapsedUs(beginTime);
+            }
+            double ms = totalUs / 1000.0 / loopCount;
+
+            double maxError = 0.0;
+            for(int y = 0; y < size; y++)
+            {
+                for(int x = 0; x < size; x++)
+                {
+                    maxError = std::max(maxError, std::fabs(fft.inputRow(y)[x] / ((double)size * size) - (x * 7 + y * 13) % 31));
+                }
+            }
+            std::cout << std::left << std::setw(8) << CpuFeatures::levelName((SimdLevel)level) << std::right << size << "x" << size
+                      << ": forward + inverse " << std::setprecision(2) << ms << " ms, round trip error " << std::scientific
+                      << std::setprecision(1) << maxError << std::fixed << (checked(maxError < 1e-2) ? " (OK)" : " (FAILED)") << std::endl;
+        }
+    }
+
+    // sub-pixel shifts of a lunar like frame, mono and bayer, the whole frame and a view
+    const int width = 1280;
+    const int height = 1088;
+    std::vector<SyntheticBlob> blobs(1500);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for(size_t i = 0; i < blobs.size(); i++)
+    {
+        blobs[i].x = unit(random) * width;
+        blobs[i].y = unit(random) * height;
+        blobs[i].sigma = 1.5 + 10.0 * unit(random) * unit(random);
+        blobs[i].amplitude = (unit(random) - 0.4) * 6000.0;
+    }
+
+    std::vector<uint16_t> reference;
+    std::vector<uint16_t> moved;
+    for(int t = 0; t < 3; t++)
+    {
+        const int size = tileSizes[t];
+        for(int mode = 0; mode < 3; mode++) //mono, bayer, a view of the bayer frame
+        {
+            const bool isBayer = mode > 0;
+            POABayerPattern bayerPattern = isBayer ? POA_BAYER_RG : POA_BAYER_MONO;
+            PhaseCorrelator correlator;
+            correlator.init(size, size);
+            renderBlobFrame(reference, width, height, blobs, 0.0, 0.0, isBayer, 1);
+            Frame referenceFrame = Frame::wrap((unsigned char *)reference.data(), width, height, width * 2, POA_RAW16, bayerPattern);
+            if(mode == 2)
+            {
+                referenceFrame = referenceFrame.view(100, 40, size + 16, size + 16);
+            }
+            correlator.setReference(referenceFrame);
+
+            const int shiftCount = 10;
+            double maxError = 0.0, minPeak = 1.0, totalUs = 0.0;
+            for(int i = 0; i < shiftCount; i++)
+            {
+                double dx = (unit(random) - 0.5) * 16.0;
+                double dy = (unit(random) - 0.5) * 16.0;
+                renderBlobFrame(moved, width, height, blobs, dx, dy, isBayer, 2 + i);
+                Frame frame = Frame::wrap((unsigned char *)moved.data(), width, height, width * 2, POA_RAW16, bayerPattern);
+                if(mode == 2)
+                {
+                    frame = frame.view(100, 40, size + 16, size + 16);
+                }
+
+                PhaseShift shift;
+                std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+                correlator.align(frame, shift);
+                totalUs += elapsedUs(beginTime);
+                maxError = std::max(maxError, std::max(std::fabs(shift.dx - dx), std::fabs(shift.dy - dy)));
+                minPeak = std::min(minPeak, shift.peak);
+            }
+
+            const char *modeNames[] = { "mono ", "bayer", "view " };
+            std::cout << "align " << std::setw(4) << size << "x" << std::left << std::setw(4) << size << std::right << " " << modeNames[mode] << ": "
+                      << std::setprecision(2) << totalUs / shiftCount / 1000.0 << " ms, max error " << std::setprecision(3) << maxError
+                      << " px, min peak " << std::setprecision(2) << minPeak << (checked(maxError < 0.1) ? " (OK)" : " (FAILED)") << std::endl;
+        }
+    }
+}
+
+// the isolated stars found near their true position(the renderer puts the center of the pixel x at x + 0.5),
+// the stars closer than their wings are one component
+static void matchStars(const std::vector<ExtractedStar> &found, const std::vector<SyntheticStar> &stars, const std::vector<char> &isIsolated,
+                       int x0, int y0, int width, int height, int &matchCount, int &truthCount, double &rmsError)
+{
+    std::vector<char> isFound(stars.size(), 0);
+    double sumError2 = 0.0;
+    matchCount = 0;
+    for(size_t i = 0; i < found.size(); i++)
+    {
+        for(size_t n = 0; n < stars.size(); n++)
+        {
+            double dx = found[i].sensorX - (stars[n].x - 0.5);
+            double dy = found[i].sensorY - (stars[n].y - 0.5);
+            if(isIsolated[n] && !isFound[n] && dx * dx + dy * dy < 1.5 * 1.5)
+            {
+                isFound[n] = 1;
+                sumError2 += dx * dx + dy * dy;
+                matchCount++;
+                break;
+            }
+        }
+    }
+
+    truthCount = 0;
+    for(size_t n = 0; n < stars.size(); n++)
+    {
+        if(isIsolated[n] && stars[n].x >= x0 + 8 && stars[n].y >= y0 + 8 && stars[n].x < x0 + width - 8 && stars[n].y < y0 + height - 8)
+        {
+            truthCount++;
+        }
+    }
+    rmsError = matchCount > 0 ? std::sqrt(sumError2 / matchCount) : 0.0;
+}
+
+static double medianFwhm(const std::vector<ExtractedStar> &found)
+{
+    std::vector<float> fwhm;
+    for(size_t i = 0; i < found.size(); i++)
+    {
+        if(found[i].fwhm > 0.0f)
+        {
+            fwhm.push_back(found[i].fwhm);
+        }
+    }
+    if(fwhm.empty())
+    {
+        return 0.0;
+    }
+    std::nth_element(fwhm.begin(), fwhm.begin() + fwhm.size() / 2, fwhm.end());
+
+    return fwhm[fwhm.size() / 2];
+}
+
+static void benchStarExtractor()
+{
+    const int width = 6248;
+    const int height = 4176;
+    const double expectedFwhm = 2.35482 * 1.6; //the sigma of renderStarFrame
+
+    std::cout << "---- star extraction(6248x4176 RAW16 color, 2000 stars, " << std::thread::hardware_concurrency() << " cores) ----" << std::endl;
+
+    std::mt19937 random(91);
+    std::vector<SyntheticStar> stars(2000);
+    for(size_t n = 0; n < stars.size(); n++)
+    {
+        stars[n].x = 20 + random() % (width - 40) + (random() % 1000) / 1000.0;
+        stars[n].y = 20 + random() % (height - 40) + (random() % 1000) / 1000.0;
+        stars[n].flux = 200.0 + 20000.0 * std::pow((random() % 1000 + 1) / 1000.0, 4.0);
+    }
+    std::vector<char> isIsolated(stars.size(), 1);
+    for(size_t n = 0; n < stars.size(); n++)
+    {
+        for(size_t m = 0; m < stars.size(); m++)
+        {
+            if(m != n && std::fabs(stars[m].x - stars[n].x) < 16.0 && std::fabs(stars[m].y - stars[n].y) < 16.0)
+            {
+                isIsolated[n] = 0;
+            }
+        }
+    }
+
+    std::vector<uint16_t> raw((size_t)width * height);
+    StackTransform truth;
+    renderStarFrame(raw, width, height, stars, 0.0, 0.0, 0.0, 1, truth);
+    Frame frame = Frame::wrap((unsigned char *)raw.data(), width, height, width * 2, POA_RAW16, POA_BAYER_RG);
+
+    StarExtractor extractor;
+    std::vector<ExtractedStar> found;
+    extractor.extract(frame, found); //the first run allocates
+    const int loopCount = 5;
+    double totalUs = 0.0, backgroundUs = 0.0, labelUs = 0.0, measureUs = 0.0;
+    for(int i = 0; i < loopCount; i++)
+    {
+        extractor.extract(frame, found);
+        const StarExtractorStats &stats = extractor.getLastStats();
+        totalUs += stats.totalUs;
+        backgroundUs += stats.backgroundUs;
+        labelUs += stats.labelUs;
+        measureUs += stats.measureUs;
+    }
+
+    int matchCount = 0, truthCount = 0;
+    double rmsError = 0.0;
+    matchStars(found, stars, isIsolated, 0, 0, width, height, matchCount, truthCount, rmsError);
+    double fwhm = medianFwhm(found);
+    double ms = totalUs / loopCount / 1000.0;
+    bool isOK = ms < 50.0 && matchCount >= truthCount * 0.98 && rmsError < 0.2 && std::fabs(fwhm - expectedFwhm) < 0.3;
+    std::cout << std::setprecision(1) << "full frame: " << ms << " ms(background " << backgroundUs / loopCount / 1000.0 << ", label "
+              << labelUs / loopCount / 1000.0 << ", measure " << measureUs / loopCount / 1000.0 << "), stars " << found.size()
+              << ", found " << matchCount << "/" << truthCount << std::setprecision(3) << ", rms error " << rmsError << " px, median FWHM "
+              << fwhm << " px(" << expectedFwhm << ")" << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+
+    // a ROI: a view at an odd position, the sensor positions are the same
+    Frame view = frame.view(1001, 501, 2048, 1536);
+    extractor.extract(view, found);
+    matchStars(found, stars, isIsolated, 1001, 501, 2048, 1536, matchCount, truthCount, rmsError);
+    isOK = matchCount >= truthCount * 0.98 && rmsError < 0.2;
+    std::cout << std::setprecision(1) << "view 2048x1536: " << extractor.getLastStats().totalUs / 1000.0 << " ms, found " << matchCount << "/"
+              << truthCount << std::setprecision(3) << ", rms error " << rmsError << " px" << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+
+    // software bin 2x2(the average of the cell, mono), the sensor positions and the FWHM in the pixels of the binned frame
+    const int binnedWidth = width / 2;
+    const int binnedHeight = height / 2;
+    std::vector<uint16_t> binned((size_t)binnedWidth * binnedHeight);
+    for(int y = 0; y < binnedHeight; y++)
+    {
+        for(int x = 0; x < binnedWidth; x++)
+        {
+            const uint16_t *pPixel = &raw[(size_t)y * 2 * width + x * 2];
+            binned[(size_t)y * binnedWidth + x] = (uint16_t)((pPixel[0] + pPixel[1] + pPixel[width] + pPixel[width + 1] + 2) / 4);
+        }
+    }
+    Frame binnedFrame = Frame::wrap((unsigned char *)binned.data(), binnedWidth, binnedHeight, binnedWidth * 2, POA_RAW16, POA_BAYER_MONO);
+    binnedFrame.bin = 2;
+    extractor.extract(binnedFrame, found);
+    matchStars(found, stars, isIsolated, 0, 0, width, height, matchCount, truthCount, rmsError);
+    fwhm = medianFwhm(found);
+    double binnedFwhm = std::sqrt(expectedFwhm * expectedFwhm / 4.0 + 2.35482 * 2.35482 / 12.0); //the bin adds a box of 1 binned pixel
+    isOK = matchCount >= truthCount * 0.98 && rmsError < 0.3 && std::fabs(fwhm - binnedFwhm) < 0.3;
+    std::cout << std::setprecision(1) << "bin 2 mono: " << extractor.getLastStats().totalUs / 1000.0 << " ms, found " << matchCount << "/"
+              << truthCount << std::setprecision(3) << ", rms error " << rmsError << " px, median FWHM " << fwhm << " px(" << binnedFwhm
+              << ")" << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+}
+
+static long long utcNowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// a V-curve: the focuser steps through the focus, the frames come at 20 fps, the metrics are measured off the producer thread
+static void benchFocusMonitor()
+{
+    const int width = 3096;
+    const int height = 2080;
+    const long exposureUs = 20000;
+
+    std::cout << "---- focus monitor(3096x2080 RAW16 color, 600 stars, 20 fps, " << std::thread::hardware_concurrency() << " cores) ----" << std::endl;
+
+    std::mt19937 random(53);
+    std::vector<SyntheticStar> stars(600);
+    for(size_t n = 0; n < stars.size(); n++)
+    {
+        stars[n].x = 20 + random() % (width - 40) + (random() % 1000) / 1000.0;
+        stars[n].y = 20 + random() % (height - 40) + (random() % 1000) / 1000.0;
+        stars[n].flux = 1000.0 + 20000.0 * std::pow((random() % 1000 + 1) / 1000.0, 4.0);
+    }
+
+    // the frames of every position are rendered first, the blur grows linearly away from the focus(position 0),
+    // the light of a star is spread: its peak falls as 1 / sigma^2
+    const int positionCount = 9;
+    std::vector<std::vector<uint16_t> > frames(positionCount, std::vector<uint16_t>((size_t)width * height));
+    std::vector<SyntheticStar> blurred(stars);
+    for(int i = 0; i < positionCount; i++)
+    {
+        double defocus = 0.6 * (i - positionCount / 2);
+        double sigma = std::sqrt(1.2 * 1.2 + defocus * defocus);
+        for(size_t n = 0; n < stars.size(); n++)
+        {
+            blurred[n].flux = stars[n].flux * 1.2 * 1.2 / (sigma * sigma);
+        }
+        StackTransform truth;
+        renderStarFrame(frames[i], width, height, blurred, 0.0, 0.0, 0.0, i + 1, truth, sigma);
+    }
+
+    FocusMonitor monitor;
+    ROIArea roi; //the center half of the frame
+    roi.startX = width / 4;
+    roi.startY = height / 4;
+    roi.width = width / 2;
+    roi.height = height / 2;
+    monitor.setROI(roi);
+    monitor.start();
+
+    const int framesPerPosition = 4;
+    unsigned long long seq = 0;
+    double maxPushUs = 0.0;
+    int waitFailures = 0;
+    for(int i = 0; i < positionCount; i++)
+    {
+        long position = (i - positionCount / 2) * 100;
+        monitor.setFocuserPosition(position);
+
+        // the first frame was exposed while the focuser moved
+        for(int n = 0; n < framesPerPosition + 1; n++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            Frame frame = Frame::wrap((unsigned char *)frames[n == 0 && i > 0 ? i - 1 : i].data(), width, height, width * 2, POA_RAW16, POA_BAYER_RG);
+            frame.seq = ++seq;
+            frame.exposureUs = exposureUs;
+            frame.timestampUs = n == 0 ? utcNowUs() - 60000 : utcNowUs();
+
+            std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+            monitor.push(frame);
+            maxPushUs = std::max(maxPushUs, elapsedUs(beginTime));
+        }
+        if(!monitor.waitSettled(1, 2000)) //the step of a focuser driver waits for the metrics of the new position
+        {
+            waitFailures++;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    monitor.stop();
+
+    std::vector<FocusCurvePoint> curve;
+    monitor.getCurve(curve);
+    size_t best = 0, bestContrast = 0;
+    bool isVShaped = curve.size() == (size_t)positionCount;
+    for(size_t i = 0; i < curve.size(); i++)
+    {
+        std::cout << "position " << std::setw(4) << curve[i].position << ": samples " << curve[i].sampleCount << std::setprecision(2)
+                  << ", median HFR " << curve[i].medianHfr << " px, stars " << std::setprecision(1) << curve[i].starCount
+                  << ", contrast " << std::setprecision(4) << curve[i].contrast << std::endl;
+        best = curve[i].medianHfr < curve[best].medianHfr ? i : best;
+        bestContrast = curve[i].contrast > curve[bestContrast].contrast ? i : bestContrast;
+    }
+    for(size_t i = 1; i < curve.size() && isVShaped; i++) //decreasing then increasing
+    {
+        isVShaped = i <= best ? curve[i].medianHfr < curve[i - 1].medianHfr : curve[i].medianHfr > curve[i - 1].medianHfr;
+    }
+
+    FocusMonitorStats stats = monitor.getStats();
+    bool isOK = isVShaped && curve.size() == (size_t)positionCount && curve[best].position == 0 && curve[bestContrast].position == 0 &&
+                stats.framesUnsettled >= (unsigned long long)(positionCount - 1) && waitFailures == 0;
+    std::cout << "pushed " << stats.framesPushed << ", measured " << stats.framesMeasured << ", skipped " << stats.framesSkipped
+              << ", unsettled " << stats.framesUnsettled << std::setprecision(1) << ", max push " << maxPushUs << " us, compute "
+              << stats.avgComputeUs / 1000.0 << " ms(max " << stats.maxComputeUs / 1000.0 << "), latency " << stats.avgLatencyUs / 1000.0
+              << " ms(max " << stats.maxLatencyUs / 1000.0 << "), best position " << (curve.empty() ? 0 : curve[best].position)
+              << (checked(isOK) ? " (OK)" : " (FAILED)") << std::endl;
+}
+
+// the definition of the camera bin, pixel by pixel
+template<typename T>
+static void referenceBin(const std::vector<T> &src, int width, int height, int bin, bool isSum, bool isBayer,
+                         std::vector<T> &dst, int &dstWidth, int &dstHeight)
+{
+    const int maxValue = sizeof(T) == 1 ? 255 : 65535;
+    const int block = isBayer ? 2 * bin : bin;
+    dstWidth = width / block * (isBayer ? 2 : 1);
+    dstHeight = height / block * (isBayer ? 2 : 1);
+    dst.assign((size_t)dstWidth * dstHeight, 0);
+    for(int y = 0; y < dstHeight; y++)
+    {
+        for(int x = 0; x < dstWidth; x++)
+        {
+            int sum = 0;
+            for(int j = 0; j < bin; j++)
+            {
+                for(int i = 0; i < bin; i++)
+                {
+                    int sx = isBayer ? (x / 2) * block + (x % 2) + 2 * i : x * bin + i;
+                    int sy = isBayer ? (y / 2) * block + (y % 2) + 2 * j : y * bin + j;
+                    sum += src[(size_t)sy * width + sx];
+                }
+            }
+            dst[(size_t)y * dstWidth + x] = (T)(isSum ? std::min(sum, maxValue) : sum / (bin * bin));
+        }
+    }
+}
+
+template<typename T>
+static int checkSoftwareBin(int width, int height, POAImgFormat imgFormat, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::vector<T> src((size_t)width * height);
+    for(size_t i = 0; i < src.size(); i++) //the full range, the sums saturate
+    {
+        src[i] = (T)(random() % (sizeof(T) == 1 ? 256 : 65536));
+    }
+    Frame srcFrame = Frame::wrap((unsigned char *)src.data(), width, height, width * sizeof(T), imgFormat, POA_BAYER_GB);
+
+    int failed = 0;
+    SoftwareBin softwareBin;
+    std::vector<T> reference, output;
+    for(int bin = 2; bin <= 4; bin++)
+    {
+        for(int mode = 0; mode < 4; mode++)
+        {
+            bool isSum = (mode & 1) != 0;
+            bool isMonoBin = (mode & 2) != 0;
+            softwareBin.setBin(bin);
+            softwareBin.setPixelBinSum(isSum);
+            softwareBin.setMonoBin(isMonoBin);
+
+            int dstWidth = 0, dstHeight = 0;
+            referenceBin(src, width, height, bin, isSum, !isMonoBin && imgFormat != POA_MONO8, reference, dstWidth, dstHeight);
+
+            int outWidth = 0, outHeight = 0;
+            POABayerPattern bayerPattern = POA_BAYER_MONO;
+            softwareBin.outputSize(srcFrame, outWidth, outHeight, bayerPattern);
+            if(outWidth != dstWidth || outHeight != dstHeight)
+            {
+                failed++;
+                continue;
+            }
+
+            output.assign(reference.size(), 0);
+            Frame dstFrame = Frame::wrap((unsigned char *)output.data(), dstWidth, dstHeight, dstWidth * sizeof(T), imgFormat, bayerPattern);
+            for(int level = SIMD_SCALAR; level < SIMD_LEVEL_COUNT; level++)
+            {
+                if(!softwareBin.setSimdLevel((SimdLevel)level))
+                {
+                    continue;
+                }
+
+                std::fill(output.begin(), output.end(), 0);
+                if(!softwareBin.process(srcFrame, dstFrame) || output != reference)
+                {
+                    failed++;
+                }
+            }
+
+            // an output with another bayer pattern is refused(a MONO8 frame is always POA_BAYER_MONO)
+            if(bin == 2 && mode == 0 && imgFormat != POA_MONO8)
+            {
+                POABayerPattern otherPattern = bayerPattern == POA_BAYER_MONO ? POA_BAYER_RG : POA_BAYER_MONO;
+                Frame otherFrame = Frame::wrap((unsigned char *)output.data(), dstWidth, dstHeight, dstWidth * sizeof(T), imgFormat, otherPattern);
+                failed += softwareBin.process(srcFrame, otherFrame) ? 1 : 0;
+            }
+        }
+    }
+
+    return failed;
+}
+
+static void benchSoftwareBin()
+{
+    SoftwareBin softwareBin;
+    std::cout << "---- software bin(6248x4176 RAW16, best SIMD level: " << CpuFeatures::levelName(softwareBin.getSimdLevel()) << ") ----" << std::endl;
+
+    // every bin, mode and level against the definition, odd sizes so the rows end with the scalar code
+    int failed = checkSoftwareBin<uint16_t>(1003, 757, POA_RAW16, 5) + checkSoftwareBin<unsigned char>(1003, 757, POA_RAW8, 6)
+                 + checkSoftwareBin<unsigned char>(998, 601, POA_MONO8, 7);
+    std::cout << "bin 2/3/4, sum/average, bayer/mono, RAW8/RAW16/MONO8, all the levels: "
+              << (checked(failed == 0) ? "the same pixels as the definition (OK)" : "different pixels (FAILED)") << std::endl;
+
+    const int width = 6248;
+    const int height = 4176;
+    std::vector<uint16_t> raw((size_t)width * height);
+    std::mt19937 random(21);
+    for(size_t i = 0; i < raw.size(); i++)
+    {
+        raw[i] = (uint16_t)(1000 + random() % 4096);
+    }
+    Frame rawFrame = Frame::wrap((unsigned char *)raw.data(), width, height, width * 2, POA_RAW16, POA_BAYER_RG);
+    std::vector<uint16_t> output(raw.size());
+
+    const int frameCount = 5;
+    const double bytes = (double)raw.size() * 2;
+    for(int bin = 2; bin <= 4; bin++)
+    {
+        for(int mode = 0; mode < 2; mode++)
+        {
+            softwareBin.setBin(bin);
+            softwareBin.setPixelBinSum(mode == 0);
+            softwareBin.setMonoBin(mode == 1);
+
+            int dstWidth = 0, dstHeight = 0;
+            POABayerPattern bayerPattern = POA_BAYER_MONO;
+            softwareBin.outputSize(rawFrame, dstWidth, dstHeight, bayerPattern);
+            Frame dstFrame = Frame::wrap((unsigned char *)output.data(), dstWidth, dstHeight, dstWidth * 2, POA_RAW16, bayerPattern);
+
+            std::cout << "bin " << bin << (mode == 0 ? " sum, bayer     " : " average, mono  ");
+            for(int level = SIMD_SCALAR; level < SIMD_LEVEL_COUNT; level++)
+            {
+                if(!softwareBin.setSimdLevel((SimdLevel)level))
+                {
+                    continue;
+                }
+
+                double us = 1e30;
+                for(int i = 0; i < frameCount; i++)
+                {
+                    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+                    softwareBin.process(rawFrame, dstFrame);
+                    us = std::min(us, elapsedUs(beginTime));
+                }
+                std::cout << " " << CpuFeatures::levelName((SimdLevel)level) << " " << std::setprecision(2) << us / 1000 << " ms("
+                          << std::setprecision(1) << bytes / us / 1000 << " GB/s)";
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+// the histogram of the definition: the value of an 8 bit sample, the high byte of a 16 bit sample
+template<typename T>
+static int checkHistogram(AutoExposure &autoExposure, int width, int height, int channels, POAImgFormat imgFormat, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::vector<T> src((size_t)width * channels * height);
+    for(size_t i = 0; i < src.size(); i++) //runs of equal samples too, as a flat background
+    {
+        src[i] = i % 7 < 3 ? (T)(sizeof(T) == 1 ? 20 : 5000) : (T)(random() % (sizeof(T) == 1 ? 256 : 65536));
+    }
+    Frame frame = Frame::wrap((unsigned char *)src.data(), width, height, width * channels * sizeof(T), imgFormat, POA_BAYER_RG);
+
+    int failed = 0;
+    std::vector<uint32_t> reference, histogram;
+    for(int rowStep = 1; rowStep <= 3; rowStep += 2)
+    {
+        reference.assign(AutoExposure::BINS, 0);
+        for(int y = 0; y < height; y += rowStep)
+        {
+            for(int x = 0; x < width * channels; x++)
+            {
+                reference[sizeof(T) == 1 ? src[(size_t)y * width * channels + x] : src[(size_t)y * width * channels + x] >> 8]++;
+            }
+        }
+
+        if(!autoExposure.computeHistogram(frame, histogram, rowStep) || histogram != reference)
+        {
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+struct AutoExposureRun
+{
+    int frames;         //popped until the level was within the tolerance, -1: not converged
+    int writes;
+    long exposureUs;
+    long gain;
+    double level;
+    bool isPaced;       //at most one write per frame period, within the ranges
+};
+
+// the closed loop on the simulated camera from an exposure and a gain, predicted by AutoExposure or stepped by 1/3 EV
+static AutoExposureRun runAutoExposure(POACamera &camera, const AutoExposureSettings &settings, long exposureUs, long gain, bool isPredicted)
+{
+    const int maxFrames = 120;
+    const double stepFactor = std::pow(2.0, 1.0 / 3.0);
+
+    camera.setExposure(exposureUs, false);
+    camera.setGain(gain, false);
+    camera.startCapture(4);
+
+    AutoExposure autoExposure(camera);
+    autoExposure.start(settings);
+
+    AutoExposureRun run;
+    run.frames = -1;
+    run.writes = 0;
+    run.isPaced = true;
+
+    long minExposureUs = 0, maxExposureUs = 0, defaultExposureUs = 0, minGain = 0, maxGain = 0, defaultGain = 0;
+    camera.getConfigRange(POA_EXPOSURE, minExposureUs, maxExposureUs, defaultExposureUs);
+    camera.getConfigRange(POA_GAIN, minGain, maxGain, defaultGain);
+
+    Frame frame;
+    std::vector<uint32_t> histogram;
+    unsigned long long settleSeq = 0;
+    long long lastWriteTimeUs = 0;
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    for(int popped = 0; popped < maxFrames && run.frames < 0 && elapsedUs(beginTime) < 10000000.0;)
+    {
+        if(!camera.popFrame(frame))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        popped++;
+
+        if(isPredicted)
+        {
+            double periodUs = autoExposure.getStats().framePeriodUs;
+            if(autoExposure.push(frame))
+            {
+                long long nowUs = (long long)elapsedUs(beginTime);
+                run.isPaced = run.isPaced && (lastWriteTimeUs == 0 || nowUs - lastWriteTimeUs >= periodUs);
+                lastWriteTimeUs = nowUs;
+                run.writes++;
+            }
+
+            AutoExposureStats stats = autoExposure.getStats();
+            run.isPaced = run.isPaced && stats.exposureUs >= minExposureUs && stats.exposureUs <= maxExposureUs
+                    && stats.gain >= minGain && stats.gain <= maxGain;
+            if(stats.isConverged)
+            {
+                run.frames = popped;
+                run.level = stats.level;
+            }
+            continue;
+        }
+
+        // the baseline: one step per measured frame, the frame in flight at a write is not measured
+        if(frame.seq <= settleSeq)
+        {
+            continue;
+        }
+        autoExposure.computeHistogram(frame, histogram);
+        double level = AutoExposure::percentileLevel(histogram, settings.targetPercentile);
+        double factor = settings.targetLevel / std::max(level, 1e-6);
+        if(std::fabs(std::log(factor)) <= std::log(1.0 + settings.tolerance))
+        {
+            run.frames = popped;
+            run.level = level;
+            continue;
+        }
+        exposureUs = (long)(factor > 1.0 ? exposureUs * stepFactor : exposureUs / stepFactor);
+        camera.setExposure(exposureUs, false);
+        settleSeq = frame.seq + 1;
+        run.writes++;
+    }
+    frame.reset();
+
+    camera.stopCapture();
+    run.exposureUs = camera.getExposure();
+    run.gain = camera.getGain();
+
+    return run;
+}
+
+// the histogram against the definition and its speed, then the closed loop on the simulated planet(real time, RAW16)
+static void benchAutoExposure()
+{
+    POACamera camera(0);
+    AutoExposure histogramOnly(camera);
+    std::cout << "---- auto exposure(histogram 6248x4176 RAW16) ----" << std::endl;
+
+    // odd sizes so the rows end with the scalar code, rowStep 1 and 3
+    int failed = checkHistogram<uint16_t>(histogramOnly, 1003, 757, 1, POA_RAW16, 61) + checkHistogram<unsigned char>(histogramOnly, 1003, 757, 1, POA_RAW8, 62)
+                 + checkHistogram<unsigned char>(histogramOnly, 501, 303, 3, POA_RGB24, 63);
+    std::cout << "RAW8/RAW16/RGB24, row step 1/3: "
+              << (checked(failed == 0) ? "the same histogram as the definition (OK)" : "different histogram (FAILED)") << std::endl;
+
+    const int width = 6248;
+    const int height = 4176;
+    std::vector<uint16_t> raw((size_t)width * height);
+    std::mt19937 random(25);
+    for(size_t i = 0; i < raw.size(); i++)
+    {
+        raw[i] = (uint16_t)(1000 + random() % 4096);
+    }
+    Frame rawFrame = Frame::wrap((unsigned char *)raw.data(), width, height, width * 2, POA_RAW16, POA_BAYER_RG);
+    std::vector<uint32_t> histogram;
+    const double bytes = (double)raw.size() * 2;
+    for(int rowStep = 1; rowStep <= 4; rowStep += 3)
+    {
+        double us = 1e30;
+        for(int i = 0; i < 5; i++)
+        {
+            std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+            histogramOnly.computeHistogram(rawFrame, histogram, rowStep);
+            us = std::min(us, elapsedUs(beginTime));
+        }
+        std::cout << "row step " << rowStep << ": " << std::setprecision(2) << us / 1000 << " ms("
+                  << std::setprecision(1) << bytes / us / 1000 << " GB/s of the frame)" << std::endl;
+    }
+
+    POASimSettings savedSettings;
+    POASimGetSettings(0, &savedSettings);
+    POASimSettings simSettings = savedSettings;
+    simSettings.isRealTime = POA_TRUE; //the settings land between the frames as on a camera
+    simSettings.scene = POA_SIM_PLANET;
+    simSettings.render = POA_SIM_RENDER_FULL;
+    POASimSetSettings(0, &simSettings);
+
+    camera.openCamera();
+    camera.initCamera();
+    camera.setImageBin(2);
+    camera.setImageFormat(POACamera::RAW16);
+    long offset = camera.getOffset();
+
+    AutoExposureSettings settings;
+    settings.targetPercentile = 99.0; //the bright part of the disc
+    settings.targetLevel = 0.6;
+    settings.tolerance = 0.1;
+    settings.blackLevel = offset / 4096.0; //the offset is in the ADU of the 12 bit ADC
+    settings.maxExposureUs = 100000;
+
+    const long startExposures[] = {200, 20000};
+    const char *startNames[] = {"dark start   ", "bright start "};
+    bool isOK = failed == 0;
+    AutoExposureRun predicted[2];
+    for(int start = 0; start < 2; start++)
+    {
+        predicted[start] = runAutoExposure(camera, settings, startExposures[start], 0, true);
+        AutoExposureRun stepped = runAutoExposure(camera, settings, startExposures[start], 0, false);
+        std::cout << startNames[start] << startExposures[start] << " us: predicted " << predicted[start].frames << " frames, "
+                  << predicted[start].writes << " writes -> " << predicted[start].exposureUs << " us(level " << std::setprecision(3)
+                  << predicted[start].level << "), stepped by 1/3 EV " << stepped.frames << " frames, " << stepped.writes << " writes" << std::endl;
+        isOK = isOK && predicted[start].frames > 0 && predicted[start].writes <= 3 && predicted[start].isPaced
+                && (stepped.frames < 0 || predicted[start].frames <= stepped.frames);
+    }
+
+    // the exposure can't reach the brightness, the rest goes into the gain
+    AutoExposureSettings gainSettings = settings;
+    gainSettings.maxExposureUs = std::max(predicted[0].exposureUs / 4, 10L);
+    AutoExposureRun gained = runAutoExposure(camera, gainSettings, 200, 0, true);
+    std::cout << "max exposure " << gainSettings.maxExposureUs << " us: " << gained.frames << " frames, " << gained.writes << " writes -> "
+              << gained.exposureUs << " us, gain " << gained.gain << "(level " << std::setprecision(3) << gained.level << ")" << std::endl;
+    isOK = isOK && gained.frames > 0 && gained.isPaced && gained.exposureUs <= gainSettings.maxExposureUs && gained.gain > 0;
+
+    std::cout << "converged by prediction, at most one write per frame period, within the ranges: " << (checked(isOK) ? "(OK)" : "(FAILED)") << std::endl;
+
+    camera.closeCamera();
+    POASimSetSettings(0, &savedSettings);
+}
+
+int main()
+{
+    // the simulated camera gives the frames at once without rendering them, so the wrapper is measured
+    POASimSettings settings;
+    POASimGetDefaultSettings(&settings);
+    settings.isRealTime = POA_FALSE;
+    settings.render = POA_SIM_RENDER_NONE;
+    POASimSetSettings(0, &settings);
+
+    benchSdkCallsPerFrame();
+
+    benchConfigCalls();
+
+    benchReconfiguration();
+
+    benchTrackingROI();
+
+    benchSteadyStateAllocations();
+
+    benchDebayer();
+
+    benchBayerKernels();
+
+    benchFitsWriter();
+
+    benchSerWriter();
+
+    benchAsyncWriter();
+
+    benchSimulator();
+
+    benchCalibration();
+
+    benchCalibrator();
+
+    benchDarkLibrary();
+
+    benchLiveStacker();
+
+    benchLuckyImaging();
+
+    benchPhaseCorrelation();
+
+    benchStarExtractor();
+
+    benchFocusMonitor();
+
+    benchSoftwareBin();
+
+    benchAutoExposure();
+
+    std::cout << "---- " << g_failures << " checks failed ----" << std::endl;
+
+    return g_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+#include <iostream>
+#include "AsyncWriter.h"
+
+using namespace std;
+
+AsyncWriter::AsyncWriter()
+    : m_bRunning(false), m_fullPolicy(BLOCK), m_nMaxQueueDepth(0), m_nFramesPushed(0), m_nFramesWritten(0), m_nFramesDropped(0),
+      m_nWriteErrors(0), m_nBytesWritten(0), m_nStalls(0), m_llStallUs(0)
+{
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    stop();
+}
+
+bool AsyncWriter::start(WriteFunc writeFunc, int queueFrames, int threadCount, FullPolicy fullPolicy)
+{
+    if(m_bRunning)
+    {
+        cerr << "start async writer failed, it's already running" << endl;
+        return false;
+    }
+
+    if(!writeFunc || queueFrames < 1 || threadCount < 1)
+    {
+        cerr << "start async writer failed, invalid parameters" << endl;
+        return false;
+    }
+
+    m_writeFunc = writeFunc;
+    m_pQueue.reset(new FrameRing<Frame>(queueFrames));
+    m_fullPolicy = fullPolicy;
+    resetStats();
+
+    m_bRunning = true;
+    for(int i = 0; i < threadCount; i++)
+    {
+        m_ioThreads.push_back(std::thread(&AsyncWriter::ioLoop, this, i));
+    }
+
+    return true;
+}
+
+void AsyncWriter::stop()
+{
+    if(!m_bRunning)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bRunning = false;
+    }
+    m_notEmpty.notify_all();
+    m_notFull.notify_all();
+
+    for(size_t i = 0; i < m_ioThreads.size(); i++)
+    {
+        m_ioThreads[i].join();
+    }
+    m_ioThreads.clear();
+}
+
+bool AsyncWriter::isRunning() const
+{
+    return m_bRunning;
+}
+
+bool AsyncWriter::push(const Frame &frame)
+{
+    if(!m_bRunning || !frame.isValid())
+    {
+        return false;
+    }
+
+    Frame *pSlot = m_pQueue->beginPush();
+    if(!pSlot)
+    {
+        m_nStalls++;
+
+        switch (m_fullPolicy.load())
+        {
+        case DROP_NEWEST:
+            m_nFramesDropped++;
+            return false;
+        case DROP_OLDEST:
+            // the producer takes the oldest frame out like an I/O thread, an I/O thread may be releasing
+            // a slot at the same time, then try again
+            while(!pSlot)
+            {
+                if(m_pQueue->tryConsume([](Frame &oldest) { oldest.reset(); }))
+                {
+                    m_nFramesDropped++;
+                }
+                pSlot = m_pQueue->beginPush();
+                if(!pSlot)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            break;
+        default:
+            pSlot = waitFreeSlot();
+            if(!pSlot)
+            {
+                return false; //stopped while waiting
+            }
+            break;
+        }
+    }
+
+    *pSlot = frame; //a reference, not a copy of the pixels
+    m_pQueue->commitPush();
+    m_nFramesPushed++;
+
+    int depth = (int)m_pQueue->size();
+    int maxDepth = m_nMaxQueueDepth.load(std::memory_order_relaxed);
+    while(depth > maxDepth && !m_nMaxQueueDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+    {
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_notEmpty.notify_one();
+
+    return true;
+}
+
+Frame *AsyncWriter::waitFreeSlot()
+{
+    std::chrono::steady_clock::time_point beginTime = std::chrono::steady_clock::now();
+    Frame *pSlot = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this, &pSlot]() { pSlot = m_pQueue->beginPush(); return pSlot != nullptr || !m_bRunning; });
+    }
+
+    m_llStallUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - beginTime).count();
+
+    return pSlot;
+}
+
+void AsyncWriter::setFullPolicy(FullPolicy fullPolicy)
+{
+    m_fullPolicy = fullPolicy;
+}
+
+AsyncWriter::FullPolicy AsyncWriter::getFullPolicy() const
+{
+    return (FullPolicy)m_fullPolicy.load();
+}
+
+AsyncWriterStats AsyncWriter::getStats() const
+{
+    AsyncWriterStats stats;
+
+    stats.queueDepth = m_pQueue ? (int)m_pQueue->size() : 0;
+    stats.maxQueueDepth = m_nMaxQueueDepth;
+    stats.queueCapacity = m_pQueue ? (int)m_pQueue->capacity() : 0;
+    stats.framesPushed = m_nFramesPushed;
+    stats.framesWritten = m_nFramesWritten;
+    stats.framesDropped = m_nFramesDropped;
+    stats.writeErrors = m_nWriteErrors;
+    stats.bytesWritten = m_nBytesWritten;
+    stats.stalls = m_nStalls;
+    stats.stallUs = m_llStallUs;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+    stats.bytesPerSecond = seconds > 0 ? stats.bytesWritten / seconds : 0;
+
+    return stats;
+}
+
+void AsyncWriter::resetStats()
+{
+    m_startTime = std::chrono::steady_clock::now();
+    m_nMaxQueueDepth = 0;
+    m_nFramesPushed = 0;
+    m_nFramesWritten = 0;
+    m_nFramesDropped = 0;
+    m_nWriteErrors = 0;
+    m_nBytesWritten = 0;
+    m_nStalls = 0;
+    m_llStallUs = 0;
+}
+
+void AsyncWriter::ioLoop(int threadIndex)
+{
+    for(;;)
+    {
+        // move the frame out, so its slot is free while the frame is written
+        Frame frame;
+        if(m_pQueue->tryConsume([&frame](Frame &queued) { frame = std::move(queued); }))
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            m_notFull.notify_one();
+
+            if(m_writeFunc(frame, threadIndex))
+            {
+                m_nFramesWritten++;
+                m_nBytesWritten += frame.sizeBytes();
+            }
+            else
+            {
+                m_nWriteErrors++;
+            }
+            continue;
+        }
+
+        if(!m_bRunning) //the queue is empty, all the frames pushed before stop() are written
+        {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this]() { return m_pQueue->size() > 0 || !m_bRunning; });
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameRing.h"
+#include "Frame.h"
+
+/*******************************************************************************
+Write-behind stage between the capture and the disk: push() puts the frame into a
+bounded queue(a FrameRing, the frame is not copied, the queue holds a reference)
+and returns at once, a pool of I/O threads takes the frames out and calls the write
+function(eg: SerWriter::write, FitsWriter::write). So a slow write or a hiccup of
+the file system never delays the next POAGetImageData.
+When the queue is full, the FullPolicy decides: BLOCK waits for a free slot,
+DROP_OLDEST discards the oldest queued frame, DROP_NEWEST discards the pushed frame.
+push() must be called from one thread(the producer), the write function is called
+from the I/O threads, with more than one thread the frames may be written out of
+order, so use 1 thread for a sequence file(SER) and more for a file per frame.
+*******************************************************************************/
+
+struct AsyncWriterStats
+{
+    int queueDepth;                    //frames waiting in the queue now
+    int maxQueueDepth;                 //the highest queue depth seen
+    int queueCapacity;
+    unsigned long long framesPushed;
+    unsigned long long framesWritten;
+    unsigned long long framesDropped;  //discarded by DROP_OLDEST or DROP_NEWEST
+    unsigned long long writeErrors;    //the write function returned false
+    unsigned long long bytesWritten;
+    double bytesPerSecond;             //bytesWritten / time since start
+    unsigned long long stalls;         //push() found the queue full
+    long long stallUs;                 //the time push() waited for a free slot(BLOCK)
+
+    AsyncWriterStats()
+    {
+        queueDepth = 0;
+        maxQueueDepth = 0;
+        queueCapacity = 0;
+        framesPushed = 0;
+        framesWritten = 0;
+        framesDropped = 0;
+        writeErrors = 0;
+        bytesWritten = 0;
+        bytesPerSecond = 0;
+        stalls = 0;
+        stallUs = 0;
+    }
+};
+
+class AsyncWriter
+{
+public:
+    enum FullPolicy
+    {
+        BLOCK,       //wait until an I/O thread takes a frame, no frame is lost but the producer is stalled
+        DROP_OLDEST, //discard the oldest queued frame, keep the latest
+        DROP_NEWEST  //discard the pushed frame
+    };
+
+    // threadIndex: 0 .. threadCount - 1, eg: to use a writer per thread
+    typedef std::function<bool(const Frame &frame, int threadIndex)> WriteFunc;
+
+    AsyncWriter();
+
+    ~AsyncWriter(); //stop()
+
+    bool start(WriteFunc writeFunc, int queueFrames = 16, int threadCount = 1, FullPolicy fullPolicy = BLOCK);
+
+    void stop(); //write the queued frames, then stop the threads
+
+    bool isRunning() const;
+
+    bool push(const Frame &frame); //return false if the frame is dropped(DROP_NEWEST) or the writer is not running
+
+    void setFullPolicy(FullPolicy fullPolicy);
+
+    FullPolicy getFullPolicy() const;
+
+    AsyncWriterStats getStats() const;
+
+    void resetStats();
+
+private:
+    AsyncWriter(const AsyncWriter &);
+    AsyncWriter &operator=(const AsyncWriter &);
+
+    void ioLoop(int threadIndex);
+
+    Frame *waitFreeSlot(); //BLOCK
+
+    std::unique_ptr<FrameRing<Frame> > m_pQueue;
+    std::vector<std::thread> m_ioThreads;
+    WriteFunc m_writeFunc;
+    std::atomic<bool> m_bRunning;
+    std::atomic<int> m_fullPolicy;
+
+    // the queue itself is lock-free, the mutex is only for the threads to sleep on
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+
+    std::chrono::steady_clock::time_point m_startTime;
+    std::atomic<int> m_nMaxQueueDepth;
+    std::atomic<unsigned long long> m_nFramesPushed;
+    std::atomic<unsigned long long> m_nFramesWritten;
+    std::atomic<unsigned long long> m_nFramesDropped;
+    std::atomic<unsigned long long> m_nWriteErrors;
+    std::atomic<unsigned long long> m_nBytesWritten;
+    std::atomic<unsigned long long> m_nStalls;
+    std::atomic<long long> m_llStallUs;
+};
+
+#endif // ASYNCWRITER_H
@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "AutoExposure.h"
+#include "AutoExposureKernels.h"
+
+using namespace std;
+
+static_assert(AutoExposure::BINS == HISTOGRAM_BINS, "the histogram of the kernels is the histogram of the class");
+
+static const int HISTOGRAM_TILE_ROWS = 64; //the rows counted into one histogram of a tile
+
+static long long steadyNowUs()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static long long utcNowUs()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+AutoExposure::AutoExposure(POACamera &camera, int threadCount)
+    : m_camera(camera), m_parallel(threadCount), m_bStarted(false),
+      m_lMinExposureUs(0), m_lMaxExposureUs(0), m_lMinGain(0), m_lMaxGain(0),
+      m_bPending(false), m_lPendingExposureUs(0), m_lPendingGain(0), m_llLastWriteUs(0), m_llWriteUtcUs(0), m_nWriteSeq(0),
+      m_llLastFrameUtcUs(0), m_nLastFrameSeq(0), m_frameIntervalUs(0.0), m_nFramesToSkip(0),
+      m_nWritesSinceConverged(0), m_nFramesSinceConverged(0), m_totalHistogramUs(0.0)
+{
+}
+
+bool AutoExposure::start(const AutoExposureSettings &settings)
+{
+    if(m_bStarted || settings.targetPercentile <= 0.0 || settings.targetPercentile > 100.0
+            || settings.blackLevel < 0.0 || settings.targetLevel <= settings.blackLevel || settings.targetLevel >= 1.0
+            || settings.tolerance <= 0.0 || settings.gainDbPerUnit <= 0.0 || settings.maxStepFactor <= 1.0
+            || settings.frameInterval < 1 || settings.rowStep < 1 || settings.settleFrames < 0)
+    {
+        cerr << "start auto exposure failed, it's started or the settings are out of range" << endl;
+        return false;
+    }
+
+    long minExposureUs = 0, maxExposureUs = 0, defaultExposureUs = 0;
+    long minGain = 0, maxGain = 0, defaultGain = 0;
+    if(!m_camera.getConfigRange(POA_EXPOSURE, minExposureUs, maxExposureUs, defaultExposureUs)
+            || !m_camera.getConfigRange(POA_GAIN, minGain, maxGain, defaultGain))
+    {
+        cerr << "start auto exposure failed, can't get the ranges of the exposure and the gain" << endl;
+        return false;
+    }
+
+    m_lMinExposureUs = settings.minExposureUs > 0 ? std::max(settings.minExposureUs, minExposureUs) : minExposureUs;
+    m_lMaxExposureUs = settings.maxExposureUs > 0 ? std::min(settings.maxExposureUs, maxExposureUs) : maxExposureUs;
+    m_lMinGain = settings.minGain >= 0 ? std::max(settings.minGain, minGain) : minGain;
+    m_lMaxGain = settings.maxGain >= 0 ? std::min(settings.maxGain, maxGain) : maxGain;
+    if(m_lMinExposureUs > m_lMaxExposureUs || m_lMinGain > m_lMaxGain)
+    {
+        cerr << "start auto exposure failed, the ranges of the settings are out of the ranges of the camera" << endl;
+        return false;
+    }
+
+    long exposureUs = m_camera.getExposure();
+    long gain = m_camera.getGain();
+    if(exposureUs <= 0 || gain < 0)
+    {
+        cerr << "start auto exposure failed, can't get the exposure and the gain" << endl;
+        return false;
+    }
+
+    m_settings = settings;
+    m_bPending = false;
+    m_llLastWriteUs = 0;
+    m_llWriteUtcUs = 0;
+    m_nWriteSeq = 0;
+    m_llLastFrameUtcUs = 0;
+    m_nLastFrameSeq = 0;
+    m_frameIntervalUs = 0.0;
+    m_nFramesToSkip = 0;
+    m_nWritesSinceConverged = 0;
+    m_nFramesSinceConverged = 0;
+    m_stats = AutoExposureStats();
+    m_stats.exposureUs = exposureUs;
+    m_stats.gain = gain;
+    m_totalHistogramUs = 0.0;
+    m_bStarted = true;
+
+    return true;
+}
+
+void AutoExposure::stop()
+{
+    m_bPending = false;
+    m_bStarted = false;
+}
+
+bool AutoExposure::isStarted() const
+{
+    return m_bStarted;
+}
+
+bool AutoExposure::push(const Frame &frame)
+{
+    if(!m_bStarted)
+    {
+        return false;
+    }
+
+    m_stats.framesSeen++;
+    updateFramePeriod(frame);
+
+    if(isSettling(frame))
+    {
+        m_stats.framesSettling++;
+        return writePending(frame);
+    }
+
+    if(m_nFramesToSkip > 0)
+    {
+        m_nFramesToSkip--;
+        return writePending(frame);
+    }
+
+    long long beginUs = steadyNowUs();
+    if(!computeHistogram(frame, m_histogram, m_settings.rowStep))
+    {
+        return writePending(frame);
+    }
+    double histogramUs = (double)(steadyNowUs() - beginUs);
+
+    m_nFramesToSkip = m_settings.frameInterval - 1;
+    m_stats.framesMeasured++;
+    m_totalHistogramUs += histogramUs;
+    m_stats.avgHistogramUs = m_totalHistogramUs / m_stats.framesMeasured;
+    m_stats.maxHistogramUs = std::max(m_stats.maxHistogramUs, histogramUs);
+
+    unsigned long long total = 0;
+    for(int bin = 0; bin < HISTOGRAM_BINS; bin++)
+    {
+        total += m_histogram[bin];
+    }
+    m_stats.level = percentileLevel(m_histogram, m_settings.targetPercentile);
+    m_stats.saturated = total > 0 ? (double)m_histogram[HISTOGRAM_BINS - 1] / total : 0.0;
+    m_nFramesSinceConverged++;
+
+    double factor = predictFactor(m_stats.level, m_stats.saturated);
+    if(std::fabs(std::log(factor)) <= std::log(1.0 + m_settings.tolerance))
+    {
+        if(m_nWritesSinceConverged > 0)
+        {
+            m_stats.lastConvergeWrites = m_nWritesSinceConverged;
+            m_stats.lastConvergeFrames = m_nFramesSinceConverged;
+        }
+        m_nWritesSinceConverged = 0;
+        m_nFramesSinceConverged = 0;
+        m_stats.isConverged = true;
+        m_stats.isLimited = false;
+        m_bPending = false; //the level is on the target, the batch which waits is stale
+
+        return false;
+    }
+
+    // the frame was exposed with the settings of the camera(the frames of the old settings are not measured)
+    double brightness = m_stats.exposureUs * gainFactor(m_stats.gain) * factor;
+    long exposureUs = 0, gain = 0;
+    splitBrightness(brightness, exposureUs, gain);
+
+    double reached = exposureUs * gainFactor(gain);
+    m_stats.isConverged = false;
+    m_stats.isLimited = std::fabs(std::log(reached / brightness)) > std::log(1.0 + m_settings.tolerance);
+
+    if(exposureUs == m_stats.exposureUs && gain == m_stats.gain) //at the end of the ranges
+    {
+        m_bPending = false;
+        return false;
+    }
+
+    m_bPending = true;
+    m_lPendingExposureUs = exposureUs;
+    m_lPendingGain = gain;
+
+    return writePending(frame);
+}
+
+bool AutoExposure::computeHistogram(const Frame &frame, std::vector<uint32_t> &histogram, int rowStep)
+{
+    POAImgFormat imgFormat = frame.imgFormat();
+    if(!frame.isValid() || rowStep < 1
+            || (imgFormat != POA_RAW8 && imgFormat != POA_RAW16 && imgFormat != POA_MONO8 && imgFormat != POA_RGB24))
+    {
+        cerr << "compute histogram failed, the frame must be RAW8, RAW16, MONO8 or RGB24" << endl;
+        return false;
+    }
+
+    const HistogramRowFunc rowFunc = imgFormat == POA_RAW16 ? histogramRowScalarKernel<uint16_t> : histogramRowScalarKernel<unsigned char>;
+    const int count = frame.width() * (imgFormat == POA_RGB24 ? 3 : 1);
+    const int rows = (frame.height() + rowStep - 1) / rowStep;
+    const int tileCount = (rows + HISTOGRAM_TILE_ROWS - 1) / HISTOGRAM_TILE_ROWS;
+    const size_t tileBins = (size_t)HISTOGRAM_COPIES * HISTOGRAM_BINS;
+    if(m_tileHists.size() < tileCount * tileBins)
+    {
+        m_tileHists.resize(tileCount * tileBins);
+    }
+
+    m_parallel.run(rows, [&](int rowBegin, int rowEnd)
+    {
+        uint32_t *pHist = &m_tileHists[(size_t)(rowBegin / HISTOGRAM_TILE_ROWS) * tileBins];
+        memset(pHist, 0, tileBins * sizeof(uint32_t));
+
+        HistogramRowArgs args;
+        args.count = count;
+        for(int i = rowBegin; i < rowEnd; i++)
+        {
+            args.row = frame.row(i * rowStep);
+            rowFunc(args, pHist);
+        }
+    }, HISTOGRAM_TILE_ROWS);
+
+    // the copies of all the tiles
+    histogram.assign(HISTOGRAM_BINS, 0);
+    for(size_t copy = 0; copy < (size_t)tileCount * HISTOGRAM_COPIES; copy++)
+    {
+        const uint32_t *pHist = &m_tileHists[copy * HISTOGRAM_BINS];
+        for(int bin = 0; bin < HISTOGRAM_BINS; bin++)
+        {
+            histogram[bin] += pHist[bin];
+        }
+    }
+
+    return true;
+}
+
+double AutoExposure::percentileLevel(const std::vector<uint32_t> &histogram, double percentile)
+{
+    unsigned long long total = 0;
+    for(size_t bin = 0; bin < histogram.size(); bin++)
+    {
+        total += histogram[bin];
+    }
+
+    if(total == 0)
+    {
+        return 0.0;
+    }
+
+    double rank = std::min(std::max(percentile, 0.0), 100.0) / 100.0 * total;
+    unsigned long long below = 0;
+    for(size_t bin = 0; bin < histogram.size(); bin++)
+    {
+        if(histogram[bin] > 0 && below + histogram[bin] >= rank)
+        {
+            return (bin + (rank - below) / histogram[bin]) / histogram.size();
+        }
+        below += histogram[bin];
+    }
+
+    return 1.0;
+}
+
+AutoExposureStats AutoExposure::getStats() const
+{
+    return m_stats;
+}
+
+double AutoExposure::gainFactor(long gain) const
+{
+    return std::pow(10.0, (gain - m_lMinGain) * m_settings.gainDbPerUnit / 20.0);
+}
+
+double AutoExposure::predictFactor(double level, double saturated) const
+{
+    const double binLevel = 1.0 / HISTOGRAM_BINS;
+    const double black = m_settings.blackLevel;
+    const double targetSignal = m_settings.targetLevel - black;
+
+    double factor = m_settings.maxStepFactor;
+    if(level >= 1.0 - binLevel)
+    {
+        // the percentile is saturated, its signal is not known: at least down to the target, and further by the
+        // samples in the top bin which should be above the percentile
+        double brightFraction = 1.0 - m_settings.targetPercentile / 100.0;
+        factor = targetSignal / (1.0 - black) * std::min(1.0, brightFraction / std::max(saturated, binLevel * binLevel));
+    }
+    else if(level - black >= binLevel) //otherwise the percentile is black, the signal is not measured
+    {
+        factor = targetSignal / (level - black);
+    }
+
+    return std::min(std::max(factor, 1.0 / m_settings.maxStepFactor), m_settings.maxStepFactor);
+}
+
+void AutoExposure::splitBrightness(double brightness, long &exposureUs, long &gain) const
+{
+    gain = m_settings.isAutoGain ? m_lMinGain : m_stats.gain;
+    if(m_settings.isAutoGain && brightness > m_lMaxExposureUs)
+    {
+        double db = 20.0 * std::log10(brightness / m_lMaxExposureUs);
+        gain = std::min(m_lMaxGain, m_lMinGain + (long)std::floor(db / m_settings.gainDbPerUnit + 0.5));
+    }
+
+    // the exposure makes up the rounding of the gain
+    double exposure = std::floor(brightness / gainFactor(gain) + 0.5);
+    exposureUs = (long)std::min(std::max(exposure, (double)m_lMinExposureUs), (double)m_lMaxExposureUs);
+}
+
+bool AutoExposure::isSettling(const Frame &frame) const
+{
+    if(m_llLastWriteUs == 0)
+    {
+        return false;
+    }
+
+    // the exposures in flight at the write, the seq starts from 1 again if the capture was restarted
+    if(frame.seq > m_nWriteSeq && frame.seq - m_nWriteSeq <= (unsigned long long)m_settings.settleFrames)
+    {
+        return true;
+    }
+
+    return frame.timestampUs - m_stats.exposureUs < m_llWriteUtcUs; //read before a whole exposure after the write
+}
+
+void AutoExposure::updateFramePeriod(const Frame &frame)
+{
+    if(m_nLastFrameSeq > 0 && frame.seq > m_nLastFrameSeq && frame.timestampUs > m_llLastFrameUtcUs)
+    {
+        double intervalUs = (double)(frame.timestampUs - m_llLastFrameUtcUs) / (frame.seq - m_nLastFrameSeq);
+        m_frameIntervalUs = m_frameIntervalUs > 0.0 ? m_frameIntervalUs + (intervalUs - m_frameIntervalUs) / 8.0 : intervalUs;
+    }
+
+    m_llLastFrameUtcUs = frame.timestampUs;
+    m_nLastFrameSeq = frame.seq;
+    m_stats.framePeriodUs = std::max(m_frameIntervalUs, (double)m_stats.exposureUs);
+}
+
+bool AutoExposure::writePending(const Frame &frame)
+{
+    if(!m_bPending)
+    {
+        return false;
+    }
+
+    long long nowUs = steadyNowUs();
+    if(m_llLastWriteUs != 0 && nowUs - m_llLastWriteUs < (long long)m_stats.framePeriodUs)
+    {
+        m_stats.writesDeferred++;
+        return false;
+    }
+
+    bool isWritten = true;
+    if(m_lPendingExposureUs != m_stats.exposureUs)
+    {
+        m_stats.configWrites++;
+        isWritten = m_camera.setExposure(m_lPendingExposureUs, false);
+        if(isWritten)
+        {
+            m_stats.exposureUs = m_lPendingExposureUs;
+        }
+    }
+
+    if(isWritten && m_lPendingGain != m_stats.gain)
+    {
+        m_stats.configWrites++;
+        isWritten = m_camera.setGain(m_lPendingGain, false);
+        if(isWritten)
+        {
+            m_stats.gain = m_lPendingGain;
+        }
+    }
+
+    // a failed batch is not retried before the next frame period either
+    m_bPending = false;
+    m_llLastWriteUs = nowUs;
+    m_llWriteUtcUs = utcNowUs();
+    m_nWriteSeq = frame.seq;
+    m_nFramesToSkip = 0; //the first frame of the new settings is measured
+    m_stats.framePeriodUs = std::max(m_frameIntervalUs, (double)m_stats.exposureUs);
+
+    if(!isWritten)
+    {
+        m_stats.writeErrors++;
+        return false;
+    }
+
+    m_stats.writes++;
+    m_nWritesSinceConverged++;
+
+    return true;
+}
@@ -0,0 +1,189 @@
+#ifndef AUTOEXPOSURE_H
+#define AUTOEXPOSURE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Frame.h"
+#include "POACamera.h"
+#include "ParallelRows.h"
+
+/*******************************************************************************
+Auto exposure and auto gain on the host: the frames of the capture stream are
+measured by a histogram and the exposure(and the gain) of the POACamera are driven
+so the target percentile of the samples(eg: 99, the bright end of a planet) sits
+at the target level of the full scale, within the ranges of the POAConfigAttributes
+of POA_EXPOSURE and POA_GAIN, narrowed by the settings.
+The histogram has 256 bins of the full scale(see AutoExposureKernels.h), it's made
+by the scalar kernel on all cores(ParallelRows), on every frame or every
+frameInterval-th frame, of every rowStep-th row.
+The controller predicts the settings instead of stepping: the signal(the level
+minus the black level) is linear in the exposure and in the gain factor
+10^(gain x gainDbPerUnit / 20), so the brightness which puts the level on the
+target is worked out from one frame and written at once, a scene change converges
+in one or two writes. The change of a write is limited to maxStepFactor, and a
+saturated or black percentile(no measure of the signal) is scaled by the fraction
+of the saturated samples or by maxStepFactor. The brightness goes into the exposure
+first, the gain is raised above minGain only when the exposure is at its maximum
+(and lowered first), so the noise is the lowest for the brightness.
+The exposure and the gain are written as one batch, at most one batch per frame
+period(the interval of the frames, or the exposure if it's longer), a newer
+prediction replaces the batch which waits. The frames which may have been exposed
+with the old settings(read less than one exposure after the write, and the
+settleFrames frames after it) are not measured, so a write is never corrected by
+the frames it didn't change.
+The exposure is written with POACamera::setExposure(POA_EXPOSURE, the same setting
+as POA_EXP in microseconds), so the wait of the capture and Frame::exposureUs follow.
+push() is called by one thread(the consumer of POACamera::popFrame()).
+*******************************************************************************/
+
+struct AutoExposureSettings
+{
+    double targetPercentile;    //0 ... 100, the percentile of the samples driven to targetLevel
+    double targetLevel;         //0 ... 1, the fraction of the full scale
+    double tolerance;           //the relative error of the level which is accepted without a write, eg: 0.1 is +-10%
+    double blackLevel;          //the fraction of the full scale without light(the offset), it doesn't scale with the exposure
+    long minExposureUs;         //0: the minimum of POA_EXPOSURE
+    long maxExposureUs;         //0: the maximum of POA_EXPOSURE
+    bool isAutoGain;            //false: only the exposure is changed
+    long minGain;               //-1: the minimum of POA_GAIN, the gain stays there until the exposure is at maxExposureUs
+    long maxGain;               //-1: the maximum of POA_GAIN
+    double gainDbPerUnit;       //the dB of one step of POA_GAIN
+    double maxStepFactor;       //the most the brightness changes by one write
+    int frameInterval;          //a histogram every frameInterval-th frame
+    int rowStep;                //the histogram counts every rowStep-th row, keep it odd on a bayer frame
+    int settleFrames;           //the frames after a write which are not measured(the exposure in flight)
+
+    AutoExposureSettings()
+    {
+        targetPercentile = 99.0;
+        targetLevel = 0.6;
+        tolerance = 0.1;
+        blackLevel = 0.0;
+        minExposureUs = 0;
+        maxExposureUs = 0;
+        isAutoGain = true;
+        minGain = -1;
+        maxGain = -1;
+        gainDbPerUnit = 0.1;
+        maxStepFactor = 16.0;
+        frameInterval = 1;
+        rowStep = 1;
+        settleFrames = 1;
+    }
+};
+
+struct AutoExposureStats
+{
+    unsigned long long framesSeen;
+    unsigned long long framesMeasured;  //a histogram was made
+    unsigned long long framesSettling;  //not measured, they may have the old settings
+    unsigned long long writes;          //the batches written
+    unsigned long long configWrites;    //the SDK setters of the batches
+    unsigned long long writesDeferred;  //the frames at which a batch waited for the frame period
+    unsigned long long writeErrors;
+    double level;                       //at the target percentile of the last histogram, fraction of the full scale
+    double saturated;                   //the fraction of the samples in the top bin of the last histogram
+    long exposureUs;                    //the settings of the camera
+    long gain;
+    bool isConverged;                   //the last level was within the tolerance
+    bool isLimited;                     //the last prediction was clamped by the ranges
+    int lastConvergeWrites;             //the writes from leaving the tolerance to reaching it again
+    int lastConvergeFrames;             //the measured frames of the same
+    double framePeriodUs;
+    double avgHistogramUs;
+    double maxHistogramUs;
+
+    AutoExposureStats()
+    {
+        framesSeen = 0;
+        framesMeasured = 0;
+        framesSettling = 0;
+        writes = 0;
+        configWrites = 0;
+        writesDeferred = 0;
+        writeErrors = 0;
+        level = 0.0;
+        saturated = 0.0;
+        exposureUs = 0;
+        gain = 0;
+        isConverged = false;
+        isLimited = false;
+        lastConvergeWrites = 0;
+        lastConvergeFrames = 0;
+        framePeriodUs = 0.0;
+        avgHistogramUs = 0.0;
+        maxHistogramUs = 0.0;
+    }
+};
+
+class AutoExposure
+{
+public:
+    enum { BINS = 256 }; //of the histogram
+
+    explicit AutoExposure(POACamera &camera, int threadCount = 0); //0: all cores
+
+    // read the ranges and the current exposure and gain of the camera
+    bool start(const AutoExposureSettings &settings);
+
+    void stop(); //the batch which waits is dropped
+
+    bool isStarted() const;
+
+    bool push(const Frame &frame); //return true if a batch was written
+
+    // the histogram of RAW8, RAW16, MONO8 or RGB24(all the channels), BINS counts of every rowStep-th row
+    bool computeHistogram(const Frame &frame, std::vector<uint32_t> &histogram, int rowStep = 1);
+
+    // the level of the percentile(0 ... 100) of a histogram, fraction of the full scale, interpolated in the bin
+    static double percentileLevel(const std::vector<uint32_t> &histogram, double percentile);
+
+    AutoExposureStats getStats() const;
+
+private:
+    AutoExposure(const AutoExposure &);
+    AutoExposure &operator=(const AutoExposure &);
+
+    double gainFactor(long gain) const; //the brightness of the gain relative to minGain
+
+    double predictFactor(double level, double saturated) const; //the change of the brightness which puts the level on the target
+
+    void splitBrightness(double brightness, long &exposureUs, long &gain) const; //the exposure first, then the gain
+
+    bool isSettling(const Frame &frame) const;
+
+    void updateFramePeriod(const Frame &frame);
+
+    bool writePending(const Frame &frame);
+
+    POACamera &m_camera;
+    ParallelRows m_parallel;
+
+    AutoExposureSettings m_settings;
+    bool m_bStarted;
+    long m_lMinExposureUs;
+    long m_lMaxExposureUs;
+    long m_lMinGain;
+    long m_lMaxGain;
+
+    bool m_bPending;            //a batch waits for the frame period
+    long m_lPendingExposureUs;
+    long m_lPendingGain;
+    long long m_llLastWriteUs;  //steady clock, 0: no write yet
+    long long m_llWriteUtcUs;   //the time of the last write, UTC as Frame::timestampUs
+    unsigned long long m_nWriteSeq; //the last frame seen at the last write
+    long long m_llLastFrameUtcUs;
+    unsigned long long m_nLastFrameSeq;
+    double m_frameIntervalUs;   //average of the interval of the frames, 0: not known yet
+    int m_nFramesToSkip;        //before the next histogram(frameInterval)
+    int m_nWritesSinceConverged;
+    int m_nFramesSinceConverged;
+
+    std::vector<uint32_t> m_histogram;
+    std::vector<uint32_t> m_tileHists; //HISTOGRAM_COPIES x HISTOGRAM_BINS per tile of rows
+    AutoExposureStats m_stats;
+    double m_totalHistogramUs;
+};
+
+#endif // AUTOEXPOSURE_H
@@ -0,0 +1,68 @@
+#ifndef AUTOEXPOSUREKERNELS_H
+#define AUTOEXPOSUREKERNELS_H
+
+#include <cstdint>
+
+/*******************************************************************************
+The histogram kernel of AutoExposure, scalar at every SIMD level.
+The kernel adds the samples of one row to a histogram of 256 bins of the full scale:
+the bin of an 8 bit sample is its value, the bin of a 16 bit sample is its high
+byte(the RAW16 data is MSB aligned, so the bins are the same for every bit depth).
+The row is counted into HISTOGRAM_COPIES interleaved histograms(sample i goes to the
+copy i % HISTOGRAM_COPIES), the increments of equal neighbours(a flat background)
+don't wait for each other, the caller adds the copies up.
+The counting is a scattered increment per sample, which the vectors can't do: the
+SSE4.1/AVX2/AVX-512 kernels which only made the bins of the 16 bit samples by the
+vectors measured the same time as this kernel(26 ms for 6248x4176 RAW16 at every
+level), the increments bound it, so there is one kernel and no table per level.
+The speed comes from the copies and from ParallelRows.
+*******************************************************************************/
+
+static const int HISTOGRAM_BINS = 256;
+static const int HISTOGRAM_COPIES = 4;
+
+struct HistogramRowArgs
+{
+    const void *row;        //unsigned char or uint16_t
+    int count;              //the samples of the row(width x 3 for RGB24)
+};
+
+typedef int (*HistogramRowFunc)(const HistogramRowArgs &args, uint32_t *pHist); //pHist: HISTOGRAM_COPIES x HISTOGRAM_BINS
+
+template <typename T>
+static inline int histogramBin(T value)
+{
+    return sizeof(T) == 1 ? value : value >> 8;
+}
+
+template <typename T>
+static inline void histogramRowScalar(const HistogramRowArgs &args, int xBegin, uint32_t *pHist)
+{
+    const T *pRow = (const T *)args.row;
+
+    for(int x = xBegin; x < args.count; x++)
+    {
+        pHist[(x % HISTOGRAM_COPIES) * HISTOGRAM_BINS + histogramBin(pRow[x])]++;
+    }
+}
+
+template <typename T>
+static int histogramRowScalarKernel(const HistogramRowArgs &args, uint32_t *pHist)
+{
+    const T *pRow = (const T *)args.row;
+
+    int x = 0;
+    for(; x + HISTOGRAM_COPIES <= args.count; x += HISTOGRAM_COPIES)
+    {
+        pHist[histogramBin(pRow[x])]++;
+        pHist[HISTOGRAM_BINS + histogramBin(pRow[x + 1])]++;
+        pHist[2 * HISTOGRAM_BINS + histogramBin(pRow[x + 2])]++;
+        pHist[3 * HISTOGRAM_BINS + histogramBin(pRow[x + 3])]++;
+    }
+
+    histogramRowScalar<T>(args, x, pHist);
+
+    return args.count;
+}
+
+#endif // AUTOEXPOSUREKERNELS_H
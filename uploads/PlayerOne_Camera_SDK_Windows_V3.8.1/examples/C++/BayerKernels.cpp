@@ -0,0 +1,462 @@
+#include <cstdlib>
+#include "BayerKernels.h"
+#include "DebayerKernels.h"
+
+using namespace std;
+
+// reflect the coordinate at the border without repeating the edge pixel, -1 -> 1, n -> n - 2, it keeps the bayer parity
+static inline int mirror(int i, int n)
+{
+    return i < 0 ? -i : (i >= n ? 2 * (n - 1) - i : i);
+}
+
+static inline int average(int a, int b)
+{
+    return (a + b + 1) >> 1;
+}
+
+template <int MAX_VALUE>
+static inline int clampValue(int value)
+{
+    return value < 0 ? 0 : (value > MAX_VALUE ? MAX_VALUE : value);
+}
+
+/***** debayer, bilinear *****/
+
+template <typename T, bool RED_ROW, bool IS_COLOR>
+static inline void bilinearPixel(const DebayerRowArgs &args, int xl, int x, int xr)
+{
+    const T *up = (const T *)args.src[1];
+    const T *cur = (const T *)args.src[2];
+    const T *dn = (const T *)args.src[3];
+    T *pOut = (T *)args.dst + 3 * x;
+
+    int h = average(cur[xl], cur[xr]);
+    int v = average(up[x], dn[x]);
+
+    int same, green, other; //same: the color of this row, other: the color of the rows above and below
+    if(IS_COLOR)
+    {
+        same = cur[x];
+        green = average(v, h);
+        other = average(average(up[xl], up[xr]), average(dn[xl], dn[xr]));
+    }
+    else
+    {
+        same = h;
+        green = cur[x];
+        other = v;
+    }
+
+    pOut[0] = (T)(RED_ROW ? other : same);
+    pOut[1] = (T)green;
+    pOut[2] = (T)(RED_ROW ? same : other);
+}
+
+template <typename T, bool RED_ROW, int COLOR_X>
+static void bilinearBorder(const DebayerRowArgs &args, int width, int x)
+{
+    if((x & 1) == COLOR_X)
+    {
+        bilinearPixel<T, RED_ROW, true>(args, mirror(x - 1, width), x, mirror(x + 1, width));
+    }
+    else
+    {
+        bilinearPixel<T, RED_ROW, false>(args, mirror(x - 1, width), x, mirror(x + 1, width));
+    }
+}
+
+// xBegin >= 1, xEnd <= width - 1
+template <typename T, bool RED_ROW, int COLOR_X>
+static void bilinearRow(const DebayerRowArgs &args, int xBegin, int xEnd)
+{
+    int x = xBegin;
+    if(x < xEnd && (x & 1) != COLOR_X)
+    {
+        bilinearPixel<T, RED_ROW, false>(args, x - 1, x, x + 1);
+        x++;
+    }
+
+    for(; x + 1 < xEnd; x += 2) //a color pixel then a green pixel
+    {
+        bilinearPixel<T, RED_ROW, true>(args, x - 1, x, x + 1);
+        bilinearPixel<T, RED_ROW, false>(args, x, x + 1, x + 2);
+    }
+
+    if(x < xEnd)
+    {
+        bilinearPixel<T, RED_ROW, true>(args, x - 1, x, x + 1);
+    }
+}
+
+template <POABayerPattern P, typename T, int Y>
+static void debayerBilinearRow(DebayerRowArgs &args, DebayerRowFunc simdRow, int width)
+{
+    typedef BayerRowTraits<P, Y> Row;
+
+    args.redRow = Row::RED_ROW;
+    args.colorParity = Row::COLOR_X;
+
+    int x = 1;
+    if(simdRow)
+    {
+        args.xBegin = 1;
+        args.xEnd = width - 1; //the vectors read x - 1 .. x + lanes
+        x = simdRow(args);
+    }
+
+    bilinearBorder<T, Row::RED_ROW, Row::COLOR_X>(args, width, 0);
+    bilinearRow<T, Row::RED_ROW, Row::COLOR_X>(args, x, width - 1);
+    bilinearBorder<T, Row::RED_ROW, Row::COLOR_X>(args, width, width - 1);
+}
+
+template <POABayerPattern P, typename T>
+static void debayerBilinear(const BayerFrameArgs &frameArgs)
+{
+    const Frame &raw = *frameArgs.pRaw;
+    int width = raw.width();
+    int height = raw.height();
+    DebayerRowFunc simdRow = frameArgs.pSimd ? frameArgs.pSimd->bilinear[sizeof(T) - 1] : nullptr;
+
+    DebayerRowArgs args = DebayerRowArgs();
+    args.maxValue = PixelTraits<T>::MAX_VALUE;
+
+    for(int y = 0; y < height; y++)
+    {
+        args.src[1] = raw.row(mirror(y - 1, height));
+        args.src[2] = raw.row(y);
+        args.src[3] = raw.row(mirror(y + 1, height));
+        args.dst = frameArgs.pDst + (size_t)y * frameArgs.dstStride;
+
+        if((y & 1) == 0)
+        {
+            debayerBilinearRow<P, T, 0>(args, simdRow, width);
+        }
+        else
+        {
+            debayerBilinearRow<P, T, 1>(args, simdRow, width);
+        }
+    }
+}
+
+/***** debayer, edge aware(Hamilton-Adams) *****/
+
+// the green at a red or blue pixel, along the direction with the smaller gradient
+template <typename T>
+static inline void edgeGreenPixel(const DebayerRowArgs &args, int xl2, int xl, int x, int xr, int xr2)
+{
+    const T *up2 = (const T *)args.src[0];
+    const T *up = (const T *)args.src[1];
+    const T *cur = (const T *)args.src[2];
+    const T *dn = (const T *)args.src[3];
+    const T *dn2 = (const T *)args.src[4];
+
+    int c = cur[x];
+    int left = cur[xl];
+    int right = cur[xr];
+    int lapH = 2 * c - cur[xl2] - cur[xr2];
+    int lapV = 2 * c - up2[x] - dn2[x];
+
+    int gradH = abs(left - right) + abs(lapH);
+    int gradV = abs(up[x] - dn[x]) + abs(lapV);
+
+    int sumH = 2 * (left + right) + lapH;
+    int sumV = 2 * (up[x] + dn[x]) + lapV;
+
+    int green;
+    if(gradH < gradV)
+    {
+        green = (sumH + 2) >> 2;
+    }
+    else if(gradV < gradH)
+    {
+        green = (sumV + 2) >> 2;
+    }
+    else
+    {
+        green = (sumH + sumV + 4) >> 3;
+    }
+
+    args.greenOut[x] = (uint16_t)clampValue<PixelTraits<T>::MAX_VALUE>(green);
+}
+
+template <typename T>
+static inline void edgeGreenCopy(const DebayerRowArgs &args, int x)
+{
+    args.greenOut[x] = ((const T *)args.src[2])[x];
+}
+
+template <typename T, int COLOR_X>
+static void edgeGreenBorder(const DebayerRowArgs &args, int width, int x)
+{
+    if((x & 1) == COLOR_X)
+    {
+        edgeGreenPixel<T>(args, mirror(x - 2, width), mirror(x - 1, width), x, mirror(x + 1, width), mirror(x + 2, width));
+    }
+    else
+    {
+        edgeGreenCopy<T>(args, x);
+    }
+}
+
+// xBegin >= 2, xEnd <= width - 2
+template <typename T, int COLOR_X>
+static void edgeGreenRow(const DebayerRowArgs &args, int xBegin, int xEnd)
+{
+    int x = xBegin;
+    if(x < xEnd && (x & 1) != COLOR_X)
+    {
+        edgeGreenCopy<T>(args, x);
+        x++;
+    }
+
+    for(; x + 1 < xEnd; x += 2)
+    {
+        edgeGreenPixel<T>(args, x - 2, x - 1, x, x + 1, x + 2);
+        edgeGreenCopy<T>(args, x + 1);
+    }
+
+    if(x < xEnd)
+    {
+        edgeGreenPixel<T>(args, x - 2, x - 1, x, x + 1, x + 2);
+    }
+}
+
+// the red and blue from the color differences(color - green) of the neighbours
+template <typename T, bool RED_ROW, bool IS_COLOR>
+static inline void edgeColorPixel(const DebayerRowArgs &args, int xl, int x, int xr)
+{
+    const T *up = (const T *)args.src[1];
+    const T *cur = (const T *)args.src[2];
+    const T *dn = (const T *)args.src[3];
+    const uint16_t *gUp = args.green[0];
+    const uint16_t *gCur = args.green[1];
+    const uint16_t *gDn = args.green[2];
+    T *pOut = (T *)args.dst + 3 * x;
+
+    int g = gCur[x];
+
+    int same, other;
+    if(IS_COLOR)
+    {
+        int diffDiag = (up[xl] - gUp[xl]) + (up[xr] - gUp[xr]) + (dn[xl] - gDn[xl]) + (dn[xr] - gDn[xr]);
+        same = cur[x];
+        other = g + ((diffDiag + 2) >> 2);
+    }
+    else
+    {
+        same = g + (((cur[xl] - gCur[xl]) + (cur[xr] - gCur[xr]) + 1) >> 1);
+        other = g + (((up[x] - gUp[x]) + (dn[x] - gDn[x]) + 1) >> 1);
+    }
+
+    same = clampValue<PixelTraits<T>::MAX_VALUE>(same);
+    other = clampValue<PixelTraits<T>::MAX_VALUE>(other);
+
+    pOut[0] = (T)(RED_ROW ? other : same);
+    pOut[1] = (T)g;
+    pOut[2] = (T)(RED_ROW ? same : other);
+}
+
+template <typename T, bool RED_ROW, int COLOR_X>
+static void edgeColorBorder(const DebayerRowArgs &args, int width, int x)
+{
+    if((x & 1) == COLOR_X)
+    {
+        edgeColorPixel<T, RED_ROW, true>(args, mirror(x - 1, width), x, mirror(x + 1, width));
+    }
+    else
+    {
+        edgeColorPixel<T, RED_ROW, false>(args, mirror(x - 1, width), x, mirror(x + 1, width));
+    }
+}
+
+// xBegin >= 1, xEnd <= width - 1
+template <typename T, bool RED_ROW, int COLOR_X>
+static void edgeColorRow(const DebayerRowArgs &args, int xBegin, int xEnd)
+{
+    int x = xBegin;
+    if(x < xEnd && (x & 1) != COLOR_X)
+    {
+        edgeColorPixel<T, RED_ROW, false>(args, x - 1, x, x + 1);
+        x++;
+    }
+
+    for(; x + 1 < xEnd; x += 2)
+    {
+        edgeColorPixel<T, RED_ROW, true>(args, x - 1, x, x + 1);
+        edgeColorPixel<T, RED_ROW, false>(args, x, x + 1, x + 2);
+    }
+
+    if(x < xEnd)
+    {
+        edgeColorPixel<T, RED_ROW, true>(args, x - 1, x, x + 1);
+    }
+}
+
+template <POABayerPattern P, typename T, int Y>
+static void debayerEdgeGreenRow(DebayerRowArgs &args, DebayerRowFunc simdRow, int width)
+{
+    typedef BayerRowTraits<P, Y> Row;
+
+    args.redRow = Row::RED_ROW;
+    args.colorParity = Row::COLOR_X;
+
+    int x = 2;
+    if(simdRow)
+    {
+        args.xBegin = 2;
+        args.xEnd = width - 2;
+        x = simdRow(args);
+    }
+
+    edgeGreenBorder<T, Row::COLOR_X>(args, width, 0);
+    edgeGreenBorder<T, Row::COLOR_X>(args, width, 1);
+    edgeGreenRow<T, Row::COLOR_X>(args, x, width - 2);
+    edgeGreenBorder<T, Row::COLOR_X>(args, width, width - 2);
+    edgeGreenBorder<T, Row::COLOR_X>(args, width, width - 1);
+}
+
+template <POABayerPattern P, typename T, int Y>
+static void debayerEdgeColorRow(DebayerRowArgs &args, DebayerRowFunc simdRow, int width)
+{
+    typedef BayerRowTraits<P, Y> Row;
+
+    args.redRow = Row::RED_ROW;
+    args.colorParity = Row::COLOR_X;
+
+    int x = 1;
+    if(simdRow)
+    {
+        args.xBegin = 1;
+        args.xEnd = width - 1;
+        x = simdRow(args);
+    }
+
+    edgeColorBorder<T, Row::RED_ROW, Row::COLOR_X>(args, width, 0);
+    edgeColorRow<T, Row::RED_ROW, Row::COLOR_X>(args, x, width - 1);
+    edgeColorBorder<T, Row::RED_ROW, Row::COLOR_X>(args, width, width - 1);
+}
+
+template <POABayerPattern P, typename T>
+static void debayerEdgeAware(const BayerFrameArgs &frameArgs)
+{
+    const Frame &raw = *frameArgs.pRaw;
+    int width = raw.width();
+    int height = raw.height();
+    uint16_t *pGreen = frameArgs.pGreen;
+    DebayerRowFunc simdGreenRow = frameArgs.pSimd ? frameArgs.pSimd->edgeGreen[sizeof(T) - 1] : nullptr;
+    DebayerRowFunc simdColorRow = frameArgs.pSimd ? frameArgs.pSimd->edgeColor[sizeof(T) - 1] : nullptr;
+
+    DebayerRowArgs args = DebayerRowArgs();
+    args.maxValue = PixelTraits<T>::MAX_VALUE;
+
+    // the color pass of row y - 1 follows the green pass of row y, so the green rows are still in the cache
+    for(int y = 0; y <= height; y++)
+    {
+        if(y < height)
+        {
+            for(int i = 0; i < 5; i++)
+            {
+                args.src[i] = raw.row(mirror(y - 2 + i, height));
+            }
+            args.greenOut = pGreen + (size_t)y * width;
+
+            if((y & 1) == 0)
+            {
+                debayerEdgeGreenRow<P, T, 0>(args, simdGreenRow, width);
+            }
+            else
+            {
+                debayerEdgeGreenRow<P, T, 1>(args, simdGreenRow, width);
+            }
+        }
+
+        int colorY = y - 1;
+        if(colorY < 0)
+        {
+            continue;
+        }
+
+        for(int i = 0; i < 3; i++)
+        {
+            int rowY = mirror(colorY - 1 + i, height);
+            args.src[1 + i] = raw.row(rowY);
+            args.green[i] = pGreen + (size_t)rowY * width;
+        }
+        args.dst = frameArgs.pDst + (size_t)colorY * frameArgs.dstStride;
+
+        if((colorY & 1) == 0)
+        {
+            debayerEdgeColorRow<P, T, 0>(args, simdColorRow, width);
+        }
+        else
+        {
+            debayerEdgeColorRow<P, T, 1>(args, simdColorRow, width);
+        }
+    }
+}
+
+/***** the dispatch table *****/
+
+#define BAYER_KERNEL_SET(pattern, PixelT) \
+    { pattern, PixelTraits<PixelT>::IMG_FORMAT, debayerBilinear<pattern, PixelT>, debayerEdgeAware<pattern, PixelT> }
+
+static const BayerKernelSet KERNEL_SETS[4][2] = //[POABayerPattern][RAW8, RAW16]
+{
+    { BAYER_KERNEL_SET(POA_BAYER_RG, unsigned char), BAYER_KERNEL_SET(POA_BAYER_RG, uint16_t) },
+    { BAYER_KERNEL_SET(POA_BAYER_BG, unsigned char), BAYER_KERNEL_SET(POA_BAYER_BG, uint16_t) },
+    { BAYER_KERNEL_SET(POA_BAYER_GR, unsigned char), BAYER_KERNEL_SET(POA_BAYER_GR, uint16_t) },
+    { BAYER_KERNEL_SET(POA_BAYER_GB, unsigned char), BAYER_KERNEL_SET(POA_BAYER_GB, uint16_t) }
+};
+
+#undef BAYER_KERNEL_SET
+
+static int formatIndex(POAImgFormat imgFormat)
+{
+    return imgFormat == POA_RAW8 ? 0 : (imgFormat == POA_RAW16 ? 1 : -1);
+}
+
+BayerDispatch::BayerDispatch()
+{
+    m_bayerPattern = POA_BAYER_MONO;
+    m_pSets[0] = nullptr;
+    m_pSets[1] = nullptr;
+}
+
+BayerDispatch::BayerDispatch(const POACameraProperties &cameraProp)
+{
+    m_bayerPattern = cameraProp.isColorCamera == POA_TRUE ? cameraProp.bayerPattern : POA_BAYER_MONO;
+    m_pSets[0] = nullptr;
+    m_pSets[1] = nullptr;
+
+    for(int i = 0; i < 8 && cameraProp.imgFormats[i] != POA_END; i++)
+    {
+        int index = formatIndex(cameraProp.imgFormats[i]);
+        if(index >= 0)
+        {
+            m_pSets[index] = find(m_bayerPattern, cameraProp.imgFormats[i]);
+        }
+    }
+}
+
+const BayerKernelSet *BayerDispatch::select(POABayerPattern bayerPattern, POAImgFormat imgFormat) const
+{
+    int index = formatIndex(imgFormat);
+    if(bayerPattern == m_bayerPattern && index >= 0 && m_pSets[index])
+    {
+        return m_pSets[index];
+    }
+
+    return find(bayerPattern, imgFormat); //eg: a view at an odd position has a shifted pattern
+}
+
+const BayerKernelSet *BayerDispatch::find(POABayerPattern bayerPattern, POAImgFormat imgFormat)
+{
+    int index = formatIndex(imgFormat);
+    if(index < 0 || bayerPattern < POA_BAYER_RG || bayerPattern > POA_BAYER_GB)
+    {
+        return nullptr;
+    }
+
+    return &KERNEL_SETS[bayerPattern][index];
+}
@@ -0,0 +1,87 @@
+#ifndef BAYERKERNELS_H
+#define BAYERKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PlayerOneCamera.h"
+#include "Frame.h"
+
+struct DebayerKernelTable;
+
+/*******************************************************************************
+The pixel processing kernels of the bayer frames, specialized at compile time for
+each bayer pattern and pixel type(template <POABayerPattern, PixelT>): the color of
+every pixel and the type of every row are constants of the instantiation, the inner
+loops step over the 2 pixels of a bayer cell and never branch on the pattern or the
+format. A BayerDispatch is built once from POACameraProperties, then the kernels of
+a frame are picked by one table lookup.
+*******************************************************************************/
+
+template <POABayerPattern P>
+struct BayerTraits //the position of the red pixel in the 2x2 cell
+{
+    static const int RED_X = (P == POA_BAYER_GR || P == POA_BAYER_BG) ? 1 : 0;
+    static const int RED_Y = (P == POA_BAYER_GB || P == POA_BAYER_BG) ? 1 : 0;
+};
+
+template <POABayerPattern P, int Y>
+struct BayerRowTraits //Y: the row parity
+{
+    static const bool RED_ROW = ((Y ^ BayerTraits<P>::RED_Y) & 1) == 0; //red and green pixels, else blue and green
+    static const int COLOR_X = RED_ROW ? BayerTraits<P>::RED_X : (BayerTraits<P>::RED_X ^ 1); //x parity of red or blue
+};
+
+template <typename PixelT>
+struct PixelTraits;
+
+template <>
+struct PixelTraits<unsigned char>
+{
+    static const POAImgFormat IMG_FORMAT = POA_RAW8;
+    static const int MAX_VALUE = 255;
+};
+
+template <>
+struct PixelTraits<uint16_t>
+{
+    static const POAImgFormat IMG_FORMAT = POA_RAW16;
+    static const int MAX_VALUE = 65535;
+};
+
+struct BayerFrameArgs
+{
+    const Frame *pRaw;
+    unsigned char *pDst;              //3 channels per pixel, B G R
+    size_t dstStride;
+    const DebayerKernelTable *pSimd;  //nullptr: the scalar kernels only
+    uint16_t *pGreen;                 //width * height, the green plane of the edge aware debayer
+};
+
+typedef void (*BayerFrameFunc)(const BayerFrameArgs &args);
+
+struct BayerKernelSet //the kernels of one bayer pattern and pixel type
+{
+    POABayerPattern bayerPattern;
+    POAImgFormat imgFormat;
+    BayerFrameFunc debayerBilinear;
+    BayerFrameFunc debayerEdgeAware;
+};
+
+class BayerDispatch
+{
+public:
+    BayerDispatch(); //no camera, every frame is looked up by find()
+
+    explicit BayerDispatch(const POACameraProperties &cameraProp); //the kernels of the pattern and the RAW formats of the camera
+
+    const BayerKernelSet *select(POABayerPattern bayerPattern, POAImgFormat imgFormat) const;
+
+    static const BayerKernelSet *find(POABayerPattern bayerPattern, POAImgFormat imgFormat); //nullptr if not a RAW8/RAW16 bayer frame
+
+private:
+    POABayerPattern m_bayerPattern;
+    const BayerKernelSet *m_pSets[2]; //RAW8, RAW16
+};
+
+#endif // BAYERKERNELS_H
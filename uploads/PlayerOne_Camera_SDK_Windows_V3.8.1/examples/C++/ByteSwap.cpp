@@ -0,0 +1,75 @@
+#include "ByteSwap.h"
+
+using namespace std;
+
+static ByteSwapFunc kernel(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SSE41:
+        return byteSwapKernelSSE41();
+    case SIMD_AVX2:
+        return byteSwapKernelAVX2();
+    case SIMD_AVX512:
+        return byteSwapKernelAVX512();
+    default:
+        return nullptr;
+    }
+}
+
+static void toBigEndian16Scalar(const uint16_t *pSrc, uint16_t *pDst, size_t count, uint16_t xorMask)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        uint16_t value = pSrc[i] ^ xorMask;
+        pDst[i] = (uint16_t)((value << 8) | (value >> 8));
+    }
+}
+
+static void toBigEndian16With(ByteSwapFunc func, const uint16_t *pSrc, uint16_t *pDst, size_t count, uint16_t xorMask)
+{
+    size_t done = func ? func(pSrc, pDst, count, xorMask) : 0;
+    toBigEndian16Scalar(pSrc + done, pDst + done, count - done, xorMask);
+}
+
+void ByteSwap::toBigEndian16(const uint16_t *pSrc, uint16_t *pDst, size_t count, uint16_t xorMask)
+{
+    static const ByteSwapFunc bestKernel = kernel(bestLevel()); //picked once
+
+    toBigEndian16With(bestKernel, pSrc, pDst, count, xorMask);
+}
+
+bool ByteSwap::toBigEndian16(const uint16_t *pSrc, uint16_t *pDst, size_t count, uint16_t xorMask, SimdLevel level)
+{
+    if(!isAvailable(level))
+    {
+        return false;
+    }
+
+    toBigEndian16With(kernel(level), pSrc, pDst, count, xorMask);
+
+    return true;
+}
+
+SimdLevel ByteSwap::bestLevel()
+{
+    for(int level = CpuFeatures::bestLevel(); level > SIMD_SCALAR; level--)
+    {
+        if(isAvailable((SimdLevel)level))
+        {
+            return (SimdLevel)level;
+        }
+    }
+
+    return SIMD_SCALAR;
+}
+
+bool ByteSwap::isAvailable(SimdLevel level)
+{
+    if(level == SIMD_SCALAR)
+    {
+        return true;
+    }
+
+    return CpuFeatures::isSupported(level) && kernel(level) != nullptr;
+}
@@ -0,0 +1,80 @@
+#ifndef BYTESWAP_H
+#define BYTESWAP_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CpuFeatures.h"
+
+/*******************************************************************************
+Conversion of the 16 bit pixels to big endian, the byte order of FITS.
+The pixels can be xor-ed with a mask before swapping, eg: 0x8000 turns the
+unsigned pixels into the signed values of BITPIX 16 with BZERO 32768.
+The kernel of the best SIMD level of the CPU is used(AVX-512, AVX2, SSE4.1),
+so the conversion runs at the speed of the memory, not of the pixel loop.
+The host is little endian(x86, ARM of Windows).
+*******************************************************************************/
+
+typedef size_t (*ByteSwapFunc)(const uint16_t *pSrc, uint16_t *pDst, size_t count, uint16_t xorMask);
+
+// nullptr if the file was built without the flags of the level
+ByteSwapFunc byteSwapKernelSSE41();
+
+ByteSwapFunc byteSwapKernelAVX2();
+
+ByteSwapFunc byteSwapKernelAVX512();
+
+class ByteSwap
+{
+public:
+    // pDst[i] = big endian(pSrc[i] ^ xorMask), pSrc and pDst can be the same buffer
+    static void toBigEndian16(const uint16_t *pSrc, uint16_t *pDst, size_t count, uint16_t xorMask = 0);
+
+    // the same with the kernel of the level, return false if it's not available
+    static bool toBigEndian16(const uint16_t *pSrc, uint16_t *pDst, size_t count, uint16_t xorMask, SimdLevel level);
+
+    static SimdLevel bestLevel(); //the level used by toBigEndian16
+
+    static bool isAvailable(SimdLevel level); //supported by the CPU and the kernel is built in
+};
+
+#ifdef POA_SIMD_NAMESPACE // included by ByteSwap_<level>.cpp after SimdOps.h
+
+namespace POA_SIMD_NAMESPACE
+{
+
+// return the count of the converted pixels, the rest(less than a vector) is left to the scalar code
+template <class Ops>
+static size_t toBigEndian16(const uint16_t *pSrc, uint16_t *pDst, size_t count, uint16_t xorMask)
+{
+    typedef typename Ops::V V;
+
+    const V mask = Ops::set1(xorMask);
+
+    size_t i = 0;
+    for(; i + 4 * Ops::LANES <= count; i += 4 * Ops::LANES) //4 vectors per loop, the loads are independent
+    {
+        V v0 = Ops::load(pSrc + i);
+        V v1 = Ops::load(pSrc + i + Ops::LANES);
+        V v2 = Ops::load(pSrc + i + 2 * Ops::LANES);
+        V v3 = Ops::load(pSrc + i + 3 * Ops::LANES);
+
+        Ops::store(pDst + i, Ops::swapBytes(Ops::bitXor(v0, mask)));
+        Ops::store(pDst + i + Ops::LANES, Ops::swapBytes(Ops::bitXor(v1, mask)));
+        Ops::store(pDst + i + 2 * Ops::LANES, Ops::swapBytes(Ops::bitXor(v2, mask)));
+        Ops::store(pDst + i + 3 * Ops::LANES, Ops::swapBytes(Ops::bitXor(v3, mask)));
+    }
+
+    for(; i + Ops::LANES <= count; i += Ops::LANES)
+    {
+        Ops::store(pDst + i, Ops::swapBytes(Ops::bitXor(Ops::load(pSrc + i), mask)));
+    }
+
+    return i;
+}
+
+} // namespace POA_SIMD_NAMESPACE
+
+#endif // POA_SIMD_NAMESPACE
+
+#endif // BYTESWAP_H
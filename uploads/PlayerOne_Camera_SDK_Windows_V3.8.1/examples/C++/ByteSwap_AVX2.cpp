@@ -0,0 +1,22 @@
+// the AVX2 kernel of ByteSwap, this file is compiled with -mavx2 or /arch:AVX2(see CMakeLists.txt)
+#if defined(__AVX2__)
+
+#define POA_SIMD_AVX2
+#include "SimdOps.h"
+#include "ByteSwap.h"
+
+ByteSwapFunc byteSwapKernelAVX2()
+{
+    return POA_SIMD_NAMESPACE::toBigEndian16<POA_SIMD_NAMESPACE::VecU16>;
+}
+
+#else
+
+#include "ByteSwap.h"
+
+ByteSwapFunc byteSwapKernelAVX2()
+{
+    return nullptr; //built without the AVX2 flags, the kernel is not available
+}
+
+#endif
@@ -0,0 +1,22 @@
+// the AVX-512 kernel of ByteSwap, this file is compiled with -mavx512f -mavx512bw or /arch:AVX512(see CMakeLists.txt)
+#if defined(__AVX512BW__)
+
+#define POA_SIMD_AVX512
+#include "SimdOps.h"
+#include "ByteSwap.h"
+
+ByteSwapFunc byteSwapKernelAVX512()
+{
+    return POA_SIMD_NAMESPACE::toBigEndian16<POA_SIMD_NAMESPACE::VecU16>;
+}
+
+#else
+
+#include "ByteSwap.h"
+
+ByteSwapFunc byteSwapKernelAVX512()
+{
+    return nullptr; //built without the AVX-512 flags, the kernel is not available
+}
+
+#endif
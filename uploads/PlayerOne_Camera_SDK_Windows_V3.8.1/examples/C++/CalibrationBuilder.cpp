@@ -0,0 +1,606 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "CalibrationBuilder.h"
+#include "POACamera.h"
+
+using namespace std;
+
+namespace
+{
+
+template<typename T>
+double sumRow(const T *pSrc, const float *pBias, size_t count)
+{
+    double sum = 0.0;
+    for(size_t i = 0; i < count; i++)
+    {
+        sum += (double)pSrc[i] - (pBias ? pBias[i] : 0.0f);
+    }
+    return sum;
+}
+
+const int SIGMA_PRIOR_FRAMES = 4; //the sigma of the frames weighs as much as 4 values of the sample
+
+inline float median3(float a, float b, float c)
+{
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+inline int bucketIndex(float x, float center, float invWidth)
+{
+    int k = (int)std::floor((x - center) * invWidth) + CalibrationBuilder::MEDIAN_BUCKETS / 2;
+    return std::min(std::max(k, 0), CalibrationBuilder::MEDIAN_BUCKETS - 1);
+}
+
+inline int bucketTotal(const uint8_t *pBuckets)
+{
+    int total = 0;
+    for(int k = 0; k < CalibrationBuilder::MEDIAN_BUCKETS; k++)
+    {
+        total += pBuckets[k];
+    }
+    return total;
+}
+
+inline void addToBuckets(uint8_t *pBuckets, int k)
+{
+    if(++pBuckets[k] == 255) //halve all the buckets of the sample, the median keeps its place
+    {
+        for(int j = 0; j < CalibrationBuilder::MEDIAN_BUCKETS; j++)
+        {
+            pBuckets[j] = (uint8_t)((pBuckets[j] + 1) >> 1);
+        }
+    }
+}
+
+} // namespace
+
+CalibrationBuilder::CalibrationBuilder(int threadCount)
+    : m_parallel(threadCount), m_type(CALIB_BIAS), m_method(COMBINE_MEAN), m_bStarted(false), m_kappa(3.0), m_pBias(nullptr),
+      m_nChannels(1), m_nRowSamples(0), m_nSamples(0), m_nFrameCount(0), m_sigma(0.0), m_sigmaFloor(0.5f)
+{
+    for(int k = 0; k < WARMUP_FRAMES; k++)
+    {
+        m_warmupScale[k] = 1.0f;
+    }
+}
+
+bool CalibrationBuilder::start(CalibrationType type, CombineMethod method, POACamera &camera)
+{
+    CalibrationTags tags;
+    tags.exposureUs = camera.getExposure();
+    tags.gain = camera.getGain();
+    tags.offset = camera.getOffset();
+    tags.bin = camera.getImageBin();
+    tags.hasTemperature = camera.getTemperature(tags.temperature);
+    tags.sensorMode = camera.getSensorMode();
+
+    return start(type, method, tags);
+}
+
+bool CalibrationBuilder::start(CalibrationType type, CombineMethod method, const CalibrationTags &tags)
+{
+    releaseAccumulators();
+
+    m_type = type;
+    m_method = method;
+    m_tags = tags;
+    m_tags.width = 0; //the size and format come from the first frame
+    m_tags.height = 0;
+    m_tags.imgFormat = POA_END;
+    m_tags.frameCount = 0;
+    m_nFrameCount = 0;
+    m_sigma = 0.0;
+    m_bStarted = true;
+
+    return true;
+}
+
+bool CalibrationBuilder::initFirstFrame(const Frame &frame)
+{
+    POAImgFormat imgFormat = frame.imgFormat();
+    if(imgFormat != POA_RAW8 && imgFormat != POA_RAW16 && imgFormat != POA_MONO8 && imgFormat != POA_RGB24)
+    {
+        cerr << "add calibration frame failed, unsupported image format" << endl;
+        return false;
+    }
+
+    m_nChannels = (imgFormat == POA_RGB24) ? 3 : 1;
+    m_nRowSamples = (size_t)frame.width() * m_nChannels;
+    m_nSamples = m_nRowSamples * frame.height();
+
+    if(m_type == CALIB_FLAT && m_pBias &&
+            (m_pBias->width != frame.width() || m_pBias->height != frame.height() || m_pBias->channels != m_nChannels))
+    {
+        cerr << "add calibration frame failed, the bias master doesn't match the frame" << endl;
+        return false;
+    }
+
+    m_tags.width = frame.width();
+    m_tags.height = frame.height();
+    m_tags.imgFormat = imgFormat;
+    m_tags.bayerPattern = frame.bayerPattern();
+    m_tags.startX = frame.startX;
+    m_tags.startY = frame.startY;
+    if(frame.bin > 0)
+    {
+        m_tags.bin = frame.bin;
+    }
+    if(frame.exposureUs > 0)
+    {
+        m_tags.exposureUs = frame.exposureUs;
+    }
+
+    m_rowRejected.assign(frame.height(), 0);
+    m_rowSums.assign(frame.height(), 0.0);
+
+    if(m_method == COMBINE_MEAN)
+    {
+        m_mean.assign(m_nSamples, 0.0f);
+    }
+    else
+    {
+        m_warmup.assign(m_nSamples * WARMUP_FRAMES, 0);
+    }
+
+    return true;
+}
+
+bool CalibrationBuilder::addFrame(const Frame &frame)
+{
+    if(!m_bStarted)
+    {
+        cerr << "add calibration frame failed, not started" << endl;
+        return false;
+    }
+
+    if(!frame.isValid())
+    {
+        return false;
+    }
+
+    if(m_nFrameCount == 0)
+    {
+        if(!initFirstFrame(frame))
+        {
+            return false;
+        }
+    }
+    else if(frame.width() != m_tags.width || frame.height() != m_tags.height || frame.imgFormat() != m_tags.imgFormat ||
+            (frame.bin > 0 && frame.bin != m_tags.bin) || (frame.exposureUs > 0 && m_tags.exposureUs > 0 && frame.exposureUs != m_tags.exposureUs))
+    {
+        cerr << "add calibration frame failed, the frame doesn't match the first one(size, format, bin or exposure)" << endl;
+        return false;
+    }
+
+    if(m_method == COMBINE_KAPPA_SIGMA && m_nFrameCount >= 65535) //the counters are 16 bit
+    {
+        cerr << "add calibration frame failed, too many frames" << endl;
+        return false;
+    }
+
+    float scale = 1.0f;
+    if(m_type == CALIB_FLAT)
+    {
+        double mean = frameMean(frame);
+        if(mean <= 0.0)
+        {
+            cerr << "add calibration frame failed, the flat frame is black" << endl;
+            return false;
+        }
+        scale = (float)(1.0 / mean);
+    }
+
+    m_nFrameCount++;
+
+    if(m_method != COMBINE_MEAN && m_nFrameCount <= WARMUP_FRAMES)
+    {
+        m_warmupScale[m_nFrameCount - 1] = scale;
+    }
+
+    bool is16Bit = frame.imgFormat() == POA_RAW16;
+    m_parallel.run(frame.height(), [this, &frame, scale, is16Bit](int rowBegin, int rowEnd)
+    {
+        if(is16Bit)
+        {
+            accumulateRows<uint16_t>(frame, scale, rowBegin, rowEnd);
+        }
+        else
+        {
+            accumulateRows<uint8_t>(frame, scale, rowBegin, rowEnd);
+        }
+    });
+
+    if(m_method != COMBINE_MEAN && m_nFrameCount == WARMUP_FRAMES)
+    {
+        endWarmup();
+    }
+
+    return true;
+}
+
+double CalibrationBuilder::frameMean(const Frame &frame)
+{
+    bool is16Bit = frame.imgFormat() == POA_RAW16;
+    m_parallel.run(frame.height(), [this, &frame, is16Bit](int rowBegin, int rowEnd)
+    {
+        for(int y = rowBegin; y < rowEnd; y++)
+        {
+            const float *pBias = m_pBias ? m_pBias->row(y) : nullptr;
+            m_rowSums[y] = is16Bit ? sumRow((const uint16_t *)frame.row(y), pBias, m_nRowSamples)
+                                   : sumRow((const uint8_t *)frame.row(y), pBias, m_nRowSamples);
+        }
+    });
+
+    double sum = 0.0;
+    for(size_t y = 0; y < m_rowSums.size(); y++)
+    {
+        sum += m_rowSums[y];
+    }
+
+    return sum / (double)m_nSamples;
+}
+
+template<typename T>
+void CalibrationBuilder::accumulateRows(const Frame &frame, float scale, int rowBegin, int rowEnd)
+{
+    const float kappa = (float)m_kappa;
+    const float sigma = (float)m_sigma;
+    const float invWidth = 2.0f / sigma; //buckets of sigma / 2
+    const float priorM2 = sigma * sigma * SIGMA_PRIOR_FRAMES;
+    const float invN = 1.0f / (float)m_nFrameCount;
+    const int halfFrames = m_nFrameCount / 2;
+    const bool isWarmup = m_method != COMBINE_MEAN && m_nFrameCount <= WARMUP_FRAMES;
+
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        const T *pSrc = (const T *)frame.row(y);
+        const size_t base = (size_t)y * m_nRowSamples;
+
+        if(isWarmup) //keep the raw values, they are combined when the warmup ends
+        {
+            uint16_t *pDst = &m_warmup[(size_t)(m_nFrameCount - 1) * m_nSamples + base];
+            for(size_t i = 0; i < m_nRowSamples; i++)
+            {
+                pDst[i] = pSrc[i];
+            }
+            continue;
+        }
+
+        const float *pBias = m_pBias ? m_pBias->row(y) : nullptr;
+
+        if(m_method == COMBINE_MEAN)
+        {
+            float *pMean = &m_mean[base];
+            for(size_t i = 0; i < m_nRowSamples; i++)
+            {
+                float x = ((float)pSrc[i] - (pBias ? pBias[i] : 0.0f)) * scale;
+                pMean[i] += (x - pMean[i]) * invN;
+            }
+        }
+        else if(m_method == COMBINE_MEDIAN)
+        {
+            float *pCenter = &m_center[base];
+            uint8_t *pBuckets = &m_buckets[base * MEDIAN_BUCKETS];
+            for(size_t i = 0; i < m_nRowSamples; i++)
+            {
+                float x = ((float)pSrc[i] - (pBias ? pBias[i] : 0.0f)) * scale;
+                uint8_t *pSample = pBuckets + i * MEDIAN_BUCKETS;
+                int k = bucketIndex(x, pCenter[i], invWidth);
+                if((k == 0 || k == MEDIAN_BUCKETS - 1) && 2 * pSample[k] >= bucketTotal(pSample))
+                {
+                    // most values are beyond the buckets, the center was taken from outliers(eg: 2 of the 3 warmup frames), restart from this one
+                    pCenter[i] = x;
+                    std::fill(pSample, pSample + MEDIAN_BUCKETS, (uint8_t)0);
+                    k = MEDIAN_BUCKETS / 2;
+                }
+                addToBuckets(pSample, k);
+            }
+        }
+        else
+        {
+            float *pMean = &m_mean[base];
+            float *pM2 = &m_m2[base];
+            uint16_t *pCount = &m_count[base];
+            unsigned long long rejected = 0;
+            for(size_t i = 0; i < m_nRowSamples; i++)
+            {
+                float x = ((float)pSrc[i] - (pBias ? pBias[i] : 0.0f)) * scale;
+                int n = pCount[i];
+                float sd = std::sqrt((pM2[i] + priorM2) / (float)(n - 1 + SIGMA_PRIOR_FRAMES));
+                float delta = x - pMean[i];
+                if(std::fabs(delta) > kappa * sd)
+                {
+                    rejected++;
+                    if(n >= halfFrames) //else most values were rejected, the mean was taken from outliers(eg: 2 of the 3 warmup frames), restart from this one
+                    {
+                        continue;
+                    }
+                    n = 0;
+                    pMean[i] = x;
+                    pM2[i] = 0.0f;
+                    delta = 0.0f;
+                }
+                n++;
+                pMean[i] += delta / (float)n;
+                pM2[i] += delta * (x - pMean[i]);
+                pCount[i] = (uint16_t)n;
+            }
+            m_rowRejected[y] += rejected;
+        }
+    }
+}
+
+float CalibrationBuilder::warmupSample(int k, size_t i) const
+{
+    float x = (float)m_warmup[(size_t)k * m_nSamples + i];
+    if(m_pBias)
+    {
+        x -= m_pBias->data[i];
+    }
+    return x * m_warmupScale[k];
+}
+
+void CalibrationBuilder::estimateSigma()
+{
+    // the MAD of the difference of 2 frames at some samples, robust to the stars, hot pixels and cosmic rays
+    size_t step = std::max((size_t)1, m_nSamples / 65536);
+    vector<float> diffs;
+    diffs.reserve(m_nSamples / step + 1);
+    for(size_t i = 0; i < m_nSamples; i += step)
+    {
+        diffs.push_back(warmupSample(1, i) - warmupSample(0, i));
+    }
+
+    size_t mid = diffs.size() / 2;
+    std::nth_element(diffs.begin(), diffs.begin() + mid, diffs.end());
+    float medianDiff = diffs[mid];
+    vector<float> deviations(diffs.size());
+    for(size_t i = 0; i < diffs.size(); i++)
+    {
+        deviations[i] = std::fabs(diffs[i] - medianDiff);
+    }
+    std::nth_element(deviations.begin(), deviations.begin() + mid, deviations.end());
+
+    // the MAD is a few ADU steps when the values are quantized(eg: 12 bit left aligned), refine it by the clipped standard deviation
+    m_sigmaFloor = 0.5f * (m_warmupScale[0] + m_warmupScale[1]) * 0.5f; //half an ADU
+    float limit = 5.0f * std::max(deviations[mid] * 1.4826f, 2.0f * m_sigmaFloor);
+    double sumSquares = 0.0;
+    size_t count = 0;
+    for(size_t i = 0; i < diffs.size(); i++)
+    {
+        float d = diffs[i] - medianDiff;
+        if(std::fabs(d) <= limit)
+        {
+            sumSquares += (double)d * d;
+            count++;
+        }
+    }
+
+    m_sigma = std::max(std::sqrt(sumSquares / std::max(count, (size_t)1) / 2.0), (double)m_sigmaFloor); //the difference has sqrt(2) times the noise
+}
+
+void CalibrationBuilder::endWarmup()
+{
+    estimateSigma();
+
+    if(m_method == COMBINE_MEDIAN)
+    {
+        m_center.assign(m_nSamples, 0.0f);
+        m_buckets.assign(m_nSamples * MEDIAN_BUCKETS, 0);
+    }
+    else
+    {
+        m_mean.assign(m_nSamples, 0.0f);
+        m_m2.assign(m_nSamples, 0.0f);
+        m_count.assign(m_nSamples, 0);
+    }
+
+    m_parallel.run(m_tags.height, [this](int rowBegin, int rowEnd)
+    {
+        warmupRows(rowBegin, rowEnd);
+    });
+
+    vector<uint16_t>().swap(m_warmup);
+}
+
+void CalibrationBuilder::warmupRows(int rowBegin, int rowEnd)
+{
+    const float kappa = (float)m_kappa;
+    const float sigma = (float)m_sigma;
+    const float invWidth = 2.0f / sigma;
+
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        unsigned long long rejected = 0;
+        size_t end = (size_t)(y + 1) * m_nRowSamples;
+        for(size_t i = (size_t)y * m_nRowSamples; i < end; i++)
+        {
+            float x[WARMUP_FRAMES];
+            for(int k = 0; k < WARMUP_FRAMES; k++)
+            {
+                x[k] = warmupSample(k, i);
+            }
+            float center = median3(x[0], x[1], x[2]);
+
+            if(m_method == COMBINE_MEDIAN)
+            {
+                m_center[i] = center;
+                for(int k = 0; k < WARMUP_FRAMES; k++)
+                {
+                    addToBuckets(&m_buckets[i * MEDIAN_BUCKETS], bucketIndex(x[k], center, invWidth));
+                }
+                continue;
+            }
+
+            // clipped against the median, which is always accepted, so every sample has a value
+            float mean = 0.0f;
+            float m2 = 0.0f;
+            int n = 0;
+            for(int k = 0; k < WARMUP_FRAMES; k++)
+            {
+                if(std::fabs(x[k] - center) > kappa * sigma)
+                {
+                    rejected++;
+                    continue;
+                }
+                n++;
+                float delta = x[k] - mean;
+                mean += delta / (float)n;
+                m2 += delta * (x[k] - mean);
+            }
+            m_mean[i] = mean;
+            m_m2[i] = m2;
+            m_count[i] = (uint16_t)n;
+        }
+        m_rowRejected[y] += rejected;
+    }
+}
+
+void CalibrationBuilder::finishRows(vector<float> &data, int rowBegin, int rowEnd) const
+{
+    const float width = (float)m_sigma * 0.5f;
+
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        size_t end = (size_t)(y + 1) * m_nRowSamples;
+        for(size_t i = (size_t)y * m_nRowSamples; i < end; i++)
+        {
+            if(m_nFrameCount < WARMUP_FRAMES && m_method != COMBINE_MEAN) //too few frames to end the warmup, the mean of them
+            {
+                float sum = 0.0f;
+                for(int k = 0; k < m_nFrameCount; k++)
+                {
+                    sum += warmupSample(k, i);
+                }
+                data[i] = sum / (float)m_nFrameCount;
+            }
+            else if(m_method == COMBINE_MEDIAN)
+            {
+                const uint8_t *pBuckets = &m_buckets[i * MEDIAN_BUCKETS];
+                float half = bucketTotal(pBuckets) * 0.5f;
+                float cumulative = 0.0f;
+                int k = 0;
+                while(k < MEDIAN_BUCKETS - 1 && cumulative + pBuckets[k] < half)
+                {
+                    cumulative += pBuckets[k];
+                    k++;
+                }
+                float fraction = pBuckets[k] ? (half - cumulative) / pBuckets[k] : 0.5f;
+                data[i] = m_center[i] + ((float)(k - MEDIAN_BUCKETS / 2) + fraction) * width;
+            }
+            else
+            {
+                data[i] = m_mean[i];
+            }
+        }
+    }
+}
+
+bool CalibrationBuilder::finish(MasterFrame &master, POACamera *pCamera)
+{
+    if(!m_bStarted || m_nFrameCount == 0)
+    {
+        cerr << "finish calibration failed, no frame" << endl;
+        return false;
+    }
+
+    master.type = m_type;
+    master.width = m_tags.width;
+    master.height = m_tags.height;
+    master.channels = m_nChannels;
+    master.data.resize(m_nSamples);
+
+    m_parallel.run(m_tags.height, [this, &master](int rowBegin, int rowEnd)
+    {
+        finishRows(master.data, rowBegin, rowEnd);
+    });
+
+    if(m_type == CALIB_FLAT) //a mean of 1
+    {
+        double sum = 0.0;
+        for(size_t i = 0; i < m_nSamples; i++)
+        {
+            sum += master.data[i];
+        }
+        float scale = sum > 0.0 ? (float)((double)m_nSamples / sum) : 1.0f;
+        m_parallel.run(m_tags.height, [this, &master, scale](int rowBegin, int rowEnd)
+        {
+            float *pData = &master.data[(size_t)rowBegin * m_nRowSamples];
+            size_t count = (size_t)(rowEnd - rowBegin) * m_nRowSamples;
+            for(size_t i = 0; i < count; i++)
+            {
+                pData[i] *= scale;
+            }
+        });
+    }
+
+    m_tags.frameCount = m_nFrameCount;
+
+    double temperature = 0.0;
+    if(pCamera && pCamera->getTemperature(temperature))
+    {
+        m_tags.temperature = m_tags.hasTemperature ? (m_tags.temperature + temperature) * 0.5 : temperature;
+        m_tags.hasTemperature = true;
+    }
+
+    master.tags = m_tags;
+
+    releaseAccumulators();
+    m_bStarted = false;
+
+    return true;
+}
+
+void CalibrationBuilder::setKappa(double kappa)
+{
+    m_kappa = kappa;
+}
+
+double CalibrationBuilder::getKappa() const
+{
+    return m_kappa;
+}
+
+void CalibrationBuilder::setBiasMaster(const MasterFrame *pBias)
+{
+    m_pBias = (pBias && pBias->isValid()) ? pBias : nullptr;
+}
+
+int CalibrationBuilder::frameCount() const
+{
+    return m_nFrameCount;
+}
+
+unsigned long long CalibrationBuilder::rejectedSamples() const
+{
+    unsigned long long rejected = 0;
+    for(size_t y = 0; y < m_rowRejected.size(); y++)
+    {
+        rejected += m_rowRejected[y];
+    }
+    return rejected;
+}
+
+double CalibrationBuilder::noiseSigma() const
+{
+    return m_sigma;
+}
+
+size_t CalibrationBuilder::memoryBytes() const
+{
+    return m_mean.capacity() * sizeof(float) + m_m2.capacity() * sizeof(float) + m_count.capacity() * sizeof(uint16_t) +
+           m_center.capacity() * sizeof(float) + m_buckets.capacity() + m_warmup.capacity() * sizeof(uint16_t);
+}
+
+void CalibrationBuilder::releaseAccumulators()
+{
+    vector<float>().swap(m_mean);
+    vector<float>().swap(m_m2);
+    vector<uint16_t>().swap(m_count);
+    vector<float>().swap(m_center);
+    vector<uint8_t>().swap(m_buckets);
+    vector<uint16_t>().swap(m_warmup);
+}
@@ -0,0 +1,196 @@
+#ifndef CALIBRATIONBUILDER_H
+#define CALIBRATIONBUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "Frame.h"
+#include "ParallelRows.h"
+
+class POACamera;
+
+/*******************************************************************************
+Builds the master bias, dark and flat frames from the frames of the capture(eg:
+POACamera::popFrame()), one frame at a time, without keeping the stack.
+The combine methods:
+COMBINE_MEAN: the running mean, 4 bytes per sample.
+COMBINE_MEDIAN: the running median by bucketing. The first 3 frames are kept to get
+the center(median of 3) of every sample and the noise(sigma) of the frames, then
+every sample has 8 counters(buckets of sigma / 2 around the center, the outer ones
+take all the values beyond), the median is interpolated in the bucket of the middle
+count. A sample which has most of its values in an outer bucket restarts from the last
+one. 12 bytes per sample.
+COMBINE_KAPPA_SIGMA: the running mean and variance of every sample(Welford), a value
+further than kappa * sigma from the mean is rejected(sigma of the sample, with the
+sigma of the frames as a prior of 4 values, so a sample with few values is not clipped
+too tight). The first 3 frames are clipped against their median, a sample which rejects
+most of its values restarts from the last one. 10 bytes per sample.
+The first 3 frames are kept(2 bytes per sample each) until the warmup ends, so the memory
+is a few frames whatever the count of the frames.
+The flat frames are divided by their mean(after subtracting the bias master, see
+setBiasMaster()) before they are combined, the master flat has a mean of 1.
+Every frame and the final combine are split into row tiles run on all cores(ParallelRows).
+The frames are RAW8, RAW16, MONO8 or RGB24(3 samples per pixel), RAW16 is combined
+as the camera sends it(left aligned).
+*******************************************************************************/
+
+enum CalibrationType
+{
+    CALIB_BIAS,
+    CALIB_DARK,
+    CALIB_FLAT
+};
+
+enum CombineMethod
+{
+    COMBINE_MEAN,
+    COMBINE_MEDIAN,
+    COMBINE_KAPPA_SIGMA
+};
+
+struct CalibrationTags //the state of the camera when the frames were taken
+{
+    long exposureUs;
+    long gain;
+    long offset;
+    int bin;
+    bool hasTemperature;
+    double temperature;     //POA_TEMPERATURE, Celsius, the mean of the start and the end
+    int sensorMode;         //-1 if the camera has no sensor modes
+    POAImgFormat imgFormat;
+    POABayerPattern bayerPattern;
+    int width;
+    int height;
+    int startX;
+    int startY;
+    int frameCount;         //the frames combined
+
+    CalibrationTags()
+    {
+        exposureUs = 0;
+        gain = -1;
+        offset = -1;
+        bin = 1;
+        hasTemperature = false;
+        temperature = 0.0;
+        sensorMode = -1;
+        imgFormat = POA_END;
+        bayerPattern = POA_BAYER_MONO;
+        width = 0;
+        height = 0;
+        startX = 0;
+        startY = 0;
+        frameCount = 0;
+    }
+};
+
+struct MasterFrame
+{
+    CalibrationType type;
+    CalibrationTags tags;
+    int width;
+    int height;
+    int channels;            //3 for RGB24, else 1
+    std::vector<float> data; //width * height * channels, ADU(bias, dark) or relative(flat)
+
+    MasterFrame()
+    {
+        type = CALIB_BIAS;
+        width = 0;
+        height = 0;
+        channels = 1;
+    }
+
+    bool isValid() const { return !data.empty(); }
+
+    const float *row(int y) const { return &data[(size_t)y * width * channels]; }
+};
+
+class CalibrationBuilder
+{
+public:
+    explicit CalibrationBuilder(int threadCount = 0); //0: all cores
+
+    // start a new master, the tags are read from the camera(exposure, gain, offset, bin, temperature, sensor mode)
+    bool start(CalibrationType type, CombineMethod method, POACamera &camera);
+
+    bool start(CalibrationType type, CombineMethod method, const CalibrationTags &tags);
+
+    // the frames must have the size, format and bin of the first one(and its exposure if the frames have it)
+    bool addFrame(const Frame &frame);
+
+    // combine the frames, the temperature tag is the mean of the start and the end if pCamera is given
+    bool finish(MasterFrame &master, POACamera *pCamera = nullptr);
+
+    void setKappa(double kappa); //default is 3.0
+
+    double getKappa() const;
+
+    // the bias(or the dark of the flats) subtracted from the flat frames, nullptr for none, it must be valid until finish()
+    void setBiasMaster(const MasterFrame *pBias);
+
+    int frameCount() const;
+
+    unsigned long long rejectedSamples() const; //the samples rejected by kappa-sigma
+
+    double noiseSigma() const; //the sigma of the frames, known after the warmup
+
+    size_t memoryBytes() const; //the bytes of the accumulators
+
+    static const int WARMUP_FRAMES = 3;
+
+    static const int MEDIAN_BUCKETS = 8;
+
+private:
+    CalibrationBuilder(const CalibrationBuilder &);
+    CalibrationBuilder &operator=(const CalibrationBuilder &);
+
+    bool initFirstFrame(const Frame &frame);
+
+    double frameMean(const Frame &frame); //the mean of the samples minus the bias
+
+    void estimateSigma();
+
+    void endWarmup();
+
+    template<typename T>
+    void accumulateRows(const Frame &frame, float scale, int rowBegin, int rowEnd);
+
+    void warmupRows(int rowBegin, int rowEnd);
+
+    void finishRows(std::vector<float> &data, int rowBegin, int rowEnd) const;
+
+    float warmupSample(int k, size_t i) const; //the sample i of the warmup frame k, minus the bias and scaled
+
+    void releaseAccumulators();
+
+    ParallelRows m_parallel;
+
+    CalibrationType m_type;
+    CombineMethod m_method;
+    CalibrationTags m_tags;
+    bool m_bStarted;
+    double m_kappa;
+    const MasterFrame *m_pBias;
+
+    int m_nChannels;
+    size_t m_nRowSamples;       //width * channels
+    size_t m_nSamples;
+    int m_nFrameCount;
+    double m_sigma;             //the noise of a frame, in the unit of the samples
+    float m_sigmaFloor;         //half an ADU, the noise can't be lower
+
+    std::vector<float> m_mean;         //MEAN, KAPPA_SIGMA
+    std::vector<float> m_m2;           //KAPPA_SIGMA, the sum of the squared differences
+    std::vector<uint16_t> m_count;     //KAPPA_SIGMA, the values accepted
+    std::vector<float> m_center;       //MEDIAN
+    std::vector<uint8_t> m_buckets;    //MEDIAN, MEDIAN_BUCKETS per sample
+    std::vector<uint16_t> m_warmup;    //the first frames, WARMUP_FRAMES * m_nSamples
+    float m_warmupScale[WARMUP_FRAMES];
+    std::vector<unsigned long long> m_rowRejected; //per row, so the tiles don't share a counter
+    std::vector<double> m_rowSums;     //per row, the mean of a flat frame
+};
+
+#endif // CALIBRATIONBUILDER_H
@@ -0,0 +1,467 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "Calibrator.h"
+#include "CalibratorKernels.h"
+
+using namespace std;
+
+static const CalibratorKernelTable *kernels(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SSE41:
+        return calibratorKernelsSSE41();
+    case SIMD_AVX2:
+        return calibratorKernelsAVX2();
+    case SIMD_AVX512:
+        return calibratorKernelsAVX512();
+    default:
+        return nullptr;
+    }
+}
+
+static bool isPlaneMaster(const MasterFrame *pMaster, const MasterFrame *pFirst)
+{
+    return pMaster->channels == 1 && pMaster->width == pFirst->width && pMaster->height == pFirst->height;
+}
+
+// the values quantized to a step of maxAbs / maxCode
+template<typename CodeT>
+static float quantize(const float *pValues, size_t count, float minValue, float maxCode, vector<CodeT> &codes)
+{
+    float maxAbs = 0.0f;
+    for(size_t i = 0; i < count; i++)
+    {
+        maxAbs = std::max(maxAbs, std::fabs(std::max(pValues[i], minValue)));
+    }
+
+    float step = maxAbs > 0.0f ? maxAbs / maxCode : 1.0f;
+    float invStep = 1.0f / step;
+
+    codes.resize(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        float code = std::min(std::max(std::max(pValues[i], minValue) * invStep, -maxCode), maxCode);
+        codes[i] = (CodeT)std::lrint(code);
+    }
+
+    return step;
+}
+
+// the dark minus the bias
+static vector<float> thermalPlane(const float *pBias, const float *pDark, size_t count)
+{
+    vector<float> thermal(pDark, pDark + count);
+    if(pBias)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            thermal[i] -= pBias[i];
+        }
+    }
+    return thermal;
+}
+
+// the median and the sigma(by the MAD) of some values of the plane
+static void robustStats(const vector<float> &values, float &median, float &sigma)
+{
+    size_t step = std::max((size_t)1, values.size() / 65536);
+    vector<float> samples;
+    for(size_t i = 0; i < values.size(); i += step)
+    {
+        samples.push_back(values[i]);
+    }
+
+    size_t mid = samples.size() / 2;
+    std::nth_element(samples.begin(), samples.begin() + mid, samples.end());
+    median = samples[mid];
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        samples[i] = std::fabs(samples[i] - median);
+    }
+    std::nth_element(samples.begin(), samples.begin() + mid, samples.end());
+    sigma = samples[mid] * 1.4826f;
+}
+
+static const float *masterPixels(const MasterFrame *pMaster)
+{
+    return (pMaster && pMaster->isValid()) ? pMaster->data.data() : nullptr;
+}
+
+Calibrator::Calibrator()
+    : m_nWidth(0), m_nHeight(0), m_darkScale(1.0), m_darkStep(1.0f), m_biasStep(1.0f), m_flatStep(1.0f),
+      m_neighboursPattern(POA_BAYER_MONO), m_bNeighboursReady(false)
+{
+}
+
+bool Calibrator::prepare(const MasterFrame *pBias, const MasterFrame *pDark, const MasterFrame *pFlat)
+{
+    const MasterFrame *pFirst = pBias ? pBias : (pDark ? pDark : pFlat);
+    if(!pFirst)
+    {
+        cerr << "prepare calibration failed, no master" << endl;
+        return false;
+    }
+
+    if((pBias && !isPlaneMaster(pBias, pFirst)) || (pDark && !isPlaneMaster(pDark, pFirst)) || (pFlat && !isPlaneMaster(pFlat, pFirst)))
+    {
+        cerr << "prepare calibration failed, the masters must have 1 channel and the same size" << endl;
+        return false;
+    }
+
+    return prepare(masterPixels(pBias), masterPixels(pDark), masterPixels(pFlat), pFirst->width, pFirst->height);
+}
+
+bool Calibrator::prepare(const float *pBias, const float *pDark, const float *pFlat, int width, int height)
+{
+    if((!pBias && !pDark && !pFlat) || width <= 0 || height <= 0)
+    {
+        cerr << "prepare calibration failed, no master" << endl;
+        return false;
+    }
+
+    size_t count = (size_t)width * height;
+    m_nWidth = width;
+    m_nHeight = height;
+    m_dark.clear();
+    m_bias.clear();
+    m_invFlat.clear();
+
+    if(pBias)
+    {
+        m_biasStep = quantize(pBias, count, -32768.0f, 32767.0f, m_bias);
+    }
+
+    if(pDark)
+    {
+        vector<float> thermal = thermalPlane(pBias, pDark, count);
+        m_darkStep = quantize(thermal.data(), count, -32768.0f, 32767.0f, m_dark);
+    }
+
+    if(pFlat)
+    {
+        vector<float> invFlat(count);
+        for(size_t i = 0; i < count; i++)
+        {
+            invFlat[i] = 1.0f / std::max(pFlat[i], 1.0f / 16); //a dead pixel of the flat is a defect, its gain is limited
+        }
+        m_flatStep = quantize(invFlat.data(), count, 0.0f, 65535.0f, m_invFlat);
+    }
+
+    setDefects(vector<DefectPixel>(m_defects)); //check them against the new size
+
+    return true;
+}
+
+void Calibrator::setDarkScale(double darkScale)
+{
+    m_darkScale = darkScale;
+}
+
+double Calibrator::getDarkScale() const
+{
+    return m_darkScale;
+}
+
+void Calibrator::setDefects(const vector<DefectPixel> &defects)
+{
+    m_defects.clear();
+    for(size_t i = 0; i < defects.size(); i++)
+    {
+        if(defects[i].x >= 0 && defects[i].x < m_nWidth && defects[i].y >= 0 && defects[i].y < m_nHeight)
+        {
+            m_defects.push_back(defects[i]);
+        }
+    }
+
+    std::sort(m_defects.begin(), m_defects.end(), [](const DefectPixel &a, const DefectPixel &b)
+    {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+    m_defects.erase(std::unique(m_defects.begin(), m_defects.end(), [](const DefectPixel &a, const DefectPixel &b)
+    {
+        return a.x == b.x && a.y == b.y;
+    }), m_defects.end());
+
+    m_defectRowBegin.assign(m_nHeight + 1, 0);
+    size_t d = 0;
+    for(int y = 0; y <= m_nHeight; y++)
+    {
+        while(d < m_defects.size() && m_defects[d].y < y)
+        {
+            d++;
+        }
+        m_defectRowBegin[y] = (int)d;
+    }
+
+    m_bNeighboursReady = false;
+}
+
+const vector<DefectPixel> &Calibrator::getDefects() const
+{
+    return m_defects;
+}
+
+vector<DefectPixel> Calibrator::findDefects(const MasterFrame *pBias, const MasterFrame *pDark, const MasterFrame *pFlat,
+                                            double hotSigma, double flatLow, double flatHigh)
+{
+    const MasterFrame *pFirst = pDark ? pDark : pFlat;
+    if(!pFirst)
+    {
+        return vector<DefectPixel>();
+    }
+
+    const float *pBiasPixels = (pBias && pBias->data.size() == pFirst->data.size()) ? masterPixels(pBias) : nullptr;
+    return findDefects(pBiasPixels, masterPixels(pDark), masterPixels(pFlat), pFirst->width, pFirst->height, hotSigma, flatLow, flatHigh);
+}
+
+vector<DefectPixel> Calibrator::findDefects(const float *pBias, const float *pDark, const float *pFlat, int width, int height,
+                                            double hotSigma, double flatLow, double flatHigh)
+{
+    vector<DefectPixel> defects;
+    size_t count = (size_t)width * height;
+
+    if(pDark)
+    {
+        vector<float> thermal = thermalPlane(pBias, pDark, count);
+
+        float median = 0.0f;
+        float sigma = 0.0f;
+        robustStats(thermal, median, sigma);
+        float threshold = median + (float)hotSigma * std::max(sigma, 1.0f); //a master has little noise, at least 1 ADU
+
+        for(size_t i = 0; i < count; i++)
+        {
+            if(thermal[i] > threshold)
+            {
+                DefectPixel defect;
+                defect.x = (int)(i % width);
+                defect.y = (int)(i / width);
+                defects.push_back(defect);
+            }
+        }
+    }
+
+    if(pFlat)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            if(pFlat[i] < flatLow || pFlat[i] > flatHigh)
+            {
+                DefectPixel defect;
+                defect.x = (int)(i % width);
+                defect.y = (int)(i / width);
+                defects.push_back(defect);
+            }
+        }
+    }
+
+    return defects;
+}
+
+bool Calibrator::isDefect(int x, int y) const
+{
+    vector<DefectPixel>::const_iterator first = m_defects.begin() + m_defectRowBegin[y];
+    vector<DefectPixel>::const_iterator last = m_defects.begin() + m_defectRowBegin[y + 1];
+
+    return std::binary_search(first, last, DefectPixel{x, y}, [](const DefectPixel &a, const DefectPixel &b) { return a.x < b.x; });
+}
+
+void Calibrator::prepareNeighbours(POABayerPattern bayerPattern)
+{
+    static const int MONO_DX[4] = {-1, 1, 0, 0};
+    static const int MONO_DY[4] = {0, 0, -1, 1};
+    static const int GREEN_DX[4] = {-1, 1, -1, 1}; //the diagonal pixels are green too
+    static const int GREEN_DY[4] = {-1, -1, 1, 1};
+    static const int COLOR_DX[4] = {-2, 2, 0, 0};
+    static const int COLOR_DY[4] = {0, 0, -2, 2};
+
+    // the position of the red pixel in the 2x2 cell, the blue one is the opposite
+    int redX = (bayerPattern == POA_BAYER_GR || bayerPattern == POA_BAYER_BG) ? 1 : 0;
+    int redY = (bayerPattern == POA_BAYER_GB || bayerPattern == POA_BAYER_BG) ? 1 : 0;
+
+    m_neighbours.resize(m_defects.size());
+    for(size_t d = 0; d < m_defects.size(); d++)
+    {
+        int x = m_defects[d].x;
+        int y = m_defects[d].y;
+
+        const int *pDx = MONO_DX;
+        const int *pDy = MONO_DY;
+        if(bayerPattern != POA_BAYER_MONO)
+        {
+            bool isGreen = ((x ^ redX) & 1) != ((y ^ redY) & 1);
+            pDx = isGreen ? GREEN_DX : COLOR_DX;
+            pDy = isGreen ? GREEN_DY : COLOR_DY;
+        }
+
+        DefectNeighbours &neighbours = m_neighbours[d];
+        neighbours.count = 0;
+        for(int k = 0; k < 4; k++)
+        {
+            int nx = x + pDx[k];
+            int ny = y + pDy[k];
+            if(nx >= 0 && nx < m_nWidth && ny >= 0 && ny < m_nHeight && !isDefect(nx, ny))
+            {
+                neighbours.dx[neighbours.count] = pDx[k];
+                neighbours.dy[neighbours.count] = pDy[k];
+                neighbours.count++;
+            }
+        }
+    }
+
+    m_neighboursPattern = bayerPattern;
+    m_bNeighboursReady = true;
+}
+
+template<typename T>
+void Calibrator::fixDefects(const Frame &dst, int y) const
+{
+    T *pRow = (T *)dst.row(y);
+
+    for(int d = m_defectRowBegin[y]; d < m_defectRowBegin[y + 1]; d++)
+    {
+        const DefectNeighbours &neighbours = m_neighbours[d];
+        int x = m_defects[d].x;
+
+        int values[4];
+        for(int k = 0; k < neighbours.count; k++)
+        {
+            values[k] = ((const T *)dst.row(y + neighbours.dy[k]))[x + neighbours.dx[k]];
+        }
+        for(int k = 1; k < neighbours.count; k++) //insertion sort, 4 values at most
+        {
+            for(int j = k; j > 0 && values[j - 1] > values[j]; j--)
+            {
+                std::swap(values[j - 1], values[j]);
+            }
+        }
+
+        switch (neighbours.count)
+        {
+        case 0:
+            break; //surrounded by defects, left as it is
+        case 1:
+        case 3:
+            pRow[x] = (T)values[neighbours.count / 2];
+            break;
+        default: //2 or 4, the mean of the middle ones
+            pRow[x] = (T)((values[neighbours.count / 2 - 1] + values[neighbours.count / 2] + 1) / 2);
+            break;
+        }
+    }
+}
+
+bool Calibrator::apply(const Frame &src, const Frame &dst)
+{
+    static const CalibratorKernelTable *pBestTable = kernels(bestLevel()); //picked once
+
+    return applyWith(pBestTable, src, dst);
+}
+
+bool Calibrator::apply(const Frame &src, const Frame &dst, SimdLevel level)
+{
+    if(!isAvailable(level))
+    {
+        return false;
+    }
+
+    return applyWith(kernels(level), src, dst);
+}
+
+bool Calibrator::applyWith(const CalibratorKernelTable *pTable, const Frame &src, const Frame &dst)
+{
+    POAImgFormat imgFormat = src.imgFormat();
+    if(imgFormat != POA_RAW8 && imgFormat != POA_RAW16 && imgFormat != POA_MONO8)
+    {
+        cerr << "calibrate frame failed, the format must be RAW8, RAW16 or MONO8" << endl;
+        return false;
+    }
+
+    if(src.width() != m_nWidth || src.height() != m_nHeight || !dst.isValid() ||
+            dst.width() != m_nWidth || dst.height() != m_nHeight || dst.imgFormat() != imgFormat)
+    {
+        cerr << "calibrate frame failed, the frames and the masters must have the same size" << endl;
+        return false;
+    }
+
+    POABayerPattern bayerPattern = (imgFormat == POA_MONO8) ? POA_BAYER_MONO : src.bayerPattern();
+    if(!m_bNeighboursReady || m_neighboursPattern != bayerPattern)
+    {
+        prepareNeighbours(bayerPattern);
+    }
+
+    bool is16Bit = imgFormat == POA_RAW16;
+    int planes = (m_dark.empty() ? 0 : PLANE_DARK) | (m_bias.empty() ? 0 : PLANE_BIAS) | (m_invFlat.empty() ? 0 : PLANE_FLAT);
+    CalibrateRowFunc rowFunc = pTable ? pTable->row[is16Bit ? 1 : 0][planes] : nullptr;
+
+    CalibrateRowArgs args;
+    args.darkMul = (float)(m_darkStep * m_darkScale);
+    args.biasMul = m_biasStep;
+    args.flatMul = m_flatStep;
+    args.maxValue = is16Bit ? 65535.0f : 255.0f;
+    args.xBegin = 0;
+    args.xEnd = m_nWidth;
+
+    for(int y = 0; y < m_nHeight; y++)
+    {
+        size_t offset = (size_t)y * m_nWidth;
+        args.src = src.row(y);
+        args.dst = dst.row(y);
+        args.dark = m_dark.empty() ? nullptr : &m_dark[offset];
+        args.bias = m_bias.empty() ? nullptr : &m_bias[offset];
+        args.invFlat = m_invFlat.empty() ? nullptr : &m_invFlat[offset];
+
+        int x = rowFunc ? rowFunc(args) : 0;
+        if(is16Bit)
+        {
+            calibrateRowScalar<uint16_t>(args, x);
+        }
+        else
+        {
+            calibrateRowScalar<unsigned char>(args, x);
+        }
+
+        if(y >= DEFECT_LAG) //the rows of the neighbours are calibrated
+        {
+            is16Bit ? fixDefects<uint16_t>(dst, y - DEFECT_LAG) : fixDefects<unsigned char>(dst, y - DEFECT_LAG);
+        }
+    }
+
+    for(int y = std::max(0, m_nHeight - DEFECT_LAG); y < m_nHeight; y++)
+    {
+        is16Bit ? fixDefects<uint16_t>(dst, y) : fixDefects<unsigned char>(dst, y);
+    }
+
+    return true;
+}
+
+size_t Calibrator::planeBytes() const
+{
+    return m_dark.size() * sizeof(int16_t) + m_bias.size() * sizeof(int16_t) + m_invFlat.size() * sizeof(uint16_t);
+}
+
+SimdLevel Calibrator::bestLevel()
+{
+    for(int level = CpuFeatures::bestLevel(); level > SIMD_SCALAR; level--)
+    {
+        if(isAvailable((SimdLevel)level))
+        {
+            return (SimdLevel)level;
+        }
+    }
+
+    return SIMD_SCALAR;
+}
+
+bool Calibrator::isAvailable(SimdLevel level)
+{
+    if(level == SIMD_SCALAR)
+    {
+        return true;
+    }
+
+    return CpuFeatures::isSupported(level) && kernels(level) != nullptr;
+}
@@ -0,0 +1,113 @@
+#ifndef CALIBRATOR_H
+#define CALIBRATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "CpuFeatures.h"
+#include "Frame.h"
+#include "CalibrationBuilder.h"
+
+struct CalibratorKernelTable;
+
+/*******************************************************************************
+Calibrates the RAW8, RAW16 or MONO8 frames with the master frames in one pass:
+dst = clamp((raw - dark * darkScale - bias) / flat), then the defect pixels(hot,
+dead) are replaced by the median of their neighbours of the same color.
+prepare() converts the float masters(CalibrationBuilder) to 16 bit planes, a value
+and a step per plane(dark and bias: int16, 1 / flat: uint16), so a pixel of RAW16
+reads 2 + 6 bytes of the planes and writes 2 bytes, the float masters would read 12.
+The dark plane is the dark minus the bias if both are given, so it can be scaled to
+the exposure of the frames(setDarkScale()).
+The rows are calibrated by the SIMD kernel of the best level of the CPU(see
+CalibratorKernels.h), the defects of a row are replaced 2 rows later, when the rows
+of their neighbours are calibrated, so the frame is read and written once while
+the rows are still in the cache. dst can be the source frame(in place).
+The neighbours follow the bayer pattern of the frame: the 4 diagonal pixels of a
+green pixel, the pixels 2 away of a red or blue pixel, the 4 nearest of a mono frame.
+*******************************************************************************/
+
+struct DefectPixel
+{
+    int x;
+    int y;
+};
+
+class Calibrator
+{
+public:
+    Calibrator();
+
+    // the masters must have the size of the frames and 1 channel, nullptr for none
+    bool prepare(const MasterFrame *pBias, const MasterFrame *pDark, const MasterFrame *pFlat);
+
+    // the same with the pixels of the masters(eg: mapped from a file by DarkLibrary), width * height each
+    bool prepare(const float *pBias, const float *pDark, const float *pFlat, int width, int height);
+
+    void setDarkScale(double darkScale); //the exposure of the frames / the exposure of the dark, default is 1
+
+    double getDarkScale() const;
+
+    void setDefects(const std::vector<DefectPixel> &defects); //the defect map, replaced, call it after prepare()
+
+    const std::vector<DefectPixel> &getDefects() const;
+
+    // the hot pixels of the dark(hotSigma above the median of the dark minus the bias) and the dead or hot pixels of the flat
+    static std::vector<DefectPixel> findDefects(const MasterFrame *pBias, const MasterFrame *pDark, const MasterFrame *pFlat,
+                                                double hotSigma = 8.0, double flatLow = 0.3, double flatHigh = 1.7);
+
+    static std::vector<DefectPixel> findDefects(const float *pBias, const float *pDark, const float *pFlat, int width, int height,
+                                                double hotSigma = 8.0, double flatLow = 0.3, double flatHigh = 1.7);
+
+    // src and dst have the same size and format, dst can be src
+    bool apply(const Frame &src, const Frame &dst);
+
+    // the same with the kernel of the level, return false if it's not available
+    bool apply(const Frame &src, const Frame &dst, SimdLevel level);
+
+    size_t planeBytes() const; //the bytes of the planes read per frame
+
+    static SimdLevel bestLevel(); //the level used by apply
+
+    static bool isAvailable(SimdLevel level); //supported by the CPU and the kernels are built in
+
+    static const int DEFECT_LAG = 2; //the rows between a row and its defects
+
+private:
+    struct DefectNeighbours
+    {
+        int count;
+        int dx[4];
+        int dy[4];
+    };
+
+    bool applyWith(const CalibratorKernelTable *pTable, const Frame &src, const Frame &dst);
+
+    void prepareNeighbours(POABayerPattern bayerPattern);
+
+    template<typename T>
+    void fixDefects(const Frame &dst, int y) const;
+
+    bool isDefect(int x, int y) const;
+
+    int m_nWidth;
+    int m_nHeight;
+    double m_darkScale;
+
+    std::vector<int16_t> m_dark;
+    std::vector<int16_t> m_bias;
+    std::vector<uint16_t> m_invFlat;
+    float m_darkStep;
+    float m_biasStep;
+    float m_flatStep;
+
+    std::vector<DefectPixel> m_defects;     //sorted by y, x
+    std::vector<int> m_defectRowBegin;      //the first defect of every row, height + 1
+    std::vector<DefectNeighbours> m_neighbours;
+    POABayerPattern m_neighboursPattern;
+    bool m_bNeighboursReady;
+};
+
+#endif // CALIBRATOR_H
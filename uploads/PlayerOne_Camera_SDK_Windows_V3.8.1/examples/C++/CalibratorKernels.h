@@ -0,0 +1,148 @@
+#ifndef CALIBRATORKERNELS_H
+#define CALIBRATORKERNELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/*******************************************************************************
+The row kernels of Calibrator, one table per SIMD level.
+A kernel computes dst = clamp(round((src - dark * darkMul - bias * biasMul) * invFlat * flatMul))
+for the pixels of one row while a whole vector fits and returns where it stopped,
+calibrateRowScalar() does the rest of the row with the same float operations, so
+both give exactly the same results. The planes are 16 bit fixed point(see
+Calibrator.h), a kernel is instantiated for every combination of the planes, a
+missing plane is neither read nor computed.
+*******************************************************************************/
+
+enum CalibratorPlane //the bits of the planes of a kernel
+{
+    PLANE_DARK = 1,
+    PLANE_BIAS = 2,
+    PLANE_FLAT = 4,
+    PLANE_COMBINATIONS = 8
+};
+
+struct CalibrateRowArgs
+{
+    const void *src;          //the raw row, unsigned char or uint16_t
+    void *dst;                //can be src
+    const int16_t *dark;      //nullptr if no dark
+    const int16_t *bias;      //nullptr if no bias
+    const uint16_t *invFlat;  //nullptr if no flat
+    float darkMul;            //the step of the dark plane * the dark scale
+    float biasMul;
+    float flatMul;
+    float maxValue;           //255 or 65535
+    int xBegin;
+    int xEnd;
+};
+
+typedef int (*CalibrateRowFunc)(const CalibrateRowArgs &args);
+
+struct CalibratorKernelTable //[0]: 8 bit, [1]: 16 bit, [the bits of the planes]
+{
+    CalibrateRowFunc row[2][PLANE_COMBINATIONS];
+};
+
+// nullptr if the file was built without the flags of the level
+const CalibratorKernelTable *calibratorKernelsSSE41();
+
+const CalibratorKernelTable *calibratorKernelsAVX2();
+
+const CalibratorKernelTable *calibratorKernelsAVX512();
+
+template <typename T>
+static inline void calibrateRowScalar(const CalibrateRowArgs &args, int xBegin)
+{
+    const T *pSrc = (const T *)args.src;
+    T *pDst = (T *)args.dst;
+
+    for(int x = xBegin; x < args.xEnd; x++)
+    {
+        float value = (float)pSrc[x];
+        if(args.dark)
+        {
+            value = value - (float)args.dark[x] * args.darkMul;
+        }
+        if(args.bias)
+        {
+            value = value - (float)args.bias[x] * args.biasMul;
+        }
+        if(args.invFlat)
+        {
+            value = value * ((float)args.invFlat[x] * args.flatMul);
+        }
+        value = std::min(std::max(value, 0.0f), args.maxValue);
+        pDst[x] = (T)std::lrint(value); //to the nearest even as cvtps_epi32
+    }
+}
+
+#ifdef POA_SIMD_NAMESPACE // included by Calibrator_<level>.cpp after SimdOps.h
+
+namespace POA_SIMD_NAMESPACE
+{
+
+template <class Ops, typename T, int PLANES>
+static inline void calibrateVector(const CalibrateRowArgs &args, int x, typename Ops::V darkMul, typename Ops::V biasMul,
+                                   typename Ops::V flatMul, typename Ops::V maxValue)
+{
+    typedef typename Ops::V V;
+
+    V value = Ops::load((const T *)args.src + x);
+    if(PLANES & PLANE_DARK)
+    {
+        value = Ops::sub(value, Ops::mul(Ops::load(args.dark + x), darkMul));
+    }
+    if(PLANES & PLANE_BIAS)
+    {
+        value = Ops::sub(value, Ops::mul(Ops::load(args.bias + x), biasMul));
+    }
+    if(PLANES & PLANE_FLAT)
+    {
+        value = Ops::mul(value, Ops::mul(Ops::load(args.invFlat + x), flatMul));
+    }
+    Ops::store((T *)args.dst + x, Ops::min(Ops::max(value, Ops::set1(0.0f)), maxValue));
+}
+
+template <class Ops, typename T, int PLANES>
+static int calibrateRow(const CalibrateRowArgs &args)
+{
+    typedef typename Ops::V V;
+
+    const V darkMul = Ops::set1(args.darkMul);
+    const V biasMul = Ops::set1(args.biasMul);
+    const V flatMul = Ops::set1(args.flatMul);
+    const V maxValue = Ops::set1(args.maxValue);
+
+    int x = args.xBegin;
+    for(; x + 2 * Ops::LANES <= args.xEnd; x += 2 * Ops::LANES) //2 vectors per loop, the loads are independent
+    {
+        calibrateVector<Ops, T, PLANES>(args, x, darkMul, biasMul, flatMul, maxValue);
+        calibrateVector<Ops, T, PLANES>(args, x + Ops::LANES, darkMul, biasMul, flatMul, maxValue);
+    }
+
+    for(; x + Ops::LANES <= args.xEnd; x += Ops::LANES)
+    {
+        calibrateVector<Ops, T, PLANES>(args, x, darkMul, biasMul, flatMul, maxValue);
+    }
+
+    return x;
+}
+
+#define POA_CALIBRATE_ROWS(T) \
+    { calibrateRow<VecF32, T, 0>, calibrateRow<VecF32, T, 1>, calibrateRow<VecF32, T, 2>, calibrateRow<VecF32, T, 3>, \
+      calibrateRow<VecF32, T, 4>, calibrateRow<VecF32, T, 5>, calibrateRow<VecF32, T, 6>, calibrateRow<VecF32, T, 7> }
+
+static const CalibratorKernelTable KERNEL_TABLE =
+{
+    { POA_CALIBRATE_ROWS(unsigned char), POA_CALIBRATE_ROWS(uint16_t) }
+};
+
+#undef POA_CALIBRATE_ROWS
+
+} // namespace POA_SIMD_NAMESPACE
+
+#endif // POA_SIMD_NAMESPACE
+
+#endif // CALIBRATORKERNELS_H
@@ -0,0 +1,22 @@
+// the SSE4.1 kernels of Calibrator, this file is compiled with -msse4.1 on GCC/Clang, MSVC needs no flag(see CMakeLists.txt)
+#if defined(__SSE4_1__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+
+#define POA_SIMD_SSE41
+#include "SimdOps.h"
+#include "CalibratorKernels.h"
+
+const CalibratorKernelTable *calibratorKernelsSSE41()
+{
+    return &POA_SIMD_NAMESPACE::KERNEL_TABLE;
+}
+
+#else
+
+#include "CalibratorKernels.h"
+
+const CalibratorKernelTable *calibratorKernelsSSE41()
+{
+    return nullptr; //built without the SSE4.1 flags, the kernels are not available
+}
+
+#endif
@@ -0,0 +1,198 @@
+#include <iostream>
+
+#include "CameraConfigTransaction.h"
+
+using namespace std;
+
+static long long steadyNowUs()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CameraConfigTransaction::CameraConfigTransaction(POACamera &camera)
+    : m_camera(camera), m_bCapturing(false), m_llCommitTimeUs(0)
+{
+    clear();
+}
+
+void CameraConfigTransaction::setImageBin(int bin)
+{
+    m_bHasBin = true;
+    m_nBin = bin;
+}
+
+void CameraConfigTransaction::setImageSize(int width, int height)
+{
+    m_bHasSize = true;
+    m_nWidth = width;
+    m_nHeight = height;
+}
+
+void CameraConfigTransaction::setImageStartPos(int startX, int startY)
+{
+    m_bHasStartPos = true;
+    m_nStartX = startX;
+    m_nStartY = startY;
+}
+
+void CameraConfigTransaction::setROIArea(const ROIArea &roiArea)
+{
+    setImageSize(roiArea.width, roiArea.height);
+    setImageStartPos(roiArea.startX, roiArea.startY);
+}
+
+void CameraConfigTransaction::setImageFormat(POACamera::ImageFormat imgFmt)
+{
+    m_bHasFormat = true;
+    m_imgFormat = imgFmt;
+}
+
+bool CameraConfigTransaction::isEmpty() const
+{
+    return !m_bHasBin && !m_bHasSize && !m_bHasStartPos && !m_bHasFormat;
+}
+
+void CameraConfigTransaction::clear()
+{
+    m_bHasBin = false;
+    m_nBin = 1;
+    m_bHasSize = false;
+    m_nWidth = 0;
+    m_nHeight = 0;
+    m_bHasStartPos = false;
+    m_nStartX = 0;
+    m_nStartY = 0;
+    m_bHasFormat = false;
+    m_imgFormat = POACamera::RAW8;
+}
+
+bool CameraConfigTransaction::commit()
+{
+    m_stats = ReconfigStats();
+    if(isEmpty())
+    {
+        return true;
+    }
+
+    m_llCommitTimeUs = steadyNowUs();
+
+    // the capture thread is stopped with its ring, otherwise one state query tells if the camera is exposing
+    m_bCapturing = m_camera.isCapturing();
+    int ringFrames = m_bCapturing ? (int)m_camera.m_pCaptureRing.load()->capacity() : 0;
+    if(m_bCapturing)
+    {
+        m_camera.stopCapture();
+        m_stats.isStreamRestarted = true;
+    }
+    else
+    {
+        m_stats.isStreamRestarted = m_camera.stopExposureIfExposing();
+    }
+
+    long long applyTimeUs = steadyNowUs();
+    m_stats.stopUs = applyTimeUs - m_llCommitTimeUs;
+
+    bool isApplied = apply();
+    clear();
+
+    long long restartTimeUs = steadyNowUs();
+    m_stats.applyUs = restartTimeUs - applyTimeUs;
+
+    bool isRestarted = true;
+    if(m_bCapturing)
+    {
+        isRestarted = m_camera.startCapture(ringFrames);
+    }
+    else if(m_stats.isStreamRestarted)
+    {
+        isRestarted = m_camera.startExposure();
+    }
+
+    long long endTimeUs = steadyNowUs();
+    m_stats.restartUs = endTimeUs - restartTimeUs;
+    m_stats.commitUs = endTimeUs - m_llCommitTimeUs;
+
+    if(!isRestarted)
+    {
+        cerr << "commit camera config failed, can not restart the stream" << endl;
+        m_stats.isStreamRestarted = false;
+    }
+
+    return isApplied && isRestarted;
+}
+
+bool CameraConfigTransaction::apply()
+{
+    // bin resets the size and the start position, the size may move the start position
+    bool isApplied = true;
+    if(m_bHasBin)
+    {
+        isApplied = m_camera.applyImageBin(m_nBin);
+    }
+
+    if(isApplied && m_bHasSize)
+    {
+        isApplied = m_camera.applyImageSize(m_nWidth, m_nHeight);
+    }
+
+    if(isApplied && m_bHasStartPos)
+    {
+        m_camera.m_cache.isROIValid = false; //the SDK may adjust the start position
+        isApplied = m_camera.applyImageStartPos(m_nStartX, m_nStartY);
+    }
+
+    if(isApplied && m_bHasFormat)
+    {
+        isApplied = m_camera.applyImageFormat(m_imgFormat);
+    }
+
+    // read the ROI back once, even after a failure the cache matches the camera
+    m_camera.getROIArea();
+    m_camera.updateFrameBytes();
+
+    return isApplied;
+}
+
+bool CameraConfigTransaction::waitFirstFrame(int timeoutMs)
+{
+    if(!m_stats.isStreamRestarted)
+    {
+        return false;
+    }
+
+    if(m_stats.firstFrameUs >= 0)
+    {
+        return true;
+    }
+
+    if(m_bCapturing)
+    {
+        // the capture thread keeps the time of its first frame, polling doesn't change the measure
+        chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+        long long frameTimeUs = 0;
+        while((frameTimeUs = m_camera.m_llFirstFrameTimeUs) == 0)
+        {
+            if(chrono::steady_clock::now() >= deadline)
+            {
+                return false;
+            }
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+        m_stats.firstFrameUs = frameTimeUs - m_llCommitTimeUs;
+    }
+    else
+    {
+        if(!m_camera.waitImageReady(timeoutMs))
+        {
+            return false;
+        }
+        m_stats.firstFrameUs = steadyNowUs() - m_llCommitTimeUs;
+    }
+
+    return true;
+}
+
+ReconfigStats CameraConfigTransaction::getStats() const
+{
+    return m_stats;
+}
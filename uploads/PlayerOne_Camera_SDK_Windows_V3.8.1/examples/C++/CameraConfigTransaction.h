@@ -0,0 +1,93 @@
+#ifndef CAMERACONFIGTRANSACTION_H
+#define CAMERACONFIGTRANSACTION_H
+
+#include "POACamera.h"
+
+/*******************************************************************************
+A batch of image settings(bin, size, start position, format) of a POACamera which
+is applied with one stop and one restart of the stream, instead of the state query
+and the stop of every POACamera setter.
+The setters only record the changes, commit() stops the exposure(or the capture
+thread of POACamera::startCapture) once, applies the changes in the order the SDK
+needs: bin(it resets the size and the start position), size(it may move the start
+position), start position, format, reads the ROI back once and restarts the stream
+as it was: the exposure, or the capture thread with the same ring. If the stream was
+not running, nothing is started.
+After a restart the capture thread drops the frames of the old settings and the
+seq of the frames starts from 1 again, waitFirstFrame() measures the time from
+commit() to the first frame of the new settings(ReconfigStats::firstFrameUs).
+The transaction is used from the thread which controls the camera.
+*******************************************************************************/
+
+struct ReconfigStats //the last commit()
+{
+    bool isStreamRestarted; //the exposure or the capture thread was running, it was stopped and restarted
+    long long stopUs;       //stopping the exposure(and joining the capture thread)
+    long long applyUs;      //the SDK setters and reading the ROI back
+    long long restartUs;    //starting the exposure(and the capture thread)
+    long long commitUs;     //the whole commit()
+    long long firstFrameUs; //from the beginning of commit() to the first frame of the new settings, -1 if not seen yet
+
+    ReconfigStats()
+    {
+        isStreamRestarted = false;
+        stopUs = 0;
+        applyUs = 0;
+        restartUs = 0;
+        commitUs = 0;
+        firstFrameUs = -1;
+    }
+};
+
+class CameraConfigTransaction
+{
+public:
+    explicit CameraConfigTransaction(POACamera &camera);
+
+    void setImageBin(int bin);
+
+    void setImageSize(int width, int height);
+
+    void setImageStartPos(int startX, int startY);
+
+    void setROIArea(const ROIArea &roiArea); //the size and the start position
+
+    void setImageFormat(POACamera::ImageFormat imgFmt);
+
+    bool isEmpty() const;
+
+    void clear(); //drop the changes
+
+    // apply the changes, the stream is restarted even if a change failed, the changes are cleared
+    bool commit();
+
+    // wait for the first frame after commit(), false if the stream was not restarted or timeout
+    bool waitFirstFrame(int timeoutMs);
+
+    ReconfigStats getStats() const;
+
+private:
+    CameraConfigTransaction(const CameraConfigTransaction &);
+    CameraConfigTransaction &operator=(const CameraConfigTransaction &);
+
+    bool apply();
+
+    POACamera &m_camera;
+
+    bool m_bHasBin;
+    int m_nBin;
+    bool m_bHasSize;
+    int m_nWidth;
+    int m_nHeight;
+    bool m_bHasStartPos;
+    int m_nStartX;
+    int m_nStartY;
+    bool m_bHasFormat;
+    POACamera::ImageFormat m_imgFormat;
+
+    bool m_bCapturing; //the stream of the last commit()
+    long long m_llCommitTimeUs; //steady clock
+    ReconfigStats m_stats;
+};
+
+#endif // CAMERACONFIGTRANSACTION_H
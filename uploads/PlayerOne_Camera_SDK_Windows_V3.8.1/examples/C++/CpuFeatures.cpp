@@ -0,0 +1,168 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define POA_CPU_X86
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define POA_CPU_X86
+#endif
+
+#ifdef POA_CPU_X86
+
+static void cpuid(unsigned int leaf, unsigned int subLeaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, (int)leaf, (int)subLeaf);
+    for(int i = 0; i < 4; i++)
+    {
+        regs[i] = (unsigned int)info[i];
+    }
+#else
+    __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+struct X86Features
+{
+    bool sse41;
+    bool avx2;
+    bool avx512;
+
+    X86Features() : sse41(false), avx2(false), avx512(false)
+    {
+        unsigned int regs[4] = {0, 0, 0, 0};
+        cpuid(0, 0, regs);
+        unsigned int maxLeaf = regs[0];
+        if(maxLeaf < 1)
+        {
+            return;
+        }
+
+        cpuid(1, 0, regs);
+        bool ssse3 = (regs[2] & (1u << 9)) != 0;
+        sse41 = ssse3 && (regs[2] & (1u << 19)) != 0;
+
+        // the AVX registers are usable only if the OS saves them(XSAVE enabled and the XCR0 bits set)
+        bool osxsave = (regs[2] & (1u << 27)) != 0;
+        bool avx = (regs[2] & (1u << 28)) != 0;
+        if(!osxsave || !avx || maxLeaf < 7)
+        {
+            return;
+        }
+
+        unsigned long long xcr0 = xgetbv0();
+        bool osYmm = (xcr0 & 0x6) == 0x6;   //XMM and YMM
+        bool osZmm = (xcr0 & 0xE6) == 0xE6; //and opmask, ZMM0-15 upper, ZMM16-31
+
+        cpuid(7, 0, regs);
+        avx2 = osYmm && (regs[1] & (1u << 5)) != 0;
+        avx512 = avx2 && osZmm && (regs[1] & (1u << 16)) != 0 && (regs[1] & (1u << 30)) != 0; //F and BW
+    }
+};
+
+static const X86Features &x86Features()
+{
+    static const X86Features features; //detected once
+    return features;
+}
+
+bool CpuFeatures::hasSSE41()
+{
+    return x86Features().sse41;
+}
+
+bool CpuFeatures::hasAVX2()
+{
+    return x86Features().avx2;
+}
+
+bool CpuFeatures::hasAVX512()
+{
+    return x86Features().avx512;
+}
+
+#else // not x86, only the scalar code
+
+bool CpuFeatures::hasSSE41()
+{
+    return false;
+}
+
+bool CpuFeatures::hasAVX2()
+{
+    return false;
+}
+
+bool CpuFeatures::hasAVX512()
+{
+    return false;
+}
+
+#endif
+
+bool CpuFeatures::isSupported(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SCALAR:
+        return true;
+    case SIMD_SSE41:
+        return hasSSE41();
+    case SIMD_AVX2:
+        return hasAVX2();
+    case SIMD_AVX512:
+        return hasAVX512();
+    default:
+        return false;
+    }
+}
+
+SimdLevel CpuFeatures::bestLevel()
+{
+    if(hasAVX512())
+    {
+        return SIMD_AVX512;
+    }
+
+    if(hasAVX2())
+    {
+        return SIMD_AVX2;
+    }
+
+    if(hasSSE41())
+    {
+        return SIMD_SSE41;
+    }
+
+    return SIMD_SCALAR;
+}
+
+const char *CpuFeatures::levelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SCALAR:
+        return "Scalar";
+    case SIMD_SSE41:
+        return "SSE4.1";
+    case SIMD_AVX2:
+        return "AVX2";
+    case SIMD_AVX512:
+        return "AVX-512";
+    default:
+        return "Unknown";
+    }
+}
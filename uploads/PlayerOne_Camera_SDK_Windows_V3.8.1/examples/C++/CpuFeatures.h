@@ -0,0 +1,36 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+/*******************************************************************************
+The SIMD instruction sets of the running CPU, detected once by CPUID(x86 only).
+The image processing code(eg: Debayer) has one kernel per SimdLevel, each one is
+compiled in its own source file with the flags of its instruction set, and picks
+the best one the CPU and the OS support at run time, so one binary runs on any PC.
+*******************************************************************************/
+
+enum SimdLevel
+{
+    SIMD_SCALAR = 0, //plain C++, the reference
+    SIMD_SSE41,      //SSE4.1(with SSSE3)
+    SIMD_AVX2,
+    SIMD_AVX512,     //AVX-512 F + BW
+    SIMD_LEVEL_COUNT
+};
+
+class CpuFeatures
+{
+public:
+    static bool hasSSE41();
+
+    static bool hasAVX2();
+
+    static bool hasAVX512();
+
+    static bool isSupported(SimdLevel level);
+
+    static SimdLevel bestLevel(); //the highest level supported by the CPU and the OS
+
+    static const char *levelName(SimdLevel level);
+};
+
+#endif // CPUFEATURES_H
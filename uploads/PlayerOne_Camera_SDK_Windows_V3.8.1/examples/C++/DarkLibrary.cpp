@@ -0,0 +1,512 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "DarkLibrary.h"
+#include "POACamera.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+using namespace std;
+
+static const char INDEX_MAGIC[8] = {'P', 'O', 'A', 'D', 'A', 'R', 'K', '1'};
+static const char MASTER_MAGIC[8] = {'P', 'O', 'A', 'M', 'S', 'T', 'R', '1'};
+static const uint32_t FILE_VERSION = 1;
+
+struct IndexHeader //the beginning of index.bin, then the records
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordBytes;
+    uint32_t recordCount;
+    uint32_t nextFileID;
+    uint32_t reserved[2];
+};
+
+struct MasterHeader //the beginning of a master file, padded to MASTER_HEADER_BYTES, then the pixels
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t channels;
+    DarkLibrary::Record record;
+};
+
+static_assert(sizeof(DarkLibrary::Record) == 80, "the record of index.bin is 80 bytes");
+static_assert(sizeof(IndexHeader) == 32, "the header of index.bin is 32 bytes");
+static_assert(sizeof(MasterHeader) <= DarkLibrary::MASTER_HEADER_BYTES, "the header of a master file is too large");
+
+static DarkLibrary::Record recordOf(const MasterFrame &master, uint32_t fileID)
+{
+    DarkLibrary::Record record;
+    memset(&record, 0, sizeof(record));
+    record.exposureUs = master.tags.exposureUs;
+    record.type = master.type;
+    record.gain = (int32_t)master.tags.gain;
+    record.offset = (int32_t)master.tags.offset;
+    record.bin = master.tags.bin;
+    record.sensorMode = master.tags.sensorMode;
+    record.imgFormat = master.tags.imgFormat;
+    record.bayerPattern = master.tags.bayerPattern;
+    record.width = master.width;
+    record.height = master.height;
+    record.startX = master.tags.startX;
+    record.startY = master.tags.startY;
+    record.frameCount = master.tags.frameCount;
+    record.hasTemperature = master.tags.hasTemperature ? 1 : 0;
+    record.temperature = (float)master.tags.temperature;
+    record.fileID = fileID;
+
+    return record;
+}
+
+static CalibrationTags tagsOf(const DarkLibrary::Record &record)
+{
+    CalibrationTags tags;
+    tags.exposureUs = (long)record.exposureUs;
+    tags.gain = record.gain;
+    tags.offset = record.offset;
+    tags.bin = record.bin;
+    tags.hasTemperature = record.hasTemperature != 0;
+    tags.temperature = record.temperature;
+    tags.sensorMode = record.sensorMode;
+    tags.imgFormat = (POAImgFormat)record.imgFormat;
+    tags.bayerPattern = (POABayerPattern)record.bayerPattern;
+    tags.width = record.width;
+    tags.height = record.height;
+    tags.startX = record.startX;
+    tags.startY = record.startY;
+    tags.frameCount = record.frameCount;
+
+    return tags;
+}
+
+MappedMaster::MappedMaster()
+    : m_pMapped(nullptr), m_nMappedBytes(0), m_type(CALIB_DARK), m_nWidth(0), m_nHeight(0), m_nChannels(1)
+{
+#if defined(_WIN32)
+    m_hFile = INVALID_HANDLE_VALUE;
+    m_hMapping = nullptr;
+#endif
+}
+
+MappedMaster::~MappedMaster()
+{
+#if defined(_WIN32)
+    if(m_pMapped)
+    {
+        UnmapViewOfFile(m_pMapped);
+    }
+    if(m_hMapping)
+    {
+        CloseHandle(m_hMapping);
+    }
+    if(m_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hFile);
+    }
+#else
+    if(m_pMapped)
+    {
+        munmap((void *)m_pMapped, m_nMappedBytes);
+    }
+#endif
+}
+
+shared_ptr<MappedMaster> MappedMaster::open(const string &fileName)
+{
+    shared_ptr<MappedMaster> master(new MappedMaster());
+
+#if defined(_WIN32)
+    master->m_hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER fileSize;
+    if(master->m_hFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(master->m_hFile, &fileSize))
+    {
+        cerr << "open master failed, can't open the file: " << fileName << endl;
+        return nullptr;
+    }
+
+    master->m_hMapping = CreateFileMappingA(master->m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    master->m_pMapped = master->m_hMapping ? (const unsigned char *)MapViewOfFile(master->m_hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    master->m_nMappedBytes = (size_t)fileSize.QuadPart;
+#else
+    int file = ::open(fileName.c_str(), O_RDONLY);
+    struct stat fileStat;
+    if(file < 0 || fstat(file, &fileStat) != 0)
+    {
+        cerr << "open master failed, can't open the file: " << fileName << ", " << strerror(errno) << endl;
+        if(file >= 0)
+        {
+            ::close(file);
+        }
+        return nullptr;
+    }
+
+    master->m_nMappedBytes = (size_t)fileStat.st_size;
+    void *pMapped = master->m_nMappedBytes > 0 ? mmap(nullptr, master->m_nMappedBytes, PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+    ::close(file); //the mapping keeps the file
+    master->m_pMapped = pMapped != MAP_FAILED ? (const unsigned char *)pMapped : nullptr;
+#endif
+
+    if(!master->m_pMapped || master->m_nMappedBytes < DarkLibrary::MASTER_HEADER_BYTES)
+    {
+        cerr << "open master failed, can't map the file: " << fileName << endl;
+        return nullptr;
+    }
+
+    MasterHeader header;
+    memcpy(&header, master->m_pMapped, sizeof(header));
+    size_t pixelBytes = (size_t)header.record.width * header.record.height * header.channels * sizeof(float);
+    if(memcmp(header.magic, MASTER_MAGIC, sizeof(MASTER_MAGIC)) != 0 || header.version != FILE_VERSION ||
+            master->m_nMappedBytes < DarkLibrary::MASTER_HEADER_BYTES + pixelBytes)
+    {
+        cerr << "open master failed, not a master file or truncated: " << fileName << endl;
+        return nullptr;
+    }
+
+    master->m_type = (CalibrationType)header.record.type;
+    master->m_tags = tagsOf(header.record);
+    master->m_nWidth = header.record.width;
+    master->m_nHeight = header.record.height;
+    master->m_nChannels = (int)header.channels;
+
+    return master;
+}
+
+const float *MappedMaster::data() const
+{
+    return (const float *)(m_pMapped + DarkLibrary::MASTER_HEADER_BYTES);
+}
+
+int MappedMaster::width() const
+{
+    return m_nWidth;
+}
+
+int MappedMaster::height() const
+{
+    return m_nHeight;
+}
+
+int MappedMaster::channels() const
+{
+    return m_nChannels;
+}
+
+CalibrationType MappedMaster::type() const
+{
+    return m_type;
+}
+
+const CalibrationTags &MappedMaster::tags() const
+{
+    return m_tags;
+}
+
+void MappedMaster::prefetch() const
+{
+#if defined(_WIN32)
+    volatile unsigned char sum = 0;
+    for(size_t i = 0; i < m_nMappedBytes; i += 4096) //touch every page
+    {
+        sum += m_pMapped[i];
+    }
+#else
+    madvise((void *)m_pMapped, m_nMappedBytes, MADV_WILLNEED); //the read ahead runs in the background
+#endif
+}
+
+DarkLibrary::DarkLibrary()
+    : m_bOpen(false), m_temperatureBand(1.5), m_nNextFileID(1)
+{
+}
+
+bool DarkLibrary::open(const string &directory)
+{
+    m_strDirectory = directory;
+    m_records.clear();
+    m_mapped.clear();
+    m_nNextFileID = 1;
+    m_bOpen = false;
+
+#if defined(_WIN32)
+    if(_mkdir(directory.c_str()) != 0 && errno != EEXIST)
+#else
+    if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+#endif
+    {
+        cerr << "open dark library failed, can't create the directory: " << directory << endl;
+        return false;
+    }
+
+    m_bOpen = true;
+
+    ifstream indexFile((directory + "/index.bin").c_str(), ios::binary);
+    if(!indexFile.is_open())
+    {
+        return true; //a new library
+    }
+
+    IndexHeader header;
+    if(!indexFile.read((char *)&header, sizeof(header)) || memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+            header.version != FILE_VERSION || header.recordBytes != sizeof(Record))
+    {
+        cerr << "open dark library failed, index.bin is not a dark library index" << endl;
+        m_bOpen = false;
+        return false;
+    }
+
+    m_records.resize(header.recordCount);
+    if(!indexFile.read((char *)m_records.data(), (streamsize)(m_records.size() * sizeof(Record)))) //the records in one read
+    {
+        cerr << "open dark library failed, index.bin is truncated" << endl;
+        m_records.resize((size_t)indexFile.gcount() / sizeof(Record));
+    }
+    m_nNextFileID = header.nextFileID;
+
+    return true;
+}
+
+bool DarkLibrary::isOpen() const
+{
+    return m_bOpen;
+}
+
+string DarkLibrary::masterFileName(uint32_t fileID) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/master_%08u.mst", fileID);
+    return m_strDirectory + name;
+}
+
+bool DarkLibrary::add(const MasterFrame &master)
+{
+    if(!m_bOpen || !master.isValid() || master.type == CALIB_FLAT)
+    {
+        cerr << "add master failed, the library is not open or the master is not a bias or a dark" << endl;
+        return false;
+    }
+
+    Record record = recordOf(master, m_nNextFileID);
+
+    MasterHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MASTER_MAGIC, sizeof(MASTER_MAGIC));
+    header.version = FILE_VERSION;
+    header.channels = (uint32_t)master.channels;
+    header.record = record;
+
+    vector<char> headerBlock(MASTER_HEADER_BYTES, 0);
+    memcpy(headerBlock.data(), &header, sizeof(header));
+
+    string fileName = masterFileName(record.fileID);
+    ofstream masterFile(fileName.c_str(), ios::binary | ios::trunc);
+    masterFile.write(headerBlock.data(), (streamsize)headerBlock.size());
+    masterFile.write((const char *)master.data.data(), (streamsize)(master.data.size() * sizeof(float)));
+    masterFile.close();
+    if(!masterFile)
+    {
+        cerr << "add master failed, can't write the file: " << fileName << endl;
+        return false;
+    }
+
+    // the record is appended, then the count of the header is updated, an interrupted add leaves the old index
+    string indexName = m_strDirectory + "/index.bin";
+    fstream indexFile(indexName.c_str(), ios::binary | ios::in | ios::out);
+    if(!indexFile.is_open())
+    {
+        indexFile.open(indexName.c_str(), ios::binary | ios::out | ios::trunc);
+    }
+
+    IndexHeader indexHeader;
+    memset(&indexHeader, 0, sizeof(indexHeader));
+    memcpy(indexHeader.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    indexHeader.version = FILE_VERSION;
+    indexHeader.recordBytes = sizeof(Record);
+    indexHeader.recordCount = (uint32_t)m_records.size() + 1;
+    indexHeader.nextFileID = record.fileID + 1;
+
+    indexFile.seekp((streamoff)(sizeof(IndexHeader) + m_records.size() * sizeof(Record)));
+    indexFile.write((const char *)&record, sizeof(record));
+    indexFile.flush();
+    indexFile.seekp(0);
+    indexFile.write((const char *)&indexHeader, sizeof(indexHeader));
+    indexFile.close();
+    if(!indexFile)
+    {
+        cerr << "add master failed, can't write the index: " << indexName << endl;
+        remove(fileName.c_str());
+        return false;
+    }
+
+    m_records.push_back(record);
+    m_nNextFileID = record.fileID + 1;
+
+    return true;
+}
+
+size_t DarkLibrary::size() const
+{
+    return m_records.size();
+}
+
+void DarkLibrary::setTemperatureBand(double band)
+{
+    m_temperatureBand = band;
+}
+
+double DarkLibrary::getTemperatureBand() const
+{
+    return m_temperatureBand;
+}
+
+const vector<DarkLibrary::Record> &DarkLibrary::getRecords() const
+{
+    return m_records;
+}
+
+bool DarkLibrary::isSameSetup(const Record &record, const DarkQuery &query) const
+{
+    return record.gain == query.gain && record.offset == query.offset && record.bin == query.bin && record.sensorMode == query.sensorMode &&
+           record.imgFormat == query.imgFormat && record.width == query.width && record.height == query.height &&
+           record.startX == query.startX && record.startY == query.startY;
+}
+
+int DarkLibrary::findNearest(const DarkQuery &query, CalibrationType type, bool isExactExposure) const
+{
+    int best = -1;
+    double bestScore = 0.0;
+
+    for(size_t i = 0; i < m_records.size(); i++)
+    {
+        const Record &record = m_records[i];
+        if(record.type != type || !isSameSetup(record, query) || (isExactExposure && record.exposureUs != query.exposureUs))
+        {
+            continue;
+        }
+
+        double temperatureDiff = m_temperatureBand; //unknown: the worst in the band
+        if(query.hasTemperature && record.hasTemperature)
+        {
+            temperatureDiff = std::fabs(record.temperature - query.temperature);
+        }
+        if(type == CALIB_DARK && temperatureDiff > m_temperatureBand) //the bias hardly depends on the temperature
+        {
+            continue;
+        }
+
+        // the nearest exposure(ratio) first, the longer one if the same, then the temperature
+        double score = temperatureDiff;
+        if(!isExactExposure)
+        {
+            double ratio = std::log((double)std::max<int64_t>(record.exposureUs, 1) / std::max(query.exposureUs, 1L));
+            score += (std::fabs(ratio) * 2.0 - (ratio > 0.0 ? 1e-3 : 0.0)) * 1000.0;
+        }
+
+        if(best < 0 || score < bestScore)
+        {
+            best = (int)i;
+            bestScore = score;
+        }
+    }
+
+    return best;
+}
+
+DarkMatch DarkLibrary::find(const DarkQuery &query)
+{
+    DarkMatch match;
+
+    int darkIndex = findNearest(query, CALIB_DARK, true);
+    int biasIndex = -1;
+    if(darkIndex < 0 && query.allowScaling)
+    {
+        biasIndex = findNearest(query, CALIB_BIAS, false);
+        darkIndex = biasIndex >= 0 ? findNearest(query, CALIB_DARK, false) : -1;
+    }
+
+    if(darkIndex < 0)
+    {
+        return match;
+    }
+
+    match.dark = openMaster(darkIndex);
+    if(biasIndex >= 0)
+    {
+        match.bias = openMaster(biasIndex);
+        match.darkScale = (double)query.exposureUs / std::max<int64_t>(m_records[darkIndex].exposureUs, 1);
+        if(!match.bias)
+        {
+            match.dark.reset(); //can't be scaled without the bias
+        }
+    }
+
+    if(query.hasTemperature && m_records[darkIndex].hasTemperature)
+    {
+        match.temperatureDiff = m_records[darkIndex].temperature - query.temperature;
+    }
+
+    return match;
+}
+
+shared_ptr<MappedMaster> DarkLibrary::openMaster(size_t index)
+{
+    if(index >= m_records.size())
+    {
+        return nullptr;
+    }
+
+    uint32_t fileID = m_records[index].fileID;
+    shared_ptr<MappedMaster> master = m_mapped[fileID].lock();
+    if(!master)
+    {
+        master = MappedMaster::open(masterFileName(fileID));
+        m_mapped[fileID] = master;
+    }
+
+    return master;
+}
+
+DarkQuery DarkLibrary::queryFor(POACamera &camera)
+{
+    DarkQuery query;
+    query.exposureUs = camera.getExposure();
+    query.gain = camera.getGain();
+    query.offset = camera.getOffset();
+    query.bin = camera.getImageBin();
+    query.sensorMode = camera.getSensorMode();
+    query.imgFormat = (POAImgFormat)camera.getImageFormat(); //the same order as POAImgFormat
+
+    ROIArea roiArea = camera.getROIArea();
+    query.width = roiArea.width;
+    query.height = roiArea.height;
+    query.startX = roiArea.startX;
+    query.startY = roiArea.startY;
+
+    // a cooled sensor settles at the target temperature, the dark of the target is the one to use
+    bool isCoolerOn = false;
+    long targetTemperature = 0;
+    if(camera.getCoolerState(isCoolerOn, targetTemperature) && isCoolerOn)
+    {
+        query.hasTemperature = true;
+        query.temperature = (double)targetTemperature;
+    }
+    else
+    {
+        query.hasTemperature = camera.getTemperature(query.temperature);
+    }
+
+    return query;
+}
@@ -0,0 +1,189 @@
+#ifndef DARKLIBRARY_H
+#define DARKLIBRARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "CalibrationBuilder.h"
+
+class POACamera;
+
+/*******************************************************************************
+A library of master darks and biases in a directory, kept between the sessions.
+Every master is a file(a header of 256 bytes and the float pixels, see MasterFrame),
+index.bin has one record of 80 bytes per master with its tags(exposure, gain, offset,
+bin, sensor mode, ROI, format, temperature), so the index of thousands of masters
+is one read of a few hundred KB, and a lookup is a scan of the records in memory.
+find() returns the master matching the gain, offset, bin, sensor mode, ROI and
+format exactly, with the exposure and the nearest temperature in the band(default
++-1.5C). If there is no dark of the exposure and the scaling is allowed, the dark
+of the nearest exposure is returned with a bias and the scale of the exposures:
+dark(t) = bias + (dark(t0) - bias) * t / t0(see Calibrator::setDarkScale()).
+The masters are memory mapped read-only, not read: opening one costs a few system
+calls, the pages are read from the disk(or the file cache) when they are used, so
+switching to another target doesn't stop the capture to load a master. An open
+master is shared, it stays mapped while a MappedMaster refers to it.
+*******************************************************************************/
+
+class MappedMaster
+{
+public:
+    ~MappedMaster();
+
+    static std::shared_ptr<MappedMaster> open(const std::string &fileName); //nullptr if it fails
+
+    const float *data() const; //width * height * channels
+
+    int width() const;
+
+    int height() const;
+
+    int channels() const;
+
+    CalibrationType type() const;
+
+    const CalibrationTags &tags() const;
+
+    void prefetch() const; //ask the OS to read the pages now(eg: on a worker thread before the master is needed)
+
+private:
+    MappedMaster();
+    MappedMaster(const MappedMaster &);
+    MappedMaster &operator=(const MappedMaster &);
+
+    const unsigned char *m_pMapped;
+    size_t m_nMappedBytes;
+#if defined(_WIN32)
+    void *m_hFile;
+    void *m_hMapping;
+#endif
+
+    CalibrationType m_type;
+    CalibrationTags m_tags;
+    int m_nWidth;
+    int m_nHeight;
+    int m_nChannels;
+};
+
+struct DarkQuery //the state of the camera to match
+{
+    long exposureUs;
+    long gain;
+    long offset;
+    int bin;
+    int sensorMode;
+    POAImgFormat imgFormat;
+    int width;
+    int height;
+    int startX;
+    int startY;
+    bool hasTemperature;
+    double temperature;     //the target temperature if the cooler is on, else POA_TEMPERATURE
+    bool allowScaling;      //use the dark of another exposure with a bias, default is false
+
+    DarkQuery()
+    {
+        exposureUs = 0;
+        gain = -1;
+        offset = -1;
+        bin = 1;
+        sensorMode = -1;
+        imgFormat = POA_END;
+        width = 0;
+        height = 0;
+        startX = 0;
+        startY = 0;
+        hasTemperature = false;
+        temperature = 0.0;
+        allowScaling = false;
+    }
+};
+
+struct DarkMatch
+{
+    std::shared_ptr<MappedMaster> dark;  //nullptr if no match
+    std::shared_ptr<MappedMaster> bias;  //the bias of a scaled dark, else nullptr
+    double darkScale;                    //the exposure of the query / the exposure of the dark
+    double temperatureDiff;              //the temperature of the dark - the temperature of the query
+
+    DarkMatch()
+    {
+        darkScale = 1.0;
+        temperatureDiff = 0.0;
+    }
+
+    bool isValid() const { return dark != nullptr; }
+};
+
+class DarkLibrary
+{
+public:
+    DarkLibrary();
+
+    bool open(const std::string &directory); //load the index, the directory is created if it doesn't exist
+
+    bool isOpen() const;
+
+    bool add(const MasterFrame &master); //a bias or a dark, written to the directory and the index
+
+    size_t size() const; //the count of the masters
+
+    void setTemperatureBand(double band); //the largest temperature difference of a match, default is 1.5C
+
+    double getTemperatureBand() const;
+
+    DarkMatch find(const DarkQuery &query);
+
+    static DarkQuery queryFor(POACamera &camera); //the state of the camera, not allowing the scaling
+
+    std::shared_ptr<MappedMaster> openMaster(size_t index); //the master of the record index, mapped once
+
+    struct Record //a record of index.bin
+    {
+        int64_t exposureUs;
+        int32_t type;
+        int32_t gain;
+        int32_t offset;
+        int32_t bin;
+        int32_t sensorMode;
+        int32_t imgFormat;
+        int32_t bayerPattern;
+        int32_t width;
+        int32_t height;
+        int32_t startX;
+        int32_t startY;
+        int32_t frameCount;
+        int32_t hasTemperature;
+        float temperature;
+        uint32_t fileID;      //the name of the master file: master_<fileID>.mst
+        uint32_t reserved[3];
+    };
+
+    const std::vector<Record> &getRecords() const;
+
+    static const size_t MASTER_HEADER_BYTES = 256; //the header of a master file, then the pixels
+
+private:
+    DarkLibrary(const DarkLibrary &);
+    DarkLibrary &operator=(const DarkLibrary &);
+
+    std::string masterFileName(uint32_t fileID) const;
+
+    bool isSameSetup(const Record &record, const DarkQuery &query) const; //everything but the exposure and the temperature
+
+    int findNearest(const DarkQuery &query, CalibrationType type, bool isExactExposure) const; //-1 if none
+
+    std::string m_strDirectory;
+    bool m_bOpen;
+    double m_temperatureBand;
+    std::vector<Record> m_records;
+    uint32_t m_nNextFileID;
+    std::map<uint32_t, std::weak_ptr<MappedMaster> > m_mapped; //fileID -> the mapped master
+};
+
+#endif // DARKLIBRARY_H
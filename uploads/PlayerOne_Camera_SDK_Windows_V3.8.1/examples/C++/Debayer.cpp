@@ -0,0 +1,129 @@
+#include <iostream>
+#include "Debayer.h"
+#include "DebayerKernels.h"
+
+using namespace std;
+
+static const DebayerKernelTable *kernelTable(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SSE41:
+        return debayerKernelsSSE41();
+    case SIMD_AVX2:
+        return debayerKernelsAVX2();
+    case SIMD_AVX512:
+        return debayerKernelsAVX512();
+    default:
+        return nullptr;
+    }
+}
+
+Debayer::Debayer()
+{
+    m_algorithm = BILINEAR;
+    m_simdLevel = SIMD_SCALAR;
+
+    for(int level = CpuFeatures::bestLevel(); level > SIMD_SCALAR; level--)
+    {
+        if(isAvailable((SimdLevel)level))
+        {
+            m_simdLevel = (SimdLevel)level;
+            break;
+        }
+    }
+}
+
+void Debayer::setCameraProperties(const POACameraProperties &cameraProp)
+{
+    m_dispatch = BayerDispatch(cameraProp);
+}
+
+void Debayer::setAlgorithm(Algorithm algorithm)
+{
+    m_algorithm = algorithm;
+}
+
+Debayer::Algorithm Debayer::getAlgorithm() const
+{
+    return m_algorithm;
+}
+
+bool Debayer::setSimdLevel(SimdLevel level)
+{
+    if(!isAvailable(level))
+    {
+        return false;
+    }
+
+    m_simdLevel = level;
+
+    return true;
+}
+
+SimdLevel Debayer::getSimdLevel() const
+{
+    return m_simdLevel;
+}
+
+bool Debayer::isAvailable(SimdLevel level)
+{
+    if(level == SIMD_SCALAR)
+    {
+        return true;
+    }
+
+    return CpuFeatures::isSupported(level) && kernelTable(level) != nullptr;
+}
+
+size_t Debayer::outputBytesPerPixel(POAImgFormat rawFormat)
+{
+    return rawFormat == POA_RAW16 ? 6 : 3;
+}
+
+bool Debayer::process(const Frame &raw, unsigned char *pDst, size_t dstStride)
+{
+    if(!raw.isValid() || !pDst)
+    {
+        cerr << "debayer failed, no image data" << endl;
+        return false;
+    }
+
+    if((raw.imgFormat() != POA_RAW8 && raw.imgFormat() != POA_RAW16) || raw.bayerPattern() == POA_BAYER_MONO)
+    {
+        cerr << "debayer failed, the frame is not RAW8 or RAW16 of a color camera" << endl;
+        return false;
+    }
+
+    if(raw.width() < 4 || raw.height() < 4 || dstStride < (size_t)raw.width() * outputBytesPerPixel(raw.imgFormat()))
+    {
+        cerr << "debayer failed, the frame is too small or dstStride is too short" << endl;
+        return false;
+    }
+
+    const BayerKernelSet *pKernels = m_dispatch.select(raw.bayerPattern(), raw.imgFormat());
+
+    BayerFrameArgs args;
+    args.pRaw = &raw;
+    args.pDst = pDst;
+    args.dstStride = dstStride;
+    args.pSimd = kernelTable(m_simdLevel);
+    args.pGreen = nullptr;
+
+    if(m_algorithm == EDGE_AWARE)
+    {
+        if(m_green.size() < (size_t)raw.width() * raw.height())
+        {
+            m_green.resize((size_t)raw.width() * raw.height());
+        }
+        args.pGreen = m_green.data();
+
+        pKernels->debayerEdgeAware(args);
+    }
+    else
+    {
+        pKernels->debayerBilinear(args);
+    }
+
+    return true;
+}
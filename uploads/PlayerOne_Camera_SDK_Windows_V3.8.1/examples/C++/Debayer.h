@@ -0,0 +1,64 @@
+#ifndef DEBAYER_H
+#define DEBAYER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "CpuFeatures.h"
+#include "Frame.h"
+#include "BayerKernels.h"
+
+/*******************************************************************************
+Host side debayering of the RAW8 / RAW16 frames of the color cameras, so the
+camera can send RAW data(1/3 of the USB bandwidth of POA_RGB24) at full frame rate.
+The output has 3 channels per pixel in B G R order(the order of OpenCV), 8 bits
+per channel for RAW8 and 16 bits for RAW16, the bayer pattern comes from the frame
+(see Frame::bayerPattern(), the views of a frame have the shifted pattern).
+BILINEAR: the average of the nearest pixels of each color.
+EDGE_AWARE: Hamilton-Adams, the green is interpolated along the edges(the direction
+with the smaller gradient) with a laplacian correction, then red and blue from the
+color differences, it's the interpolation step of AHD, sharper and less zippering.
+The kernels of the best SIMD level of the CPU are used(AVX-512, AVX2, SSE4.1),
+the scalar code is the reference, all the levels give exactly the same output.
+The kernels are specialized for each bayer pattern and pixel type(see BayerKernels.h)
+and picked once per frame.
+*******************************************************************************/
+
+class Debayer
+{
+public:
+    enum Algorithm
+    {
+        BILINEAR = 0,
+        EDGE_AWARE
+    };
+
+    Debayer();
+
+    void setCameraProperties(const POACameraProperties &cameraProp); //build the dispatch table for the camera, optional
+
+    void setAlgorithm(Algorithm algorithm);
+
+    Algorithm getAlgorithm() const;
+
+    bool setSimdLevel(SimdLevel level); //eg: SIMD_SCALAR to compare with the reference, return false if it's not available
+
+    SimdLevel getSimdLevel() const;
+
+    // debayer raw into pDst, the rows of the output are dstStride bytes apart, width * outputBytesPerPixel() at least
+    bool process(const Frame &raw, unsigned char *pDst, size_t dstStride);
+
+    static size_t outputBytesPerPixel(POAImgFormat rawFormat); //3 for RAW8, 6 for RAW16
+
+    static bool isAvailable(SimdLevel level); //supported by the CPU and the kernels are built in
+
+private:
+    BayerDispatch m_dispatch;
+    Algorithm m_algorithm;
+    SimdLevel m_simdLevel;
+    std::vector<uint16_t> m_green; //the green plane of EDGE_AWARE, reused from frame to frame
+};
+
+#endif // DEBAYER_H
@@ -0,0 +1,239 @@
+#ifndef DEBAYERKERNELS_H
+#define DEBAYERKERNELS_H
+
+#include <cstdint>
+
+/*******************************************************************************
+The SIMD row kernels of Debayer, one table per SIMD level.
+A kernel processes the pixels of one output row from xBegin while a whole vector
+fits before xEnd and returns where it stopped, the scalar kernels of BayerKernels
+do the rest of the row and the border pixels, both give the same results.
+The row pointers are already mirrored at the top and bottom borders.
+*******************************************************************************/
+
+struct DebayerRowArgs
+{
+    const void *src[5];       //raw rows y-2 .. y+2
+    const uint16_t *green[3]; //green plane rows y-1 .. y+1(edge aware, color pass)
+    uint16_t *greenOut;       //green plane row y(edge aware, green pass)
+    void *dst;                //output row y, 3 channels per pixel, B G R
+    int xBegin;
+    int xEnd;
+    int colorParity;          //x & 1 of the red or blue pixels in this row
+    bool redRow;              //the row has red pixels(else blue)
+    int maxValue;             //255 or 65535
+};
+
+typedef int (*DebayerRowFunc)(const DebayerRowArgs &args);
+
+struct DebayerKernelTable //[0]: 8 bit, [1]: 16 bit
+{
+    DebayerRowFunc bilinear[2];
+    DebayerRowFunc edgeGreen[2];
+    DebayerRowFunc edgeColor[2];
+};
+
+// nullptr if the file was built without the flags of the level
+const DebayerKernelTable *debayerKernelsSSE41();
+
+const DebayerKernelTable *debayerKernelsAVX2();
+
+const DebayerKernelTable *debayerKernelsAVX512();
+
+#ifdef POA_SIMD_NAMESPACE // included by Debayer_<level>.cpp after SimdOps.h
+
+namespace POA_SIMD_NAMESPACE
+{
+
+// the color pixels(red or blue) are in the even lanes if COLOR_EVEN, else in the odd lanes
+template <class Ops, bool COLOR_EVEN>
+static inline typename Ops::V pickColor(typename Ops::V colorValue, typename Ops::V greenValue)
+{
+    return COLOR_EVEN ? Ops::blendOdd(colorValue, greenValue) : Ops::blendOdd(greenValue, colorValue);
+}
+
+template <class Ops, bool COLOR_EVEN, bool RED_ROW>
+static int bilinearRow(const DebayerRowArgs &args)
+{
+    typedef typename Ops::T T;
+    typedef typename Ops::V V;
+
+    const T *up = (const T *)args.src[1];
+    const T *cur = (const T *)args.src[2];
+    const T *dn = (const T *)args.src[3];
+    T *dst = (T *)args.dst;
+
+    int x = args.xBegin;
+    for(; x + (int)Ops::LANES <= args.xEnd; x += Ops::LANES)
+    {
+        V c = Ops::load(cur + x);
+        V h = Ops::avg(Ops::load(cur + x - 1), Ops::load(cur + x + 1));
+        V v = Ops::avg(Ops::load(up + x), Ops::load(dn + x));
+        V diag = Ops::avg(Ops::avg(Ops::load(up + x - 1), Ops::load(up + x + 1)), Ops::avg(Ops::load(dn + x - 1), Ops::load(dn + x + 1)));
+        V cross = Ops::avg(v, h);
+
+        V same = pickColor<Ops, COLOR_EVEN>(c, h);     //the color of this row
+        V green = pickColor<Ops, COLOR_EVEN>(cross, c);
+        V other = pickColor<Ops, COLOR_EVEN>(diag, v); //the color of the rows above and below
+
+        if(RED_ROW)
+        {
+            Ops::store3(dst + 3 * x, other, green, same);
+        }
+        else
+        {
+            Ops::store3(dst + 3 * x, same, green, other);
+        }
+    }
+
+    return x;
+}
+
+template <class Ops>
+static int bilinearRow(const DebayerRowArgs &args)
+{
+    bool colorEven = ((args.xBegin ^ args.colorParity) & 1) == 0;
+
+    if(colorEven)
+    {
+        return args.redRow ? bilinearRow<Ops, true, true>(args) : bilinearRow<Ops, true, false>(args);
+    }
+
+    return args.redRow ? bilinearRow<Ops, false, true>(args) : bilinearRow<Ops, false, false>(args);
+}
+
+// Hamilton-Adams: interpolate the green along the direction with the smaller gradient
+template <typename T, bool COLOR_EVEN>
+static int edgeGreenRow(const DebayerRowArgs &args)
+{
+    typedef VecI32 Ops;
+    typedef Ops::V V;
+
+    const T *up2 = (const T *)args.src[0];
+    const T *up = (const T *)args.src[1];
+    const T *cur = (const T *)args.src[2];
+    const T *dn = (const T *)args.src[3];
+    const T *dn2 = (const T *)args.src[4];
+
+    const V zero = Ops::set1(0);
+    const V two = Ops::set1(2);
+    const V four = Ops::set1(4);
+    const V maxValue = Ops::set1(args.maxValue);
+
+    int x = args.xBegin;
+    for(; x + (int)Ops::LANES <= args.xEnd; x += Ops::LANES)
+    {
+        V c = Ops::load(cur + x);
+        V left = Ops::load(cur + x - 1);
+        V right = Ops::load(cur + x + 1);
+        V top = Ops::load(up + x);
+        V bottom = Ops::load(dn + x);
+
+        V twoC = Ops::add(c, c);
+        V lapH = Ops::sub(Ops::sub(twoC, Ops::load(cur + x - 2)), Ops::load(cur + x + 2));
+        V lapV = Ops::sub(Ops::sub(twoC, Ops::load(up2 + x)), Ops::load(dn2 + x));
+
+        V gradH = Ops::add(Ops::abs(Ops::sub(left, right)), Ops::abs(lapH));
+        V gradV = Ops::add(Ops::abs(Ops::sub(top, bottom)), Ops::abs(lapV));
+
+        V sumH = Ops::add(Ops::shl<1>(Ops::add(left, right)), lapH);
+        V sumV = Ops::add(Ops::shl<1>(Ops::add(top, bottom)), lapV);
+
+        V greenH = Ops::sar<2>(Ops::add(sumH, two));
+        V greenV = Ops::sar<2>(Ops::add(sumV, two));
+        V greenA = Ops::sar<3>(Ops::add(Ops::add(sumH, sumV), four));
+
+        V green = Ops::select(Ops::lessThan(gradH, gradV), greenH, Ops::select(Ops::lessThan(gradV, gradH), greenV, greenA));
+        green = Ops::min(Ops::max(green, zero), maxValue);
+
+        Ops::storeU16(args.greenOut + x, pickColor<Ops, COLOR_EVEN>(green, c));
+    }
+
+    return x;
+}
+
+template <typename T>
+static int edgeGreenRow(const DebayerRowArgs &args)
+{
+    bool colorEven = ((args.xBegin ^ args.colorParity) & 1) == 0;
+    return colorEven ? edgeGreenRow<T, true>(args) : edgeGreenRow<T, false>(args);
+}
+
+// the red and blue from the color differences(color - green) of the neighbours
+template <typename T, bool COLOR_EVEN, bool RED_ROW>
+static int edgeColorRow(const DebayerRowArgs &args)
+{
+    typedef VecI32 Ops;
+    typedef Ops::V V;
+
+    const T *up = (const T *)args.src[1];
+    const T *cur = (const T *)args.src[2];
+    const T *dn = (const T *)args.src[3];
+    const uint16_t *gUp = args.green[0];
+    const uint16_t *gCur = args.green[1];
+    const uint16_t *gDn = args.green[2];
+    T *dst = (T *)args.dst;
+
+    const V zero = Ops::set1(0);
+    const V one = Ops::set1(1);
+    const V two = Ops::set1(2);
+    const V maxValue = Ops::set1(args.maxValue);
+
+    int x = args.xBegin;
+    for(; x + (int)Ops::LANES <= args.xEnd; x += Ops::LANES)
+    {
+        V g = Ops::load(gCur + x);
+        V c = Ops::load(cur + x);
+
+        V diffLeft = Ops::sub(Ops::load(cur + x - 1), Ops::load(gCur + x - 1));
+        V diffRight = Ops::sub(Ops::load(cur + x + 1), Ops::load(gCur + x + 1));
+        V diffTop = Ops::sub(Ops::load(up + x), Ops::load(gUp + x));
+        V diffBottom = Ops::sub(Ops::load(dn + x), Ops::load(gDn + x));
+        V diffDiag = Ops::add(Ops::add(Ops::sub(Ops::load(up + x - 1), Ops::load(gUp + x - 1)), Ops::sub(Ops::load(up + x + 1), Ops::load(gUp + x + 1))),
+                              Ops::add(Ops::sub(Ops::load(dn + x - 1), Ops::load(gDn + x - 1)), Ops::sub(Ops::load(dn + x + 1), Ops::load(gDn + x + 1))));
+
+        V sameAtGreen = Ops::add(g, Ops::sar<1>(Ops::add(Ops::add(diffLeft, diffRight), one)));
+        V otherAtGreen = Ops::add(g, Ops::sar<1>(Ops::add(Ops::add(diffTop, diffBottom), one)));
+        V otherAtColor = Ops::add(g, Ops::sar<2>(Ops::add(diffDiag, two)));
+
+        V same = Ops::min(Ops::max(pickColor<Ops, COLOR_EVEN>(c, sameAtGreen), zero), maxValue);
+        V other = Ops::min(Ops::max(pickColor<Ops, COLOR_EVEN>(otherAtColor, otherAtGreen), zero), maxValue);
+
+        if(RED_ROW)
+        {
+            Ops::store3(dst + 3 * x, other, g, same);
+        }
+        else
+        {
+            Ops::store3(dst + 3 * x, same, g, other);
+        }
+    }
+
+    return x;
+}
+
+template <typename T>
+static int edgeColorRow(const DebayerRowArgs &args)
+{
+    bool colorEven = ((args.xBegin ^ args.colorParity) & 1) == 0;
+
+    if(colorEven)
+    {
+        return args.redRow ? edgeColorRow<T, true, true>(args) : edgeColorRow<T, true, false>(args);
+    }
+
+    return args.redRow ? edgeColorRow<T, false, true>(args) : edgeColorRow<T, false, false>(args);
+}
+
+static const DebayerKernelTable KERNEL_TABLE =
+{
+    { bilinearRow<VecU8>, bilinearRow<VecU16> },
+    { edgeGreenRow<unsigned char>, edgeGreenRow<uint16_t> },
+    { edgeColorRow<unsigned char>, edgeColorRow<uint16_t> }
+};
+
+} // namespace POA_SIMD_NAMESPACE
+
+#endif // POA_SIMD_NAMESPACE
+
+#endif // DEBAYERKERNELS_H
@@ -0,0 +1,22 @@
+// the AVX-512 kernels of Debayer, this file is compiled with -mavx512f -mavx512bw or /arch:AVX512(see CMakeLists.txt)
+#if defined(__AVX512BW__)
+
+#define POA_SIMD_AVX512
+#include "SimdOps.h"
+#include "DebayerKernels.h"
+
+const DebayerKernelTable *debayerKernelsAVX512()
+{
+    return &POA_SIMD_NAMESPACE::KERNEL_TABLE;
+}
+
+#else
+
+#include "DebayerKernels.h"
+
+const DebayerKernelTable *debayerKernelsAVX512()
+{
+    return nullptr; //built without the AVX-512 flags, the kernels are not available
+}
+
+#endif
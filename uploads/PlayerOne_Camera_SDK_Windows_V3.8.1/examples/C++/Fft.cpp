@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "Fft.h"
+#include "FftKernels.h"
+
+using namespace std;
+
+static const double PI = 3.14159265358979323846;
+
+static const FftKernelTable *kernels(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SSE41:
+        return fftKernelsSSE41();
+    case SIMD_AVX2:
+        return fftKernelsAVX2();
+    case SIMD_AVX512:
+        return fftKernelsAVX512();
+    default:
+        return nullptr;
+    }
+}
+
+static const FftStageFunc SCALAR_STAGES[4] = { fftStageScalar<2>, fftStageScalar<3>, fftStageScalar<4>, fftStageScalar<5> };
+
+static int radixIndex(int radix) //the index in FftKernelTable::stage
+{
+    switch (radix)
+    {
+    case 2:
+        return 0;
+    case 3:
+        return 1;
+    case 4:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+static size_t alignedFloats(int count) //the rows of the planes start at 64 bytes
+{
+    return ((size_t)count + 15) / 16 * 16;
+}
+
+FftPlan::FftPlan(int size)
+    : m_nSize(size)
+{
+    // radix 4 first: fewer passes over the data
+    int rest = size;
+    while(rest % 4 == 0)
+    {
+        m_radices.push_back(4);
+        rest /= 4;
+    }
+    const int radices[] = { 2, 3, 5 };
+    for(int i = 0; i < 3; i++)
+    {
+        while(rest % radices[i] == 0)
+        {
+            m_radices.push_back(radices[i]);
+            rest /= radices[i];
+        }
+    }
+
+    int n = size;
+    for(size_t stage = 0; stage < m_radices.size(); stage++)
+    {
+        int radix = m_radices[stage];
+        int m = n / radix;
+        for(int j = 0; j < m; j++)
+        {
+            for(int k = 1; k < radix; k++)
+            {
+                double angle = -2.0 * PI * j * k / n;
+                m_twiddleRe.push_back((float)cos(angle));
+                m_twiddleIm.push_back((float)sin(angle));
+            }
+        }
+        n = m;
+    }
+}
+
+const FftPlan *FftPlan::get(int size)
+{
+    static mutex cacheMutex;
+    static map<int, unique_ptr<FftPlan> > cache;
+
+    if(!isSupportedSize(size))
+    {
+        return nullptr;
+    }
+
+    lock_guard<mutex> lock(cacheMutex);
+    unique_ptr<FftPlan> &pPlan = cache[size];
+    if(!pPlan)
+    {
+        pPlan.reset(new FftPlan(size));
+    }
+
+    return pPlan.get();
+}
+
+bool FftPlan::isSupportedSize(int size)
+{
+    if(size <= 0)
+    {
+        return false;
+    }
+
+    const int radices[] = { 2, 3, 5 };
+    for(int i = 0; i < 3; i++)
+    {
+        while(size % radices[i] == 0)
+        {
+            size /= radices[i];
+        }
+    }
+
+    return size == 1;
+}
+
+int FftPlan::size() const
+{
+    return m_nSize;
+}
+
+void FftPlan::transform(float *pRe, float *pIm, size_t stride, float *pWorkRe, float *pWorkIm, const FftKernelTable *pTable, bool isInverse) const
+{
+    if(isInverse) //ifft(x) = swap(fft(swap(x))), swap: the real and imaginary parts
+    {
+        std::swap(pRe, pIm);
+        std::swap(pWorkRe, pWorkIm);
+    }
+
+    FftStageArgs args;
+    args.xRe = pRe;
+    args.xIm = pIm;
+    args.yRe = pWorkRe;
+    args.yIm = pWorkIm;
+    args.span = stride;
+    int n = m_nSize;
+    size_t twiddleOffset = 0;
+
+    for(size_t stage = 0; stage < m_radices.size(); stage++)
+    {
+        int radix = m_radices[stage];
+        args.m = n / radix;
+        args.twRe = m_twiddleRe.data() + twiddleOffset;
+        args.twIm = m_twiddleIm.data() + twiddleOffset;
+        (pTable ? pTable->stage[radixIndex(radix)] : SCALAR_STAGES[radixIndex(radix)])(args);
+
+        // ping-pong, the next stage has radix times more floats per element
+        float *pOutRe = args.yRe, *pOutIm = args.yIm;
+        args.yRe = (float *)args.xRe;
+        args.yIm = (float *)args.xIm;
+        args.xRe = pOutRe;
+        args.xIm = pOutIm;
+        args.span *= radix;
+        twiddleOffset += (size_t)args.m * (radix - 1);
+        n = args.m;
+    }
+
+    if(args.xRe != pRe) //an odd count of stages, the result is in the work planes
+    {
+        memcpy(pRe, args.xRe, (size_t)m_nSize * stride * sizeof(float));
+        memcpy(pIm, args.xIm, (size_t)m_nSize * stride * sizeof(float));
+    }
+}
+
+RealFft2D::RealFft2D()
+    : m_nWidth(0), m_nHeight(0), m_nHalf(0), m_simdLevel(SIMD_SCALAR), m_pColumnPlan(nullptr), m_pRowPlan(nullptr),
+      m_nImageStride(0), m_nSpectrumStride(0)
+{
+    for(int level = CpuFeatures::bestLevel(); level > SIMD_SCALAR; level--)
+    {
+        if(isAvailable((SimdLevel)level))
+        {
+            m_simdLevel = (SimdLevel)level;
+            break;
+        }
+    }
+}
+
+bool RealFft2D::isSupportedSize(int width, int height)
+{
+    return width % 2 == 0 && height % 2 == 0 && FftPlan::isSupportedSize(width) && FftPlan::isSupportedSize(height / 2);
+}
+
+bool RealFft2D::init(int width, int height)
+{
+    if(!isSupportedSize(width, height))
+    {
+        cerr << "init FFT failed, the width and height must be even and 2^a * 3^b * 5^c, " << width << " x " << height << endl;
+        return false;
+    }
+
+    m_nWidth = width;
+    m_nHeight = height;
+    m_nHalf = height / 2;
+    m_pColumnPlan = FftPlan::get(m_nHalf);
+    m_pRowPlan = FftPlan::get(width);
+    m_nImageStride = alignedFloats(width);
+    m_nSpectrumStride = alignedFloats(m_nHalf + 1);
+
+    // the padding floats are transformed too, they stay 0
+    m_imageRe.assign(m_nHalf * m_nImageStride, 0.0f);
+    m_imageIm.assign(m_nHalf * m_nImageStride, 0.0f);
+    m_columnRe.assign((m_nHalf + 1) * m_nImageStride, 0.0f);
+    m_columnIm.assign((m_nHalf + 1) * m_nImageStride, 0.0f);
+    m_spectrumRe.assign(width * m_nSpectrumStride, 0.0f);
+    m_spectrumIm.assign(width * m_nSpectrumStride, 0.0f);
+    size_t workFloats = std::max(m_nHalf * m_nImageStride, width * m_nSpectrumStride);
+    m_workRe.assign(workFloats, 0.0f);
+    m_workIm.assign(workFloats, 0.0f);
+
+    m_realTwiddleRe.resize(m_nHalf + 1);
+    m_realTwiddleIm.resize(m_nHalf + 1);
+    for(int k = 0; k <= m_nHalf; k++)
+    {
+        double angle = -2.0 * PI * k / height;
+        m_realTwiddleRe[k] = (float)cos(angle);
+        m_realTwiddleIm[k] = (float)sin(angle);
+    }
+
+    return true;
+}
+
+bool RealFft2D::setSimdLevel(SimdLevel level)
+{
+    if(!isAvailable(level))
+    {
+        return false;
+    }
+
+    m_simdLevel = level;
+
+    return true;
+}
+
+SimdLevel RealFft2D::getSimdLevel() const
+{
+    return m_simdLevel;
+}
+
+int RealFft2D::width() const
+{
+    return m_nWidth;
+}
+
+int RealFft2D::height() const
+{
+    return m_nHeight;
+}
+
+float *RealFft2D::inputRow(int y)
+{
+    std::vector<float> &plane = y % 2 == 0 ? m_imageRe : m_imageIm; //packed for the column FFT
+    return plane.data() + (size_t)(y / 2) * m_nImageStride;
+}
+
+int RealFft2D::spectrumColumns() const
+{
+    return m_nHalf + 1;
+}
+
+float *RealFft2D::spectrumRe(int u)
+{
+    return m_spectrumRe.data() + (size_t)u * m_nSpectrumStride;
+}
+
+float *RealFft2D::spectrumIm(int u)
+{
+    return m_spectrumIm.data() + (size_t)u * m_nSpectrumStride;
+}
+
+void RealFft2D::transpose(const float *pSrc, size_t srcStride, float *pDst, size_t dstStride, int rows, int columns)
+{
+    const int block = 16; //a block of the source and of the destination stay in the cache
+    for(int rowBegin = 0; rowBegin < rows; rowBegin += block)
+    {
+        int rowEnd = std::min(rowBegin + block, rows);
+        for(int columnBegin = 0; columnBegin < columns; columnBegin += block)
+        {
+            int columnEnd = std::min(columnBegin + block, columns);
+            for(int column = columnBegin; column < columnEnd; column++)
+            {
+                float *pDstRow = pDst + (size_t)column * dstStride;
+                for(int row = rowBegin; row < rowEnd; row++)
+                {
+                    pDstRow[row] = pSrc[(size_t)row * srcStride + column];
+                }
+            }
+        }
+    }
+}
+
+void RealFft2D::forward()
+{
+    if(m_nWidth == 0)
+    {
+        return;
+    }
+
+    const FftKernelTable *pTable = kernels(m_simdLevel);
+    m_pColumnPlan->transform(m_imageRe.data(), m_imageIm.data(), m_nImageStride, m_workRe.data(), m_workIm.data(), pTable, false);
+
+    FftRealArgs args;
+    args.zRe = m_imageRe.data();
+    args.zIm = m_imageIm.data();
+    args.xRe = m_columnRe.data();
+    args.xIm = m_columnIm.data();
+    args.half = m_nHalf;
+    args.span = m_nImageStride;
+    args.twRe = m_realTwiddleRe.data();
+    args.twIm = m_realTwiddleIm.data();
+    (pTable ? pTable->realForward : fftRealForwardScalar)(args);
+
+    transpose(m_columnRe.data(), m_nImageStride, m_spectrumRe.data(), m_nSpectrumStride, m_nHalf + 1, m_nWidth);
+    transpose(m_columnIm.data(), m_nImageStride, m_spectrumIm.data(), m_nSpectrumStride, m_nHalf + 1, m_nWidth);
+
+    m_pRowPlan->transform(m_spectrumRe.data(), m_spectrumIm.data(), m_nSpectrumStride, m_workRe.data(), m_workIm.data(), pTable, false);
+}
+
+void RealFft2D::inverse()
+{
+    if(m_nWidth == 0)
+    {
+        return;
+    }
+
+    const FftKernelTable *pTable = kernels(m_simdLevel);
+    m_pRowPlan->transform(m_spectrumRe.data(), m_spectrumIm.data(), m_nSpectrumStride, m_workRe.data(), m_workIm.data(), pTable, true);
+
+    transpose(m_spectrumRe.data(), m_nSpectrumStride, m_columnRe.data(), m_nImageStride, m_nWidth, m_nHalf + 1);
+    transpose(m_spectrumIm.data(), m_nSpectrumStride, m_columnIm.data(), m_nImageStride, m_nWidth, m_nHalf + 1);
+
+    FftRealArgs args;
+    args.zRe = m_imageRe.data();
+    args.zIm = m_imageIm.data();
+    args.xRe = m_columnRe.data();
+    args.xIm = m_columnIm.data();
+    args.half = m_nHalf;
+    args.span = m_nImageStride;
+    args.twRe = m_realTwiddleRe.data();
+    args.twIm = m_realTwiddleIm.data();
+    (pTable ? pTable->realInverse : fftRealInverseScalar)(args);
+
+    m_pColumnPlan->transform(m_imageRe.data(), m_imageIm.data(), m_nImageStride, m_workRe.data(), m_workIm.data(), pTable, true);
+}
+
+bool RealFft2D::isAvailable(SimdLevel level)
+{
+    if(level == SIMD_SCALAR)
+    {
+        return true;
+    }
+
+    return CpuFeatures::isSupported(level) && kernels(level) != nullptr;
+}
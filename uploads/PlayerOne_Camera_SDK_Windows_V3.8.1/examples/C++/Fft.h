@@ -0,0 +1,112 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <cstddef>
+#include <vector>
+
+#include "CpuFeatures.h"
+
+struct FftKernelTable;
+
+/*******************************************************************************
+A self-contained FFT for the image processing(eg: PhaseCorrelator), float, split
+complex(a plane of the real parts, a plane of the imaginary parts).
+FftPlan: the complex FFT of the sizes 2^a * 3^b * 5^c(mixed radix: 4, 2, 3, 5),
+Stockham autosort, so no bit reversal pass. It transforms the columns of a plane
+at once(batched): the butterflies run along the rows, the SIMD lanes are the
+columns(see FftKernels.h). The plans are cached by size, the twiddle factors are
+computed once per size for the life of the process.
+RealFft2D: the 2D FFT of a real image of width x height, both even and
+width, height / 2 of the sizes above(eg: 256, 512, 1024, 640, 480).
+The columns are transformed first, the even and odd rows packed as the real and
+imaginary parts of one complex FFT of height / 2, then split into the height / 2 + 1
+rows of the spectrum(the others are the conjugates), the spectrum is transposed and
+its columns(the rows of the image) transformed. So the spectrum is stored by x
+frequency: spectrumRe(u)[v], u = 0 .. width - 1, v = 0 .. height / 2.
+Nothing is normalized: inverse(forward(image)) = width * height * image.
+*******************************************************************************/
+
+class FftPlan
+{
+public:
+    static const FftPlan *get(int size); //the cached plan, nullptr if the size is not supported
+
+    static bool isSupportedSize(int size); //2^a * 3^b * 5^c
+
+    int size() const;
+
+    // transform the size rows of stride floats in place(all the floats of a row are transformed), pTable: nullptr for the scalar code
+    // pWorkRe, pWorkIm: size * stride floats, isInverse: exp(+2 pi i ...), not normalized
+    void transform(float *pRe, float *pIm, size_t stride, float *pWorkRe, float *pWorkIm, const FftKernelTable *pTable, bool isInverse) const;
+
+private:
+    explicit FftPlan(int size);
+
+    FftPlan(const FftPlan &);
+    FftPlan &operator=(const FftPlan &);
+
+    int m_nSize;
+    std::vector<int> m_radices;     //the stages
+    std::vector<float> m_twiddleRe; //the twiddle factors of all the stages
+    std::vector<float> m_twiddleIm;
+};
+
+class RealFft2D
+{
+public:
+    RealFft2D();
+
+    bool init(int width, int height); //allocate the planes, return false if the size is not supported
+
+    static bool isSupportedSize(int width, int height);
+
+    bool setSimdLevel(SimdLevel level); //eg: SIMD_SCALAR to compare with the reference, return false if it's not available
+
+    SimdLevel getSimdLevel() const;
+
+    int width() const;
+
+    int height() const;
+
+    float *inputRow(int y); //the row y of the real image, width floats, the input of forward and the output of inverse
+
+    void forward(); //image -> spectrum
+
+    void inverse(); //spectrum -> image * width * height, the spectrum is overwritten
+
+    int spectrumColumns() const; //height / 2 + 1
+
+    float *spectrumRe(int u); //the spectrum of x frequency u, spectrumColumns() floats
+
+    float *spectrumIm(int u);
+
+    static bool isAvailable(SimdLevel level); //supported by the CPU and the kernels are built in
+
+private:
+    RealFft2D(const RealFft2D &);
+    RealFft2D &operator=(const RealFft2D &);
+
+    static void transpose(const float *pSrc, size_t srcStride, float *pDst, size_t dstStride, int rows, int columns);
+
+    int m_nWidth;
+    int m_nHeight;
+    int m_nHalf;
+    SimdLevel m_simdLevel;
+    const FftPlan *m_pColumnPlan;   //height / 2
+    const FftPlan *m_pRowPlan;      //width
+    size_t m_nImageStride;          //the floats of a row of the image planes
+    size_t m_nSpectrumStride;       //the floats of a row of the spectrum
+
+    std::vector<float> m_imageRe;   //the even rows of the image, then the column FFT
+    std::vector<float> m_imageIm;   //the odd rows
+    std::vector<float> m_columnRe;  //height / 2 + 1 rows, the spectrum before the transposition
+    std::vector<float> m_columnIm;
+    std::vector<float> m_spectrumRe;
+    std::vector<float> m_spectrumIm;
+    std::vector<float> m_workRe;
+    std::vector<float> m_workIm;
+    std::vector<float> m_realTwiddleRe; //exp(-2 pi i * k / height)
+    std::vector<float> m_realTwiddleIm;
+};
+
+#endif // FFT_H
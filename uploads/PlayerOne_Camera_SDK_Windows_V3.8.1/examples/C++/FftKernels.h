@@ -0,0 +1,362 @@
+#ifndef FFTKERNELS_H
+#define FFTKERNELS_H
+
+#include <cstddef>
+
+/*******************************************************************************
+The kernels of the FFT(see Fft.h), one table per SIMD level.
+The data is split complex(a plane of the real parts, a plane of the imaginary
+parts) and batched: an element of the transform is a row of stride floats, so a
+butterfly does the same thing on all the floats of its rows, the SIMD lanes are the
+columns of the image and no shuffle is needed, the twiddle factors are broadcast.
+A stage of the Stockham autosort FFT(radix 2, 3, 4 or 5) reads the elements
+j + r * m(r = 0 .. radix - 1) of x and writes the elements j * radix + k of y:
+y[j * radix + k] = w^(j * k) * sum(x[j + r * m] * exp(-2 pi i * r * k / radix)),
+w = exp(-2 pi i / (m * radix)), after all the stages y is in the natural order.
+The stage n of the stockham recursion(s: the product of the radices before) has
+s * stride floats per element, so the rows of an element are contiguous and a
+butterfly runs over span = s * stride floats.
+The real kernels split the FFT of the rows packed 2 by 2(even rows: real, odd rows:
+imaginary) into the spectrum of the real rows, and pack it again for the inverse.
+*******************************************************************************/
+
+struct FftStageArgs
+{
+    const float *xRe;   //the input, element i at xRe + i * span
+    const float *xIm;
+    float *yRe;         //the output
+    float *yIm;
+    int m;              //the butterflies of the stage, the size of the stage is m * radix
+    size_t span;        //the floats of an element of this stage
+    const float *twRe;  //radix - 1 twiddle factors per butterfly: w^(j * k), k = 1 .. radix - 1
+    const float *twIm;
+};
+
+typedef void (*FftStageFunc)(const FftStageArgs &args);
+
+struct FftRealArgs
+{
+    float *zRe;         //half rows, the FFT of the packed rows
+    float *zIm;
+    float *xRe;         //half + 1 rows, the spectrum of the real rows(0 .. half)
+    float *xIm;
+    int half;           //the real rows / 2
+    size_t span;        //the floats of a row
+    const float *twRe;  //exp(-2 pi i * k / (2 * half)), k = 0 .. half
+    const float *twIm;
+};
+
+typedef void (*FftRealFunc)(const FftRealArgs &args);
+
+struct FftKernelTable
+{
+    FftStageFunc stage[4];      //radix 2, 3, 4, 5
+    FftRealFunc realForward;    //z -> x
+    FftRealFunc realInverse;    //x -> z, the inverse FFT of z gives the real rows * 2 * half
+};
+
+// nullptr if the file was built without the flags of the level
+const FftKernelTable *fftKernelsSSE41();
+
+const FftKernelTable *fftKernelsAVX2();
+
+const FftKernelTable *fftKernelsAVX512();
+
+struct FftScalarOps //the operations of VecF32(see SimdOps.h) on one float, for the scalar code and the tails
+{
+    typedef float V;
+    enum { LANES = 1 };
+
+    static V load(const float *p) { return *p; }
+    static void store(float *p, V a) { *p = a; }
+    static V set1(float value) { return value; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+};
+
+template <class Ops, int RADIX>
+struct FftDft; //the DFT of RADIX elements in place
+
+template <class Ops>
+struct FftDft<Ops, 2>
+{
+    typedef typename Ops::V V;
+
+    static inline void run(V *re, V *im)
+    {
+        V re0 = re[0], im0 = im[0];
+        re[0] = Ops::add(re0, re[1]);
+        im[0] = Ops::add(im0, im[1]);
+        re[1] = Ops::sub(re0, re[1]);
+        im[1] = Ops::sub(im0, im[1]);
+    }
+};
+
+template <class Ops>
+struct FftDft<Ops, 3>
+{
+    typedef typename Ops::V V;
+
+    static inline void run(V *re, V *im)
+    {
+        const V half = Ops::set1(0.5f);
+        const V sin60 = Ops::set1(0.866025403784438647f);
+
+        V sumRe = Ops::add(re[1], re[2]), sumIm = Ops::add(im[1], im[2]);
+        V diffRe = Ops::mul(Ops::sub(re[1], re[2]), sin60), diffIm = Ops::mul(Ops::sub(im[1], im[2]), sin60);
+        V midRe = Ops::sub(re[0], Ops::mul(sumRe, half)), midIm = Ops::sub(im[0], Ops::mul(sumIm, half));
+
+        re[0] = Ops::add(re[0], sumRe);
+        im[0] = Ops::add(im[0], sumIm);
+        re[1] = Ops::add(midRe, diffIm); //mid - i * diff
+        im[1] = Ops::sub(midIm, diffRe);
+        re[2] = Ops::sub(midRe, diffIm);
+        im[2] = Ops::add(midIm, diffRe);
+    }
+};
+
+template <class Ops>
+struct FftDft<Ops, 4>
+{
+    typedef typename Ops::V V;
+
+    static inline void run(V *re, V *im)
+    {
+        V sum02Re = Ops::add(re[0], re[2]), sum02Im = Ops::add(im[0], im[2]);
+        V diff02Re = Ops::sub(re[0], re[2]), diff02Im = Ops::sub(im[0], im[2]);
+        V sum13Re = Ops::add(re[1], re[3]), sum13Im = Ops::add(im[1], im[3]);
+        V diff13Re = Ops::sub(re[1], re[3]), diff13Im = Ops::sub(im[1], im[3]);
+
+        re[0] = Ops::add(sum02Re, sum13Re);
+        im[0] = Ops::add(sum02Im, sum13Im);
+        re[2] = Ops::sub(sum02Re, sum13Re);
+        im[2] = Ops::sub(sum02Im, sum13Im);
+        re[1] = Ops::add(diff02Re, diff13Im); //diff02 - i * diff13
+        im[1] = Ops::sub(diff02Im, diff13Re);
+        re[3] = Ops::sub(diff02Re, diff13Im);
+        im[3] = Ops::add(diff02Im, diff13Re);
+    }
+};
+
+template <class Ops>
+struct FftDft<Ops, 5>
+{
+    typedef typename Ops::V V;
+
+    static inline void run(V *re, V *im)
+    {
+        const V cos72 = Ops::set1(0.309016994374947424f);
+        const V cos144 = Ops::set1(-0.809016994374947424f);
+        const V sin72 = Ops::set1(0.951056516295153572f);
+        const V sin144 = Ops::set1(0.587785252292473129f);
+
+        V sum14Re = Ops::add(re[1], re[4]), sum14Im = Ops::add(im[1], im[4]);
+        V sum23Re = Ops::add(re[2], re[3]), sum23Im = Ops::add(im[2], im[3]);
+        V diff14Re = Ops::sub(re[1], re[4]), diff14Im = Ops::sub(im[1], im[4]);
+        V diff23Re = Ops::sub(re[2], re[3]), diff23Im = Ops::sub(im[2], im[3]);
+
+        V mid1Re = Ops::add(re[0], Ops::add(Ops::mul(sum14Re, cos72), Ops::mul(sum23Re, cos144)));
+        V mid1Im = Ops::add(im[0], Ops::add(Ops::mul(sum14Im, cos72), Ops::mul(sum23Im, cos144)));
+        V mid2Re = Ops::add(re[0], Ops::add(Ops::mul(sum14Re, cos144), Ops::mul(sum23Re, cos72)));
+        V mid2Im = Ops::add(im[0], Ops::add(Ops::mul(sum14Im, cos144), Ops::mul(sum23Im, cos72)));
+        V rot1Re = Ops::add(Ops::mul(diff14Re, sin72), Ops::mul(diff23Re, sin144));
+        V rot1Im = Ops::add(Ops::mul(diff14Im, sin72), Ops::mul(diff23Im, sin144));
+        V rot2Re = Ops::sub(Ops::mul(diff14Re, sin144), Ops::mul(diff23Re, sin72));
+        V rot2Im = Ops::sub(Ops::mul(diff14Im, sin144), Ops::mul(diff23Im, sin72));
+
+        re[0] = Ops::add(re[0], Ops::add(sum14Re, sum23Re));
+        im[0] = Ops::add(im[0], Ops::add(sum14Im, sum23Im));
+        re[1] = Ops::add(mid1Re, rot1Im); //mid - i * rot
+        im[1] = Ops::sub(mid1Im, rot1Re);
+        re[4] = Ops::sub(mid1Re, rot1Im);
+        im[4] = Ops::add(mid1Im, rot1Re);
+        re[2] = Ops::add(mid2Re, rot2Im);
+        im[2] = Ops::sub(mid2Im, rot2Re);
+        re[3] = Ops::sub(mid2Re, rot2Im);
+        im[3] = Ops::add(mid2Im, rot2Re);
+    }
+};
+
+// the butterfly j of a stage on the floats u .. span while a whole vector fits, return where it stopped
+template <class Ops, int RADIX>
+static inline size_t fftButterfly(const FftStageArgs &args, int j, size_t u)
+{
+    typedef typename Ops::V V;
+
+    const size_t span = args.span;
+    const size_t inStep = (size_t)args.m * span;
+    const float *pXRe = args.xRe + (size_t)j * span;
+    const float *pXIm = args.xIm + (size_t)j * span;
+    float *pYRe = args.yRe + (size_t)j * RADIX * span;
+    float *pYIm = args.yIm + (size_t)j * RADIX * span;
+
+    V twRe[RADIX], twIm[RADIX];
+    for(int k = 1; k < RADIX; k++)
+    {
+        twRe[k] = Ops::set1(args.twRe[j * (RADIX - 1) + k - 1]);
+        twIm[k] = Ops::set1(args.twIm[j * (RADIX - 1) + k - 1]);
+    }
+
+    for(; u + Ops::LANES <= span; u += Ops::LANES)
+    {
+        V re[RADIX], im[RADIX];
+        for(int r = 0; r < RADIX; r++)
+        {
+            re[r] = Ops::load(pXRe + r * inStep + u);
+            im[r] = Ops::load(pXIm + r * inStep + u);
+        }
+
+        FftDft<Ops, RADIX>::run(re, im);
+
+        Ops::store(pYRe + u, re[0]);
+        Ops::store(pYIm + u, im[0]);
+        for(int k = 1; k < RADIX; k++)
+        {
+            Ops::store(pYRe + k * span + u, Ops::sub(Ops::mul(re[k], twRe[k]), Ops::mul(im[k], twIm[k])));
+            Ops::store(pYIm + k * span + u, Ops::add(Ops::mul(re[k], twIm[k]), Ops::mul(im[k], twRe[k])));
+        }
+    }
+
+    return u;
+}
+
+// the row k of the spectrum of the real rows from the rows k and half - k of z
+template <class Ops>
+static inline size_t fftRealForwardRow(const FftRealArgs &args, int k, size_t u)
+{
+    typedef typename Ops::V V;
+
+    const float *pARe = args.zRe + (size_t)(k % args.half) * args.span;
+    const float *pAIm = args.zIm + (size_t)(k % args.half) * args.span;
+    const float *pBRe = args.zRe + (size_t)((args.half - k) % args.half) * args.span;
+    const float *pBIm = args.zIm + (size_t)((args.half - k) % args.half) * args.span;
+    float *pXRe = args.xRe + (size_t)k * args.span;
+    float *pXIm = args.xIm + (size_t)k * args.span;
+    const V half = Ops::set1(0.5f);
+    const V twRe = Ops::set1(args.twRe[k]);
+    const V twIm = Ops::set1(args.twIm[k]);
+
+    for(; u + Ops::LANES <= args.span; u += Ops::LANES)
+    {
+        V aRe = Ops::load(pARe + u), aIm = Ops::load(pAIm + u);
+        V bRe = Ops::load(pBRe + u), bIm = Ops::load(pBIm + u);
+
+        // even = (a + conj(b)) / 2, odd = -i * (a - conj(b)) / 2, x = even + w * odd
+        V evenRe = Ops::mul(Ops::add(aRe, bRe), half);
+        V evenIm = Ops::mul(Ops::sub(aIm, bIm), half);
+        V oddRe = Ops::mul(Ops::add(aIm, bIm), half);
+        V oddIm = Ops::mul(Ops::sub(bRe, aRe), half);
+
+        Ops::store(pXRe + u, Ops::add(evenRe, Ops::sub(Ops::mul(oddRe, twRe), Ops::mul(oddIm, twIm))));
+        Ops::store(pXIm + u, Ops::add(evenIm, Ops::add(Ops::mul(oddRe, twIm), Ops::mul(oddIm, twRe))));
+    }
+
+    return u;
+}
+
+// the row k of z from the rows k and half - k of the spectrum
+template <class Ops>
+static inline size_t fftRealInverseRow(const FftRealArgs &args, int k, size_t u)
+{
+    typedef typename Ops::V V;
+
+    const float *pARe = args.xRe + (size_t)k * args.span;
+    const float *pAIm = args.xIm + (size_t)k * args.span;
+    const float *pBRe = args.xRe + (size_t)(args.half - k) * args.span;
+    const float *pBIm = args.xIm + (size_t)(args.half - k) * args.span;
+    float *pZRe = args.zRe + (size_t)k * args.span;
+    float *pZIm = args.zIm + (size_t)k * args.span;
+    const V twRe = Ops::set1(args.twRe[k]);
+    const V twIm = Ops::set1(args.twIm[k]);
+
+    for(; u + Ops::LANES <= args.span; u += Ops::LANES)
+    {
+        V aRe = Ops::load(pARe + u), aIm = Ops::load(pAIm + u);
+        V bRe = Ops::load(pBRe + u), bIm = Ops::load(pBIm + u);
+
+        // even = a + conj(b), odd = (a - conj(b)) * conj(w), z = even + i * odd
+        V evenRe = Ops::add(aRe, bRe);
+        V evenIm = Ops::sub(aIm, bIm);
+        V diffRe = Ops::sub(aRe, bRe);
+        V diffIm = Ops::add(aIm, bIm);
+        V oddRe = Ops::add(Ops::mul(diffRe, twRe), Ops::mul(diffIm, twIm));
+        V oddIm = Ops::sub(Ops::mul(diffIm, twRe), Ops::mul(diffRe, twIm));
+
+        Ops::store(pZRe + u, Ops::sub(evenRe, oddIm));
+        Ops::store(pZIm + u, Ops::add(evenIm, oddRe));
+    }
+
+    return u;
+}
+
+template <int RADIX>
+static void fftStageScalar(const FftStageArgs &args)
+{
+    for(int j = 0; j < args.m; j++)
+    {
+        fftButterfly<FftScalarOps, RADIX>(args, j, 0);
+    }
+}
+
+static inline void fftRealForwardScalar(const FftRealArgs &args)
+{
+    for(int k = 0; k <= args.half; k++)
+    {
+        fftRealForwardRow<FftScalarOps>(args, k, 0);
+    }
+}
+
+static inline void fftRealInverseScalar(const FftRealArgs &args)
+{
+    for(int k = 0; k < args.half; k++)
+    {
+        fftRealInverseRow<FftScalarOps>(args, k, 0);
+    }
+}
+
+#ifdef POA_SIMD_NAMESPACE // included by Fft_<level>.cpp after SimdOps.h
+
+namespace POA_SIMD_NAMESPACE
+{
+
+template <int RADIX>
+static void fftStage(const FftStageArgs &args)
+{
+    for(int j = 0; j < args.m; j++)
+    {
+        size_t u = fftButterfly<VecF32, RADIX>(args, j, 0);
+        fftButterfly<FftScalarOps, RADIX>(args, j, u);
+    }
+}
+
+static void fftRealForward(const FftRealArgs &args)
+{
+    for(int k = 0; k <= args.half; k++)
+    {
+        size_t u = fftRealForwardRow<VecF32>(args, k, 0);
+        fftRealForwardRow<FftScalarOps>(args, k, u);
+    }
+}
+
+static void fftRealInverse(const FftRealArgs &args)
+{
+    for(int k = 0; k < args.half; k++)
+    {
+        size_t u = fftRealInverseRow<VecF32>(args, k, 0);
+        fftRealInverseRow<FftScalarOps>(args, k, u);
+    }
+}
+
+static const FftKernelTable KERNEL_TABLE =
+{
+    { fftStage<2>, fftStage<3>, fftStage<4>, fftStage<5> },
+    fftRealForward,
+    fftRealInverse
+};
+
+} // namespace POA_SIMD_NAMESPACE
+
+#endif // POA_SIMD_NAMESPACE
+
+#endif // FFTKERNELS_H
@@ -0,0 +1,22 @@
+// the AVX2 kernels of the FFT, this file is compiled with -mavx2 or /arch:AVX2(see CMakeLists.txt)
+#if defined(__AVX2__)
+
+#define POA_SIMD_AVX2
+#include "SimdOps.h"
+#include "FftKernels.h"
+
+const FftKernelTable *fftKernelsAVX2()
+{
+    return &POA_SIMD_NAMESPACE::KERNEL_TABLE;
+}
+
+#else
+
+#include "FftKernels.h"
+
+const FftKernelTable *fftKernelsAVX2()
+{
+    return nullptr; //built without the AVX2 flags, the kernels are not available
+}
+
+#endif
@@ -0,0 +1,313 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "FitsWriter.h"
+#include "ByteSwap.h"
+#include "POACamera.h"
+
+using namespace std;
+
+static const size_t CARD_BYTES = 80;
+
+// keyword = value / comment, the value is right-justified to column 30(fixed format), the card is padded with spaces
+static size_t addCard(char *pCard, const char *keyword, const char *value, const char *comment)
+{
+    char card[CARD_BYTES * 2];
+    int len = snprintf(card, sizeof(card), "%-8.8s= %20s / %s", keyword, value, comment);
+
+    size_t n = len < 0 ? 0 : std::min((size_t)len, CARD_BYTES);
+    memcpy(pCard, card, n);
+    memset(pCard + n, ' ', CARD_BYTES - n);
+
+    return CARD_BYTES;
+}
+
+static size_t addCard(char *pCard, const char *keyword, long long value, const char *comment)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%lld", value);
+
+    return addCard(pCard, keyword, text, comment);
+}
+
+static size_t addCard(char *pCard, const char *keyword, double value, const char *comment)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.6f", value);
+
+    return addCard(pCard, keyword, text, comment);
+}
+
+// the string value starts at column 11, padded to 8 chars at least, a quote is written as 2 quotes
+static size_t addStringCard(char *pCard, const char *keyword, const char *value, const char *comment)
+{
+    char text[72];
+    size_t n = 0;
+    text[n++] = '\'';
+    for(size_t i = 0; value[i] != '\0' && n < 66; i++)
+    {
+        if(value[i] == '\'')
+        {
+            text[n++] = '\'';
+        }
+        text[n++] = value[i];
+    }
+    while(n < 9)
+    {
+        text[n++] = ' ';
+    }
+    text[n++] = '\'';
+    text[n] = '\0';
+
+    char card[CARD_BYTES * 2];
+    int len = snprintf(card, sizeof(card), "%-8.8s= %-20s / %s", keyword, text, comment);
+
+    size_t cardLen = len < 0 ? 0 : std::min((size_t)len, CARD_BYTES);
+    memcpy(pCard, card, cardLen);
+    memset(pCard + cardLen, ' ', CARD_BYTES - cardLen);
+
+    return CARD_BYTES;
+}
+
+// UTC, microseconds since 1970-01-01 -> "yyyy-mm-ddThh:mm:ss.ssssss"
+static void formatDate(long long timestampUs, char *pText, size_t textSize)
+{
+    long long seconds = timestampUs / 1000000;
+    long long micros = timestampUs % 1000000;
+    long long days = seconds / 86400;
+    long long secondOfDay = seconds % 86400;
+
+    // days since 1970-01-01 to the civil date(proleptic Gregorian)
+    long long z = days + 719468;
+    long long era = z / 146097;
+    long long dayOfEra = z - era * 146097;
+    long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    long long mp = (5 * dayOfYear + 2) / 153;
+    long long day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    long long month = mp < 10 ? mp + 3 : mp - 9;
+    long long year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    snprintf(pText, textSize, "%04lld-%02lld-%02lldT%02lld:%02lld:%02lld.%06lld", year, month, day,
+             secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60, micros);
+}
+
+static const char *bayerPatternName(POABayerPattern bayerPattern)
+{
+    switch (bayerPattern)
+    {
+    case POA_BAYER_RG:
+        return "RGGB";
+    case POA_BAYER_BG:
+        return "BGGR";
+    case POA_BAYER_GR:
+        return "GRBG";
+    case POA_BAYER_GB:
+        return "GBRG";
+    default:
+        return "NONE";
+    }
+}
+
+FitsWriter::FitsWriter(FramePool *pBufferPool)
+{
+    m_pBufferPool = pBufferPool;
+}
+
+bool FitsWriter::readCameraState(POACamera &camera)
+{
+    POACameraProperties cameraProp;
+    if(!camera.getCameraProperties(cameraProp))
+    {
+        return false;
+    }
+
+    m_cameraState.instrument = cameraProp.cameraModelName;
+    m_cameraState.gain = camera.getGain();
+    m_cameraState.offset = camera.getOffset();
+    m_cameraState.hasTemperature = camera.getTemperature(m_cameraState.temperature);
+
+    return true;
+}
+
+void FitsWriter::setCameraState(const FitsCameraState &cameraState)
+{
+    m_cameraState = cameraState;
+}
+
+const FitsCameraState &FitsWriter::getCameraState() const
+{
+    return m_cameraState;
+}
+
+size_t FitsWriter::formatHeader(const Frame &frame, char *pDst) const
+{
+    bool is16Bit = frame.imgFormat() == POA_RAW16;
+    char *pCard = pDst;
+
+    pCard += addCard(pCard, "SIMPLE", "T", "file conforms to FITS standard");
+    pCard += addCard(pCard, "BITPIX", is16Bit ? 16LL : 8LL, "number of bits per data pixel");
+    pCard += addCard(pCard, "NAXIS", 2LL, "number of data axes");
+    pCard += addCard(pCard, "NAXIS1", (long long)frame.width(), "length of data axis 1");
+    pCard += addCard(pCard, "NAXIS2", (long long)frame.height(), "length of data axis 2");
+    if(is16Bit)
+    {
+        pCard += addCard(pCard, "BZERO", 32768LL, "offset data range to that of unsigned short");
+        pCard += addCard(pCard, "BSCALE", 1LL, "default scaling factor");
+    }
+    pCard += addStringCard(pCard, "ROWORDER", "TOP-DOWN", "order of the rows");
+
+    if(frame.timestampUs > 0) //the frame is stamped when it's ready, DATE-OBS is the start of the exposure
+    {
+        char date[64];
+        formatDate(frame.timestampUs - frame.exposureUs, date, sizeof(date));
+        pCard += addStringCard(pCard, "DATE-OBS", date, "UTC start of the exposure");
+    }
+    pCard += addCard(pCard, "EXPTIME", frame.exposureUs / 1000000.0, "exposure time in seconds");
+    pCard += addCard(pCard, "XBINNING", (long long)frame.bin, "binning factor in width");
+    pCard += addCard(pCard, "YBINNING", (long long)frame.bin, "binning factor in height");
+    pCard += addCard(pCard, "XORGSUBF", (long long)frame.startX, "subframe origin on X axis");
+    pCard += addCard(pCard, "YORGSUBF", (long long)frame.startY, "subframe origin on Y axis");
+
+    if(frame.bayerPattern() != POA_BAYER_MONO) //the pattern of the frame, a view has the shifted pattern
+    {
+        pCard += addStringCard(pCard, "BAYERPAT", bayerPatternName(frame.bayerPattern()), "bayer color pattern");
+        pCard += addCard(pCard, "XBAYROFF", 0LL, "X offset of bayer array");
+        pCard += addCard(pCard, "YBAYROFF", 0LL, "Y offset of bayer array");
+    }
+
+    if(!m_cameraState.instrument.empty())
+    {
+        pCard += addStringCard(pCard, "INSTRUME", m_cameraState.instrument.c_str(), "camera model");
+    }
+    if(m_cameraState.gain >= 0)
+    {
+        pCard += addCard(pCard, "GAIN", (long long)m_cameraState.gain, "sensor gain");
+    }
+    if(m_cameraState.offset >= 0)
+    {
+        pCard += addCard(pCard, "OFFSET", (long long)m_cameraState.offset, "sensor offset");
+    }
+    if(m_cameraState.hasTemperature)
+    {
+        pCard += addCard(pCard, "CCD-TEMP", m_cameraState.temperature, "sensor temperature in C");
+    }
+
+    memset(pCard, ' ', CARD_BYTES);
+    memcpy(pCard, "END", 3);
+    pCard += CARD_BYTES;
+
+    size_t headerBytes = pCard - pDst;
+    size_t paddedBytes = (headerBytes + BLOCK_BYTES - 1) / BLOCK_BYTES * BLOCK_BYTES;
+    memset(pCard, ' ', paddedBytes - headerBytes);
+
+    return paddedBytes;
+}
+
+size_t FitsWriter::fileBytes(const Frame &frame)
+{
+    size_t dataBytes = frame.sizeBytes();
+
+    return BLOCK_BYTES + (dataBytes + BLOCK_BYTES - 1) / BLOCK_BYTES * BLOCK_BYTES;
+}
+
+bool FitsWriter::write(const std::string &fileName, const Frame &frame)
+{
+    POAImgFormat imgFormat = frame.imgFormat();
+    if(!frame.isValid() || (imgFormat != POA_RAW8 && imgFormat != POA_MONO8 && imgFormat != POA_RAW16))
+    {
+        cerr << "write fits failed, only RAW8, MONO8 and RAW16 frames are supported" << endl;
+        return false;
+    }
+
+    FramePool *pPool = m_pBufferPool;
+    if(!pPool)
+    {
+        if(!m_ownPool.isInitialized() && !m_ownPool.init(BUFFER_BYTES, 1))
+        {
+            return false;
+        }
+        pPool = &m_ownPool;
+    }
+
+    size_t bufferBytes = pPool->slabBytes() / BLOCK_BYTES * BLOCK_BYTES;
+    unsigned char *pBuffer = bufferBytes > 0 ? pPool->acquire() : nullptr;
+    if(!pBuffer)
+    {
+        cerr << "write fits failed, no free output buffer" << endl;
+        return false;
+    }
+
+    std::ofstream outFile;
+    outFile.rdbuf()->pubsetbuf(nullptr, 0); //the writes are large, no need to copy them into the stream buffer
+    outFile.open(fileName, std::ios::out | std::ios::binary);
+
+    size_t used = formatHeader(frame, (char *)pBuffer);
+
+    if(imgFormat == POA_RAW16)
+    {
+        for(int y = 0; y < frame.height(); y++)
+        {
+            const uint16_t *pRow = (const uint16_t *)frame.row(y);
+            size_t left = frame.width();
+
+            while(left > 0)
+            {
+                size_t count = std::min(left, (bufferBytes - used) / sizeof(uint16_t));
+                if(count == 0)
+                {
+                    outFile.write((const char *)pBuffer, used);
+                    used = 0;
+                    continue;
+                }
+
+                // the unsigned pixels - 32768(BZERO), in big endian
+                ByteSwap::toBigEndian16(pRow, (uint16_t *)(pBuffer + used), count, 0x8000);
+                pRow += count;
+                left -= count;
+                used += count * sizeof(uint16_t);
+            }
+        }
+    }
+    else
+    {
+        outFile.write((const char *)pBuffer, used); //the header, then the rows straight from the frame
+        used = 0;
+
+        if(frame.isContiguous())
+        {
+            outFile.write((const char *)frame.data(), frame.sizeBytes());
+        }
+        else
+        {
+            for(int y = 0; y < frame.height(); y++)
+            {
+                outFile.write((const char *)frame.row(y), frame.rowBytes());
+            }
+        }
+    }
+
+    // the data is padded with zeros to a whole block
+    size_t padBytes = (BLOCK_BYTES - frame.sizeBytes() % BLOCK_BYTES) % BLOCK_BYTES;
+    if(used + padBytes > bufferBytes)
+    {
+        outFile.write((const char *)pBuffer, used);
+        used = 0;
+    }
+    memset(pBuffer + used, 0, padBytes);
+    used += padBytes;
+    outFile.write((const char *)pBuffer, used);
+
+    pPool->recycle(pBuffer);
+
+    outFile.close();
+    if(!outFile)
+    {
+        cerr << "write fits failed, can't write the file: " << fileName << endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef FITSWRITER_H
+#define FITSWRITER_H
+
+#include <cstddef>
+#include <string>
+
+#include "PlayerOneCamera.h"
+#include "FramePool.h"
+#include "Frame.h"
+
+class POACamera;
+
+/*******************************************************************************
+A FITS writer without 3rdparty library(cfitsio), one frame per file.
+RAW8 / MONO8 are written as BITPIX 8, RAW16 as BITPIX 16 with BZERO 32768 and
+BSCALE 1(FITS has no unsigned 16 bit integer, the pixels are stored as value - 32768).
+The header has the cards of the frame(EXPTIME, XBINNING, YBINNING, BAYERPAT,
+XORGSUBF, YORGSUBF, DATE-OBS) and of the camera(INSTRUME, GAIN, OFFSET, CCD-TEMP),
+see readCameraState(). The rows are written top-down(ROWORDER), as the camera sends them.
+The file is streamed through an output buffer taken from a pool: the 8 bit rows
+are written directly from the frame, the 16 bit rows are converted to big endian
+into the buffer(see ByteSwap) and written a buffer at a time, no pixel buffer is allocated
+per frame.
+*******************************************************************************/
+
+struct FitsCameraState //the cards of the camera, read by FitsWriter::readCameraState()
+{
+    std::string instrument; //INSTRUME, the camera model name
+    long gain;              //GAIN, -1 if unknown
+    long offset;            //OFFSET, -1 if unknown
+    bool hasTemperature;
+    double temperature;     //CCD-TEMP, Celsius
+
+    FitsCameraState()
+    {
+        gain = -1;
+        offset = -1;
+        hasTemperature = false;
+        temperature = 0.0;
+    }
+};
+
+class FitsWriter
+{
+public:
+    // the output buffers are taken from pBufferPool if given(eg: a pool shared by the writers), else from an own pool
+    explicit FitsWriter(FramePool *pBufferPool = nullptr);
+
+    bool readCameraState(POACamera &camera); //the cached gain and offset, the temperature, call it when they change
+
+    void setCameraState(const FitsCameraState &cameraState);
+
+    const FitsCameraState &getCameraState() const;
+
+    bool write(const std::string &fileName, const Frame &frame); //RAW8, MONO8 or RAW16
+
+    size_t formatHeader(const Frame &frame, char *pDst) const; //the header blocks, pDst must have BLOCK_BYTES, return the bytes
+
+    static size_t fileBytes(const Frame &frame); //the size of the file of the frame
+
+    static const size_t BLOCK_BYTES = 2880; //FITS is written in blocks of 2880 bytes(36 cards of 80 chars)
+
+    static const size_t BUFFER_BYTES = 364 * BLOCK_BYTES; //about 1MB, the output buffer of the own pool
+
+private:
+    FitsWriter(const FitsWriter &);
+    FitsWriter &operator=(const FitsWriter &);
+
+    FramePool *m_pBufferPool;
+    FramePool m_ownPool; //initialized at the first write if no pool is given
+    FitsCameraState m_cameraState;
+};
+
+#endif // FITSWRITER_H
@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+
+#include "FocusMonitor.h"
+
+using namespace std;
+
+static const int CONTRAST_TILE_ROWS = 64;
+
+static double elapsedUs(chrono::steady_clock::time_point beginTime)
+{
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - beginTime).count();
+}
+
+static long long utcNowUs()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static double median(vector<float> &values) //reordered
+{
+    if(values.empty())
+    {
+        return 0.0;
+    }
+
+    size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+
+    return values[middle];
+}
+
+FocusMonitor::FocusMonitor(int threadCount)
+    : m_parallel(threadCount), m_extractor(threadCount), m_bRunning(false), m_bHasPending(false), m_nPendingMove(0),
+      m_lPosition(0), m_llMoveTimeUs(0), m_nMove(0), m_nCurveLength(256), m_nSettledMove(0), m_nSettledSamples(0),
+      m_totalLatencyUs(0.0), m_totalComputeUs(0.0)
+{
+}
+
+FocusMonitor::~FocusMonitor()
+{
+    stop();
+}
+
+bool FocusMonitor::start(const SampleFunc &sampleFunc, int curveLength)
+{
+    if(m_bRunning)
+    {
+        cerr << "start focus monitor failed, it's already running" << endl;
+        return false;
+    }
+
+    if(curveLength < 1)
+    {
+        cerr << "start focus monitor failed, invalid curve length" << endl;
+        return false;
+    }
+
+    m_sampleFunc = sampleFunc;
+    {
+        lock_guard<mutex> lock(m_curveMutex);
+        m_nCurveLength = curveLength;
+        m_samples.clear();
+        m_stats = FocusMonitorStats();
+        m_totalLatencyUs = 0.0;
+        m_totalComputeUs = 0.0;
+    }
+
+    m_bRunning = true;
+    m_workerThread = std::thread(&FocusMonitor::workerLoop, this);
+
+    return true;
+}
+
+void FocusMonitor::stop()
+{
+    if(!m_bRunning)
+    {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_bRunning = false;
+        m_pending.reset();
+        m_bHasPending = false;
+    }
+    m_slotReady.notify_all();
+    m_workerThread.join();
+    m_sampled.notify_all();
+}
+
+bool FocusMonitor::isRunning() const
+{
+    return m_bRunning;
+}
+
+void FocusMonitor::setROI(const ROIArea &roi)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_roi = roi;
+}
+
+ROIArea FocusMonitor::getROI() const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    return m_roi;
+}
+
+StarExtractor &FocusMonitor::getStarExtractor()
+{
+    return m_extractor;
+}
+
+void FocusMonitor::setFocuserPosition(long position)
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_lPosition = position;
+    m_llMoveTimeUs = utcNowUs();
+    m_nMove++;
+}
+
+long FocusMonitor::getFocuserPosition() const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    return m_lPosition;
+}
+
+bool FocusMonitor::push(const Frame &frame)
+{
+    if(!frame.isValid())
+    {
+        return false;
+    }
+
+    bool isSkipped = false;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if(!m_bRunning)
+        {
+            return false;
+        }
+
+        isSkipped = m_bHasPending;
+        m_pending = frame; //a reference, not a copy of the pixels
+        m_bHasPending = true;
+        m_pendingTime = chrono::steady_clock::now();
+        m_nPendingMove = m_nMove;
+
+        // the exposure started at timestampUs - exposureUs, a frame without a timestamp was exposed before push()
+        long long endUs = frame.timestampUs > 0 ? frame.timestampUs : utcNowUs();
+        m_pendingTags = FocusSample();
+        m_pendingTags.seq = frame.seq;
+        m_pendingTags.timestampUs = frame.timestampUs;
+        m_pendingTags.position = m_lPosition;
+        m_pendingTags.isSettled = endUs - frame.exposureUs >= m_llMoveTimeUs;
+    }
+    m_slotReady.notify_one();
+
+    lock_guard<mutex> lock(m_curveMutex);
+    m_stats.framesPushed++;
+    if(isSkipped)
+    {
+        m_stats.framesSkipped++;
+    }
+
+    return true;
+}
+
+bool FocusMonitor::waitSettled(int sampleCount, int timeoutMs)
+{
+    unsigned long long move = 0;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        move = m_nMove;
+    }
+
+    unique_lock<mutex> lock(m_curveMutex);
+
+    return m_sampled.wait_for(lock, chrono::milliseconds(timeoutMs), [&]()
+    {
+        return m_nSettledMove == move && m_nSettledSamples >= sampleCount;
+    });
+}
+
+void FocusMonitor::getSamples(vector<FocusSample> &samples) const
+{
+    lock_guard<mutex> lock(m_curveMutex);
+    samples.assign(m_samples.begin(), m_samples.end());
+}
+
+void FocusMonitor::getCurve(vector<FocusCurvePoint> &points) const
+{
+    map<long, vector<const FocusSample *> > byPosition;
+    lock_guard<mutex> lock(m_curveMutex);
+    for(size_t i = 0; i < m_samples.size(); i++)
+    {
+        if(m_samples[i].isSettled)
+        {
+            byPosition[m_samples[i].position].push_back(&m_samples[i]);
+        }
+    }
+
+    points.clear();
+    vector<float> hfr;
+    for(map<long, vector<const FocusSample *> >::const_iterator iter = byPosition.begin(); iter != byPosition.end(); ++iter)
+    {
+        FocusCurvePoint point;
+        point.position = iter->first;
+        point.sampleCount = (int)iter->second.size();
+        hfr.clear();
+        for(size_t i = 0; i < iter->second.size(); i++)
+        {
+            const FocusSample &sample = *iter->second[i];
+            if(sample.starCount > 0)
+            {
+                hfr.push_back((float)sample.medianHfr);
+            }
+            point.starCount += sample.starCount;
+            point.contrast += sample.contrast;
+        }
+        point.medianHfr = median(hfr);
+        point.starCount /= point.sampleCount;
+        point.contrast /= point.sampleCount;
+        points.push_back(point);
+    }
+}
+
+void FocusMonitor::clearCurve()
+{
+    lock_guard<mutex> lock(m_curveMutex);
+    m_samples.clear();
+}
+
+FocusMonitorStats FocusMonitor::getStats() const
+{
+    lock_guard<mutex> lock(m_curveMutex);
+    FocusMonitorStats stats = m_stats;
+    if(stats.framesMeasured > 0)
+    {
+        stats.avgLatencyUs = m_totalLatencyUs / stats.framesMeasured;
+        stats.avgComputeUs = m_totalComputeUs / stats.framesMeasured;
+    }
+
+    return stats;
+}
+
+template<typename T>
+double FocusMonitor::contrast(const Frame &frame, int step)
+{
+    const int width = frame.width();
+    const int height = frame.height();
+    if(width <= step || height <= step)
+    {
+        return 0.0;
+    }
+
+    // the differences to the right and below, step 2 on a bayer frame: the same color
+    const int tileCount = (height - step + CONTRAST_TILE_ROWS - 1) / CONTRAST_TILE_ROWS;
+    m_tileSums.assign((size_t)tileCount * 2, 0.0);
+    m_parallel.run(height - step, [&](int rowBegin, int rowEnd)
+    {
+        double sum = 0.0, sumSquares = 0.0;
+        for(int y = rowBegin; y < rowEnd; y++)
+        {
+            const T *pRow = (const T *)frame.row(y);
+            const T *pBelow = (const T *)frame.row(y + step);
+            int64_t rowSum = 0, rowSquares = 0; //exact, a row of RAW16 fits
+            for(int x = 0; x < width - step; x++)
+            {
+                int right = (int)pRow[x + step] - pRow[x];
+                int below = (int)pBelow[x] - pRow[x];
+                rowSum += pRow[x];
+                rowSquares += (int64_t)right * right + (int64_t)below * below;
+            }
+            sum += (double)rowSum;
+            sumSquares += (double)rowSquares;
+        }
+        m_tileSums[(size_t)(rowBegin / CONTRAST_TILE_ROWS) * 2] = sum;
+        m_tileSums[(size_t)(rowBegin / CONTRAST_TILE_ROWS) * 2 + 1] = sumSquares;
+    }, CONTRAST_TILE_ROWS);
+
+    double sum = 0.0, sumSquares = 0.0;
+    for(int tile = 0; tile < tileCount; tile++)
+    {
+        sum += m_tileSums[(size_t)tile * 2];
+        sumSquares += m_tileSums[(size_t)tile * 2 + 1];
+    }
+
+    double count = (double)(width - step) * (height - step);
+    double mean = sum / count;
+
+    return mean > 0.0 ? sumSquares / (2.0 * count) / (mean * mean) : 0.0;
+}
+
+void FocusMonitor::measure(const Frame &frame, FocusSample &sample)
+{
+    ROIArea roi = getROI();
+    Frame area = frame;
+    if(roi.width > 0 && roi.height > 0)
+    {
+        int x0 = std::max(roi.startX, 0);
+        int y0 = std::max(roi.startY, 0);
+        int x1 = std::min(roi.startX + roi.width, frame.width());
+        int y1 = std::min(roi.startY + roi.height, frame.height());
+        if(x1 > x0 && y1 > y0)
+        {
+            area = frame.view(x0, y0, x1 - x0, y1 - y0);
+        }
+    }
+
+    m_extractor.extract(area, m_stars);
+    sample.starCount = (int)m_stars.size();
+
+    m_values.clear();
+    for(size_t i = 0; i < m_stars.size(); i++)
+    {
+        m_values.push_back(m_stars[i].hfr);
+    }
+    sample.medianHfr = median(m_values);
+
+    m_values.clear();
+    for(size_t i = 0; i < m_stars.size(); i++)
+    {
+        if(m_stars[i].fwhm > 0.0f)
+        {
+            m_values.push_back(m_stars[i].fwhm);
+        }
+    }
+    sample.medianFwhm = median(m_values);
+
+    int step = area.bayerPattern() != POA_BAYER_MONO && area.imgFormat() != POA_MONO8 ? 2 : 1;
+    if(area.imgFormat() == POA_RAW16)
+    {
+        sample.contrast = contrast<uint16_t>(area, step);
+    }
+    else if(area.imgFormat() == POA_RAW8 || area.imgFormat() == POA_MONO8)
+    {
+        sample.contrast = contrast<unsigned char>(area, step);
+    }
+}
+
+void FocusMonitor::workerLoop()
+{
+    for(;;)
+    {
+        Frame frame;
+        FocusSample sample;
+        unsigned long long move = 0;
+        chrono::steady_clock::time_point pushTime;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_slotReady.wait(lock, [this]() { return m_bHasPending || !m_bRunning; });
+            if(!m_bRunning)
+            {
+                break;
+            }
+
+            frame = std::move(m_pending); //the slot is free while the frame is measured
+            m_bHasPending = false;
+            sample = m_pendingTags;
+            move = m_nPendingMove;
+            pushTime = m_pendingTime;
+        }
+
+        sample.queueUs = elapsedUs(pushTime);
+        chrono::steady_clock::time_point beginTime = chrono::steady_clock::now();
+        measure(frame, sample);
+        sample.computeUs = elapsedUs(beginTime);
+        sample.latencyUs = frame.timestampUs > 0 ? (double)(utcNowUs() - frame.timestampUs) : elapsedUs(pushTime);
+        frame.reset(); //the buffer goes back to the pool before the callback
+
+        {
+            lock_guard<mutex> lock(m_curveMutex);
+            m_samples.push_back(sample);
+            while(m_samples.size() > m_nCurveLength)
+            {
+                m_samples.pop_front();
+            }
+
+            if(m_nSettledMove != move)
+            {
+                m_nSettledMove = move;
+                m_nSettledSamples = 0;
+            }
+            if(sample.isSettled)
+            {
+                m_nSettledSamples++;
+            }
+            else
+            {
+                m_stats.framesUnsettled++;
+            }
+
+            m_stats.framesMeasured++;
+            m_stats.lastLatencyUs = sample.latencyUs;
+            m_stats.maxLatencyUs = std::max(m_stats.maxLatencyUs, sample.latencyUs);
+            m_stats.maxComputeUs = std::max(m_stats.maxComputeUs, sample.computeUs);
+            m_totalLatencyUs += sample.latencyUs;
+            m_totalComputeUs += sample.computeUs;
+        }
+        m_sampled.notify_all();
+
+        if(m_sampleFunc)
+        {
+            m_sampleFunc(sample);
+        }
+    }
+}
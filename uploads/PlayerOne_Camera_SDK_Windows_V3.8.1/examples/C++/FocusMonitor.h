@@ -0,0 +1,195 @@
+#ifndef FOCUSMONITOR_H
+#define FOCUSMONITOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Frame.h"
+#include "ParallelRows.h"
+#include "POACamera.h"
+#include "StarExtractor.h"
+
+/*******************************************************************************
+Focus metrics of the capture stream, for a focuser driver(autofocus, V-curve): the
+consumer of POACamera::popFrame() pushes the frames, a worker thread measures them
+in the ROI: the median HFR and FWHM of the stars(StarExtractor), the star count, and
+the contrast(the mean square difference of the neighbours of the same color / the
+square of the mean), which still works without stars(planets, the moon).
+push() never blocks and never copies the pixels: the frame waits in a single slot,
+a frame pushed while the worker is busy replaces the waiting one(the focus needs
+the newest frame, see FocusMonitorStats::framesSkipped), so the capture thread and
+the consumer never wait for the metrics.
+The focuser driver calls setFocuserPosition() when the focuser stopped, a frame is
+settled if its exposure started after that(Frame::timestampUs - exposureUs), only
+the settled frames make the curve(getCurve(): the median of the samples of every
+position), waitSettled() waits for the samples of the current position.
+Every sample has its latency: from the end of the exposure(Frame::timestampUs) to
+the sample published, the wait in the slot and the time of the measure, so the
+latency of the metrics can be compared with the step rate of the V-curve.
+*******************************************************************************/
+
+struct FocusSample
+{
+    unsigned long long seq; //Frame::seq
+    long long timestampUs;  //Frame::timestampUs
+    long position;          //the focuser position when the frame was pushed
+    bool isSettled;         //the exposure started after the focuser stopped at position
+    int starCount;
+    double medianHfr;       //pixels of the frame, 0 if no star
+    double medianFwhm;
+    double contrast;        //higher is sharper, it depends on the scene, compare the frames of the same run
+    double queueUs;         //from push() to the start of the measure
+    double computeUs;       //the stars and the contrast
+    double latencyUs;       //from the end of the exposure(or push() if the frame has no timestamp) to the sample published
+
+    FocusSample()
+    {
+        seq = 0;
+        timestampUs = 0;
+        position = 0;
+        isSettled = false;
+        starCount = 0;
+        medianHfr = 0.0;
+        medianFwhm = 0.0;
+        contrast = 0.0;
+        queueUs = 0.0;
+        computeUs = 0.0;
+        latencyUs = 0.0;
+    }
+};
+
+struct FocusCurvePoint //the settled samples of a position
+{
+    long position;
+    int sampleCount;
+    double medianHfr;   //the median of the samples with stars, 0 if none
+    double starCount;   //the mean of the samples
+    double contrast;    //the mean of the samples
+
+    FocusCurvePoint()
+    {
+        position = 0;
+        sampleCount = 0;
+        medianHfr = 0.0;
+        starCount = 0.0;
+        contrast = 0.0;
+    }
+};
+
+struct FocusMonitorStats
+{
+    unsigned long long framesPushed;
+    unsigned long long framesMeasured;
+    unsigned long long framesSkipped;   //replaced in the slot by a newer frame
+    unsigned long long framesUnsettled; //measured, but the focuser moved during the exposure
+    double lastLatencyUs;
+    double avgLatencyUs;
+    double maxLatencyUs;
+    double avgComputeUs;
+    double maxComputeUs;
+
+    FocusMonitorStats()
+    {
+        framesPushed = 0;
+        framesMeasured = 0;
+        framesSkipped = 0;
+        framesUnsettled = 0;
+        lastLatencyUs = 0.0;
+        avgLatencyUs = 0.0;
+        maxLatencyUs = 0.0;
+        avgComputeUs = 0.0;
+        maxComputeUs = 0.0;
+    }
+};
+
+class FocusMonitor
+{
+public:
+    typedef std::function<void(const FocusSample &sample)> SampleFunc;
+
+    explicit FocusMonitor(int threadCount = 0); //the threads of the measure, 0: all cores
+
+    ~FocusMonitor(); //stop()
+
+    // sampleFunc(optional) is called by the worker thread after every sample, the samples kept are the rolling curve
+    bool start(const SampleFunc &sampleFunc = SampleFunc(), int curveLength = 256);
+
+    void stop(); //the frame waiting in the slot is dropped
+
+    bool isRunning() const;
+
+    void setROI(const ROIArea &roi); //pixels of the frames, width or height 0: the whole frame(default)
+
+    ROIArea getROI() const;
+
+    StarExtractor &getStarExtractor(); //the settings of the detection, change them before start()
+
+    void setFocuserPosition(long position); //the focuser stopped at position, the frames exposed before are not settled
+
+    long getFocuserPosition() const;
+
+    bool push(const Frame &frame); //RAW8, RAW16 or MONO8, return false if the monitor is not running
+
+    // wait until sampleCount settled samples of the current position are measured, false if timeout
+    bool waitSettled(int sampleCount, int timeoutMs);
+
+    void getSamples(std::vector<FocusSample> &samples) const; //the rolling curve, the oldest first
+
+    void getCurve(std::vector<FocusCurvePoint> &points) const; //the settled samples by position, sorted by position
+
+    void clearCurve();
+
+    FocusMonitorStats getStats() const;
+
+private:
+    FocusMonitor(const FocusMonitor &);
+    FocusMonitor &operator=(const FocusMonitor &);
+
+    void workerLoop();
+
+    void measure(const Frame &frame, FocusSample &sample);
+
+    template<typename T>
+    double contrast(const Frame &frame, int step);
+
+    ParallelRows m_parallel;
+    StarExtractor m_extractor;
+    std::vector<ExtractedStar> m_stars;
+    std::vector<float> m_values;            //the HFR or FWHM of the stars, for the median
+    std::vector<double> m_tileSums;         //the contrast of every tile: the sum, the sum of squares of the differences
+    std::thread m_workerThread;
+    SampleFunc m_sampleFunc;
+    std::atomic<bool> m_bRunning;
+
+    // the slot, the ROI and the focuser
+    mutable std::mutex m_mutex;
+    std::condition_variable m_slotReady;
+    Frame m_pending;
+    bool m_bHasPending;
+    FocusSample m_pendingTags;              //seq, position, isSettled
+    unsigned long long m_nPendingMove;      //the move of the focuser when the frame was pushed
+    std::chrono::steady_clock::time_point m_pendingTime;
+    ROIArea m_roi;
+    long m_lPosition;
+    long long m_llMoveTimeUs;               //UTC, when the focuser stopped
+    unsigned long long m_nMove;             //incremented by setFocuserPosition
+
+    // the samples
+    mutable std::mutex m_curveMutex;
+    std::condition_variable m_sampled;
+    std::deque<FocusSample> m_samples;
+    size_t m_nCurveLength;
+    unsigned long long m_nSettledMove;      //the move of the settled samples counted
+    int m_nSettledSamples;
+    FocusMonitorStats m_stats;
+    double m_totalLatencyUs;
+    double m_totalComputeUs;
+};
+
+#endif // FOCUSMONITOR_H
@@ -0,0 +1,261 @@
+#include "Frame.h"
+
+Frame::Frame()
+{
+    m_pBuffer = nullptr;
+    m_pData = nullptr;
+    m_nWidth = 0;
+    m_nHeight = 0;
+    m_nStride = 0;
+    m_imgFormat = POA_END;
+    m_bayerPattern = POA_BAYER_MONO;
+
+    bin = 1;
+    startX = 0;
+    startY = 0;
+    exposureUs = 0;
+    timestampUs = 0;
+    seq = 0;
+}
+
+Frame::Frame(const Frame &other)
+{
+    m_pBuffer = nullptr;
+    *this = other;
+}
+
+Frame::Frame(Frame &&other)
+{
+    m_pBuffer = nullptr;
+    *this = static_cast<Frame &&>(other);
+}
+
+Frame &Frame::operator=(const Frame &other)
+{
+    if(this == &other)
+    {
+        return *this;
+    }
+
+    if(other.m_pBuffer)
+    {
+        other.m_pBuffer->refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    FrameBuffer *pOldBuffer = m_pBuffer;
+
+    m_pBuffer = other.m_pBuffer;
+    m_pData = other.m_pData;
+    m_nWidth = other.m_nWidth;
+    m_nHeight = other.m_nHeight;
+    m_nStride = other.m_nStride;
+    m_imgFormat = other.m_imgFormat;
+    m_bayerPattern = other.m_bayerPattern;
+
+    bin = other.bin;
+    startX = other.startX;
+    startY = other.startY;
+    exposureUs = other.exposureUs;
+    timestampUs = other.timestampUs;
+    seq = other.seq;
+
+    if(pOldBuffer && pOldBuffer->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        pOldBuffer->pool->recycle(pOldBuffer);
+    }
+
+    return *this;
+}
+
+Frame &Frame::operator=(Frame &&other)
+{
+    if(this == &other)
+    {
+        return *this;
+    }
+
+    release();
+
+    m_pBuffer = other.m_pBuffer;
+    m_pData = other.m_pData;
+    m_nWidth = other.m_nWidth;
+    m_nHeight = other.m_nHeight;
+    m_nStride = other.m_nStride;
+    m_imgFormat = other.m_imgFormat;
+    m_bayerPattern = other.m_bayerPattern;
+
+    bin = other.bin;
+    startX = other.startX;
+    startY = other.startY;
+    exposureUs = other.exposureUs;
+    timestampUs = other.timestampUs;
+    seq = other.seq;
+
+    other.m_pBuffer = nullptr;
+    other.m_pData = nullptr;
+
+    return *this;
+}
+
+Frame::~Frame()
+{
+    release();
+}
+
+Frame Frame::fromBuffer(FrameBuffer *pBuffer, int width, int height, POAImgFormat imgFormat, POABayerPattern bayerPattern)
+{
+    Frame frame;
+
+    if(!pBuffer)
+    {
+        return frame;
+    }
+
+    frame.m_pBuffer = pBuffer; //takes the reference of the caller
+    frame.m_pData = pBuffer->data;
+    frame.m_nWidth = width;
+    frame.m_nHeight = height;
+    frame.m_imgFormat = imgFormat;
+    frame.m_nStride = (size_t)width * FramePool::bytesPerPixel(imgFormat);
+    frame.m_bayerPattern = (imgFormat == POA_RAW8 || imgFormat == POA_RAW16) ? bayerPattern : POA_BAYER_MONO;
+
+    return frame;
+}
+
+Frame Frame::wrap(unsigned char *pData, int width, int height, size_t stride, POAImgFormat imgFormat, POABayerPattern bayerPattern)
+{
+    Frame frame;
+
+    frame.m_pData = pData;
+    frame.m_nWidth = width;
+    frame.m_nHeight = height;
+    frame.m_imgFormat = imgFormat;
+    frame.m_nStride = stride;
+    frame.m_bayerPattern = (imgFormat == POA_RAW8 || imgFormat == POA_RAW16) ? bayerPattern : POA_BAYER_MONO;
+
+    return frame;
+}
+
+bool Frame::isValid() const
+{
+    return m_pData != nullptr;
+}
+
+void Frame::reset()
+{
+    release();
+}
+
+Frame Frame::view(int x, int y, int width, int height) const
+{
+    if(!isValid() || x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > m_nWidth || y + height > m_nHeight)
+    {
+        return Frame();
+    }
+
+    Frame frame(*this);
+
+    frame.m_pData = m_pData + (size_t)y * m_nStride + (size_t)x * bytesPerPixel();
+    frame.m_nWidth = width;
+    frame.m_nHeight = height;
+    frame.m_bayerPattern = shiftBayerPattern(m_bayerPattern, x, y);
+    frame.startX = startX + x;
+    frame.startY = startY + y;
+
+    return frame;
+}
+
+unsigned char *Frame::data() const
+{
+    return m_pData;
+}
+
+unsigned char *Frame::row(int y) const
+{
+    return m_pData + (size_t)y * m_nStride;
+}
+
+int Frame::width() const
+{
+    return m_nWidth;
+}
+
+int Frame::height() const
+{
+    return m_nHeight;
+}
+
+size_t Frame::stride() const
+{
+    return m_nStride;
+}
+
+POAImgFormat Frame::imgFormat() const
+{
+    return m_imgFormat;
+}
+
+POABayerPattern Frame::bayerPattern() const
+{
+    return m_bayerPattern;
+}
+
+size_t Frame::bytesPerPixel() const
+{
+    return FramePool::bytesPerPixel(m_imgFormat);
+}
+
+size_t Frame::rowBytes() const
+{
+    return (size_t)m_nWidth * bytesPerPixel();
+}
+
+size_t Frame::sizeBytes() const
+{
+    return (size_t)m_nHeight * rowBytes();
+}
+
+bool Frame::isContiguous() const
+{
+    return m_nStride == rowBytes();
+}
+
+bool Frame::isShared() const
+{
+    return m_pBuffer && m_pBuffer->refCount.load(std::memory_order_acquire) > 1;
+}
+
+POABayerPattern Frame::shiftBayerPattern(POABayerPattern bayerPattern, int dx, int dy)
+{
+    if(bayerPattern == POA_BAYER_MONO)
+    {
+        return bayerPattern;
+    }
+
+    // RGGB <-> GRBG, BGGR <-> GBRG when the column is odd, RGGB <-> GBRG, BGGR <-> GRBG when the row is odd
+    static const POABayerPattern shiftX[4] = { POA_BAYER_GR, POA_BAYER_GB, POA_BAYER_RG, POA_BAYER_BG };
+    static const POABayerPattern shiftY[4] = { POA_BAYER_GB, POA_BAYER_GR, POA_BAYER_BG, POA_BAYER_RG };
+
+    if(dx & 1)
+    {
+        bayerPattern = shiftX[bayerPattern];
+    }
+
+    if(dy & 1)
+    {
+        bayerPattern = shiftY[bayerPattern];
+    }
+
+    return bayerPattern;
+}
+
+void Frame::release()
+{
+    if(m_pBuffer && m_pBuffer->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        m_pBuffer->pool->recycle(m_pBuffer);
+    }
+
+    m_pBuffer = nullptr;
+    m_pData = nullptr;
+}
@@ -0,0 +1,93 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <cstddef>
+
+#include "PlayerOneCamera.h"
+#include "FramePool.h"
+
+/*******************************************************************************
+A frame of image data with its description.
+Copying a Frame doesn't copy the pixels, the copies share the buffer(a slab of
+FramePool) by reference counting, the slab goes back to the pool when the last
+copy is destroyed. So the display, writer and analysis can hold the same frame.
+view() returns a sub-rectangle of the frame, it shares the buffer too, rows are
+addressed by stride, so a view is not contiguous in general.
+The Frame can also wrap the memory owned by others, then it's not reference counted.
+*******************************************************************************/
+
+class Frame
+{
+public:
+    Frame();
+
+    Frame(const Frame &other);
+
+    Frame(Frame &&other);
+
+    Frame &operator=(const Frame &other);
+
+    Frame &operator=(Frame &&other);
+
+    ~Frame();
+
+    // take the buffer which reference count is already 1(FramePool::acquireBuffer), the rows are contiguous
+    static Frame fromBuffer(FrameBuffer *pBuffer, int width, int height, POAImgFormat imgFormat, POABayerPattern bayerPattern);
+
+    // wrap the memory owned by the caller, it must be valid as long as the frame and its copies are used
+    static Frame wrap(unsigned char *pData, int width, int height, size_t stride, POAImgFormat imgFormat, POABayerPattern bayerPattern);
+
+    bool isValid() const;
+
+    void reset(); //release the buffer, the frame becomes invalid
+
+    // zero-copy sub-rectangle, the bayer pattern is shifted if x or y is odd, return an invalid frame if out of range
+    Frame view(int x, int y, int width, int height) const;
+
+    unsigned char *data() const;
+
+    unsigned char *row(int y) const;
+
+    int width() const;
+
+    int height() const;
+
+    size_t stride() const; //bytes from one row to the next
+
+    POAImgFormat imgFormat() const;
+
+    POABayerPattern bayerPattern() const;
+
+    size_t bytesPerPixel() const;
+
+    size_t rowBytes() const; //width * bytes per pixel
+
+    size_t sizeBytes() const; //the bytes of the pixels, height * rowBytes()
+
+    bool isContiguous() const; //stride == rowBytes()
+
+    bool isShared() const; //other copies share the buffer
+
+    // the description of the frame, filled by the capture thread
+    int bin;
+    int startX; //the ROI start position on the sensor(of current bin)
+    int startY;
+    long exposureUs;
+    long long timestampUs; //when the frame was captured, UTC, microseconds since 1970-01-01
+    unsigned long long seq; //sequence number of the frame since the capture started, 1 is the first
+
+    static POABayerPattern shiftBayerPattern(POABayerPattern bayerPattern, int dx, int dy);
+
+private:
+    void release();
+
+    FrameBuffer *m_pBuffer; //nullptr if the memory is not owned
+    unsigned char *m_pData;
+    int m_nWidth;
+    int m_nHeight;
+    size_t m_nStride;
+    POAImgFormat m_imgFormat;
+    POABayerPattern m_bayerPattern;
+};
+
+#endif // FRAME_H
@@ -0,0 +1,359 @@
+#include <iostream>
+#include <cstdlib>
+#include "FramePool.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+static const size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+FramePool::FramePool()
+    : m_nFrameBytes(0), m_freeHead(0), m_nFreeCount(0)
+{
+    m_pMemory = nullptr;
+    m_nMemoryBytes = 0;
+    m_bHugePages = false;
+    m_bMapped = false;
+    m_nSlabBytes = 0;
+    m_nSlabCount = 0;
+    m_nAllocations = 0;
+}
+
+FramePool::~FramePool()
+{
+    release();
+}
+
+size_t FramePool::bytesPerPixel(POAImgFormat imgFormat)
+{
+    switch (imgFormat)
+    {
+    case POA_RAW16:
+        return 2;
+    case POA_RGB24:
+        return 3;
+    case POA_RAW8:
+    case POA_MONO8:
+    default:
+        return 1;
+    }
+}
+
+bool FramePool::init(const POACameraProperties &cameraProp, int slabCount, bool useHugePages)
+{
+    // the widest format the camera supports, imgFormats ends with POA_END
+    size_t maxPixelBytes = 1;
+    for(int i = 0; i < 8 && cameraProp.imgFormats[i] != POA_END; i++)
+    {
+        size_t pixelBytes = bytesPerPixel(cameraProp.imgFormats[i]);
+        if(pixelBytes > maxPixelBytes)
+        {
+            maxPixelBytes = pixelBytes;
+        }
+    }
+
+    return init((size_t)cameraProp.maxWidth * cameraProp.maxHeight * maxPixelBytes, slabCount, useHugePages);
+}
+
+bool FramePool::init(size_t slabBytes, int slabCount, bool useHugePages)
+{
+    if(slabBytes == 0 || slabCount <= 0)
+    {
+        cerr << "init frame pool failed, invalid argument" << endl;
+        return false;
+    }
+
+    size_t alignment = useHugePages ? HUGE_PAGE_BYTES : SLAB_ALIGNMENT;
+    size_t alignedSlabBytes = alignUp(slabBytes, alignment);
+
+    // already big enough, keep the slabs
+    if(isInitialized() && m_nSlabBytes >= alignedSlabBytes && m_nSlabCount >= slabCount && m_bHugePages == useHugePages)
+    {
+        return true;
+    }
+
+    if(freeCount() != m_nSlabCount)
+    {
+        cerr << "init frame pool failed, the slabs are in use" << endl;
+        return false;
+    }
+
+    release();
+
+    if(!allocate(alignedSlabBytes * slabCount, useHugePages))
+    {
+        cerr << "init frame pool failed, can not allocate " << alignedSlabBytes * slabCount << " bytes" << endl;
+        return false;
+    }
+
+    m_nSlabBytes = alignedSlabBytes;
+    m_nFrameBytes = slabBytes;
+    m_nSlabCount = slabCount;
+
+    std::vector<FrameBuffer>(slabCount).swap(m_buffers);
+    m_freeHead = 0;
+    m_nFreeCount = 0;
+    for(int i = slabCount - 1; i >= 0; i--)
+    {
+        m_buffers[i].pool = this;
+        m_buffers[i].data = m_pMemory + (size_t)i * alignedSlabBytes;
+        pushFree(i);
+    }
+
+    return true;
+}
+
+void FramePool::release()
+{
+    if(m_pMemory && m_nFreeCount != m_nSlabCount)
+    {
+        cerr << "frame pool released with " << m_nSlabCount - m_nFreeCount << " slabs in use" << endl;
+    }
+
+    deallocate();
+
+    std::vector<FrameBuffer>().swap(m_buffers);
+    m_freeHead = 0;
+    m_nFreeCount = 0;
+    m_nSlabBytes = 0;
+    m_nFrameBytes = 0;
+    m_nSlabCount = 0;
+}
+
+bool FramePool::isInitialized() const
+{
+    return m_pMemory != nullptr;
+}
+
+unsigned char *FramePool::acquire()
+{
+    int index = popFree();
+
+    return index >= 0 ? m_buffers[index].data : nullptr;
+}
+
+void FramePool::recycle(unsigned char *pSlab)
+{
+    if(!pSlab || !m_pMemory)
+    {
+        return;
+    }
+
+    pushFree((int)((size_t)(pSlab - m_pMemory) / m_nSlabBytes));
+}
+
+FrameBuffer *FramePool::acquireBuffer()
+{
+    int index = popFree();
+    if(index < 0)
+    {
+        return nullptr;
+    }
+
+    m_buffers[index].refCount.store(1, std::memory_order_relaxed);
+
+    return &m_buffers[index];
+}
+
+void FramePool::recycle(FrameBuffer *pBuffer)
+{
+    if(!pBuffer)
+    {
+        return;
+    }
+
+    pushFree((int)(pBuffer - m_buffers.data()));
+}
+
+int FramePool::popFree()
+{
+    uint64_t head = m_freeHead.load(std::memory_order_acquire);
+
+    for(;;)
+    {
+        uint32_t indexPlusOne = (uint32_t)(head & 0xFFFFFFFFu);
+        if(indexPlusOne == 0)
+        {
+            return -1;
+        }
+
+        uint32_t next = m_buffers[indexPlusOne - 1].next.load(std::memory_order_relaxed);
+        uint64_t newHead = (((head >> 32) + 1) << 32) | next;
+
+        if(m_freeHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            m_nFreeCount--;
+            return (int)indexPlusOne - 1;
+        }
+    }
+}
+
+void FramePool::pushFree(int index)
+{
+    uint64_t head = m_freeHead.load(std::memory_order_relaxed);
+    uint64_t newHead;
+
+    do
+    {
+        m_buffers[index].next.store((uint32_t)(head & 0xFFFFFFFFu), std::memory_order_relaxed);
+        newHead = (((head >> 32) + 1) << 32) | (uint32_t)(index + 1);
+    } while(!m_freeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+
+    m_nFreeCount++;
+}
+
+bool FramePool::setFrameBytes(size_t frameBytes)
+{
+    if(frameBytes > m_nSlabBytes)
+    {
+        return false;
+    }
+
+    m_nFrameBytes = frameBytes;
+
+    return true;
+}
+
+size_t FramePool::frameBytes() const
+{
+    return m_nFrameBytes;
+}
+
+size_t FramePool::slabBytes() const
+{
+    return m_nSlabBytes;
+}
+
+int FramePool::slabCount() const
+{
+    return m_nSlabCount;
+}
+
+int FramePool::freeCount() const
+{
+    return m_nFreeCount;
+}
+
+bool FramePool::isHugePages() const
+{
+    return m_bHugePages;
+}
+
+unsigned long long FramePool::allocationCount() const
+{
+    return m_nAllocations;
+}
+
+bool FramePool::allocate(size_t totalBytes, bool useHugePages)
+{
+    m_bHugePages = false;
+    m_bMapped = false;
+
+#if defined(_WIN32)
+    if(useHugePages)
+    {
+        // needs the "Lock pages in memory" privilege, if not granted, fall back to the normal pages
+        SIZE_T largePageBytes = GetLargePageMinimum();
+        if(largePageBytes > 0)
+        {
+            SIZE_T bytes = alignUp(totalBytes, largePageBytes);
+            m_pMemory = (unsigned char *)VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if(m_pMemory)
+            {
+                m_nMemoryBytes = bytes;
+                m_bHugePages = true;
+                m_bMapped = true;
+            }
+        }
+    }
+
+    if(!m_pMemory)
+    {
+        m_pMemory = (unsigned char *)_aligned_malloc(totalBytes, useHugePages ? HUGE_PAGE_BYTES : SLAB_ALIGNMENT);
+        m_nMemoryBytes = totalBytes;
+    }
+#else
+#if defined(MAP_HUGETLB)
+    if(useHugePages)
+    {
+        // needs reserved huge pages(vm.nr_hugepages), if not, fall back to the transparent huge pages
+        size_t bytes = alignUp(totalBytes, HUGE_PAGE_BYTES);
+        void *pMapped = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(pMapped != MAP_FAILED)
+        {
+            m_pMemory = (unsigned char *)pMapped;
+            m_nMemoryBytes = bytes;
+            m_bHugePages = true;
+            m_bMapped = true;
+        }
+    }
+#endif
+
+    if(!m_pMemory)
+    {
+        void *pMemory = nullptr;
+        if(posix_memalign(&pMemory, useHugePages ? HUGE_PAGE_BYTES : SLAB_ALIGNMENT, totalBytes) == 0)
+        {
+            m_pMemory = (unsigned char *)pMemory;
+            m_nMemoryBytes = totalBytes;
+#if defined(MADV_HUGEPAGE)
+            if(useHugePages)
+            {
+                m_bHugePages = madvise(pMemory, totalBytes, MADV_HUGEPAGE) == 0;
+            }
+#endif
+        }
+    }
+#endif
+
+    if(m_pMemory)
+    {
+        m_nAllocations++;
+    }
+
+    return m_pMemory != nullptr;
+}
+
+void FramePool::deallocate()
+{
+    if(!m_pMemory)
+    {
+        return;
+    }
+
+#if defined(_WIN32)
+    if(m_bMapped)
+    {
+        VirtualFree(m_pMemory, 0, MEM_RELEASE);
+    }
+    else
+    {
+        _aligned_free(m_pMemory);
+    }
+#else
+    if(m_bMapped)
+    {
+        munmap(m_pMemory, m_nMemoryBytes);
+    }
+    else
+    {
+        free(m_pMemory);
+    }
+#endif
+
+    m_pMemory = nullptr;
+    m_nMemoryBytes = 0;
+    m_bHugePages = false;
+    m_bMapped = false;
+}
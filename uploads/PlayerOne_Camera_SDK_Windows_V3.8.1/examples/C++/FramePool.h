@@ -0,0 +1,102 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+
+/*******************************************************************************
+A pool of frame buffers(slabs), all the slabs are allocated once in init() and
+each one is big enough for the largest frame of the camera:
+maxWidth * maxHeight * bytes per pixel of the widest POAImgFormat it supports.
+So changing the image format, ROI or bin only changes frameBytes(), the slabs
+are reused, acquire() and recycle() never allocate memory and never lock.
+The slabs are aligned to 64 bytes(cache line), or to 2MB if huge pages are used.
+*******************************************************************************/
+
+class FramePool;
+
+struct FrameBuffer //the reference counted owner of one slab, see Frame
+{
+    std::atomic<int> refCount;
+    std::atomic<uint32_t> next; //free list link, index + 1, 0 is the end
+    FramePool *pool;
+    unsigned char *data;
+
+    FrameBuffer() : refCount(0), next(0), pool(nullptr), data(nullptr) {}
+};
+
+class FramePool
+{
+public:
+    FramePool();
+
+    ~FramePool();
+
+    bool init(const POACameraProperties &cameraProp, int slabCount, bool useHugePages = false);
+
+    bool init(size_t slabBytes, int slabCount, bool useHugePages = false);
+
+    void release(); //free all the slabs, all the acquired slabs must be recycled first, init and release are not thread safe
+
+    bool isInitialized() const;
+
+    unsigned char *acquire(); //get a free slab, return nullptr if all the slabs are in use
+
+    void recycle(unsigned char *pSlab); //give back a slab got from acquire()
+
+    FrameBuffer *acquireBuffer(); //get a free slab with its reference count set to 1, return nullptr if all are in use
+
+    void recycle(FrameBuffer *pBuffer); //called when the reference count of the buffer drops to 0
+
+    bool setFrameBytes(size_t frameBytes); //the size of the current frame, return false if it's larger than a slab
+
+    size_t frameBytes() const;
+
+    size_t slabBytes() const;
+
+    int slabCount() const;
+
+    int freeCount() const;
+
+    bool isHugePages() const;
+
+    unsigned long long allocationCount() const; //how many times the pool allocated memory since constructed
+
+    static size_t bytesPerPixel(POAImgFormat imgFormat);
+
+    static const size_t SLAB_ALIGNMENT = 64;
+
+private:
+    FramePool(const FramePool &);
+    FramePool &operator=(const FramePool &);
+
+    bool allocate(size_t totalBytes, bool useHugePages);
+
+    void deallocate();
+
+    int popFree(); //return the slab index, -1 if empty
+
+    void pushFree(int index);
+
+    unsigned char *m_pMemory;
+    size_t m_nMemoryBytes;
+    bool m_bHugePages;
+    bool m_bMapped; //the memory is from mmap/VirtualAlloc, not from the aligned malloc
+
+    size_t m_nSlabBytes;
+    std::atomic<size_t> m_nFrameBytes;
+    int m_nSlabCount;
+
+    // lock-free free list(Treiber stack), the high 32 bits of the head is a tag against the ABA problem
+    std::vector<FrameBuffer> m_buffers;
+    std::atomic<uint64_t> m_freeHead;
+    std::atomic<int> m_nFreeCount;
+
+    unsigned long long m_nAllocations;
+};
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "FrameQuality.h"
+#include "FrameQualityKernels.h"
+
+using namespace std;
+
+static const FrameQualityKernelTable *kernels(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SSE41:
+        return frameQualityKernelsSSE41();
+    case SIMD_AVX2:
+        return frameQualityKernelsAVX2();
+    case SIMD_AVX512:
+        return frameQualityKernelsAVX512();
+    default:
+        return nullptr;
+    }
+}
+
+// every step-th pixel of every step-th row
+template<typename T>
+static void samplePixels(const Frame &frame, int step, vector<int> &samples)
+{
+    samples.clear();
+    for(int y = 0; y < frame.height(); y += step)
+    {
+        const T *pRow = (const T *)frame.row(y);
+        for(int x = 0; x < frame.width(); x += step)
+        {
+            samples.push_back(pRow[x]);
+        }
+    }
+}
+
+FrameQuality::FrameQuality()
+    : m_metric(QUALITY_LAPLACIAN), m_bDiscTracking(false), m_discMargin(1.25)
+{
+}
+
+void FrameQuality::setMetric(QualityMetric metric)
+{
+    m_metric = metric;
+}
+
+QualityMetric FrameQuality::getMetric() const
+{
+    return m_metric;
+}
+
+void FrameQuality::setDiscTracking(bool isEnabled, double margin)
+{
+    m_bDiscTracking = isEnabled;
+    m_discMargin = margin;
+    m_disc = QualityDisc();
+}
+
+bool FrameQuality::isDiscTracking() const
+{
+    return m_bDiscTracking;
+}
+
+const QualityDisc &FrameQuality::getDisc() const
+{
+    return m_disc;
+}
+
+double FrameQuality::score(const Frame &frame)
+{
+    static const FrameQualityKernelTable *pBestTable = kernels(bestLevel()); //picked once
+
+    return scoreWith(pBestTable, frame);
+}
+
+double FrameQuality::score(const Frame &frame, SimdLevel level)
+{
+    if(!isAvailable(level))
+    {
+        return -1.0;
+    }
+
+    return scoreWith(kernels(level), frame);
+}
+
+void FrameQuality::trackDisc(const Frame &frame)
+{
+    const int sampleStep = 4;
+    const int columns = (frame.width() + sampleStep - 1) / sampleStep;
+    frame.imgFormat() == POA_RAW16 ? samplePixels<uint16_t>(frame, sampleStep, m_samples) : samplePixels<unsigned char>(frame, sampleStep, m_samples);
+
+    double sum = 0.0;
+    for(size_t i = 0; i < m_samples.size(); i++)
+    {
+        sum += m_samples[i];
+    }
+
+    // the threshold is the middle of the mean and the bright part of the disc(not the max: a hot pixel)
+    m_sorted.assign(m_samples.begin(), m_samples.end());
+    size_t brightIndex = m_sorted.size() - 1 - m_sorted.size() / 200;
+    std::nth_element(m_sorted.begin(), m_sorted.begin() + brightIndex, m_sorted.end());
+    double threshold = (sum / m_samples.size() + m_sorted[brightIndex]) / 2.0;
+
+    long long sumX = 0, sumY = 0;
+    int count = 0;
+    for(size_t i = 0; i < m_samples.size(); i++)
+    {
+        if(m_samples[i] > threshold)
+        {
+            sumX += (long long)(i % columns) * sampleStep;
+            sumY += (long long)(i / columns) * sampleStep;
+            count++;
+        }
+    }
+
+    m_disc.isFound = count >= 4;
+    if(m_disc.isFound)
+    {
+        m_disc.centerX = (int)(sumX / count);
+        m_disc.centerY = (int)(sumY / count);
+        m_disc.radius = (int)std::ceil(std::sqrt(count * sampleStep * sampleStep / 3.14159265358979323846));
+    }
+}
+
+double FrameQuality::scoreWith(const FrameQualityKernelTable *pTable, const Frame &frame)
+{
+    POAImgFormat imgFormat = frame.imgFormat();
+    if(!frame.isValid() || (imgFormat != POA_RAW8 && imgFormat != POA_RAW16 && imgFormat != POA_MONO8))
+    {
+        cerr << "score frame failed, the format must be RAW8, RAW16 or MONO8" << endl;
+        return -1.0;
+    }
+
+    const int step = frame.bayerPattern() != POA_BAYER_MONO ? 2 : 1; //the same color
+    int xBegin = step;
+    int xEnd = frame.width() - step;
+    int yBegin = step;
+    int yEnd = frame.height() - step;
+
+    if(m_bDiscTracking)
+    {
+        trackDisc(frame);
+        if(m_disc.isFound)
+        {
+            int halfSize = (int)(m_disc.radius * m_discMargin) + step;
+            xBegin = std::max(xBegin, m_disc.centerX - halfSize);
+            xEnd = std::min(xEnd, m_disc.centerX + halfSize);
+            yBegin = std::max(yBegin, m_disc.centerY - halfSize);
+            yEnd = std::min(yEnd, m_disc.centerY + halfSize);
+        }
+    }
+
+    if(xEnd <= xBegin || yEnd <= yBegin)
+    {
+        return 0.0;
+    }
+
+    const bool is16Bit = imgFormat == POA_RAW16;
+    double sums[4] = { 0.0, 0.0, 0.0, 0.0 };
+    for(int y = yBegin; y < yEnd; y++)
+    {
+        QualityRowArgs args;
+        args.up = frame.row(y - step);
+        args.row = frame.row(y);
+        args.down = frame.row(y + step);
+        args.step = step;
+        args.xBegin = xBegin;
+        args.xEnd = xEnd;
+
+        float rowSums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        int x = pTable ? pTable->row[is16Bit ? 1 : 0](args, rowSums) : xBegin;
+        is16Bit ? qualityRowScalar<uint16_t>(args, x, rowSums) : qualityRowScalar<unsigned char>(args, x, rowSums);
+
+        for(int i = 0; i < 4; i++)
+        {
+            sums[i] += rowSums[i];
+        }
+    }
+
+    double count = (double)(xEnd - xBegin) * (yEnd - yBegin);
+    switch (m_metric)
+    {
+    case QUALITY_GRADIENT:
+        return sums[2] / count;
+    case QUALITY_LOCAL_CONTRAST:
+    {
+        double mean = sums[3] / count;
+        return sums[2] / count / std::max(mean * mean, 1.0);
+    }
+    default:
+    {
+        double mean = sums[0] / count;
+        return sums[1] / count - mean * mean;
+    }
+    }
+}
+
+SimdLevel FrameQuality::bestLevel()
+{
+    for(int level = CpuFeatures::bestLevel(); level > SIMD_SCALAR; level--)
+    {
+        if(isAvailable((SimdLevel)level))
+        {
+            return (SimdLevel)level;
+        }
+    }
+
+    return SIMD_SCALAR;
+}
+
+bool FrameQuality::isAvailable(SimdLevel level)
+{
+    if(level == SIMD_SCALAR)
+    {
+        return true;
+    }
+
+    return CpuFeatures::isSupported(level) && kernels(level) != nullptr;
+}
@@ -0,0 +1,91 @@
+#ifndef FRAMEQUALITY_H
+#define FRAMEQUALITY_H
+
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "CpuFeatures.h"
+#include "Frame.h"
+
+struct FrameQualityKernelTable;
+
+/*******************************************************************************
+Scores the sharpness of the frames of a planetary or lunar stream, a higher score
+is a sharper frame(lucky imaging, see LuckySelector).
+QUALITY_LAPLACIAN: the variance of the laplacian(4 * c - the 4 neighbours).
+QUALITY_GRADIENT: the mean of the gradient energy((right - c)^2 + (down - c)^2).
+QUALITY_LOCAL_CONTRAST: the gradient energy / the square of the mean intensity, so
+a thin cloud or the altitude of the target doesn't change the score.
+The neighbours of a bayer frame(RAW8 / RAW16) are 2 pixels away, the same color, so
+the bayer pattern itself is not scored.
+With the disc tracking, only a box around the disc of the planet is scored: the disc
+is found on every 4th pixel of every 4th row(the pixels brighter than the middle of
+the mean and the 99.5th percentile, their centroid and area), so the box follows the
+disc from frame to frame, the black sky around it adds only noise to the score.
+The rows are scored by the SIMD kernel of the best level of the CPU(see
+FrameQualityKernels.h), a 640x480 RAW8 frame takes well under 1 ms.
+*******************************************************************************/
+
+enum QualityMetric
+{
+    QUALITY_LAPLACIAN = 0,
+    QUALITY_GRADIENT,
+    QUALITY_LOCAL_CONTRAST
+};
+
+struct QualityDisc //the disc found by the tracking
+{
+    bool isFound;
+    int centerX;
+    int centerY;
+    int radius;
+
+    QualityDisc()
+    {
+        isFound = false;
+        centerX = 0;
+        centerY = 0;
+        radius = 0;
+    }
+};
+
+class FrameQuality
+{
+public:
+    FrameQuality();
+
+    void setMetric(QualityMetric metric); //default is QUALITY_LAPLACIAN
+
+    QualityMetric getMetric() const;
+
+    // score only the box around the disc, its half size is margin * the radius of the disc, default is off
+    void setDiscTracking(bool isEnabled, double margin = 1.25);
+
+    bool isDiscTracking() const;
+
+    // RAW8, RAW16 or MONO8, return -1 if the format is not supported
+    double score(const Frame &frame);
+
+    // the same with the kernel of the level, return -1 if it's not available
+    double score(const Frame &frame, SimdLevel level);
+
+    const QualityDisc &getDisc() const; //the disc of the last frame
+
+    static SimdLevel bestLevel(); //the level used by score
+
+    static bool isAvailable(SimdLevel level); //supported by the CPU and the kernels are built in
+
+private:
+    double scoreWith(const FrameQualityKernelTable *pTable, const Frame &frame);
+
+    void trackDisc(const Frame &frame);
+
+    QualityMetric m_metric;
+    bool m_bDiscTracking;
+    double m_discMargin;
+    QualityDisc m_disc;
+    std::vector<int> m_samples; //the pixels of the disc tracking, reused from frame to frame
+    std::vector<int> m_sorted;
+};
+
+#endif // FRAMEQUALITY_H
@@ -0,0 +1,121 @@
+#ifndef FRAMEQUALITYKERNELS_H
+#define FRAMEQUALITYKERNELS_H
+
+#include <cstdint>
+
+/*******************************************************************************
+The row kernels of FrameQuality, one table per SIMD level.
+A kernel adds the sums of the pixels of one row to pSums while a whole vector fits
+and returns where it stopped, qualityRowScalar() does the rest of the row:
+[0] the laplacian: 4 * c - left - right - up - down
+[1] the square of the laplacian
+[2] the gradient energy: (right - c)^2 + (down - c)^2
+[3] the intensity: c
+The neighbours are step pixels away(2: the same color of a bayer frame). The sums of
+a row are kept in float lanes and added to pSums once, the levels add them in another
+order, so the sums differ a little(about 1e-6 relative), the scores are compared, not
+the bits.
+*******************************************************************************/
+
+struct QualityRowArgs
+{
+    const void *up;     //the row y - step, unsigned char or uint16_t
+    const void *row;    //the row y
+    const void *down;   //the row y + step
+    int step;
+    int xBegin;         //step at least
+    int xEnd;           //width - step at most
+};
+
+typedef int (*QualityRowFunc)(const QualityRowArgs &args, float *pSums);
+
+struct FrameQualityKernelTable //[0]: 8 bit, [1]: 16 bit
+{
+    QualityRowFunc row[2];
+};
+
+// nullptr if the file was built without the flags of the level
+const FrameQualityKernelTable *frameQualityKernelsSSE41();
+
+const FrameQualityKernelTable *frameQualityKernelsAVX2();
+
+const FrameQualityKernelTable *frameQualityKernelsAVX512();
+
+template <typename T>
+static inline void qualityRowScalar(const QualityRowArgs &args, int xBegin, float *pSums)
+{
+    const T *pUp = (const T *)args.up;
+    const T *pRow = (const T *)args.row;
+    const T *pDown = (const T *)args.down;
+    const int step = args.step;
+
+    for(int x = xBegin; x < args.xEnd; x++)
+    {
+        float center = (float)pRow[x];
+        float right = (float)pRow[x + step];
+        float down = (float)pDown[x];
+        float laplacian = center * 4.0f - (float)pRow[x - step] - right - (float)pUp[x] - down;
+        float gradientX = right - center;
+        float gradientY = down - center;
+        pSums[0] += laplacian;
+        pSums[1] += laplacian * laplacian;
+        pSums[2] += gradientX * gradientX + gradientY * gradientY;
+        pSums[3] += center;
+    }
+}
+
+#ifdef POA_SIMD_NAMESPACE // included by FrameQuality_<level>.cpp after SimdOps.h
+
+namespace POA_SIMD_NAMESPACE
+{
+
+template <class Ops, typename T>
+static int qualityRow(const QualityRowArgs &args, float *pSums)
+{
+    typedef typename Ops::V V;
+
+    const T *pUp = (const T *)args.up;
+    const T *pRow = (const T *)args.row;
+    const T *pDown = (const T *)args.down;
+    const int step = args.step;
+    const V four = Ops::set1(4.0f);
+
+    V laplacianSum = Ops::set1(0.0f);
+    V laplacianSquares = Ops::set1(0.0f);
+    V gradientSum = Ops::set1(0.0f);
+    V intensitySum = Ops::set1(0.0f);
+
+    int x = args.xBegin;
+    for(; x + Ops::LANES <= args.xEnd; x += Ops::LANES)
+    {
+        V center = Ops::load(pRow + x);
+        V right = Ops::load(pRow + x + step);
+        V down = Ops::load(pDown + x);
+        V laplacian = Ops::sub(Ops::sub(Ops::sub(Ops::sub(Ops::mul(center, four), Ops::load(pRow + x - step)), right), Ops::load(pUp + x)), down);
+        V gradientX = Ops::sub(right, center);
+        V gradientY = Ops::sub(down, center);
+
+        laplacianSum = Ops::add(laplacianSum, laplacian);
+        laplacianSquares = Ops::add(laplacianSquares, Ops::mul(laplacian, laplacian));
+        gradientSum = Ops::add(gradientSum, Ops::add(Ops::mul(gradientX, gradientX), Ops::mul(gradientY, gradientY)));
+        intensitySum = Ops::add(intensitySum, center);
+    }
+
+    pSums[0] += Ops::sum(laplacianSum);
+    pSums[1] += Ops::sum(laplacianSquares);
+    pSums[2] += Ops::sum(gradientSum);
+    pSums[3] += Ops::sum(intensitySum);
+
+    return x;
+}
+
+static const FrameQualityKernelTable KERNEL_TABLE =
+{
+    { qualityRow<VecF32, unsigned char>, qualityRow<VecF32, uint16_t> }
+};
+
+} // namespace POA_SIMD_NAMESPACE
+
+#endif // POA_SIMD_NAMESPACE
+
+#endif // FRAMEQUALITYKERNELS_H
@@ -0,0 +1,142 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*******************************************************************************
+A bounded single-producer / multi-consumer lock-free ring.
+The slots are allocated once in the constructor and reused forever, the producer
+fills a slot in place (eg: POAGetImageData writes straight into it) and the
+consumers claim slots with one CAS, no lock is taken on either side.
+Based on the per-slot sequence scheme of D. Vyukov's bounded MPMC queue.
+*******************************************************************************/
+
+template <typename T>
+class FrameRing
+{
+public:
+    explicit FrameRing(size_t capacity)
+    {
+        size_t size = roundCapacity(capacity);
+
+        m_nMask = size - 1;
+        std::vector<Slot>(size).swap(m_slots);
+        for(size_t i = 0; i < size; ++i)
+        {
+            m_slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        m_enqueuePos.store(0, std::memory_order_relaxed);
+        m_dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    // the capacity of a ring made for capacity, the power of 2 at or above it(at least 2)
+    static size_t roundCapacity(size_t capacity)
+    {
+        size_t size = 2;
+        while(size < capacity)
+        {
+            size <<= 1;
+        }
+
+        return size;
+    }
+
+    size_t capacity() const
+    {
+        return m_nMask + 1;
+    }
+
+    // Producer only: get the next free slot, return nullptr if the ring is full
+    T *beginPush()
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Slot &slot = m_slots[pos & m_nMask];
+
+        if(slot.seq.load(std::memory_order_acquire) != pos)
+        {
+            return nullptr; // the consumer has not released this slot yet
+        }
+
+        return &slot.value;
+    }
+
+    // Producer only: publish the slot returned by beginPush()
+    void commitPush()
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        m_slots[pos & m_nMask].seq.store(pos + 1, std::memory_order_release);
+        m_enqueuePos.store(pos + 1, std::memory_order_release);
+    }
+
+    // Any consumer: claim the oldest slot, call func(T&) on it and release it, return false if the ring is empty
+    template <typename F>
+    bool tryConsume(F func)
+    {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Slot *pSlot = nullptr;
+
+        for(;;)
+        {
+            pSlot = &m_slots[pos & m_nMask];
+            size_t seq = pSlot->seq.load(std::memory_order_acquire);
+            std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+
+            if(dif == 0)
+            {
+                if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if(dif < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = m_dequeuePos.load(std::memory_order_relaxed); // another consumer took it
+            }
+        }
+
+        func(pSlot->value);
+
+        pSlot->seq.store(pos + m_nMask + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Approximate count of the published but not consumed slots
+    size_t size() const
+    {
+        size_t enq = m_enqueuePos.load(std::memory_order_acquire);
+        size_t deq = m_dequeuePos.load(std::memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        T value;
+
+        Slot() : seq(0), value() {}
+    };
+
+    FrameRing(const FrameRing &);
+    FrameRing &operator=(const FrameRing &);
+
+    std::vector<Slot> m_slots;
+    size_t m_nMask;
+
+    // keep the producer index and the consumer index on different cache lines
+    char m_padBegin[64];
+    std::atomic<size_t> m_enqueuePos;
+    char m_padMiddle[64];
+    std::atomic<size_t> m_dequeuePos;
+    char m_padEnd[64];
+};
+
+#endif // FRAMERING_H
@@ -0,0 +1,552 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "LiveStacker.h"
+
+using namespace std;
+
+static const float TRIANGLE_EPSILON = 0.004f;   //the largest difference of the side ratios of 2 matching triangles
+static const float MIN_TRIANGLE_SIDE = 20.0f;   //pixels, the smaller triangles are too sensitive to the centroid errors
+static const double PAIR_RADIUS = 3.0;          //pixels, a star paired by the first transform
+static const double MIN_OUTLIER = 1.0;          //pixels, a residual below is never an outlier
+
+static double elapsedUs(chrono::steady_clock::time_point beginTime)
+{
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - beginTime).count();
+}
+
+double StackTransform::rotationDegrees() const
+{
+    return std::atan2(c, a) * 180.0 / 3.14159265358979323846;
+}
+
+double StackTransform::scale() const
+{
+    return std::sqrt(std::fabs(a * d - b * c));
+}
+
+LiveStacker::LiveStacker(int threadCount)
+    : m_parallel(threadCount), m_extractor(threadCount), m_model(STACK_SIMILARITY), m_detectSigma(5.0), m_nMaxStars(50), m_maxError(1.5)
+{
+    reset();
+}
+
+void LiveStacker::setModel(StackTransformModel model)
+{
+    m_model = model;
+}
+
+StackTransformModel LiveStacker::getModel() const
+{
+    return m_model;
+}
+
+void LiveStacker::setDetectSigma(double detectSigma)
+{
+    m_detectSigma = detectSigma;
+}
+
+void LiveStacker::setMaxStars(int maxStars)
+{
+    m_nMaxStars = std::max(maxStars, (int)TRIANGLE_STARS);
+}
+
+void LiveStacker::setMaxError(double maxError)
+{
+    m_maxError = maxError;
+}
+
+void LiveStacker::reset()
+{
+    m_nWidth = 0;
+    m_nHeight = 0;
+    m_nChannels = 1;
+    m_imgFormat = POA_END;
+    m_bayerPattern = POA_BAYER_MONO;
+    m_refStars.clear();
+    m_refTriangles.clear();
+    m_sum.clear();
+    m_count.clear();
+    m_nStackedCount = 0;
+    m_nRejectedCount = 0;
+    m_lastStats = StackFrameStats();
+}
+
+bool LiveStacker::addFrame(const Frame &frame)
+{
+    chrono::steady_clock::time_point beginTime = chrono::steady_clock::now();
+    StackFrameStats stats;
+    stats.seq = frame.seq;
+
+    POAImgFormat imgFormat = frame.imgFormat();
+    if(!frame.isValid() || (imgFormat != POA_RAW8 && imgFormat != POA_RAW16 && imgFormat != POA_MONO8) || frame.width() < 16 || frame.height() < 16)
+    {
+        cerr << "add frame failed, the frame is not RAW8, RAW16 or MONO8" << endl;
+        m_nRejectedCount++;
+        m_lastStats = stats;
+        return false;
+    }
+
+    bool isReference = m_refStars.empty();
+    if(!isReference && (frame.width() != m_nWidth || frame.height() != m_nHeight || imgFormat != m_imgFormat || frame.bayerPattern() != m_bayerPattern))
+    {
+        cerr << "add frame failed, the size or the format differs from the reference, reset() the stack first" << endl;
+        m_nRejectedCount++;
+        m_lastStats = stats;
+        return false;
+    }
+
+    if(m_nStackedCount >= 65535) //the count of a pixel is 16 bits
+    {
+        m_nRejectedCount++;
+        m_lastStats = stats;
+        return false;
+    }
+
+    if(isReference)
+    {
+        m_nWidth = frame.width();
+        m_nHeight = frame.height();
+        m_imgFormat = imgFormat;
+        m_bayerPattern = frame.bayerPattern();
+        m_nChannels = (imgFormat != POA_MONO8 && m_bayerPattern != POA_BAYER_MONO) ? 3 : 1;
+    }
+
+    chrono::steady_clock::time_point stepTime = chrono::steady_clock::now();
+    vector<StackStar> stars;
+    detectStars(frame, stars);
+    stats.starCount = (int)stars.size();
+    stats.detectUs = elapsedUs(stepTime);
+
+    stepTime = chrono::steady_clock::now();
+    bool isRegistered = false;
+    if(isReference)
+    {
+        if(stars.size() >= (size_t)MIN_STARS)
+        {
+            m_refStars = stars;
+            buildTriangles(m_refStars, m_refTriangles);
+            m_sum.assign((size_t)m_nWidth * m_nHeight * m_nChannels, 0.0f);
+            m_count.assign((size_t)m_nWidth * m_nHeight, 0);
+            stats.isReference = true;
+            stats.matchCount = stats.starCount;
+            isRegistered = true;
+        }
+    }
+    else
+    {
+        isRegistered = registerStars(stars, stats);
+    }
+    stats.registerUs = elapsedUs(stepTime);
+
+    if(!isRegistered)
+    {
+        m_nRejectedCount++;
+        stats.totalUs = elapsedUs(beginTime);
+        m_lastStats = stats;
+        return false;
+    }
+
+    stepTime = chrono::steady_clock::now();
+    accumulate(frame, stats.transform);
+    stats.warpUs = elapsedUs(stepTime);
+
+    m_nStackedCount++;
+    stats.isStacked = true;
+    stats.totalUs = elapsedUs(beginTime);
+    m_lastStats = stats;
+
+    return true;
+}
+
+const StackFrameStats &LiveStacker::getLastStats() const
+{
+    return m_lastStats;
+}
+
+int LiveStacker::getStackedCount() const
+{
+    return m_nStackedCount;
+}
+
+int LiveStacker::getRejectedCount() const
+{
+    return m_nRejectedCount;
+}
+
+int LiveStacker::width() const
+{
+    return m_nWidth;
+}
+
+int LiveStacker::height() const
+{
+    return m_nHeight;
+}
+
+int LiveStacker::channels() const
+{
+    return m_nChannels;
+}
+
+bool LiveStacker::getStack(vector<float> &image) const
+{
+    if(m_nStackedCount == 0)
+    {
+        return false;
+    }
+
+    size_t pixelCount = (size_t)m_nWidth * m_nHeight;
+    image.resize(pixelCount * m_nChannels);
+    for(size_t i = 0; i < pixelCount; i++)
+    {
+        float scale = m_count[i] > 0 ? 1.0f / m_count[i] : 0.0f;
+        for(int c = 0; c < m_nChannels; c++)
+        {
+            image[i * m_nChannels + c] = m_sum[i * m_nChannels + c] * scale;
+        }
+    }
+
+    return true;
+}
+
+const vector<StackStar> &LiveStacker::getReferenceStars() const
+{
+    return m_refStars;
+}
+
+void LiveStacker::detectStars(const Frame &frame, vector<StackStar> &stars)
+{
+    m_extractor.setDetectSigma(m_detectSigma);
+    m_extractor.setMaxStars(m_nMaxStars);
+    m_extractor.extract(frame, m_extracted); //the brightest first
+
+    stars.resize(m_extracted.size());
+    for(size_t i = 0; i < m_extracted.size(); i++)
+    {
+        stars[i].x = m_extracted[i].x;
+        stars[i].y = m_extracted[i].y;
+        stars[i].flux = m_extracted[i].flux;
+    }
+}
+
+void LiveStacker::buildTriangles(const vector<StackStar> &stars, vector<Triangle> &triangles)
+{
+    int count = std::min((int)stars.size(), (int)TRIANGLE_STARS);
+    triangles.clear();
+
+    for(int i = 0; i < count; i++)
+    {
+        for(int j = i + 1; j < count; j++)
+        {
+            for(int k = j + 1; k < count; k++)
+            {
+                int vertex[3] = { i, j, k };
+                float side[3] = //the side opposite to the vertex
+                {
+                    std::hypot(stars[j].x - stars[k].x, stars[j].y - stars[k].y),
+                    std::hypot(stars[i].x - stars[k].x, stars[i].y - stars[k].y),
+                    std::hypot(stars[i].x - stars[j].x, stars[i].y - stars[j].y)
+                };
+
+                // the vertices by their opposite side, the longest first
+                for(int m = 1; m < 3; m++)
+                {
+                    for(int n = m; n > 0 && side[n] > side[n - 1]; n--)
+                    {
+                        std::swap(side[n], side[n - 1]);
+                        std::swap(vertex[n], vertex[n - 1]);
+                    }
+                }
+
+                if(side[2] < MIN_TRIANGLE_SIDE)
+                {
+                    continue;
+                }
+
+                Triangle triangle;
+                triangle.ratio1 = side[1] / side[0];
+                triangle.ratio2 = side[2] / side[0];
+                triangle.star[0] = vertex[0];
+                triangle.star[1] = vertex[1];
+                triangle.star[2] = vertex[2];
+                triangles.push_back(triangle);
+            }
+        }
+    }
+
+    std::sort(triangles.begin(), triangles.end(), [](const Triangle &left, const Triangle &right) { return left.ratio1 < right.ratio1; });
+}
+
+bool LiveStacker::registerStars(const vector<StackStar> &stars, StackFrameStats &stats)
+{
+    if(stars.size() < (size_t)MIN_STARS)
+    {
+        return false;
+    }
+
+    vector<Triangle> triangles;
+    buildTriangles(stars, triangles);
+
+    // every pair of matching triangles votes for its 3 pairs of stars
+    const int n = TRIANGLE_STARS;
+    vector<int> votes(n * n, 0);
+    for(size_t t = 0; t < triangles.size(); t++)
+    {
+        const Triangle &triangle = triangles[t];
+        Triangle lowest = triangle;
+        lowest.ratio1 -= TRIANGLE_EPSILON;
+        vector<Triangle>::const_iterator it = std::lower_bound(m_refTriangles.begin(), m_refTriangles.end(), lowest,
+                                                               [](const Triangle &left, const Triangle &right) { return left.ratio1 < right.ratio1; });
+        for(; it != m_refTriangles.end() && it->ratio1 <= triangle.ratio1 + TRIANGLE_EPSILON; ++it)
+        {
+            if(std::fabs(it->ratio2 - triangle.ratio2) <= TRIANGLE_EPSILON)
+            {
+                for(int v = 0; v < 3; v++)
+                {
+                    votes[it->star[v] * n + triangle.star[v]]++;
+                }
+            }
+        }
+    }
+
+    // the pairs which are the best of their row and of their column
+    vector<int> refIndex, frameIndex;
+    for(int r = 0; r < n; r++)
+    {
+        int best = 0;
+        for(int f = 1; f < n; f++)
+        {
+            best = votes[r * n + f] > votes[r * n + best] ? f : best;
+        }
+
+        int bestVotes = votes[r * n + best];
+        bool isMutual = bestVotes >= 2;
+        for(int other = 0; other < n && isMutual; other++)
+        {
+            isMutual = other == r || votes[other * n + best] < bestVotes;
+        }
+        if(isMutual)
+        {
+            refIndex.push_back(r);
+            frameIndex.push_back(best);
+        }
+    }
+
+    StackTransform transform;
+    double rmsError = 0.0;
+    if(!fitTransform(refIndex, frameIndex, stars, transform, rmsError))
+    {
+        return false;
+    }
+
+    // pair all the stars with the first transform and fit again
+    refIndex.clear();
+    frameIndex.clear();
+    for(size_t r = 0; r < m_refStars.size(); r++)
+    {
+        double x = transform.a * m_refStars[r].x + transform.b * m_refStars[r].y + transform.tx;
+        double y = transform.c * m_refStars[r].x + transform.d * m_refStars[r].y + transform.ty;
+
+        int nearest = -1;
+        double nearestDistance = PAIR_RADIUS * PAIR_RADIUS;
+        for(size_t f = 0; f < stars.size(); f++)
+        {
+            double distance = (stars[f].x - x) * (stars[f].x - x) + (stars[f].y - y) * (stars[f].y - y);
+            if(distance < nearestDistance)
+            {
+                nearest = (int)f;
+                nearestDistance = distance;
+            }
+        }
+        if(nearest >= 0)
+        {
+            refIndex.push_back((int)r);
+            frameIndex.push_back(nearest);
+        }
+    }
+
+    if(!fitTransform(refIndex, frameIndex, stars, transform, rmsError) || rmsError > m_maxError)
+    {
+        return false;
+    }
+
+    stats.transform = transform;
+    stats.rmsError = rmsError;
+    stats.matchCount = (int)refIndex.size();
+
+    return true;
+}
+
+bool LiveStacker::fitTransform(vector<int> &refIndex, vector<int> &frameIndex, const vector<StackStar> &stars,
+                               StackTransform &transform, double &rmsError) const
+{
+    const size_t minPairs = m_model == STACK_AFFINE ? 4 : 3; //one more than needed, so an outlier shows
+
+    for(;;)
+    {
+        size_t count = refIndex.size();
+        if(count < minPairs)
+        {
+            return false;
+        }
+
+        // centered on the means, the sums stay small
+        double refX = 0.0, refY = 0.0, frameX = 0.0, frameY = 0.0;
+        for(size_t i = 0; i < count; i++)
+        {
+            refX += m_refStars[refIndex[i]].x;
+            refY += m_refStars[refIndex[i]].y;
+            frameX += stars[frameIndex[i]].x;
+            frameY += stars[frameIndex[i]].y;
+        }
+        refX /= count;
+        refY /= count;
+        frameX /= count;
+        frameY /= count;
+
+        double sxx = 0.0, sxy = 0.0, syy = 0.0, sxu = 0.0, syu = 0.0, sxv = 0.0, syv = 0.0;
+        for(size_t i = 0; i < count; i++)
+        {
+            double x = m_refStars[refIndex[i]].x - refX;
+            double y = m_refStars[refIndex[i]].y - refY;
+            double u = stars[frameIndex[i]].x - frameX;
+            double v = stars[frameIndex[i]].y - frameY;
+            sxx += x * x;
+            sxy += x * y;
+            syy += y * y;
+            sxu += x * u;
+            syu += y * u;
+            sxv += x * v;
+            syv += y * v;
+        }
+
+        if(m_model == STACK_AFFINE)
+        {
+            double det = sxx * syy - sxy * sxy;
+            if(std::fabs(det) < 1e-9)
+            {
+                return false;
+            }
+            transform.a = (sxu * syy - syu * sxy) / det;
+            transform.b = (syu * sxx - sxu * sxy) / det;
+            transform.c = (sxv * syy - syv * sxy) / det;
+            transform.d = (syv * sxx - sxv * sxy) / det;
+        }
+        else
+        {
+            double norm = sxx + syy;
+            if(norm < 1e-9)
+            {
+                return false;
+            }
+            double cosScaled = (sxu + syv) / norm;
+            double sinScaled = (sxv - syu) / norm;
+            transform.a = cosScaled;
+            transform.b = -sinScaled;
+            transform.c = sinScaled;
+            transform.d = cosScaled;
+        }
+        transform.tx = frameX - transform.a * refX - transform.b * refY;
+        transform.ty = frameY - transform.c * refX - transform.d * refY;
+
+        // the residuals, the worst pair is removed if it's an outlier
+        double sumSquares = 0.0;
+        double worstSquare = 0.0;
+        size_t worst = 0;
+        for(size_t i = 0; i < count; i++)
+        {
+            const StackStar &ref = m_refStars[refIndex[i]];
+            double dx = transform.a * ref.x + transform.b * ref.y + transform.tx - stars[frameIndex[i]].x;
+            double dy = transform.c * ref.x + transform.d * ref.y + transform.ty - stars[frameIndex[i]].y;
+            double square = dx * dx + dy * dy;
+            sumSquares += square;
+            if(square > worstSquare)
+            {
+                worstSquare = square;
+                worst = i;
+            }
+        }
+        rmsError = std::sqrt(sumSquares / count);
+
+        double limit = std::max(MIN_OUTLIER, 3.0 * rmsError);
+        if(worstSquare <= limit * limit || count == minPairs)
+        {
+            return worstSquare <= limit * limit;
+        }
+        refIndex.erase(refIndex.begin() + worst);
+        frameIndex.erase(frameIndex.begin() + worst);
+    }
+}
+
+void LiveStacker::accumulate(const Frame &frame, const StackTransform &transform)
+{
+    const unsigned char *pSrc = frame.data();
+    size_t srcStride = frame.stride();
+    if(m_nChannels == 3)
+    {
+        srcStride = (size_t)m_nWidth * Debayer::outputBytesPerPixel(m_imgFormat);
+        m_color.resize(srcStride * m_nHeight);
+        m_debayer.process(frame, m_color.data(), srcStride);
+        pSrc = m_color.data();
+    }
+
+    const bool is16Bit = m_imgFormat == POA_RAW16;
+    m_parallel.run(m_nHeight, [&](int rowBegin, int rowEnd)
+    {
+        if(m_nChannels == 3)
+        {
+            is16Bit ? warpRows<uint16_t, 3>(pSrc, srcStride, transform, rowBegin, rowEnd)
+                    : warpRows<unsigned char, 3>(pSrc, srcStride, transform, rowBegin, rowEnd);
+        }
+        else
+        {
+            is16Bit ? warpRows<uint16_t, 1>(pSrc, srcStride, transform, rowBegin, rowEnd)
+                    : warpRows<unsigned char, 1>(pSrc, srcStride, transform, rowBegin, rowEnd);
+        }
+    });
+}
+
+template<typename T, int CHANNELS>
+void LiveStacker::warpRows(const unsigned char *pSrc, size_t srcStride, const StackTransform &transform, int rowBegin, int rowEnd)
+{
+    const double maxX = m_nWidth - 1;
+    const double maxY = m_nHeight - 1;
+
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        float *pSum = &m_sum[(size_t)y * m_nWidth * CHANNELS];
+        uint16_t *pCount = &m_count[(size_t)y * m_nWidth];
+        double rowX = transform.b * y + transform.tx;
+        double rowY = transform.d * y + transform.ty;
+
+        for(int x = 0; x < m_nWidth; x++)
+        {
+            double srcX = rowX + transform.a * x;
+            double srcY = rowY + transform.c * x;
+            if(srcX < 0.0 || srcY < 0.0 || srcX >= maxX || srcY >= maxY) //not covered by the frame
+            {
+                continue;
+            }
+
+            int ix = (int)srcX;
+            int iy = (int)srcY;
+            float fx = (float)(srcX - ix);
+            float fy = (float)(srcY - iy);
+            float w00 = (1.0f - fx) * (1.0f - fy);
+            float w01 = fx * (1.0f - fy);
+            float w10 = (1.0f - fx) * fy;
+            float w11 = fx * fy;
+
+            const T *p0 = (const T *)(pSrc + iy * srcStride) + ix * CHANNELS;
+            const T *p1 = (const T *)(pSrc + (iy + 1) * srcStride) + ix * CHANNELS;
+            for(int c = 0; c < CHANNELS; c++)
+            {
+                pSum[x * CHANNELS + c] += w00 * p0[c] + w01 * p0[CHANNELS + c] + w10 * p1[c] + w11 * p1[CHANNELS + c];
+            }
+            pCount[x]++;
+        }
+    }
+}
@@ -0,0 +1,195 @@
+#ifndef LIVESTACKER_H
+#define LIVESTACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "Frame.h"
+#include "Debayer.h"
+#include "ParallelRows.h"
+#include "StarExtractor.h"
+
+/*******************************************************************************
+Live stacking of the frames of the video mode(POAStartExposure(id, POA_FALSE),
+POACamera::popFrame()): every frame is registered on the stars of the reference
+frame(the first one, see reset()), warped and added to a float accumulator, so the
+stack can be shown while the camera runs.
+Registration: the stars are found by StarExtractor(the 2x2 cells of a bayer frame,
+a background mesh, the components above detectSigma * noise, a hot pixel is too
+small to be one), the maxStars brightest are kept.
+The triangles of the brightest stars of the frame are matched with the triangles of
+the reference by their shape(the ratios of the sides don't change with the shift,
+rotation and scale), every match votes for 3 pairs of stars, the pairs with the most
+votes give a first transform(least squares, the outliers removed), then all the
+stars are paired by it and the transform is fitted again.
+The transform maps the reference to the frame: similarity(shift, rotation, scale)
+or affine. A frame with too few stars or an rms error above maxError is rejected.
+Warping: every pixel of the stack samples the frame bilinearly where the transform
+maps it, the color frames(RAW8 / RAW16 with a bayer pattern) are debayered first
+(Debayer::BILINEAR, B G R), the mono frames are sampled as they are. Every pixel
+counts the frames which covered it, the stack is the sum / the count.
+The detection and the warping are split into row tiles run on all
+cores(ParallelRows), the timing of every step is kept per frame(getLastStats()).
+*******************************************************************************/
+
+enum StackTransformModel
+{
+    STACK_SIMILARITY = 0,
+    STACK_AFFINE
+};
+
+struct StackTransform //a point of the reference -> the point of the frame
+{
+    double a;   //xf = a * x + b * y + tx
+    double b;
+    double c;   //yf = c * x + d * y + ty
+    double d;
+    double tx;
+    double ty;
+
+    StackTransform()
+    {
+        a = 1.0;
+        b = 0.0;
+        c = 0.0;
+        d = 1.0;
+        tx = 0.0;
+        ty = 0.0;
+    }
+
+    double rotationDegrees() const;
+
+    double scale() const;
+};
+
+struct StackStar
+{
+    float x;    //full resolution pixels
+    float y;
+    float flux; //the sum above the background, ADU(ExtractedStar::flux)
+};
+
+struct StackFrameStats
+{
+    unsigned long long seq; //Frame::seq
+    bool isStacked;
+    bool isReference;
+    int starCount;          //the stars found
+    int matchCount;         //the stars paired with the reference and fitted
+    double rmsError;        //pixels
+    StackTransform transform;
+    double detectUs;        //background, stars(StarExtractor)
+    double registerUs;      //triangles, fit
+    double warpUs;          //debayer, warp and accumulate
+    double totalUs;
+
+    StackFrameStats()
+    {
+        seq = 0;
+        isStacked = false;
+        isReference = false;
+        starCount = 0;
+        matchCount = 0;
+        rmsError = 0.0;
+        detectUs = 0.0;
+        registerUs = 0.0;
+        warpUs = 0.0;
+        totalUs = 0.0;
+    }
+};
+
+class LiveStacker
+{
+public:
+    explicit LiveStacker(int threadCount = 0); //0: all cores
+
+    void setModel(StackTransformModel model); //default is STACK_SIMILARITY
+
+    StackTransformModel getModel() const;
+
+    void setDetectSigma(double detectSigma); //the threshold of the stars above the background, default is 5 sigma
+
+    void setMaxStars(int maxStars); //the brightest stars kept per frame, default is 50
+
+    void setMaxError(double maxError); //the largest rms error of a stacked frame, default is 1.5 pixels
+
+    void reset(); //clear the stack, the next frame is the reference
+
+    // RAW8, RAW16 or MONO8, the size and format of the reference, return false if the frame is rejected
+    bool addFrame(const Frame &frame);
+
+    const StackFrameStats &getLastStats() const;
+
+    int getStackedCount() const;
+
+    int getRejectedCount() const;
+
+    int width() const;
+
+    int height() const;
+
+    int channels() const; //1 or 3(B G R)
+
+    // the mean of the stacked frames, width * height * channels, 0 where no frame covered the pixel
+    bool getStack(std::vector<float> &image) const;
+
+    const std::vector<StackStar> &getReferenceStars() const;
+
+    static const int TRIANGLE_STARS = 20;   //the brightest stars of the triangles
+    static const int MIN_STARS = 6;         //the stars needed to register a frame
+
+private:
+    LiveStacker(const LiveStacker &);
+    LiveStacker &operator=(const LiveStacker &);
+
+    struct Triangle
+    {
+        float ratio1;   //middle side / longest side
+        float ratio2;   //shortest side / longest side
+        int star[3];    //the vertices, opposite to the longest, the middle and the shortest side
+    };
+
+    void detectStars(const Frame &frame, std::vector<StackStar> &stars);
+
+    static void buildTriangles(const std::vector<StackStar> &stars, std::vector<Triangle> &triangles);
+
+    bool registerStars(const std::vector<StackStar> &stars, StackFrameStats &stats);
+
+    // least squares, the worst pair is removed while it's an outlier, false if too few pairs are left
+    bool fitTransform(std::vector<int> &refIndex, std::vector<int> &frameIndex, const std::vector<StackStar> &stars,
+                      StackTransform &transform, double &rmsError) const;
+
+    void accumulate(const Frame &frame, const StackTransform &transform);
+
+    template<typename T, int CHANNELS>
+    void warpRows(const unsigned char *pSrc, size_t srcStride, const StackTransform &transform, int rowBegin, int rowEnd);
+
+    ParallelRows m_parallel;
+    StarExtractor m_extractor;
+    Debayer m_debayer;
+    StackTransformModel m_model;
+    double m_detectSigma;
+    int m_nMaxStars;
+    double m_maxError;
+
+    int m_nWidth;
+    int m_nHeight;
+    int m_nChannels;
+    POAImgFormat m_imgFormat;
+    POABayerPattern m_bayerPattern;
+
+    std::vector<StackStar> m_refStars;
+    std::vector<Triangle> m_refTriangles;   //sorted by ratio1
+    std::vector<float> m_sum;               //width * height * channels
+    std::vector<uint16_t> m_count;          //the frames which covered the pixel
+    int m_nStackedCount;
+    int m_nRejectedCount;
+    StackFrameStats m_lastStats;
+
+    std::vector<ExtractedStar> m_extracted;
+    std::vector<unsigned char> m_color;     //the debayered frame
+};
+
+#endif // LIVESTACKER_H
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "LuckySelector.h"
+
+using namespace std;
+
+LuckySelector::LuckySelector()
+    : m_keepPercent(10.0), m_nWindowUs(1000000), m_nMaxFrames(0), m_bStarted(false),
+      m_nWindowBeginUs(-1), m_nWindowFrames(0), m_nLastWindowFrames(0), m_totalScoreUs(0.0)
+{
+}
+
+LuckySelector::~LuckySelector()
+{
+    stop();
+}
+
+bool LuckySelector::start(const KeepFunc &keepFunc, double keepPercent, long long windowUs, int maxFrames, size_t frameBytes)
+{
+    if(m_bStarted || !keepFunc || keepPercent <= 0.0 || keepPercent > 100.0 || windowUs <= 0 || maxFrames <= 0)
+    {
+        cerr << "start lucky selector failed, it's started or the arguments are out of range" << endl;
+        return false;
+    }
+
+    if(!m_pool.init(frameBytes, maxFrames * 2))
+    {
+        cerr << "start lucky selector failed, can't allocate the frame pool" << endl;
+        return false;
+    }
+
+    m_keepFunc = keepFunc;
+    m_keepPercent = keepPercent;
+    m_nWindowUs = windowUs;
+    m_nMaxFrames = maxFrames;
+    m_heap.clear();
+    m_heap.reserve(maxFrames);
+    m_nWindowBeginUs = -1;
+    m_nWindowFrames = 0;
+    m_nLastWindowFrames = 0;
+    m_stats = LuckyStats();
+    m_totalScoreUs = 0.0;
+    m_bStarted = true;
+
+    return true;
+}
+
+void LuckySelector::stop()
+{
+    if(!m_bStarted)
+    {
+        return;
+    }
+
+    flush();
+    m_keepFunc = nullptr;
+    m_pool.release();
+    m_bStarted = false;
+}
+
+bool LuckySelector::isStarted() const
+{
+    return m_bStarted;
+}
+
+FrameQuality &LuckySelector::getQuality()
+{
+    return m_quality;
+}
+
+bool LuckySelector::isWorse(const Candidate &left, const Candidate &right)
+{
+    return left.score > right.score; //std::push_heap keeps the largest first, so the worst is at the front
+}
+
+int LuckySelector::windowCapacity() const
+{
+    if(m_nLastWindowFrames == 0) //the first window, the frame rate is not known yet
+    {
+        return m_nMaxFrames;
+    }
+
+    int capacity = (int)std::ceil(m_nLastWindowFrames * m_keepPercent / 100.0);
+    return std::min(std::max(capacity, 1), m_nMaxFrames);
+}
+
+bool LuckySelector::copyFrame(const Frame &src, Frame &dst)
+{
+    if(src.sizeBytes() > m_pool.slabBytes())
+    {
+        return false;
+    }
+
+    FrameBuffer *pBuffer = m_pool.acquireBuffer();
+    if(!pBuffer)
+    {
+        return false;
+    }
+
+    dst = Frame::fromBuffer(pBuffer, src.width(), src.height(), src.imgFormat(), src.bayerPattern());
+    size_t rowBytes = src.rowBytes();
+    for(int y = 0; y < src.height(); y++)
+    {
+        memcpy(dst.row(y), src.row(y), rowBytes);
+    }
+
+    dst.bin = src.bin;
+    dst.startX = src.startX;
+    dst.startY = src.startY;
+    dst.exposureUs = src.exposureUs;
+    dst.timestampUs = src.timestampUs;
+    dst.seq = src.seq;
+
+    return true;
+}
+
+double LuckySelector::push(const Frame &frame)
+{
+    if(!m_bStarted)
+    {
+        return -1.0;
+    }
+
+    if(m_nWindowBeginUs < 0)
+    {
+        m_nWindowBeginUs = frame.timestampUs;
+    }
+    else if(frame.timestampUs - m_nWindowBeginUs >= m_nWindowUs)
+    {
+        flush();
+        m_nWindowBeginUs = frame.timestampUs;
+    }
+
+    chrono::steady_clock::time_point beginTime = chrono::steady_clock::now();
+    double score = m_quality.score(frame);
+    double scoreUs = chrono::duration<double, micro>(chrono::steady_clock::now() - beginTime).count();
+    if(score < 0.0)
+    {
+        return score;
+    }
+
+    m_stats.framesScored++;
+    m_totalScoreUs += scoreUs;
+    m_stats.avgScoreUs = m_totalScoreUs / m_stats.framesScored;
+    m_stats.maxScoreUs = std::max(m_stats.maxScoreUs, scoreUs);
+    m_nWindowFrames++;
+
+    bool isFull = (int)m_heap.size() >= windowCapacity();
+    if(isFull && score <= m_heap.front().score)
+    {
+        m_stats.framesDiscarded++;
+        return score;
+    }
+
+    if(isFull) //the worst candidate leaves first, its slab is reused
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), isWorse);
+        m_heap.pop_back();
+        m_stats.framesDiscarded++;
+    }
+
+    Candidate candidate;
+    candidate.score = score;
+    if(!copyFrame(frame, candidate.frame))
+    {
+        m_stats.framesDropped++;
+        return score;
+    }
+    m_heap.push_back(candidate);
+    std::push_heap(m_heap.begin(), m_heap.end(), isWorse);
+
+    return score;
+}
+
+void LuckySelector::flush()
+{
+    if(m_nWindowFrames == 0)
+    {
+        return;
+    }
+
+    // the capacity came from the last window, the best keepPercent of this one are kept
+    size_t keepCount = (size_t)std::max(1.0, std::ceil(m_nWindowFrames * m_keepPercent / 100.0));
+    while(m_heap.size() > keepCount)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), isWorse);
+        m_heap.pop_back();
+        m_stats.framesDiscarded++;
+    }
+
+    std::sort(m_heap.begin(), m_heap.end(), [](const Candidate &left, const Candidate &right)
+    {
+        return left.frame.timestampUs != right.frame.timestampUs ? left.frame.timestampUs < right.frame.timestampUs
+                                                                  : left.frame.seq < right.frame.seq;
+    });
+    for(size_t i = 0; i < m_heap.size(); i++)
+    {
+        m_keepFunc(m_heap[i].frame, m_heap[i].score);
+        m_stats.framesKept++;
+    }
+
+    m_heap.clear(); //the slabs go back to the pool when the frames passed on are released
+    m_nLastWindowFrames = m_nWindowFrames;
+    m_nWindowFrames = 0;
+    m_stats.windows++;
+}
+
+LuckyStats LuckySelector::getStats() const
+{
+    return m_stats;
+}
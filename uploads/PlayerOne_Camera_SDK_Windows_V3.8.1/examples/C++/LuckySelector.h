@@ -0,0 +1,107 @@
+#ifndef LUCKYSELECTOR_H
+#define LUCKYSELECTOR_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "Frame.h"
+#include "FramePool.h"
+#include "FrameQuality.h"
+
+/*******************************************************************************
+Lucky imaging on the capture stream: every frame is scored(FrameQuality), only the
+best keepPercent of the frames of every time window(by Frame::timestampUs) are
+passed on(eg: to AsyncWriter::push or SerWriter::write), the others are dropped
+before they reach the disk.
+The candidates of the window are kept in a min-heap by score, a frame better than the
+worst candidate replaces it, the others are discarded at once. The candidates are
+copied into the own frame pool of the selector, so the slabs of the camera go back to
+the capture at once. The heap holds keepPercent of the frames of the last window(at
+most maxFrames), so the memory is bounded whatever the frame rate, when the window
+closes the best keepPercent of its frames are passed on in the order of the capture.
+The pool has 2 * maxFrames slabs: the frames passed on may still be written while the
+next window fills the heap, a better frame is dropped if no slab is free(see
+LuckyStats::framesDropped).
+push() is called by one thread(the consumer of POACamera::popFrame()).
+*******************************************************************************/
+
+struct LuckyStats
+{
+    unsigned long long framesScored;
+    unsigned long long framesKept;      //passed on
+    unsigned long long framesDiscarded;
+    unsigned long long framesDropped;   //better than a candidate, but no free slab
+    unsigned long long windows;         //the closed windows
+    double avgScoreUs;                  //the time of FrameQuality::score
+    double maxScoreUs;
+
+    LuckyStats()
+    {
+        framesScored = 0;
+        framesKept = 0;
+        framesDiscarded = 0;
+        framesDropped = 0;
+        windows = 0;
+        avgScoreUs = 0.0;
+        maxScoreUs = 0.0;
+    }
+};
+
+class LuckySelector
+{
+public:
+    typedef std::function<void(const Frame &frame, double score)> KeepFunc;
+
+    LuckySelector();
+
+    ~LuckySelector();
+
+    // the frames up to frameBytes(eg: POACamera::getFrameBytes()), the best keepPercent of every windowUs go to keepFunc
+    bool start(const KeepFunc &keepFunc, double keepPercent, long long windowUs, int maxFrames, size_t frameBytes);
+
+    void stop(); //close the last window and release the pool, the frames passed on must be released first
+
+    bool isStarted() const;
+
+    FrameQuality &getQuality(); //the metric and the disc tracking
+
+    double push(const Frame &frame); //return the score, -1 if the frame is not scored
+
+    void flush(); //close the window now
+
+    LuckyStats getStats() const;
+
+private:
+    LuckySelector(const LuckySelector &);
+    LuckySelector &operator=(const LuckySelector &);
+
+    struct Candidate
+    {
+        Frame frame;
+        double score;
+    };
+
+    static bool isWorse(const Candidate &left, const Candidate &right); //the order of the min-heap
+
+    bool copyFrame(const Frame &src, Frame &dst);
+
+    int windowCapacity() const; //the candidates of the current window
+
+    FrameQuality m_quality;
+    FramePool m_pool;
+    KeepFunc m_keepFunc;
+    double m_keepPercent;
+    long long m_nWindowUs;
+    int m_nMaxFrames;
+    bool m_bStarted;
+
+    std::vector<Candidate> m_heap;
+    long long m_nWindowBeginUs;     //-1 before the first frame
+    unsigned long long m_nWindowFrames;
+    unsigned long long m_nLastWindowFrames;
+    LuckyStats m_stats;
+    double m_totalScoreUs;
+};
+
+#endif // LUCKYSELECTOR_H
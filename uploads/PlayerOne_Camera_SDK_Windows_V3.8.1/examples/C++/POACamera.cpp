@@ -1,21 +1,75 @@
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include "POACamera.h"
 
 #include "PlayerOneCamera.h"
 
+static POAImgFormat toPOAImgFormat(POACamera::ImageFormat imgFmt)
+{
+    switch (imgFmt)
+    {
+    case POACamera::RAW16:
+        return POA_RAW16;
+    case POACamera::RGB888:
+        return POA_RGB24;
+    case POACamera::MONO8:
+        return POA_MONO8;
+    case POACamera::RAW8:
+    default:
+        return POA_RAW8;
+    }
+}
+
+static long long steadyNowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static POACamera::ImageFormat fromPOAImgFormat(POAImgFormat poaImgFmt)
+{
+    switch (poaImgFmt)
+    {
+    case POA_RAW16:
+        return POACamera::RAW16;
+    case POA_RGB24:
+        return POACamera::RGB888;
+    case POA_MONO8:
+        return POACamera::MONO8;
+    case POA_RAW8:
+    case POA_END:
+    default:
+        return POACamera::RAW8;
+    }
+}
+
 POACamera::POACamera()
+    : POACamera(-1)
 {
-    m_nCameraID = -1;
 }
 
 POACamera::POACamera(int nCameraID)
+    : m_pCaptureRing(nullptr), m_bCapturing(false), m_nFramesCaptured(0), m_nFramesOverrun(0), m_nCaptureErrors(0), m_llFirstFrameTimeUs(0),
+      m_bTracking(false), m_nTrackingMinMoveFrames(2), m_llTrackingPending(-1), m_llTrackingPendingTimeUs(0),
+      m_nTrackingRequests(0), m_nTrackingHeld(0), m_nTrackingCoalesced(0), m_nTrackingMoves(0), m_nTrackingMoveErrors(0),
+      m_nTrackingFirstSeq(0), m_llTrackingStart(0), m_llTrackingLastLatencyUs(0), m_llTrackingTotalLatencyUs(0),
+      m_llTrackingMaxLatencyUs(0), m_lWaitExposureUs(0),
+      m_nWaits(0), m_nWaitPolls(0), m_llLastWakeLatencyUs(0), m_llTotalWakeLatencyUs(0), m_llMaxWakeLatencyUs(0)
 {
     m_nCameraID = nCameraID;
+    m_nCaptureFrameBytes = 0;
+    m_lCaptureTimeoutMs = 0;
+    m_pOverrunBuffer = nullptr;
+    m_waitStrategy = WAIT_HYBRID;
+    m_nTrackingDeadband = 8;
+    m_nTrackingMaxStartX = 0;
+    m_nTrackingMaxStartY = 0;
+    m_nTrackingNextMoveSeq = 0;
 }
 
 POACamera::~POACamera()
 {
-
+    stopCapture();
 }
 
 map<int, string> POACamera::getALLCameraIDName()
@@ -44,6 +98,9 @@ map<int, string> POACamera::getALLCameraIDName()
 
 bool POACamera::openCamera()
 {
+    invalidateCache();
+    m_configCache = ConfigCache();
+
     POAErrors error = POAOpenCamera(m_nCameraID);
 
     if(error != POA_OK)
@@ -56,39 +113,32 @@ bool POACamera::openCamera()
 
 bool POACamera::initCamera()
 {
+    invalidateCache(); //init resets the camera parameters
+
     POAErrors error = POAInitCamera(m_nCameraID);
 
     if(error != POA_OK)
     {
         cerr << "Init camera failed！, error code: " << POAGetErrorString(error) << endl;
+        return false;
     }
 
-    return error == POA_OK ? true : false;
+    return loadConfigAttributes();
 }
 
 void POACamera::getAllConfigAttributes()
 {
-    int config_count = 0;
-    POAErrors error;
-    error = POAGetConfigsCount(m_nCameraID, &config_count);
-    if(error != POA_OK)
-    {
-        cerr << "Get config count failed！, error code: " << POAGetErrorString(error) << endl;
-        return;
-    }
-
-    for(int i = 0; i < config_count; i++)
+    for(int i = 0; i < CONFIG_COUNT; i++)
     {
-        POAConfigAttributes confAttributes;
-
-        error = POAGetConfigAttributes(m_nCameraID, i, &confAttributes);
-
-        if(error != POA_OK)
+        POAConfigAttributes sdkAttributes;
+        const POAConfigAttributes *pAttributes = findConfigAttributes((POAConfig)i, sdkAttributes);
+        if(!pAttributes)
         {
-            cerr << "Get config attributes failed！, index: " << i << ", error code: " << POAGetErrorString(error) << endl;
             continue;
         }
 
+        const POAConfigAttributes &confAttributes = *pAttributes;
+
         cout << endl;
 
         cout << "config name: " << confAttributes.szConfName << ", config description: " << confAttributes.szDescription << endl;
@@ -113,301 +163,1603 @@ void POACamera::getAllConfigAttributes()
     }
 }
 
-bool POACamera::setROIArea(const ROIArea &roiArea)
+bool POACamera::loadConfigAttributes()
 {
-    //set ROI Area, if exposing, please stop exposure first
-
-    POACameraState cameraState;
-
-    POAGetCameraState(m_nCameraID, &cameraState);
-
-    if(cameraState == STATE_EXPOSING)
-    {
-        POAStopExposure(m_nCameraID);
-    }
+    m_configCache = ConfigCache();
 
-    POAErrors error;
-    // set resolution
-    error = POASetImageSize(m_nCameraID, roiArea.width, roiArea.height); //default resolution is maxWidth * maxHeight
+    int config_count = 0;
+    POAErrors error = POAGetConfigsCount(m_nCameraID, &config_count);
     if(error != POA_OK)
     {
-        cerr << "set resolution failed, error code: " << POAGetErrorString(error) << endl;
+        cerr << "Get config count failed！, error code: " << POAGetErrorString(error) << endl;
         return false;
     }
 
-    // set start position
-    error = POASetImageStartPos(m_nCameraID, roiArea.startX, roiArea.startY); //default start position is (0, 0)
-    if(error != POA_OK)
+    for(int i = 0; i < config_count; i++)
     {
-        cerr << "set start position failed, error code: " << POAGetErrorString(error) << endl;
-        return false;
+        POAConfigAttributes confAttributes;
+
+        error = POAGetConfigAttributes(m_nCameraID, i, &confAttributes);
+
+        if(error != POA_OK)
+        {
+            cerr << "Get config attributes failed！, index: " << i << ", error code: " << POAGetErrorString(error) << endl;
+            m_configCache = ConfigCache();
+            return false;
+        }
+
+        if(confAttributes.configID < 0 || confAttributes.configID >= CONFIG_COUNT) //a config of a newer SDK
+        {
+            continue;
+        }
+
+        m_configCache.attributes[confAttributes.configID] = confAttributes;
+        m_configCache.hasConfig[confAttributes.configID] = true;
     }
 
+    m_configCache.isLoaded = true;
+
     return true;
 }
 
-ROIArea POACamera::getROIArea()
+const POAConfigAttributes *POACamera::findConfigAttributes(POAConfig confID, POAConfigAttributes &sdkAttributes)
 {
-    ROIArea roiArea;
-
-    POAErrors error;
-    error = POAGetImageStartPos(m_nCameraID, &roiArea.startX, &roiArea.startY);
-    if(error != POA_OK)
+    if(confID < 0 || confID >= CONFIG_COUNT)
     {
-        cerr << "get start position failed, error code: " << POAGetErrorString(error) << endl;
+        return nullptr;
     }
 
-    error = POAGetImageSize(m_nCameraID, &roiArea.width, &roiArea.height);
-    if(error != POA_OK)
+    if(m_configCache.isLoaded)
     {
-        cerr << "get resolution failed, error code: " << POAGetErrorString(error) << endl;
+        return m_configCache.hasConfig[confID] ? &m_configCache.attributes[confID] : nullptr;
     }
 
-    return roiArea;
+    // not loaded(eg: the camera was initialized outside this class), one SDK call, the load is not retried
+    return POAGetConfigAttributesByConfigID(m_nCameraID, confID, &sdkAttributes) == POA_OK ? &sdkAttributes : nullptr;
 }
 
-bool POACamera::setImageSize(int width, int height)
+bool POACamera::hasConfig(POAConfig confID)
 {
+    POAConfigAttributes sdkAttributes;
 
-    POACameraState cameraState;
-
-    POAGetCameraState(m_nCameraID, &cameraState);
+    return findConfigAttributes(confID, sdkAttributes) != nullptr;
+}
 
-    if(cameraState == STATE_EXPOSING)
-    {
-        POAStopExposure(m_nCameraID);
-    }
+const POAConfigAttributes *POACamera::getConfigAttributes(POAConfig confID)
+{
+    return m_configCache.isLoaded && hasConfig(confID) ? &m_configCache.attributes[confID] : nullptr;
+}
 
-    // set resolution
-    POAErrors error = POASetImageSize(m_nCameraID, width, height); //default resolution is maxWidth * maxHeight
-    if(error != POA_OK)
+bool POACamera::getConfigRange(POAConfig confID, long &minValue, long &maxValue, long &defaultValue)
+{
+    POAConfigAttributes sdkAttributes;
+    const POAConfigAttributes *pAttributes = findConfigAttributes(confID, sdkAttributes);
+    if(!pAttributes || pAttributes->valueType != VAL_INT)
     {
-        cerr << "set resolution failed, error code: " << POAGetErrorString(error) << endl;
+        cerr << "get config range failed, config " << confID << " is not an integer config of this camera" << endl;
         return false;
     }
 
+    minValue = pAttributes->minValue.intValue;
+    maxValue = pAttributes->maxValue.intValue;
+    defaultValue = pAttributes->defaultValue.intValue;
+
     return true;
 }
 
-bool POACamera::setImageStartPos(int startX, int startY)
+bool POACamera::getConfigRange(POAConfig confID, double &minValue, double &maxValue, double &defaultValue)
 {
-    // set start position
-    POAErrors error = POASetImageStartPos(m_nCameraID, startX, startY); //default start position is (0, 0)
-    if(error != POA_OK)
+    POAConfigAttributes sdkAttributes;
+    const POAConfigAttributes *pAttributes = findConfigAttributes(confID, sdkAttributes);
+    if(!pAttributes || pAttributes->valueType != VAL_FLOAT)
     {
-        cerr << "set start position failed, error code: " << POAGetErrorString(error) << endl;
+        cerr << "get config range failed, config " << confID << " is not a float config of this camera" << endl;
         return false;
     }
 
+    minValue = pAttributes->minValue.floatValue;
+    maxValue = pAttributes->maxValue.floatValue;
+    defaultValue = pAttributes->defaultValue.floatValue;
+
     return true;
 }
 
-bool POACamera::setImageFormat(POACamera::ImageFormat imgFmt)
+bool POACamera::getConfig(POAConfig confID, long &value, bool *pIsAuto)
 {
-    POACameraState cameraState;
+    POAConfigValue confValue;
+    bool isAuto = false;
 
-    POAGetCameraState(m_nCameraID, &cameraState);
+    POAErrors error = readConfig(confID, VAL_INT, confValue, isAuto);
 
-    if(cameraState == STATE_EXPOSING) //should stop exposure first if exposing
+    if(error != POA_OK)
     {
-        POAStopExposure(m_nCameraID);
+        printConfigError("get", confID, error);
+        return false;
     }
 
-    POAImgFormat poaImgFmt = POA_RAW8;
-
-    switch (imgFmt)
+    value = confValue.intValue;
+    if(pIsAuto)
     {
-    case RAW8:
-        poaImgFmt = POA_RAW8;
-        break;
-    case RAW16:
-        poaImgFmt = POA_RAW16;
-        break;
-    case RGB888:
-        poaImgFmt = POA_RGB24;
-        break;
-    case MONO8:
-        poaImgFmt = POA_MONO8;
-        break;
+        *pIsAuto = isAuto;
     }
 
-    POAErrors error = POASetImageFormat(m_nCameraID, poaImgFmt); //default image format is POA_RAW8
+    return true;
+}
+
+bool POACamera::getConfig(POAConfig confID, double &value, bool *pIsAuto)
+{
+    POAConfigValue confValue;
+    bool isAuto = false;
+
+    POAErrors error = readConfig(confID, VAL_FLOAT, confValue, isAuto);
+
     if(error != POA_OK)
     {
-        cerr << "set image format failed, error code: " << POAGetErrorString(error) << endl;
+        printConfigError("get", confID, error);
         return false;
     }
 
+    value = confValue.floatValue;
+    if(pIsAuto)
+    {
+        *pIsAuto = isAuto;
+    }
+
     return true;
 }
 
-POACamera::ImageFormat POACamera::getImageFormat()
+bool POACamera::getConfig(POAConfig confID, bool &isEnable)
 {
-    POAImgFormat poaImgFmt = POA_RAW8;
+    POAConfigValue confValue;
+    bool isAuto = false;
 
-    POAErrors error = POAGetImageFormat(m_nCameraID, &poaImgFmt);
+    POAErrors error = readConfig(confID, VAL_BOOL, confValue, isAuto);
 
     if(error != POA_OK)
     {
-        cerr << "get image format failed, error code: " << POAGetErrorString(error) << endl;
+        printConfigError("get", confID, error);
+        return false;
     }
 
-    ImageFormat imgFmt;
-    switch (poaImgFmt)
-    {
-    case POA_RAW8:
-        imgFmt = RAW8;
-        break;
-    case POA_RAW16:
-        imgFmt = RAW16;
-        break;
-    case POA_RGB24:
-        imgFmt = RGB888;
-        break;
-    case POA_MONO8:
-        imgFmt = MONO8;
-        break;
-    case POA_END:
-        imgFmt = RAW8;
-        break;
-    }
+    isEnable = confValue.boolValue == POA_TRUE;
 
-    return imgFmt;
+    return true;
 }
 
-bool POACamera::setExposure(long expoUs, bool isAuto)
+bool POACamera::setConfig(POAConfig confID, long value, bool isAuto)
 {
-    POAConfigValue exposValue;
-    exposValue.intValue = expoUs;
+    POAConfigValue confValue;
+    confValue.intValue = value;
 
-    POAErrors error = POASetConfig(m_nCameraID, POA_EXPOSURE, exposValue, isAuto ? POA_TRUE : POA_FALSE);
+    POAErrors error = writeConfig(confID, VAL_INT, confValue, isAuto);
 
     if(error != POA_OK)
     {
-        cerr << "set exposure failed, error code: " << POAGetErrorString(error) << endl;
+        printConfigError("set", confID, error);
         return false;
     }
 
     return true;
 }
 
-long POACamera::getExposure()
+bool POACamera::setConfig(POAConfig confID, double value, bool isAuto)
 {
-    POAConfigValue exposValue;
+    POAConfigValue confValue;
+    confValue.floatValue = value;
 
-    POABool boolValue;
-
-    POAErrors error = POAGetConfig(m_nCameraID, POA_EXPOSURE, &exposValue, &boolValue);
+    POAErrors error = writeConfig(confID, VAL_FLOAT, confValue, isAuto);
 
     if(error != POA_OK)
     {
-        cerr << "get exposure failed, error code: " << POAGetErrorString(error) << endl;
-        return -1;
+        printConfigError("set", confID, error);
+        return false;
     }
 
-    return exposValue.intValue;
+    return true;
 }
 
-bool POACamera::setGain(long gain, bool isAuto)
+bool POACamera::setConfig(POAConfig confID, bool isEnable)
 {
-    POAConfigValue gainValue;
-    gainValue.intValue = gain;
+    POAConfigValue confValue;
+    confValue.boolValue = isEnable ? POA_TRUE : POA_FALSE;
 
-    POAErrors error = POASetConfig(m_nCameraID, POA_GAIN, gainValue, isAuto ? POA_TRUE : POA_FALSE);
+    POAErrors error = writeConfig(confID, VAL_BOOL, confValue, false);
 
     if(error != POA_OK)
     {
-        cerr << "set gain failed, error code: " << POAGetErrorString(error) << endl;
+        printConfigError("set", confID, error);
         return false;
     }
 
     return true;
 }
 
-long POACamera::getGain()
+void POACamera::printConfigError(const char *operation, POAConfig confID, POAErrors error)
+{
+    cerr << operation << " config " << confID << " failed, error code: " << POAGetErrorString(error) << endl;
+}
+
+POAErrors POACamera::checkConfig(POAConfig confID, POAValueType valueType, bool isWrite)
 {
-    POAConfigValue gainValue;
+    if(!m_configCache.isLoaded)
+    {
+        return POA_OK; //not loaded(eg: the camera was initialized outside this class), the SDK checks it
+    }
+
+    if(confID < 0 || confID >= CONFIG_COUNT || !m_configCache.hasConfig[confID])
+    {
+        return POA_ERROR_INVALID_CONFIG;
+    }
 
-    POABool boolValue;
+    const POAConfigAttributes &attributes = m_configCache.attributes[confID];
 
-    POAErrors error = POAGetConfig(m_nCameraID, POA_GAIN, &gainValue, &boolValue);
+    if(attributes.valueType != valueType)
+    {
+        return POA_ERROR_INVALID_CONFIG;
+    }
 
-    if(error != POA_OK)
+    if(isWrite && !attributes.isWritable)
     {
-        cerr << "get gain failed, error code: " << POAGetErrorString(error) << endl;
-        return -1;
+        return POA_ERROR_CONF_CANNOT_WRITE;
+    }
+
+    if(!isWrite && !attributes.isReadable)
+    {
+        return POA_ERROR_CONF_CANNOT_READ;
     }
 
-    return gainValue.intValue;
+    return POA_OK;
 }
 
-bool POACamera::startExposure()
+POAErrors POACamera::readConfig(POAConfig confID, POAValueType valueType, POAConfigValue &value, bool &isAuto)
 {
-    POAErrors error = POAStartExposure(m_nCameraID, POA_FALSE); // continuously exposure
+    POAErrors error = checkConfig(confID, valueType, false);
 
     if(error != POA_OK)
     {
-        cerr << "start exposure failed, error code: " << POAGetErrorString(error) << endl;
-        return false;
+        return error;
     }
 
-    return true;
+    POABool boolValue = POA_FALSE;
+
+    error = POAGetConfig(m_nCameraID, confID, &value, &boolValue);
+
+    isAuto = boolValue == POA_TRUE;
+
+    return error;
 }
 
-bool POACamera::isImgDataAvailable()
+POAErrors POACamera::writeConfig(POAConfig confID, POAValueType valueType, POAConfigValue value, bool isAuto)
 {
-    POABool pIsReady = POA_FALSE;
-
-    POAErrors error = POAImageReady(m_nCameraID, &pIsReady);
+    POAErrors error = checkConfig(confID, valueType, true);
 
     if(error != POA_OK)
     {
-        return false;
+        return error;
     }
 
-    return pIsReady == POA_TRUE ? true : false;
+    if(m_configCache.isLoaded)
+    {
+        const POAConfigAttributes &attributes = m_configCache.attributes[confID];
+
+        if(valueType == VAL_INT && (value.intValue < attributes.minValue.intValue || value.intValue > attributes.maxValue.intValue))
+        {
+            return POA_ERROR_OUT_OF_LIMIT;
+        }
+
+        if(valueType == VAL_FLOAT && !(value.floatValue >= attributes.minValue.floatValue && value.floatValue <= attributes.maxValue.floatValue))
+        {
+            return POA_ERROR_OUT_OF_LIMIT; //NaN too
+        }
+    }
+
+    error = POASetConfig(m_nCameraID, confID, value, isAuto ? POA_TRUE : POA_FALSE);
+
+    updateStateCache(confID, value, isAuto, error);
+
+    return error;
 }
 
-bool POACamera::getImageData(unsigned char *pDataBuffer, unsigned long size)
+void POACamera::updateStateCache(POAConfig confID, POAConfigValue value, bool isAuto, POAErrors error)
 {
-    long exposureUs = getExposure();
-    POAErrors error = POAGetImageData(m_nCameraID, pDataBuffer, size, exposureUs /1000 + 500);
+    switch(confID)
+    {
+    case POA_EXPOSURE:
+    case POA_EXP: //the same exposure, POA_EXP in seconds
+        if(error != POA_OK)
+        {
+            m_cache.isExposureValid = false;
+            break;
+        }
 
-    return error == POA_OK ? true : false;
+        // in auto mode the camera changes the exposure by itself, so the cached value is not valid,
+        // the longest possible exposure(POA_AUTOEXPO_MAX_EXPOSURE, ms) is used to work out the timeout
+        m_cache.exposureUs = confID == POA_EXP ? (long)(value.floatValue * 1000000.0 + 0.5) : value.intValue;
+        m_cache.isExposureAuto = isAuto;
+        m_cache.isExposureValid = !isAuto;
+
+        if(isAuto)
+        {
+            loadAutoMaxExposure();
+        }
+
+        m_lWaitExposureUs = isAuto ? m_cache.autoMaxExposureUs : m_cache.exposureUs;
+        break;
+    case POA_AUTOEXPO_MAX_EXPOSURE:
+        if(error == POA_OK)
+        {
+            m_cache.autoMaxExposureUs = value.intValue * 1000;
+
+            if(m_cache.isExposureAuto)
+            {
+                m_lWaitExposureUs = m_cache.autoMaxExposureUs;
+            }
+        }
+        break;
+    case POA_GAIN:
+        m_cache.gain = value.intValue;
+        m_cache.isGainValid = error == POA_OK && !isAuto;
+        break;
+    case POA_OFFSET:
+        m_cache.offset = value.intValue;
+        m_cache.isOffsetValid = error == POA_OK;
+        break;
+    default:
+        break;
+    }
 }
 
-bool POACamera::stopExposure()
+void POACamera::loadAutoMaxExposure()
 {
-    POAErrors error = POAStopExposure(m_nCameraID);
+    long maxExposureMs = 0;
+    bool isMaxAuto = false;
+    if(readTyped<POA_AUTOEXPO_MAX_EXPOSURE>(maxExposureMs, isMaxAuto) == POA_OK)
+    {
+        m_cache.autoMaxExposureUs = maxExposureMs * 1000;
+    }
+}
 
-    if(error != POA_OK)
+bool POACamera::setROIArea(const ROIArea &roiArea)
+{
+    if(isRefusedWhileCapturing("set ROI area"))
+    {
+        return false;
+    }
+
+    //set ROI Area, if exposing, please stop exposure first
+    stopExposureIfExposing();
+
+    if(!applyImageSize(roiArea.width, roiArea.height) || !applyImageStartPos(roiArea.startX, roiArea.startY))
     {
-        cerr << "stop exposure failed, error code: " << POAGetErrorString(error) << endl;
         return false;
     }
 
+    m_cache.isROIValid = false; //the SDK may adjust the size, read it back once
+    getROIArea();
+    updateFrameBytes();
+
     return true;
 }
 
-bool POACamera::closeCamera()
+ROIArea POACamera::getROIArea()
 {
-    POAErrors error = POACloseCamera(m_nCameraID);
+    if(m_cache.isROIValid)
+    {
+        return m_cache.roi;
+    }
+
+    ROIArea roiArea;
 
+    POAErrors error;
+    error = POAGetImageStartPos(m_nCameraID, &roiArea.startX, &roiArea.startY);
     if(error != POA_OK)
     {
-        cerr << "clsoe camera failed, error code: " << POAGetErrorString(error) << endl;
-        return false;
+        cerr << "get start position failed, error code: " << POAGetErrorString(error) << endl;
     }
 
-    return true;
-}
+    POAErrors sizeError = POAGetImageSize(m_nCameraID, &roiArea.width, &roiArea.height);
+    if(sizeError != POA_OK)
+    {
+        cerr << "get resolution failed, error code: " << POAGetErrorString(sizeError) << endl;
+    }
 
-int POACamera::getCameraID() const
-{
+    if(error == POA_OK && sizeError == POA_OK)
+    {
+        m_cache.roi = roiArea;
+        m_cache.isROIValid = true;
+    }
+
+    return roiArea;
+}
+
+bool POACamera::setImageSize(int width, int height)
+{
+    if(isRefusedWhileCapturing("set resolution"))
+    {
+        return false;
+    }
+
+    stopExposureIfExposing();
+
+    if(!applyImageSize(width, height))
+    {
+        return false;
+    }
+
+    getROIArea(); //the SDK may adjust the size, read it back once
+    updateFrameBytes();
+
+    return true;
+}
+
+bool POACamera::setImageStartPos(int startX, int startY)
+{
+    // the capture thread owns the start position while capturing(the tracking moves, Frame::startX and startY)
+    if(isRefusedWhileCapturing("set start position"))
+    {
+        return false;
+    }
+
+    return applyImageStartPos(startX, startY);
+}
+
+bool POACamera::setImageFormat(POACamera::ImageFormat imgFmt)
+{
+    if(isRefusedWhileCapturing("set image format"))
+    {
+        return false;
+    }
+
+    stopExposureIfExposing(); //should stop exposure first if exposing
+
+    if(!applyImageFormat(imgFmt))
+    {
+        return false;
+    }
+
+    updateFrameBytes();
+
+    return true;
+}
+
+POACamera::ImageFormat POACamera::getImageFormat()
+{
+    if(m_cache.isFormatValid)
+    {
+        return m_cache.imgFormat;
+    }
+
+    POAImgFormat poaImgFmt = POA_RAW8;
+
+    POAErrors error = POAGetImageFormat(m_nCameraID, &poaImgFmt);
+
+    if(error != POA_OK)
+    {
+        cerr << "get image format failed, error code: " << POAGetErrorString(error) << endl;
+        return RAW8;
+    }
+
+    m_cache.imgFormat = fromPOAImgFormat(poaImgFmt);
+    m_cache.isFormatValid = true;
+
+    return m_cache.imgFormat;
+}
+
+bool POACamera::setImageBin(int bin)
+{
+    if(isRefusedWhileCapturing("set bin"))
+    {
+        return false;
+    }
+
+    stopExposureIfExposing(); //should stop exposure first if exposing
+
+    if(!applyImageBin(bin))
+    {
+        return false;
+    }
+
+    updateFrameBytes();
+
+    return true;
+}
+
+int POACamera::getImageBin()
+{
+    if(m_cache.isBinValid)
+    {
+        return m_cache.bin;
+    }
+
+    int bin = 1;
+    POAErrors error = POAGetImageBin(m_nCameraID, &bin);
+    if(error != POA_OK)
+    {
+        cerr << "get bin failed, error code: " << POAGetErrorString(error) << endl;
+        return 1;
+    }
+
+    m_cache.bin = bin;
+    m_cache.isBinValid = true;
+
+    return bin;
+}
+
+bool POACamera::isRefusedWhileCapturing(const char *operation)
+{
+    // the capture thread and its ring have the frame bytes of the old format
+    if(m_bCapturing)
+    {
+        cerr << operation << " failed, the capture is running, stop it first or use CameraConfigTransaction" << endl;
+        return true;
+    }
+
+    return false;
+}
+
+bool POACamera::stopExposureIfExposing()
+{
+    POACameraState cameraState;
+
+    POAGetCameraState(m_nCameraID, &cameraState);
+
+    if(cameraState == STATE_EXPOSING)
+    {
+        POAStopExposure(m_nCameraID);
+        return true;
+    }
+
+    return false;
+}
+
+bool POACamera::applyImageSize(int width, int height)
+{
+    m_bTracking = false; //the tracking window has the old size
+    m_cache.isROIValid = false;
+
+    // set resolution
+    POAErrors error = POASetImageSize(m_nCameraID, width, height); //default resolution is maxWidth * maxHeight
+    if(error != POA_OK)
+    {
+        cerr << "set resolution failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool POACamera::applyImageStartPos(int startX, int startY)
+{
+    // set start position
+    POAErrors error = POASetImageStartPos(m_nCameraID, startX, startY); //default start position is (0, 0)
+    if(error != POA_OK)
+    {
+        cerr << "set start position failed, error code: " << POAGetErrorString(error) << endl;
+        m_cache.isROIValid = false;
+        return false;
+    }
+
+    if(m_cache.isROIValid)
+    {
+        m_cache.roi.startX = startX;
+        m_cache.roi.startY = startY;
+    }
+
+    return true;
+}
+
+bool POACamera::applyImageFormat(POACamera::ImageFormat imgFmt)
+{
+    POAImgFormat poaImgFmt = toPOAImgFormat(imgFmt);
+
+    POAErrors error = POASetImageFormat(m_nCameraID, poaImgFmt); //default image format is POA_RAW8
+    if(error != POA_OK)
+    {
+        cerr << "set image format failed, error code: " << POAGetErrorString(error) << endl;
+        m_cache.isFormatValid = false;
+        return false;
+    }
+
+    m_cache.imgFormat = imgFmt;
+    m_cache.isFormatValid = true;
+
+    return true;
+}
+
+bool POACamera::applyImageBin(int bin)
+{
+    m_bTracking = false;
+    m_cache.isROIValid = false; //after setting bin, the image size and start position will be changed
+
+    POAErrors error = POASetImageBin(m_nCameraID, bin); //default bin is 1
+    if(error != POA_OK)
+    {
+        cerr << "set bin failed, error code: " << POAGetErrorString(error) << endl;
+        m_cache.isBinValid = false;
+        return false;
+    }
+
+    m_cache.bin = bin;
+    m_cache.isBinValid = true;
+
+    return true;
+}
+
+void POACamera::invalidateCache()
+{
+    m_cache = StateCache();
+}
+
+bool POACamera::setExposure(long expoUs, bool isAuto)
+{
+    POAErrors error = writeTyped<POA_EXPOSURE>(expoUs, isAuto);
+
+    if(error != POA_OK)
+    {
+        cerr << "set exposure failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    return true; //the cache and the wait are updated by writeConfig()
+}
+
+long POACamera::getExposure()
+{
+    if(m_cache.isExposureValid)
+    {
+        return m_cache.exposureUs;
+    }
+
+    long expoUs = 0;
+
+    bool isAuto = false;
+
+    POAErrors error = readTyped<POA_EXPOSURE>(expoUs, isAuto);
+
+    if(error != POA_OK)
+    {
+        cerr << "get exposure failed, error code: " << POAGetErrorString(error) << endl;
+        return -1;
+    }
+
+    if(isAuto && (!m_cache.isExposureAuto || m_cache.autoMaxExposureUs == 0))
+    {
+        loadAutoMaxExposure(); //the auto mode was set by someone else, the timeout needs the maximum
+    }
+
+    m_cache.exposureUs = expoUs;
+    m_cache.isExposureAuto = isAuto;
+    m_cache.isExposureValid = !isAuto;
+
+    return expoUs;
+}
+
+bool POACamera::setGain(long gain, bool isAuto)
+{
+    POAErrors error = writeTyped<POA_GAIN>(gain, isAuto);
+
+    if(error != POA_OK)
+    {
+        cerr << "set gain failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+long POACamera::getGain()
+{
+    if(m_cache.isGainValid)
+    {
+        return m_cache.gain;
+    }
+
+    long gain = 0;
+
+    bool isAuto = false;
+
+    POAErrors error = readTyped<POA_GAIN>(gain, isAuto);
+
+    if(error != POA_OK)
+    {
+        cerr << "get gain failed, error code: " << POAGetErrorString(error) << endl;
+        return -1;
+    }
+
+    m_cache.gain = gain;
+    m_cache.isGainValid = !isAuto;
+
+    return gain;
+}
+
+bool POACamera::setOffset(long offset)
+{
+    POAErrors error = writeTyped<POA_OFFSET>(offset, false);
+
+    if(error != POA_OK)
+    {
+        cerr << "set offset failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+long POACamera::getOffset()
+{
+    if(m_cache.isOffsetValid)
+    {
+        return m_cache.offset;
+    }
+
+    long offset = 0;
+
+    bool isAuto = false;
+
+    POAErrors error = readTyped<POA_OFFSET>(offset, isAuto);
+
+    if(error != POA_OK)
+    {
+        cerr << "get offset failed, error code: " << POAGetErrorString(error) << endl;
+        return -1;
+    }
+
+    m_cache.offset = offset;
+    m_cache.isOffsetValid = true;
+
+    return offset;
+}
+
+bool POACamera::getTemperature(double &temperature)
+{
+    bool isAuto = false;
+
+    POAErrors error = readTyped<POA_TEMPERATURE>(temperature, isAuto);
+
+    if(error != POA_OK)
+    {
+        cerr << "get temperature failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+int POACamera::getSensorMode()
+{
+    int modeCount = 0;
+
+    POAErrors error = POAGetSensorModeCount(m_nCameraID, &modeCount);
+
+    if(error != POA_OK || modeCount <= 0)
+    {
+        return -1;
+    }
+
+    int modeIndex = -1;
+
+    error = POAGetSensorMode(m_nCameraID, &modeIndex);
+
+    if(error != POA_OK)
+    {
+        cerr << "get sensor mode failed, error code: " << POAGetErrorString(error) << endl;
+        return -1;
+    }
+
+    return modeIndex;
+}
+
+bool POACamera::getCoolerState(bool &isCoolerOn, long &targetTemperature)
+{
+    if(!hasConfig(POA_COOLER) || !hasConfig(POA_TARGET_TEMP)) //only the cooled cameras
+    {
+        return false;
+    }
+
+    bool isAuto = false;
+
+    POAErrors error = readTyped<POA_COOLER>(isCoolerOn, isAuto);
+
+    if(error == POA_OK)
+    {
+        error = readTyped<POA_TARGET_TEMP>(targetTemperature, isAuto);
+    }
+
+    if(error != POA_OK)
+    {
+        cerr << "get cooler state failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool POACamera::startExposure()
+{
+    POAErrors error = POAStartExposure(m_nCameraID, POA_FALSE); // continuously exposure
+
+    if(error != POA_OK)
+    {
+        cerr << "start exposure failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    m_lWaitExposureUs = expectedExposureUs(); // from the cache, not once per frame
+    m_lastReadyTime = std::chrono::steady_clock::now();
+
+    return true;
+}
+
+bool POACamera::isImgDataAvailable()
+{
+    POABool pIsReady = POA_FALSE;
+
+    POAErrors error = POAImageReady(m_nCameraID, &pIsReady);
+
+    if(error != POA_OK)
+    {
+        return false;
+    }
+
+    return pIsReady == POA_TRUE ? true : false;
+}
+
+void POACamera::setWaitStrategy(POACamera::WaitStrategy strategy)
+{
+    m_waitStrategy = strategy;
+}
+
+POACamera::WaitStrategy POACamera::getWaitStrategy() const
+{
+    return m_waitStrategy;
+}
+
+bool POACamera::waitImageReady(int timeoutMs)
+{
+    return waitReady(timeoutMs, nullptr);
+}
+
+WaitStats POACamera::getWaitStats() const
+{
+    WaitStats stats;
+    stats.waits = m_nWaits;
+    stats.polls = m_nWaitPolls;
+    stats.lastWakeLatencyUs = m_llLastWakeLatencyUs;
+    stats.avgWakeLatencyUs = stats.waits > 0 ? m_llTotalWakeLatencyUs / (long long)stats.waits : 0;
+    stats.maxWakeLatencyUs = m_llMaxWakeLatencyUs;
+
+    return stats;
+}
+
+bool POACamera::waitReady(int timeoutMs, const std::atomic<bool> *pKeepWaiting)
+{
+    using namespace std::chrono;
+
+    const microseconds maxSleepSlice(100000); // sleep at most 100ms at a time, so that the caller can stop waiting
+    const microseconds minPollInterval(50);
+
+    steady_clock::time_point beginTime = steady_clock::now();
+    steady_clock::time_point deadline = beginTime + milliseconds(timeoutMs);
+    steady_clock::time_point lastPollTime = beginTime;
+
+    long exposureUs = std::max(0L, m_lWaitExposureUs.load());
+    microseconds pollInterval(0);
+
+    if(m_waitStrategy == WAIT_HYBRID)
+    {
+        // the next frame can not be ready before one exposure after the last one, sleep most of that interval
+        steady_clock::time_point predicted = m_lastReadyTime + microseconds(exposureUs);
+        microseconds guard(std::max(2000L, exposureUs / 10));
+        steady_clock::time_point wakeTime = predicted - guard;
+
+        while(steady_clock::now() < wakeTime && steady_clock::now() < deadline)
+        {
+            if(pKeepWaiting && !*pKeepWaiting)
+            {
+                return false;
+            }
+
+            steady_clock::time_point now = steady_clock::now();
+            std::this_thread::sleep_for(std::min(maxSleepSlice, duration_cast<microseconds>(std::min(wakeTime, deadline) - now)));
+        }
+
+        pollInterval = guard / 4;
+    }
+    else if(m_waitStrategy == WAIT_SLEEP)
+    {
+        pollInterval = microseconds(std::max(1000L, exposureUs / 10));
+    }
+
+    unsigned long long polls = 0;
+
+    for(;;)
+    {
+        steady_clock::time_point pollTime = steady_clock::now();
+        polls++;
+
+        if(isImgDataAvailable())
+        {
+            // the frame got ready between the previous poll and this one, but not earlier than one exposure after the last frame
+            steady_clock::time_point earliestReady = std::max(lastPollTime, m_lastReadyTime + microseconds(exposureUs));
+            long long latencyUs = pollTime > earliestReady ? duration_cast<microseconds>(pollTime - earliestReady).count() : 0;
+            m_lastReadyTime = pollTime;
+            recordWake(latencyUs, polls);
+            return true;
+        }
+
+        lastPollTime = pollTime;
+
+        if(pollTime >= deadline || (pKeepWaiting && !*pKeepWaiting))
+        {
+            m_nWaitPolls += polls;
+            return false;
+        }
+
+        if(m_waitStrategy == WAIT_SPIN)
+        {
+            continue;
+        }
+
+        if(pollInterval >= microseconds(1000))
+        {
+            std::this_thread::sleep_for(std::min(pollInterval, maxSleepSlice));
+        }
+        else
+        {
+            std::this_thread::yield(); // the OS sleep is too coarse for such a short interval
+        }
+
+        if(m_waitStrategy == WAIT_HYBRID && pollInterval > minPollInterval)
+        {
+            pollInterval /= 2; // getting closer to the frame, poll more tightly
+        }
+    }
+}
+
+void POACamera::recordWake(long long latencyUs, unsigned long long polls)
+{
+    m_nWaits++;
+    m_nWaitPolls += polls;
+    m_llLastWakeLatencyUs = latencyUs;
+    m_llTotalWakeLatencyUs += latencyUs;
+
+    long long maxLatency = m_llMaxWakeLatencyUs;
+    while(latencyUs > maxLatency && !m_llMaxWakeLatencyUs.compare_exchange_weak(maxLatency, latencyUs))
+    {
+    }
+}
+
+bool POACamera::getImageData(unsigned char *pDataBuffer, unsigned long size)
+{
+    // the timeout comes from the cached state, so this is the only SDK call per frame
+    POAErrors error = POAGetImageData(m_nCameraID, pDataBuffer, size, (int)frameTimeoutMs());
+
+    return error == POA_OK ? true : false;
+}
+
+bool POACamera::stopExposure()
+{
+    POAErrors error = POAStopExposure(m_nCameraID);
+
+    if(error != POA_OK)
+    {
+        cerr << "stop exposure failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool POACamera::startCapture(int ringFrames)
+{
+    if(m_bCapturing)
+    {
+        return true;
+    }
+
+    if(ringFrames < 2)
+    {
+        ringFrames = 2;
+    }
+
+    m_nCaptureFrameBytes = currentFrameBytes();
+    if(m_nCaptureFrameBytes == 0)
+    {
+        cerr << "start capture failed, can not get the image size or format" << endl;
+        return false;
+    }
+
+    m_lCaptureTimeoutMs = frameTimeoutMs();
+
+    if(!updateCaptureFormat())
+    {
+        return false;
+    }
+
+    // the frames come from the pool, the capture thread never allocates memory. By default the pool has slabs for
+    // a full ring, the same number again for the frames held by the consumers, and one for the overrun
+    FrameRing<Frame> *pRing = captureRing(ringFrames);
+    int slabCount = (int)pRing->capacity() * 2 + 1;
+    if(m_framePool.slabCount() < slabCount && !initFramePool(slabCount, m_framePool.isHugePages()))
+    {
+        return false;
+    }
+
+    m_pCaptureRing = pRing;
+
+    m_pOverrunBuffer = m_framePool.acquire();
+    if(!m_pOverrunBuffer)
+    {
+        cerr << "start capture failed, no free frame in the pool" << endl;
+        releaseCaptureFrames();
+        return false;
+    }
+
+    m_nFramesCaptured = 0;
+    m_nFramesOverrun = 0;
+    m_nCaptureErrors = 0;
+    m_llFirstFrameTimeUs = 0;
+    m_llTrackingStart = packStartPos(m_captureFormat.startX, m_captureFormat.startY);
+    m_nTrackingNextMoveSeq = 0;
+    m_nTrackingFirstSeq = 0;
+
+    if(!startExposure())
+    {
+        releaseCaptureFrames();
+        return false;
+    }
+
+    m_bCapturing = true;
+    m_captureThread = std::thread(&POACamera::captureLoop, this);
+
+    return true;
+}
+
+bool POACamera::stopCapture()
+{
+    if(!m_bCapturing)
+    {
+        return true;
+    }
+
+    m_bCapturing = false;
+
+    if(m_captureThread.joinable())
+    {
+        m_captureThread.join(); //the thread exits after the current POAGetImageData returns(at most timeout)
+    }
+
+    releaseCaptureFrames();
+
+    // the window moved by the tracking, and the move the capture thread had not applied yet
+    if(m_cache.isROIValid)
+    {
+        m_cache.roi.startX = m_captureFormat.startX;
+        m_cache.roi.startY = m_captureFormat.startY;
+    }
+
+    long long pending = m_llTrackingPending.exchange(-1);
+    if(pending >= 0)
+    {
+        applyImageStartPos((int)(pending >> 32), (int)(pending & 0xFFFFFFFF));
+    }
+
+    return stopExposure();
+}
+
+void POACamera::releaseCaptureFrames()
+{
+    // the ring is not freed, a consumer may be in popFrame with it, the frames not popped are claimed the same way as
+    // popFrame does and go back to the pool
+    FrameRing<Frame> *pRing = m_pCaptureRing.exchange(nullptr);
+    if(pRing)
+    {
+        while(pRing->tryConsume([](Frame &frame)
+        {
+            frame.reset();
+        }))
+        {
+        }
+    }
+
+    m_framePool.recycle(m_pOverrunBuffer);
+    m_pOverrunBuffer = nullptr;
+}
+
+FrameRing<Frame> *POACamera::captureRing(int ringFrames)
+{
+    size_t capacity = FrameRing<Frame>::roundCapacity(ringFrames);
+
+    for(size_t i = 0; i < m_captureRings.size(); i++)
+    {
+        if(m_captureRings[i]->capacity() == capacity)
+        {
+            return m_captureRings[i].get();
+        }
+    }
+
+    m_captureRings.push_back(std::unique_ptr<FrameRing<Frame> >(new FrameRing<Frame>(capacity)));
+
+    return m_captureRings.back().get();
+}
+
+bool POACamera::initFramePool(int slabCount, bool useHugePages)
+{
+    POACameraProperties cameraProp;
+
+    POAErrors error = POAGetCameraPropertiesByID(m_nCameraID, &cameraProp);
+    if(error != POA_OK)
+    {
+        cerr << "init frame pool failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    if(!m_framePool.init(cameraProp, slabCount, useHugePages))
+    {
+        return false;
+    }
+
+    updateFrameBytes();
+
+    return true;
+}
+
+FramePool &POACamera::getFramePool()
+{
+    return m_framePool;
+}
+
+unsigned long POACamera::getFrameBytes()
+{
+    return currentFrameBytes();
+}
+
+void POACamera::updateFrameBytes()
+{
+    if(m_framePool.isInitialized())
+    {
+        m_framePool.setFrameBytes(currentFrameBytes()); //the slabs are big enough for any format and ROI, nothing is reallocated
+    }
+}
+
+bool POACamera::isCapturing() const
+{
+    return m_bCapturing;
+}
+
+bool POACamera::popFrame(Frame &frame)
+{
+    FrameRing<Frame> *pRing = m_pCaptureRing; //stays valid after stopCapture(), see captureRing()
+    if(!pRing)
+    {
+        return false;
+    }
+
+    return pRing->tryConsume([&](Frame &slot)
+    {
+        frame = std::move(slot); //no copy, the frame keeps the slab until it's released
+    });
+}
+
+bool POACamera::popFrame(unsigned char *pDataBuffer, unsigned long size, unsigned long long *pFrameSeq)
+{
+    FrameRing<Frame> *pRing = m_pCaptureRing;
+    if(!pRing || !pDataBuffer)
+    {
+        return false;
+    }
+
+    bool isSizeOK = true;
+    bool isPopped = pRing->tryConsume([&](Frame &slot)
+    {
+        if(size < slot.sizeBytes())
+        {
+            isSizeOK = false; // the frame is dropped, the same as POA_ERROR_SIZE_LESS
+        }
+        else
+        {
+            std::copy(slot.data(), slot.data() + slot.sizeBytes(), pDataBuffer);
+
+            if(pFrameSeq)
+            {
+                *pFrameSeq = slot.seq;
+            }
+        }
+
+        slot.reset();
+    });
+
+    if(isPopped && !isSizeOK)
+    {
+        cerr << "pop frame failed, the buffer size is not enough" << endl;
+        return false;
+    }
+
+    return isPopped;
+}
+
+CaptureStats POACamera::getCaptureStats()
+{
+    CaptureStats stats;
+    stats.framesCaptured = m_nFramesCaptured;
+    stats.framesOverrun = m_nFramesOverrun;
+    stats.captureErrors = m_nCaptureErrors;
+
+    int droppedCount = 0;
+    if(POAGetDroppedImagesCount(m_nCameraID, &droppedCount) == POA_OK)
+    {
+        stats.sdkDroppedFrames = droppedCount;
+    }
+
+    return stats;
+}
+
+bool POACamera::startTracking(const TrackingSettings &settings)
+{
+    if(settings.deadband < 0 || settings.minMoveFrames < 1)
+    {
+        cerr << "start tracking failed, invalid settings" << endl;
+        return false;
+    }
+
+    POACameraProperties cameraProp;
+
+    POAErrors error = POAGetCameraPropertiesByID(m_nCameraID, &cameraProp);
+    if(error != POA_OK)
+    {
+        cerr << "start tracking failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    // while capturing, the window of the capture thread, it may have been moved by an earlier tracking
+    ROIArea window;
+    int bin = 1;
+    if(m_bCapturing)
+    {
+        long long start = m_llTrackingStart;
+        window.startX = (int)(start >> 32);
+        window.startY = (int)(start & 0xFFFFFFFF);
+        window.width = m_captureFormat.width;
+        window.height = m_captureFormat.height;
+        bin = m_captureFormat.bin;
+    }
+    else
+    {
+        window = getROIArea();
+        bin = getImageBin();
+        m_llTrackingStart = packStartPos(window.startX, window.startY);
+    }
+
+    if(window.width <= 0 || window.height <= 0)
+    {
+        cerr << "start tracking failed, can not get the image size" << endl;
+        return false;
+    }
+
+    m_trackingWindow = window;
+    m_nTrackingMaxStartX = std::max(cameraProp.maxWidth / bin - window.width, 0);
+    m_nTrackingMaxStartY = std::max(cameraProp.maxHeight / bin - window.height, 0);
+    m_nTrackingDeadband = settings.deadband;
+    m_nTrackingMinMoveFrames = settings.minMoveFrames;
+
+    m_llTrackingPending = -1;
+    m_nTrackingRequests = 0;
+    m_nTrackingHeld = 0;
+    m_nTrackingCoalesced = 0;
+    m_nTrackingMoves = 0;
+    m_nTrackingMoveErrors = 0;
+    m_llTrackingLastLatencyUs = 0;
+    m_llTrackingTotalLatencyUs = 0;
+    m_llTrackingMaxLatencyUs = 0;
+
+    m_bTracking = true;
+
+    return true;
+}
+
+void POACamera::stopTracking()
+{
+    m_bTracking = false;
+    m_llTrackingPending = -1; //the move not applied yet is dropped
+}
+
+bool POACamera::isTracking() const
+{
+    return m_bTracking;
+}
+
+bool POACamera::updateTrackingTarget(double targetX, double targetY)
+{
+    if(!m_bTracking)
+    {
+        return false;
+    }
+
+    m_nTrackingRequests++;
+
+    // hysteresis: the window stays until the target leaves the deadband, then it's centred on the target
+    ROIArea &window = m_trackingWindow;
+    double offsetX = targetX - (window.startX + window.width / 2.0);
+    double offsetY = targetY - (window.startY + window.height / 2.0);
+    if(std::fabs(offsetX) <= m_nTrackingDeadband && std::fabs(offsetY) <= m_nTrackingDeadband)
+    {
+        m_nTrackingHeld++;
+        return false;
+    }
+
+    // even, so the bayer pattern of the window doesn't change
+    int startX = std::min(std::max((int)std::lround(targetX - window.width / 2.0), 0), m_nTrackingMaxStartX) / 2 * 2;
+    int startY = std::min(std::max((int)std::lround(targetY - window.height / 2.0), 0), m_nTrackingMaxStartY) / 2 * 2;
+    if(startX == window.startX && startY == window.startY) //at the edge of the sensor
+    {
+        m_nTrackingHeld++;
+        return false;
+    }
+
+    window.startX = startX;
+    window.startY = startY;
+
+    if(m_bCapturing)
+    {
+        m_llTrackingPendingTimeUs = steadyNowUs();
+        if(m_llTrackingPending.exchange(packStartPos(startX, startY)) >= 0)
+        {
+            m_nTrackingCoalesced++;
+        }
+        return true;
+    }
+
+    long long requestTimeUs = steadyNowUs();
+    if(!applyImageStartPos(startX, startY))
+    {
+        m_nTrackingMoveErrors++;
+        return false;
+    }
+
+    long long latencyUs = steadyNowUs() - requestTimeUs;
+    m_llTrackingStart = packStartPos(startX, startY);
+    m_llTrackingLastLatencyUs = latencyUs;
+    m_llTrackingTotalLatencyUs += latencyUs;
+    m_llTrackingMaxLatencyUs = std::max(m_llTrackingMaxLatencyUs.load(), latencyUs);
+    m_nTrackingMoves++;
+
+    return true;
+}
+
+TrackingStats POACamera::getTrackingStats() const
+{
+    TrackingStats stats;
+    stats.requests = m_nTrackingRequests;
+    stats.held = m_nTrackingHeld;
+    stats.coalesced = m_nTrackingCoalesced;
+    stats.moves = m_nTrackingMoves;
+    stats.moveErrors = m_nTrackingMoveErrors;
+    stats.firstSeq = m_nTrackingFirstSeq;
+
+    long long start = m_llTrackingStart;
+    stats.startX = (int)(start >> 32);
+    stats.startY = (int)(start & 0xFFFFFFFF);
+    stats.lastMoveLatencyUs = m_llTrackingLastLatencyUs;
+    stats.avgMoveLatencyUs = stats.moves > 0 ? m_llTrackingTotalLatencyUs / (long long)stats.moves : 0;
+    stats.maxMoveLatencyUs = m_llTrackingMaxLatencyUs;
+
+    return stats;
+}
+
+void POACamera::applyTrackingMove(unsigned long long seq)
+{
+    // rate limit: the pending move waits, a newer target replaces it
+    if(seq < m_nTrackingNextMoveSeq || m_llTrackingPending.load(std::memory_order_relaxed) < 0)
+    {
+        return;
+    }
+
+    long long pending = m_llTrackingPending.exchange(-1);
+    if(pending < 0)
+    {
+        return;
+    }
+
+    int startX = (int)(pending >> 32);
+    int startY = (int)(pending & 0xFFFFFFFF);
+    if(POASetImageStartPos(m_nCameraID, startX, startY) != POA_OK)
+    {
+        m_nTrackingMoveErrors++;
+        return;
+    }
+
+    // only the capture thread reads the capture format while capturing
+    m_captureFormat.startX = startX;
+    m_captureFormat.startY = startY;
+    m_nTrackingNextMoveSeq = seq + m_nTrackingMinMoveFrames;
+    m_nTrackingFirstSeq = seq + 1;
+    m_llTrackingStart = pending;
+
+    long long latencyUs = steadyNowUs() - m_llTrackingPendingTimeUs;
+    m_llTrackingLastLatencyUs = latencyUs;
+    m_llTrackingTotalLatencyUs += latencyUs;
+    m_llTrackingMaxLatencyUs = std::max(m_llTrackingMaxLatencyUs.load(), latencyUs);
+    m_nTrackingMoves++;
+}
+
+void POACamera::captureLoop()
+{
+    FrameRing<Frame> *pRing = m_pCaptureRing;
+    unsigned long long seq = 0;
+
+    while(m_bCapturing)
+    {
+        if(m_bTracking)
+        {
+            applyTrackingMove(seq); //between 2 frames, the frames after seq come from the new window
+        }
+
+        if(!waitReady((int)m_lCaptureTimeoutMs, &m_bCapturing))
+        {
+            continue;
+        }
+
+        long long timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+
+        Frame *pSlot = pRing->beginPush();
+        FrameBuffer *pBuffer = pSlot ? m_framePool.acquireBuffer() : nullptr;
+
+        // if the ring is full or the consumers hold all the frames, still drain the camera so that
+        // the SDK doesn't drop frames, the newest frame is discarded
+        unsigned char *pBuf = pBuffer ? pBuffer->data : m_pOverrunBuffer;
+
+        POAErrors error = POAGetImageData(m_nCameraID, pBuf, (long)m_nCaptureFrameBytes, (int)m_lCaptureTimeoutMs);
+
+        if(error != POA_OK)
+        {
+            if(error != POA_ERROR_TIMEOUT)
+            {
+                m_nCaptureErrors++;
+            }
+            m_framePool.recycle(pBuffer);
+            continue;
+        }
+
+        seq++;
+
+        if(seq == 1)
+        {
+            m_llFirstFrameTimeUs = steadyNowUs();
+        }
+
+        if(!pBuffer)
+        {
+            m_nFramesOverrun++;
+            continue;
+        }
+
+        Frame frame = Frame::fromBuffer(pBuffer, m_captureFormat.width, m_captureFormat.height,
+                                        m_captureFormat.imgFormat, m_captureFormat.bayerPattern);
+        frame.bin = m_captureFormat.bin;
+        frame.startX = m_captureFormat.startX;
+        frame.startY = m_captureFormat.startY;
+        frame.exposureUs = m_lWaitExposureUs;
+        frame.timestampUs = timestampUs;
+        frame.seq = seq;
+
+        *pSlot = std::move(frame);
+        pRing->commitPush();
+        m_nFramesCaptured++;
+    }
+}
+
+bool POACamera::updateCaptureFormat()
+{
+    POACameraProperties cameraProp;
+
+    POAErrors error = POAGetCameraPropertiesByID(m_nCameraID, &cameraProp);
+    if(error != POA_OK)
+    {
+        cerr << "get camera properties failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    ROIArea roiArea = getROIArea();
+
+    m_captureFormat.width = roiArea.width;
+    m_captureFormat.height = roiArea.height;
+    m_captureFormat.startX = roiArea.startX;
+    m_captureFormat.startY = roiArea.startY;
+    m_captureFormat.bin = getImageBin();
+    m_captureFormat.imgFormat = toPOAImgFormat(getImageFormat());
+    m_captureFormat.bayerPattern = cameraProp.isColorCamera ? cameraProp.bayerPattern : POA_BAYER_MONO;
+
+    // the color camera loses the bayer pattern after binning with POA_MONO_BIN
+    if(m_captureFormat.bin > 1 && m_captureFormat.bayerPattern != POA_BAYER_MONO)
+    {
+        bool isMonoBin = false;
+        bool isAuto = false;
+        if(readTyped<POA_MONO_BIN>(isMonoBin, isAuto) == POA_OK && isMonoBin)
+        {
+            m_captureFormat.bayerPattern = POA_BAYER_MONO;
+        }
+    }
+
+    return true;
+}
+
+unsigned long POACamera::currentFrameBytes()
+{
+    ROIArea roiArea = getROIArea();
+    ImageFormat imgFmt = getImageFormat();
+
+    unsigned long pixelBytes = 1; //RAW8, MONO8
+    if(imgFmt == RAW16)
+    {
+        pixelBytes = 2;
+    }
+    else if(imgFmt == RGB888)
+    {
+        pixelBytes = 3;
+    }
+
+    return (unsigned long)roiArea.width * roiArea.height * pixelBytes;
+}
+
+long POACamera::expectedExposureUs()
+{
+    if(!m_cache.isExposureAuto)
+    {
+        long exposureUs = getExposure(); //finds the auto mode if the cache is empty
+        if(!m_cache.isExposureAuto)
+        {
+            return exposureUs;
+        }
+    }
+
+    return m_cache.autoMaxExposureUs;
+}
+
+long POACamera::frameTimeoutMs()
+{
+    long exposureUs = expectedExposureUs();
+
+    return (exposureUs > 0 ? exposureUs / 1000 : 0) + 500;
+}
+
+bool POACamera::closeCamera()
+{
+    stopCapture();
+
+    invalidateCache();
+    m_configCache = ConfigCache();
+
+    POAErrors error = POACloseCamera(m_nCameraID);
+
+    if(error != POA_OK)
+    {
+        cerr << "clsoe camera failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+int POACamera::getCameraID() const
+{
     return m_nCameraID;
 }
 
+bool POACamera::getCameraProperties(POACameraProperties &cameraProp)
+{
+    POAErrors error = POAGetCameraPropertiesByID(m_nCameraID, &cameraProp);
+    if(error != POA_OK)
+    {
+        cerr << "get camera properties failed, error code: " << POAGetErrorString(error) << endl;
+        return false;
+    }
+
+    return true;
+}
+
 void POACamera::setCameraID(int nCameraID)
 {
     m_nCameraID = nCameraID;
+    m_configCache = ConfigCache();
 }
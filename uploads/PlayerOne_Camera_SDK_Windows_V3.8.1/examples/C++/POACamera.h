@@ -3,6 +3,16 @@
 
 #include <map>
 #include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <chrono>
+
+#include "FrameRing.h"
+#include "FramePool.h"
+#include "Frame.h"
+#include "POAConfigTraits.h"
 
 using namespace std;
 
@@ -28,8 +38,88 @@ struct ROIArea //custom a ROI rectangle area
     }
 };
 
+struct CaptureStats //statistics of the capture thread
+{
+    unsigned long long framesCaptured; //frames pushed into the ring
+    unsigned long long framesOverrun;  //frames read from the camera but discarded because the ring was full
+    unsigned long long captureErrors;  //POAGetImageData failed or timeout
+    int sdkDroppedFrames;              //POAGetDroppedImagesCount
+
+    CaptureStats()
+    {
+        framesCaptured = 0;
+        framesOverrun = 0;
+        captureErrors = 0;
+        sdkDroppedFrames = 0;
+    }
+};
+
+struct WaitStats //statistics of waitImageReady
+{
+    unsigned long long waits;              //the count of successful waits
+    unsigned long long polls;              //the count of POAImageReady calls
+    long long lastWakeLatencyUs;           //estimated time between the frame became ready and it was seen
+    long long avgWakeLatencyUs;
+    long long maxWakeLatencyUs;
+
+    WaitStats()
+    {
+        waits = 0;
+        polls = 0;
+        lastWakeLatencyUs = 0;
+        avgWakeLatencyUs = 0;
+        maxWakeLatencyUs = 0;
+    }
+};
+
+struct TrackingSettings //the tracking ROI mode of POACamera
+{
+    int deadband;      //pixels, the window moves when the target is further than this from its centre
+    int minMoveFrames; //at least this many frames between 2 moves of the window
+
+    TrackingSettings()
+    {
+        deadband = 8;
+        minMoveFrames = 2;
+    }
+};
+
+struct TrackingStats //statistics of the tracking ROI mode
+{
+    unsigned long long requests;   //updateTrackingTarget calls
+    unsigned long long held;       //the target was inside the deadband, the window did not move
+    unsigned long long coalesced;  //replaced by a newer target before it was applied(rate limit)
+    unsigned long long moves;      //POASetImageStartPos calls
+    unsigned long long moveErrors;
+    unsigned long long firstSeq;   //the seq of the first frame of the current window, 0 before the first move
+    int startX;                    //the current window
+    int startY;
+    long long lastMoveLatencyUs;   //from updateTrackingTarget to POASetImageStartPos
+    long long avgMoveLatencyUs;
+    long long maxMoveLatencyUs;
+
+    TrackingStats()
+    {
+        requests = 0;
+        held = 0;
+        coalesced = 0;
+        moves = 0;
+        moveErrors = 0;
+        firstSeq = 0;
+        startX = 0;
+        startY = 0;
+        lastMoveLatencyUs = 0;
+        avgMoveLatencyUs = 0;
+        maxMoveLatencyUs = 0;
+    }
+};
+
+class CameraConfigTransaction;
+
 class POACamera
 {
+    friend class CameraConfigTransaction;
+
 public:
     POACamera();
 
@@ -48,12 +138,83 @@ public:
         MONO8
     };
 
+    enum WaitStrategy //how to wait for POAImageReady
+    {
+        WAIT_SPIN,   //poll POAImageReady continuously, lowest latency, takes a whole CPU core
+        WAIT_HYBRID, //sleep most of the predicted exposure, then poll with progressively shorter sleeps
+        WAIT_SLEEP   //poll every 1/10 exposure(at least 1ms), lowest CPU usage
+    };
+
 
     bool openCamera();
 
     bool initCamera();
 
-    void getAllConfigAttributes();
+    void getAllConfigAttributes(); //print the attributes of the configs
+
+    // The attributes of all the configs(POAConfigAttributes) are loaded once by initCamera() into a table indexed by
+    // POAConfig, the typed getters and setters below check the value type, the access and the range with them, so
+    // every call is one SDK call and a value out of the range is refused(POA_ERROR_OUT_OF_LIMIT) without calling the SDK
+    // called by initCamera(), call it if the camera was initialized outside this class, until then the calls below ask the
+    // SDK without the cache(the load is not retried by them)
+    bool loadConfigAttributes();
+
+    bool hasConfig(POAConfig confID); //the camera has the config, eg: POA_COOLER only on a cooled camera
+
+    const POAConfigAttributes *getConfigAttributes(POAConfig confID); //nullptr if the camera doesn't have the config or it's not loaded
+
+    bool getConfigRange(POAConfig confID, long &minValue, long &maxValue, long &defaultValue); //VAL_INT
+
+    bool getConfigRange(POAConfig confID, double &minValue, double &maxValue, double &defaultValue); //VAL_FLOAT
+
+    bool getConfig(POAConfig confID, long &value, bool *pIsAuto = nullptr); //VAL_INT, eg: POA_GAIN
+
+    bool getConfig(POAConfig confID, double &value, bool *pIsAuto = nullptr); //VAL_FLOAT, eg: POA_EXP, POA_TEMPERATURE
+
+    bool getConfig(POAConfig confID, bool &isEnable); //VAL_BOOL, eg: POA_COOLER
+
+    bool setConfig(POAConfig confID, long value, bool isAuto); //VAL_INT, eg: setConfig(POA_GAIN, 100L, false)
+
+    bool setConfig(POAConfig confID, double value, bool isAuto); //VAL_FLOAT, eg: setConfig(POA_EXP, 0.5, false)
+
+    bool setConfig(POAConfig confID, bool isEnable); //VAL_BOOL, eg: setConfig(POA_PIXEL_BIN_SUM, true)
+
+    // The same with the POAConfig known at compile time, the type of the value comes from POAConfigTraits.h, so a wrong
+    // type or writing a read-only config doesn't compile, eg: long gain; get<POA_GAIN>(gain); set<POA_EXP>(0.5);
+    // set<>() updates the cache of getExposure(), getGain() and getOffset() as the setters do
+    template<POAConfig CONF>
+    bool get(typename POAConfigTraits<CONF>::Type &value, bool *pIsAuto = nullptr)
+    {
+        bool isAuto = false;
+        POAErrors error = readTyped<CONF>(value, isAuto);
+
+        if(error != POA_OK)
+        {
+            printConfigError("get", CONF, error);
+            return false;
+        }
+
+        if(pIsAuto)
+        {
+            *pIsAuto = isAuto;
+        }
+
+        return true;
+    }
+
+    template<POAConfig CONF>
+    bool set(typename POAConfigTraits<CONF>::Type value, bool isAuto = false)
+    {
+        POAErrors error = writeTyped<CONF>(value, isAuto);
+
+        if(error != POA_OK)
+        {
+            printConfigError("set", CONF, error);
+            return false;
+        }
+
+        return true;
+    }
 
     bool setROIArea(const ROIArea &roiArea);
 
@@ -67,6 +228,15 @@ public:
 
     ImageFormat getImageFormat();
 
+    bool setImageBin(int bin); //note: after setting bin, the image size and start position will be changed
+
+    // every setter above stops the exposure by itself, to change several of them at once(and keep the stream or the
+    // capture thread running) use CameraConfigTransaction, which stops and restarts the stream only once.
+    // The setters above return false while capturing, CameraConfigTransaction restarts the capture thread with the new
+    // settings, the tracking ROI mode(updateTrackingTarget) moves the window between the frames
+
+    int getImageBin();
+
     bool setExposure(long expoUs, bool isAuto); //Microsecond
 
     long getExposure();
@@ -75,22 +245,281 @@ public:
 
     long getGain();
 
+    bool setOffset(long offset);
+
+    long getOffset();
+
+    bool getTemperature(double &temperature); //the sensor temperature in Celsius, it's not cached
+
+    int getSensorMode(); //the index of the sensor mode, -1 if the camera has no sensor modes, it's not cached
+
+    bool getCoolerState(bool &isCoolerOn, long &targetTemperature); //POA_COOLER and POA_TARGET_TEMP(Celsius), false if the camera has no cooler, it's not cached
+
     bool startExposure();
 
     bool isImgDataAvailable();
 
+    void setWaitStrategy(WaitStrategy strategy); //default is WAIT_HYBRID
+
+    WaitStrategy getWaitStrategy() const;
+
+    bool waitImageReady(int timeoutMs); //wait until the image data is available, return false if timeout
+
+    WaitStats getWaitStats() const;
+
     bool getImageData(unsigned char *pDataBuffer, unsigned long size);
 
     bool stopExposure();
 
+    // Capture thread mode(opt-in): the camera owns a thread that keeps draining POAGetImageData into a ring of
+    // pre-allocated frames, consumers call popFrame from any thread, popFrame never locks and never blocks.
+    // After stopCapture() popFrame returns false and the frames not popped are back in the pool, the ring itself is
+    // kept(a consumer may still be in popFrame) and reused by the next startCapture of the same ringFrames
+    bool startCapture(int ringFrames = 8); //start continuous exposure and the capture thread
+
+    bool stopCapture();
+
+    bool isCapturing() const;
+
+    bool popFrame(Frame &frame); //zero-copy, the frame holds a slab of the frame pool until it(and its copies) is released
+
+    bool popFrame(unsigned char *pDataBuffer, unsigned long size, unsigned long long *pFrameSeq = nullptr); //copy the frame, return false if no frame
+
+    CaptureStats getCaptureStats();
+
+    // Tracking ROI mode: the window follows a target(eg: the centroid of a guide star or a planet) by moving its start
+    // position only(POASetImageStartPos), the size and the stream don't change. The window moves when the target is out
+    // of the deadband around its centre, it's centred on the target, rounded to even and kept on the sensor.
+    // In capture thread mode the move is applied by the capture thread between 2 frames, at most once every
+    // minMoveFrames(a newer target replaces the one not applied yet), the frames after the move(seq >= firstSeq of
+    // TrackingStats) have the new Frame::startX and startY, this assumes POASetImageStartPos restarts the frame in
+    // progress. Otherwise the window moves at once.
+    // Changing the size or the bin stops the tracking, updateTrackingTarget is called by one thread(eg: the consumer).
+    bool startTracking(const TrackingSettings &settings = TrackingSettings());
+
+    void stopTracking();
+
+    bool isTracking() const;
+
+    // the target in the pixels of the current bin on the sensor(eg: frame.startX + x), return true if the window moves
+    bool updateTrackingTarget(double targetX, double targetY);
+
+    TrackingStats getTrackingStats() const;
+
+    // The frame buffers are taken from a pool of slabs sized for the largest frame of this camera, so
+    // changing the format, ROI or bin never reallocates, startCapture() initializes it if needed
+    bool initFramePool(int slabCount, bool useHugePages = false);
+
+    FramePool &getFramePool();
+
+    unsigned long getFrameBytes(); //the size of the current frame: width * height * bytes per pixel
+
     bool closeCamera();
 
     int getCameraID() const;
 
+    bool getCameraProperties(POACameraProperties &cameraProp);
+
     void setCameraID(int nCameraID);
 
+    // The setters keep a copy of the camera state(exposure, gain, offset, ROI, format, bin), so the getters and the hot path
+    // don't query the SDK, call this if the camera was changed outside this class(eg: calling the C API directly)
+    void invalidateCache();
+
 private:
+    struct CaptureFormat //the description of the captured frames
+    {
+        int width;
+        int height;
+        int startX;
+        int startY;
+        int bin;
+        POAImgFormat imgFormat;
+        POABayerPattern bayerPattern;
+    };
+
+    static const int CONFIG_COUNT = POA_EXP + 1; //the POAConfig known by this class
+
+    struct ConfigCache //the attributes of the configs, they don't change while the camera is open
+    {
+        bool isLoaded;
+        bool hasConfig[CONFIG_COUNT];
+        POAConfigAttributes attributes[CONFIG_COUNT];
+
+        ConfigCache()
+        {
+            isLoaded = false;
+            for(int i = 0; i < CONFIG_COUNT; i++)
+            {
+                hasConfig[i] = false;
+            }
+        }
+    };
+
+    POAErrors checkConfig(POAConfig confID, POAValueType valueType, bool isWrite); //with the attributes, without calling the SDK
+
+    // the attributes from the cache, or from the SDK into sdkAttributes if the cache is not loaded, nullptr if there is none
+    const POAConfigAttributes *findConfigAttributes(POAConfig confID, POAConfigAttributes &sdkAttributes);
+
+    POAErrors readConfig(POAConfig confID, POAValueType valueType, POAConfigValue &value, bool &isAuto);
+
+    POAErrors writeConfig(POAConfig confID, POAValueType valueType, POAConfigValue value, bool isAuto); //the range is checked, the state cache is updated
+
+    void updateStateCache(POAConfig confID, POAConfigValue value, bool isAuto, POAErrors error); //after a write of the SDK
+
+    void loadAutoMaxExposure(); //POA_AUTOEXPO_MAX_EXPOSURE into the state cache
+
+    template<POAConfig CONF>
+    POAErrors readTyped(typename POAConfigTraits<CONF>::Type &value, bool &isAuto)
+    {
+        POAConfigValue confValue;
+        POAErrors error = readConfig(CONF, POAConfigTraits<CONF>::valueType, confValue, isAuto);
+
+        if(error == POA_OK)
+        {
+            value = POAConfigTraits<CONF>::get(confValue);
+        }
+
+        return error;
+    }
+
+    template<POAConfig CONF>
+    POAErrors writeTyped(typename POAConfigTraits<CONF>::Type value, bool isAuto)
+    {
+        static_assert(POAConfigTraits<CONF>::isWritable, "the POAConfig is read-only");
+
+        return writeConfig(CONF, POAConfigTraits<CONF>::valueType, POAConfigTraits<CONF>::make(value), isAuto);
+    }
+
+    void printConfigError(const char *operation, POAConfig confID, POAErrors error);
+
+    bool stopExposureIfExposing(); //one POAGetCameraState, return true if the exposure was stopped
+
+    bool isRefusedWhileCapturing(const char *operation); //print the error and return true if the capture is running
+
+    // the SDK call and the cache of the setters, the caller stops the exposure and reads the ROI back
+    bool applyImageSize(int width, int height);
+
+    bool applyImageStartPos(int startX, int startY);
+
+    bool applyImageFormat(ImageFormat imgFmt);
+
+    bool applyImageBin(int bin);
+
+    void applyTrackingMove(unsigned long long seq); //the capture thread, after the frame seq
+
+    static long long packStartPos(int startX, int startY) { return ((long long)startX << 32) | (unsigned int)startY; }
+
+    void captureLoop();
+
+    void releaseCaptureFrames();
+
+    FrameRing<Frame> *captureRing(int ringFrames); //the ring of the capacity, made once
+
+    bool updateCaptureFormat();
+
+    void updateFrameBytes();
+
+    bool waitReady(int timeoutMs, const std::atomic<bool> *pKeepWaiting);
+
+    void recordWake(long long latencyUs, unsigned long long polls);
+
+    unsigned long currentFrameBytes();
+
+    long expectedExposureUs(); //the cached exposure, or the maximum exposure in auto mode
+
+    long frameTimeoutMs(); //the POAGetImageData timeout: exposure + 500ms
+
+    struct StateCache
+    {
+        bool isExposureValid;
+        bool isExposureAuto;
+        long exposureUs;
+        long autoMaxExposureUs; //POA_AUTOEXPO_MAX_EXPOSURE, used as exposure in auto mode
+
+        bool isGainValid;
+        long gain;
+
+        bool isOffsetValid;
+        long offset;
+
+        bool isROIValid;
+        ROIArea roi;
+
+        bool isFormatValid;
+        ImageFormat imgFormat;
+
+        bool isBinValid;
+        int bin;
+
+        StateCache()
+        {
+            isExposureValid = false;
+            isExposureAuto = false;
+            exposureUs = 0;
+            autoMaxExposureUs = 0;
+            isGainValid = false;
+            gain = 0;
+            isOffsetValid = false;
+            offset = 0;
+            isROIValid = false;
+            isFormatValid = false;
+            imgFormat = RAW8;
+            isBinValid = false;
+            bin = 1;
+        }
+    };
+
     int m_nCameraID;
+
+    StateCache m_cache;
+
+    ConfigCache m_configCache;
+
+    std::atomic<FrameRing<Frame> *> m_pCaptureRing; //of the running capture, nullptr when stopped
+    std::vector<std::unique_ptr<FrameRing<Frame> > > m_captureRings; //one per capacity, kept until the camera is destroyed
+    CaptureFormat m_captureFormat;
+    std::thread m_captureThread;
+    std::atomic<bool> m_bCapturing;
+    FramePool m_framePool;
+    unsigned char *m_pOverrunBuffer; //the frames that do not fit in the ring are drained into here
+    unsigned long m_nCaptureFrameBytes;
+    long m_lCaptureTimeoutMs;
+
+    std::atomic<unsigned long long> m_nFramesCaptured;
+    std::atomic<unsigned long long> m_nFramesOverrun;
+    std::atomic<unsigned long long> m_nCaptureErrors;
+    std::atomic<long long> m_llFirstFrameTimeUs; //steady clock, when the capture thread got its first frame, 0 before
+
+    std::atomic<bool> m_bTracking;
+    std::atomic<int> m_nTrackingMinMoveFrames;
+    int m_nTrackingDeadband;
+    ROIArea m_trackingWindow;             //the window decided by updateTrackingTarget(pending or applied)
+    int m_nTrackingMaxStartX;
+    int m_nTrackingMaxStartY;
+    std::atomic<long long> m_llTrackingPending;       //packStartPos of the move not applied yet, -1 if none
+    std::atomic<long long> m_llTrackingPendingTimeUs; //steady clock, when the pending move was requested
+    unsigned long long m_nTrackingNextMoveSeq;        //capture thread, the rate limit
+    std::atomic<unsigned long long> m_nTrackingRequests;
+    std::atomic<unsigned long long> m_nTrackingHeld;
+    std::atomic<unsigned long long> m_nTrackingCoalesced;
+    std::atomic<unsigned long long> m_nTrackingMoves;
+    std::atomic<unsigned long long> m_nTrackingMoveErrors;
+    std::atomic<unsigned long long> m_nTrackingFirstSeq;
+    std::atomic<long long> m_llTrackingStart;          //packStartPos of the applied window
+    std::atomic<long long> m_llTrackingLastLatencyUs;
+    std::atomic<long long> m_llTrackingTotalLatencyUs;
+    std::atomic<long long> m_llTrackingMaxLatencyUs;
+
+    WaitStrategy m_waitStrategy;
+    std::atomic<long> m_lWaitExposureUs; //exposure used to predict when the next frame is ready, it's updated by the writes of the exposure
+    std::chrono::steady_clock::time_point m_lastReadyTime; //when the last frame was seen ready, or the exposure started
+
+    std::atomic<unsigned long long> m_nWaits;
+    std::atomic<unsigned long long> m_nWaitPolls;
+    std::atomic<long long> m_llLastWakeLatencyUs;
+    std::atomic<long long> m_llTotalWakeLatencyUs;
+    std::atomic<long long> m_llMaxWakeLatencyUs;
 };
 
 #endif // POACAMERA_H
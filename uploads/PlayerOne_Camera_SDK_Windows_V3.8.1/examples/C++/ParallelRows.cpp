@@ -0,0 +1,116 @@
+#include <algorithm>
+#include "ParallelRows.h"
+
+using namespace std;
+
+ParallelRows::ParallelRows(int threadCount)
+    : m_nGeneration(0), m_nBusyWorkers(0), m_bStop(false), m_pRowFunc(nullptr), m_nRowCount(0), m_nTileRows(1), m_nTileCount(0), m_nNextTile(0)
+{
+    if(threadCount <= 0)
+    {
+        threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    m_nThreadCount = threadCount;
+
+    for(int i = 1; i < threadCount; i++) //the calling thread is the first one
+    {
+        m_workers.push_back(std::thread(&ParallelRows::workerLoop, this));
+    }
+}
+
+ParallelRows::~ParallelRows()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_startCond.notify_all();
+
+    for(size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }
+}
+
+int ParallelRows::threadCount() const
+{
+    return m_nThreadCount;
+}
+
+void ParallelRows::run(int rowCount, const RowFunc &rowFunc, int tileRows)
+{
+    if(rowCount <= 0)
+    {
+        return;
+    }
+
+    if(tileRows <= 0)
+    {
+        tileRows = std::max(1, rowCount / (m_nThreadCount * 4));
+    }
+
+    if(m_workers.empty() || tileRows >= rowCount) //one tile, no need to wake up the workers
+    {
+        rowFunc(0, rowCount);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pRowFunc = &rowFunc;
+        m_nRowCount = rowCount;
+        m_nTileRows = tileRows;
+        m_nTileCount = (rowCount + tileRows - 1) / tileRows;
+        m_nNextTile = 0;
+        m_nBusyWorkers = (int)m_workers.size();
+        m_nGeneration++;
+    }
+    m_startCond.notify_all();
+
+    runTiles();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCond.wait(lock, [this]() { return m_nBusyWorkers == 0; });
+    m_pRowFunc = nullptr;
+}
+
+void ParallelRows::runTiles()
+{
+    for(;;)
+    {
+        int tile = m_nNextTile.fetch_add(1);
+        if(tile >= m_nTileCount)
+        {
+            break;
+        }
+
+        int rowBegin = tile * m_nTileRows;
+        (*m_pRowFunc)(rowBegin, std::min(rowBegin + m_nTileRows, m_nRowCount));
+    }
+}
+
+void ParallelRows::workerLoop()
+{
+    unsigned long long generation = 0;
+
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCond.wait(lock, [this, generation]() { return m_nGeneration != generation || m_bStop; });
+            if(m_bStop)
+            {
+                return;
+            }
+            generation = m_nGeneration;
+        }
+
+        runTiles();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_nBusyWorkers--;
+        }
+        m_doneCond.notify_one();
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef PARALLELROWS_H
+#define PARALLELROWS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*******************************************************************************
+Runs a function over the rows of an image split into tiles(bands of rows) on all
+cores. The threads are created once and sleep between the runs, so a run costs a
+wake-up, not a thread creation, and nothing is allocated per run.
+The tiles are handed out by an atomic counter, a thread that finishes its tile takes
+the next one, so the load is balanced even if some rows cost more. The calling thread
+works on the tiles too, run() returns when all the tiles are done.
+The row function must only write the rows of its tile.
+*******************************************************************************/
+
+class ParallelRows
+{
+public:
+    typedef std::function<void(int rowBegin, int rowEnd)> RowFunc;
+
+    explicit ParallelRows(int threadCount = 0); //0: all cores(std::thread::hardware_concurrency)
+
+    ~ParallelRows();
+
+    int threadCount() const; //the calling thread included
+
+    // tileRows: the rows of a tile, 0: about 4 tiles per thread
+    void run(int rowCount, const RowFunc &rowFunc, int tileRows = 0);
+
+private:
+    ParallelRows(const ParallelRows &);
+    ParallelRows &operator=(const ParallelRows &);
+
+    void workerLoop();
+
+    void runTiles(); //take the tiles until there is none left
+
+    std::vector<std::thread> m_workers;
+    int m_nThreadCount;
+
+    std::mutex m_mutex;
+    std::condition_variable m_startCond;
+    std::condition_variable m_doneCond;
+    unsigned long long m_nGeneration; //incremented by every run, the workers wait for a new one
+    int m_nBusyWorkers;
+    bool m_bStop;
+
+    const RowFunc *m_pRowFunc;
+    int m_nRowCount;
+    int m_nTileRows;
+    int m_nTileCount;
+    std::atomic<int> m_nNextTile;
+};
+
+#endif // PARALLELROWS_H
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include "PhaseCorrelator.h"
+
+using namespace std;
+
+static const double PI = 3.14159265358979323846;
+static const double PEAK_SIGMA = 1.0; //pixels, the width of the correlation peak after the low pass
+
+// the offset of the top of a parabola through -1, 0, 1, the log of a gaussian is a parabola
+static double refinePeak(double left, double center, double right)
+{
+    if(left > 0.0 && center > 0.0 && right > 0.0)
+    {
+        left = log(left);
+        center = log(center);
+        right = log(right);
+    }
+
+    double denominator = left - 2.0 * center + right;
+    if(denominator >= 0.0) //not a maximum
+    {
+        return 0.0;
+    }
+
+    return std::min(1.0, std::max(-1.0, 0.5 * (left - right) / denominator));
+}
+
+PhaseCorrelator::PhaseCorrelator()
+    : m_bHasReference(false), m_lowPassSum(1.0)
+{
+}
+
+bool PhaseCorrelator::init(int tileWidth, int tileHeight)
+{
+    m_bHasReference = false;
+    if(!m_fft.init(tileWidth, tileHeight))
+    {
+        return false;
+    }
+
+    m_windowX.resize(tileWidth);
+    for(int x = 0; x < tileWidth; x++)
+    {
+        m_windowX[x] = (float)(0.5 - 0.5 * cos(2.0 * PI * (x + 0.5) / tileWidth));
+    }
+    m_windowY.resize(tileHeight);
+    for(int y = 0; y < tileHeight; y++)
+    {
+        m_windowY[y] = (float)(0.5 - 0.5 * cos(2.0 * PI * (y + 0.5) / tileHeight));
+    }
+
+    // exp(-2 pi^2 sigma^2 f^2) is the spectrum of a gaussian of sigma pixels, f: cycles per pixel
+    double sumU = 0.0;
+    m_lowPassU.resize(tileWidth);
+    for(int u = 0; u < tileWidth; u++)
+    {
+        double f = (double)(u <= tileWidth / 2 ? u : u - tileWidth) / tileWidth;
+        m_lowPassU[u] = (float)exp(-2.0 * PI * PI * PEAK_SIGMA * PEAK_SIGMA * f * f);
+        sumU += m_lowPassU[u];
+    }
+    double sumV = 0.0;
+    m_lowPassV.resize(m_fft.spectrumColumns());
+    for(int v = 0; v < m_fft.spectrumColumns(); v++)
+    {
+        double f = (double)v / tileHeight;
+        m_lowPassV[v] = (float)exp(-2.0 * PI * PI * PEAK_SIGMA * PEAK_SIGMA * f * f);
+        sumV += (v == 0 || v == tileHeight / 2) ? m_lowPassV[v] : 2.0 * m_lowPassV[v]; //the conjugate half is not stored
+    }
+    m_lowPassSum = sumU * sumV;
+
+    m_referenceRe.resize((size_t)tileWidth * m_fft.spectrumColumns());
+    m_referenceIm.resize((size_t)tileWidth * m_fft.spectrumColumns());
+
+    return true;
+}
+
+bool PhaseCorrelator::setSimdLevel(SimdLevel level)
+{
+    return m_fft.setSimdLevel(level);
+}
+
+SimdLevel PhaseCorrelator::getSimdLevel() const
+{
+    return m_fft.getSimdLevel();
+}
+
+int PhaseCorrelator::tileWidth() const
+{
+    return m_fft.width();
+}
+
+int PhaseCorrelator::tileHeight() const
+{
+    return m_fft.height();
+}
+
+bool PhaseCorrelator::hasReference() const
+{
+    return m_bHasReference;
+}
+
+template <typename T>
+void PhaseCorrelator::loadRows(const Frame &frame, int x0, int y0, bool isBayer)
+{
+    const int tileWidth = m_fft.width();
+    const int tileHeight = m_fft.height();
+    double sums[4] = { 0.0, 0.0, 0.0, 0.0 }; //per bayer cell position
+
+    for(int y = 0; y < tileHeight; y++)
+    {
+        const T *pRow = (const T *)frame.row(y0 + y);
+        float *pDst = m_fft.inputRow(y);
+        for(int x = 0; x < tileWidth; x++)
+        {
+            pDst[x] = (float)pRow[x0 + x];
+        }
+
+        double *pSums = sums + (y & 1) * 2;
+        for(int x = 0; x < tileWidth; x += 2)
+        {
+            pSums[0] += pDst[x];
+            pSums[1] += pDst[x + 1];
+        }
+    }
+
+    // the colors of a bayer frame are scaled to the same mean, then the mosaic is gone where the color doesn't change
+    const double cellPixels = (double)tileWidth * tileHeight / 4.0;
+    const double mean = (sums[0] + sums[1] + sums[2] + sums[3]) / (4.0 * cellPixels);
+    float gains[4];
+    for(int i = 0; i < 4; i++)
+    {
+        double cellMean = isBayer ? sums[i] / cellPixels : mean;
+        gains[i] = cellMean > 0.0 ? (float)(mean / cellMean) : 1.0f;
+    }
+
+    for(int y = 0; y < tileHeight; y++)
+    {
+        float *pDst = m_fft.inputRow(y);
+        const float *pGains = gains + (y & 1) * 2;
+        for(int x = 0; x < tileWidth; x++)
+        {
+            pDst[x] = (pDst[x] * pGains[x & 1] - (float)mean) * m_windowX[x] * m_windowY[y];
+        }
+    }
+}
+
+bool PhaseCorrelator::loadTile(const Frame &frame)
+{
+    POAImgFormat imgFormat = frame.imgFormat();
+    if(m_fft.width() == 0 || !frame.isValid() || (imgFormat != POA_RAW8 && imgFormat != POA_RAW16 && imgFormat != POA_MONO8))
+    {
+        cerr << "load tile failed, not initialized or the format is not RAW8, RAW16 or MONO8" << endl;
+        return false;
+    }
+
+    if(frame.width() < m_fft.width() || frame.height() < m_fft.height())
+    {
+        cerr << "load tile failed, the frame is smaller than the tile, " << frame.width() << " x " << frame.height() << endl;
+        return false;
+    }
+
+    int x0 = (frame.width() - m_fft.width()) / 2;
+    int y0 = (frame.height() - m_fft.height()) / 2;
+    bool isBayer = frame.bayerPattern() != POA_BAYER_MONO && imgFormat != POA_MONO8;
+    if(imgFormat == POA_RAW16)
+    {
+        loadRows<uint16_t>(frame, x0, y0, isBayer);
+    }
+    else
+    {
+        loadRows<unsigned char>(frame, x0, y0, isBayer);
+    }
+
+    return true;
+}
+
+bool PhaseCorrelator::setReference(const Frame &frame)
+{
+    if(!loadTile(frame))
+    {
+        return false;
+    }
+
+    m_fft.forward();
+
+    const int columns = m_fft.spectrumColumns();
+    for(int u = 0; u < m_fft.width(); u++)
+    {
+        std::copy(m_fft.spectrumRe(u), m_fft.spectrumRe(u) + columns, m_referenceRe.begin() + (size_t)u * columns);
+        std::copy(m_fft.spectrumIm(u), m_fft.spectrumIm(u) + columns, m_referenceIm.begin() + (size_t)u * columns);
+    }
+    m_bHasReference = true;
+
+    return true;
+}
+
+double PhaseCorrelator::peakValue(int x, int y)
+{
+    x = (x + m_fft.width()) % m_fft.width();
+    y = (y + m_fft.height()) % m_fft.height();
+
+    return m_fft.inputRow(y)[x];
+}
+
+bool PhaseCorrelator::align(const Frame &frame, PhaseShift &shift)
+{
+    if(!m_bHasReference)
+    {
+        cerr << "align failed, no reference" << endl;
+        return false;
+    }
+
+    if(!loadTile(frame))
+    {
+        return false;
+    }
+
+    m_fft.forward();
+
+    // the normalized cross power spectrum, weighted by the low pass
+    const int columns = m_fft.spectrumColumns();
+    for(int u = 0; u < m_fft.width(); u++)
+    {
+        float *pRe = m_fft.spectrumRe(u);
+        float *pIm = m_fft.spectrumIm(u);
+        const float *pRefRe = m_referenceRe.data() + (size_t)u * columns;
+        const float *pRefIm = m_referenceIm.data() + (size_t)u * columns;
+        for(int v = 0; v < columns; v++)
+        {
+            float re = pRe[v] * pRefRe[v] + pIm[v] * pRefIm[v];
+            float im = pIm[v] * pRefRe[v] - pRe[v] * pRefIm[v];
+            float magnitude = sqrt(re * re + im * im);
+            float scale = magnitude > 0.0f ? m_lowPassU[u] * m_lowPassV[v] / magnitude : 0.0f;
+            pRe[v] = re * scale;
+            pIm[v] = im * scale;
+        }
+    }
+
+    m_fft.inverse();
+
+    int peakX = 0, peakY = 0;
+    float peak = m_fft.inputRow(0)[0];
+    for(int y = 0; y < m_fft.height(); y++)
+    {
+        const float *pRow = m_fft.inputRow(y);
+        for(int x = 0; x < m_fft.width(); x++)
+        {
+            if(pRow[x] > peak)
+            {
+                peak = pRow[x];
+                peakX = x;
+                peakY = y;
+            }
+        }
+    }
+
+    double offsetX = refinePeak(peakValue(peakX - 1, peakY), peak, peakValue(peakX + 1, peakY));
+    double offsetY = refinePeak(peakValue(peakX, peakY - 1), peak, peakValue(peakX, peakY + 1));
+
+    // the peak wraps around: past the half of the tile it's a negative shift
+    shift.dx = (peakX > m_fft.width() / 2 ? peakX - m_fft.width() : peakX) + offsetX;
+    shift.dy = (peakY > m_fft.height() / 2 ? peakY - m_fft.height() : peakY) + offsetY;
+    shift.peak = peak / m_lowPassSum;
+
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef PHASECORRELATOR_H
+#define PHASECORRELATOR_H
+
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "CpuFeatures.h"
+#include "Frame.h"
+#include "Fft.h"
+
+/*******************************************************************************
+Translation-only registration of the frames of a planetary or lunar stream by phase
+correlation: the shift of a frame from the reference is the peak of the inverse FFT
+of the normalized cross power spectrum F(frame) * conj(F(reference)) / |...|.
+The tile(tileWidth x tileHeight, see RealFft2D::isSupportedSize, eg: 256 x 256) is
+taken from the center of the frame, pass a view(Frame::view) to register on another
+part of the image, eg: the disc of the planet(FrameQuality::getDisc()) or an ROI.
+The mean is removed and a Hann window applied, so the edges of the tile don't
+correlate. The 4 pixels of the bayer cell of the RAW8 / RAW16 color frames are
+scaled to the same mean(the gray world), so the bayer pattern doesn't give a false
+peak at the zero shift and the shift keeps the full resolution.
+Sub-pixel: the cross power spectrum is weighted by a gaussian low pass, the peak
+becomes a gaussian of about 1 pixel, and its center is found by fitting a parabola
+to the log of the peak and its neighbours in x and in y(exact for a gaussian).
+All the FFTs use the SIMD kernels of the best level of the CPU(see Fft.h).
+*******************************************************************************/
+
+struct PhaseShift
+{
+    double dx;      //the content of the frame moved by dx, dy pixels from the reference(positive: right, down)
+    double dy;
+    double peak;    //the height of the correlation peak, about 1 for the same image, near 0: no match
+
+    PhaseShift()
+    {
+        dx = 0.0;
+        dy = 0.0;
+        peak = 0.0;
+    }
+};
+
+class PhaseCorrelator
+{
+public:
+    PhaseCorrelator();
+
+    bool init(int tileWidth, int tileHeight); //allocate the FFT planes, the reference is cleared
+
+    bool setSimdLevel(SimdLevel level); //eg: SIMD_SCALAR to compare with the reference, return false if it's not available
+
+    SimdLevel getSimdLevel() const;
+
+    // RAW8, RAW16 or MONO8, at least the size of the tile, the tile at the center of the frame is the reference
+    bool setReference(const Frame &frame);
+
+    bool hasReference() const;
+
+    bool align(const Frame &frame, PhaseShift &shift); //the shift of the tile at the center of the frame
+
+    int tileWidth() const;
+
+    int tileHeight() const;
+
+private:
+    PhaseCorrelator(const PhaseCorrelator &);
+    PhaseCorrelator &operator=(const PhaseCorrelator &);
+
+    bool loadTile(const Frame &frame); //into the input of the FFT, windowed
+
+    template <typename T>
+    void loadRows(const Frame &frame, int x0, int y0, bool isBayer); //the tile at x0, y0
+
+    double peakValue(int x, int y); //the correlation at x, y wrapped around the tile
+
+    RealFft2D m_fft;
+    bool m_bHasReference;
+    std::vector<float> m_windowX;   //Hann
+    std::vector<float> m_windowY;
+    std::vector<float> m_lowPassU;  //the gaussian low pass of the x frequencies, separable
+    std::vector<float> m_lowPassV;
+    double m_lowPassSum;            //the peak of the identical tiles
+    std::vector<float> m_referenceRe;
+    std::vector<float> m_referenceIm;
+};
+
+#endif // PHASECORRELATOR_H
@@ -0,0 +1,365 @@
+#include <iostream>
+#include <cstring>
+#include <ctime>
+#include <cerrno>
+#include <chrono>
+#include "SerWriter.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#endif
+
+using namespace std;
+
+static const long long TICKS_PER_US = 10; //the SER time is in ticks of 100ns since 0001-01-01
+static const long long TICKS_TO_1970 = 621355968000000000LL;
+
+static int serColorID(POAImgFormat imgFormat, POABayerPattern bayerPattern)
+{
+    if(imgFormat == POA_RGB24)
+    {
+        return 101; //BGR
+    }
+
+    switch (bayerPattern)
+    {
+    case POA_BAYER_RG:
+        return 8;
+    case POA_BAYER_GR:
+        return 9;
+    case POA_BAYER_GB:
+        return 10;
+    case POA_BAYER_BG:
+        return 11;
+    default:
+        return 0; //MONO
+    }
+}
+
+static void putInt32(unsigned char *p, int value)
+{
+    uint32_t v = (uint32_t)value;
+    for(int i = 0; i < 4; i++)
+    {
+        p[i] = (unsigned char)(v >> (8 * i));
+    }
+}
+
+static void putInt64(unsigned char *p, long long value)
+{
+    uint64_t v = (uint64_t)value;
+    for(int i = 0; i < 8; i++)
+    {
+        p[i] = (unsigned char)(v >> (8 * i));
+    }
+}
+
+static void putString(unsigned char *p, const std::string &value, size_t size)
+{
+    memset(p, 0, size);
+    memcpy(p, value.data(), value.size() < size ? value.size() : size);
+}
+
+static long long toSerTime(long long timestampUs)
+{
+    return timestampUs * TICKS_PER_US + TICKS_TO_1970;
+}
+
+static long long localOffsetUs(long long timestampUs) //local time - UTC
+{
+    time_t utcTime = (time_t)(timestampUs / 1000000);
+    struct tm localTm = *localtime(&utcTime);
+    struct tm utcTm = *gmtime(&utcTime);
+    utcTm.tm_isdst = localTm.tm_isdst;
+
+    return (long long)(utcTime - mktime(&utcTm)) * 1000000;
+}
+
+static long long nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+SerWriter::SerWriter()
+{
+#if defined(_WIN32)
+    m_hFile = INVALID_HANDLE_VALUE;
+#else
+    m_nFile = -1;
+#endif
+    m_nWidth = 0;
+    m_nHeight = 0;
+    m_imgFormat = POA_END;
+    m_bayerPattern = POA_BAYER_MONO;
+    m_nFrameBytes = 0;
+    m_nFrameCount = 0;
+}
+
+SerWriter::~SerWriter()
+{
+    if(isOpen())
+    {
+        close();
+    }
+}
+
+void SerWriter::setObserver(const std::string &observer)
+{
+    m_strObserver = observer;
+}
+
+void SerWriter::setInstrument(const std::string &instrument)
+{
+    m_strInstrument = instrument;
+}
+
+void SerWriter::setTelescope(const std::string &telescope)
+{
+    m_strTelescope = telescope;
+}
+
+bool SerWriter::open(const std::string &fileName, int width, int height, POAImgFormat imgFormat, POABayerPattern bayerPattern, int reserveFrames)
+{
+    if(isOpen())
+    {
+        cerr << "open ser file failed, the writer is already open" << endl;
+        return false;
+    }
+
+    if(width <= 0 || height <= 0 || (imgFormat != POA_RAW8 && imgFormat != POA_RAW16 && imgFormat != POA_RGB24 && imgFormat != POA_MONO8))
+    {
+        cerr << "open ser file failed, invalid frame size or format" << endl;
+        return false;
+    }
+
+    m_strFileName = fileName;
+    m_nWidth = width;
+    m_nHeight = height;
+    m_imgFormat = imgFormat;
+    m_bayerPattern = imgFormat == POA_RAW8 || imgFormat == POA_RAW16 ? bayerPattern : POA_BAYER_MONO;
+    m_nFrameBytes = (size_t)width * height * FramePool::bytesPerPixel(imgFormat);
+    m_nFrameCount = 0;
+    m_timestamps.clear();
+    m_timestamps.reserve(reserveFrames > 0 ? reserveFrames : 0);
+
+    unsigned long long reserveBytes = reserveFrames > 0 ? HEADER_BYTES + (unsigned long long)reserveFrames * (m_nFrameBytes + sizeof(long long)) : 0;
+
+#if defined(_WIN32)
+    m_hFile = CreateFileA(fileName.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(m_hFile == INVALID_HANDLE_VALUE)
+    {
+        cerr << "open ser file failed, can't create the file: " << fileName << endl;
+        return false;
+    }
+
+    if(reserveBytes > 0) //set the end of file once, the clusters are allocated here instead of at every frame
+    {
+        LARGE_INTEGER size;
+        size.QuadPart = (LONGLONG)reserveBytes;
+        LARGE_INTEGER begin;
+        begin.QuadPart = 0;
+        if(!SetFilePointerEx(m_hFile, size, nullptr, FILE_BEGIN) || !SetEndOfFile(m_hFile) || !SetFilePointerEx(m_hFile, begin, nullptr, FILE_BEGIN))
+        {
+            cerr << "preallocate ser file failed, the file grows frame by frame" << endl;
+        }
+    }
+#else
+    m_nFile = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(m_nFile < 0)
+    {
+        cerr << "open ser file failed, can't create the file: " << fileName << endl;
+        return false;
+    }
+
+#if defined(__linux__)
+    if(reserveBytes > 0 && posix_fallocate(m_nFile, 0, (off_t)reserveBytes) != 0)
+    {
+        cerr << "preallocate ser file failed, the file grows frame by frame" << endl;
+    }
+#endif
+#endif
+
+    // the header is written again with the frame count and the dates in close()
+    if(!writeHeader())
+    {
+        closeFile();
+        return false;
+    }
+
+    return true;
+}
+
+bool SerWriter::write(const Frame &frame)
+{
+    if(!isOpen())
+    {
+        return false;
+    }
+
+    if(frame.width() != m_nWidth || frame.height() != m_nHeight || frame.imgFormat() != m_imgFormat)
+    {
+        cerr << "write ser frame failed, the frame size or format differs from the file" << endl;
+        return false;
+    }
+
+    bool isOK = true;
+    if(frame.isContiguous())
+    {
+        isOK = writeBytes(frame.data(), m_nFrameBytes);
+    }
+    else
+    {
+        for(int y = 0; y < m_nHeight && isOK; y++)
+        {
+            isOK = writeBytes(frame.row(y), frame.rowBytes());
+        }
+    }
+
+    if(!isOK)
+    {
+        cerr << "write ser frame failed, can't write the file: " << m_strFileName << endl;
+        return false;
+    }
+
+    m_timestamps.push_back(frame.timestampUs > 0 ? frame.timestampUs : nowUs());
+    m_nFrameCount++;
+
+    return true;
+}
+
+bool SerWriter::close()
+{
+    if(!isOpen())
+    {
+        return false;
+    }
+
+    // the trailer: the UTC timestamp of every frame
+    bool isOK = true;
+    if(!m_timestamps.empty())
+    {
+        std::vector<unsigned char> trailer(m_timestamps.size() * sizeof(long long));
+        for(size_t i = 0; i < m_timestamps.size(); i++)
+        {
+            putInt64(trailer.data() + i * sizeof(long long), toSerTime(m_timestamps[i]));
+        }
+        isOK = writeBytes(trailer.data(), trailer.size());
+    }
+
+    unsigned long long fileBytes = HEADER_BYTES + (unsigned long long)m_nFrameCount * m_nFrameBytes + m_timestamps.size() * sizeof(long long);
+
+#if defined(_WIN32)
+    LARGE_INTEGER size;
+    size.QuadPart = (LONGLONG)fileBytes;
+    LARGE_INTEGER begin;
+    begin.QuadPart = 0;
+    isOK = isOK && SetFilePointerEx(m_hFile, size, nullptr, FILE_BEGIN) && SetEndOfFile(m_hFile)
+            && SetFilePointerEx(m_hFile, begin, nullptr, FILE_BEGIN);
+#else
+    isOK = isOK && ftruncate(m_nFile, (off_t)fileBytes) == 0 && lseek(m_nFile, 0, SEEK_SET) == 0;
+#endif
+
+    isOK = isOK && writeHeader();
+
+    closeFile();
+
+    if(!isOK)
+    {
+        cerr << "close ser file failed, can't write the file: " << m_strFileName << endl;
+    }
+
+    return isOK;
+}
+
+bool SerWriter::isOpen() const
+{
+#if defined(_WIN32)
+    return m_hFile != INVALID_HANDLE_VALUE;
+#else
+    return m_nFile >= 0;
+#endif
+}
+
+int SerWriter::frameCount() const
+{
+    return m_nFrameCount;
+}
+
+unsigned long long SerWriter::bytesWritten() const
+{
+    return (unsigned long long)m_nFrameCount * m_nFrameBytes;
+}
+
+size_t SerWriter::frameBytes() const
+{
+    return m_nFrameBytes;
+}
+
+bool SerWriter::writeBytes(const void *pData, size_t size)
+{
+    const char *p = (const char *)pData;
+
+    while(size > 0)
+    {
+#if defined(_WIN32)
+        DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+        DWORD written = 0;
+        if(!WriteFile(m_hFile, p, chunk, &written, nullptr) || written == 0)
+        {
+            return false;
+        }
+#else
+        ssize_t written = ::write(m_nFile, p, size);
+        if(written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(written <= 0)
+        {
+            return false;
+        }
+#endif
+        p += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+bool SerWriter::writeHeader()
+{
+    unsigned char header[HEADER_BYTES];
+
+    memcpy(header, "LUCAM-RECORDER", 14);
+    putInt32(header + 14, 0);                                       //LuID
+    putInt32(header + 18, serColorID(m_imgFormat, m_bayerPattern)); //ColorID
+    putInt32(header + 22, 0);                                       //LittleEndian, 0: little endian as most software reads it(the spec says the opposite)
+    putInt32(header + 26, m_nWidth);
+    putInt32(header + 30, m_nHeight);
+    putInt32(header + 34, m_imgFormat == POA_RAW16 ? 16 : 8);       //PixelDepthPerPlane
+    putInt32(header + 38, m_nFrameCount);
+    putString(header + 42, m_strObserver, 40);
+    putString(header + 82, m_strInstrument, 40);
+    putString(header + 122, m_strTelescope, 40);
+
+    long long startUs = m_timestamps.empty() ? nowUs() : m_timestamps[0];
+    putInt64(header + 162, toSerTime(startUs + localOffsetUs(startUs))); //DateTime, local
+    putInt64(header + 170, toSerTime(startUs));                          //DateTime_UTC
+
+    return writeBytes(header, HEADER_BYTES);
+}
+
+void SerWriter::closeFile()
+{
+#if defined(_WIN32)
+    CloseHandle(m_hFile);
+    m_hFile = INVALID_HANDLE_VALUE;
+#else
+    ::close(m_nFile);
+    m_nFile = -1;
+#endif
+}
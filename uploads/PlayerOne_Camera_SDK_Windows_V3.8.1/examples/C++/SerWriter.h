@@ -0,0 +1,87 @@
+#ifndef SERWRITER_H
+#define SERWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "Frame.h"
+
+/*******************************************************************************
+A writer of SER sequences(the video format of the planetary capture and stacking
+software), all the frames of a capture go into one file:
+a header of 178 bytes, the frames back to back, then a table of the UTC timestamps
+of the frames(8 bytes each).
+The file is preallocated for the expected frame count in open(), so the file system
+doesn't extend it at every frame, and truncated to the real size in close().
+The frames are written straight from their buffers(eg: the frames of popFrame)
+with one system call per frame, there is no copy and no stream buffer.
+RAW8, RAW16(little endian), MONO8 and RGB24(B G R) are supported, all the frames
+of a file must have the same size and format.
+*******************************************************************************/
+
+class SerWriter
+{
+public:
+    SerWriter();
+
+    ~SerWriter(); //close the file if it's open
+
+    // the strings of the header, 40 chars at most, call them before open()
+    void setObserver(const std::string &observer);
+
+    void setInstrument(const std::string &instrument);
+
+    void setTelescope(const std::string &telescope);
+
+    // create the file, reserveFrames: the expected frame count, the file is preallocated for it(0: no preallocation)
+    bool open(const std::string &fileName, int width, int height, POAImgFormat imgFormat, POABayerPattern bayerPattern, int reserveFrames = 0);
+
+    bool write(const Frame &frame); //append a frame, it must have the size and format given to open()
+
+    bool close(); //write the timestamps and the final header, then truncate the file
+
+    bool isOpen() const;
+
+    int frameCount() const;
+
+    unsigned long long bytesWritten() const; //the bytes of the frames written so far
+
+    size_t frameBytes() const;
+
+    static const size_t HEADER_BYTES = 178;
+
+private:
+    SerWriter(const SerWriter &);
+    SerWriter &operator=(const SerWriter &);
+
+    bool writeBytes(const void *pData, size_t size);
+
+    bool writeHeader();
+
+    void closeFile();
+
+#if defined(_WIN32)
+    void *m_hFile;
+#else
+    int m_nFile;
+#endif
+
+    std::string m_strFileName;
+    std::string m_strObserver;
+    std::string m_strInstrument;
+    std::string m_strTelescope;
+
+    int m_nWidth;
+    int m_nHeight;
+    POAImgFormat m_imgFormat;
+    POABayerPattern m_bayerPattern;
+    size_t m_nFrameBytes;
+
+    int m_nFrameCount;
+    std::vector<long long> m_timestamps; //UTC, microseconds since 1970-01-01, reserved in open()
+};
+
+#endif // SERWRITER_H
@@ -0,0 +1,29 @@
+# the SIMD kernel sources are named by their instruction set: *_SSE41.cpp, *_AVX2.cpp, *_AVX512.cpp,
+# each one is built with the flags of its set, the best kernel is picked at run time(see CpuFeatures.h).
+# GCC and Clang don't fuse a multiply and an add(-mavx512f enables FMA), so the kernels give the same results
+# as the scalar code
+function(poa_set_simd_flags)
+    if(NOT CMAKE_SYSTEM_PROCESSOR MATCHES "^(x86_64|AMD64|amd64|i[3-6]86|x86|X86)$")
+        return() # not x86, the kernels are built empty and only the scalar code is used
+    endif()
+
+    foreach(src ${ARGN})
+        if(src MATCHES "_SSE41\\.cpp$")
+            if(NOT MSVC) # MSVC needs no flag for SSE4.1
+                set_source_files_properties(${src} PROPERTIES COMPILE_FLAGS "-msse4.1 -ffp-contract=off")
+            endif()
+        elseif(src MATCHES "_AVX2\\.cpp$")
+            if(MSVC)
+                set_source_files_properties(${src} PROPERTIES COMPILE_FLAGS "/arch:AVX2")
+            else()
+                set_source_files_properties(${src} PROPERTIES COMPILE_FLAGS "-mavx2 -ffp-contract=off")
+            endif()
+        elseif(src MATCHES "_AVX512\\.cpp$")
+            if(MSVC)
+                set_source_files_properties(${src} PROPERTIES COMPILE_FLAGS "/arch:AVX512")
+            else()
+                set_source_files_properties(${src} PROPERTIES COMPILE_FLAGS "-mavx512f -mavx512bw -ffp-contract=off")
+            endif()
+        endif()
+    endforeach()
+endfunction()
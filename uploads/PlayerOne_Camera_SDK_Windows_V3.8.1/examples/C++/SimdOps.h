@@ -0,0 +1,515 @@
+#ifndef SIMDOPS_H
+#define SIMDOPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+/*******************************************************************************
+Thin wrappers of the SSE4.1 / AVX2 / AVX-512 intrinsics, so a kernel template is
+written once and instantiated for each instruction set.
+Only include it from the source file of one SIMD level(eg: Debayer_AVX2.cpp),
+after defining POA_SIMD_SSE41, POA_SIMD_AVX2 or POA_SIMD_AVX512, and compile that
+file with the flags of the level. Everything is in the namespace of the level,
+so the code built with different flags never gets merged by the linker.
+
+VecU8 / VecU16: the pixels at their own width, VecI32: the pixels widened to int,
+VecF32: the pixels and the 16 bit planes converted to float, and the float planes.
+*******************************************************************************/
+
+#if defined(POA_SIMD_AVX512)
+#define POA_SIMD_NAMESPACE simd_avx512
+#if defined(__GNUC__) && !defined(__clang__)
+// false warnings from the AVX-512 intrinsics of GCC 12(bug 105593)
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#elif defined(POA_SIMD_AVX2)
+#define POA_SIMD_NAMESPACE simd_avx2
+#elif defined(POA_SIMD_SSE41)
+#define POA_SIMD_NAMESPACE simd_sse41
+#else
+#error "define POA_SIMD_SSE41, POA_SIMD_AVX2 or POA_SIMD_AVX512 before including SimdOps.h"
+#endif
+
+namespace POA_SIMD_NAMESPACE
+{
+
+// 16 pixels of 3 planes -> 48 bytes of c0 c1 c2 c0 c1 c2 ... in o0, o1, o2
+static inline void interleaveBytes3(__m128i c0, __m128i c1, __m128i c2, __m128i &o0, __m128i &o1, __m128i &o2)
+{
+    const __m128i m00 = _mm_setr_epi8(0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128, 5);
+    const __m128i m01 = _mm_setr_epi8(-128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128);
+    const __m128i m02 = _mm_setr_epi8(-128, -128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128);
+    const __m128i m10 = _mm_setr_epi8(-128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10, -128);
+    const __m128i m11 = _mm_setr_epi8(5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10);
+    const __m128i m12 = _mm_setr_epi8(-128, 5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128);
+    const __m128i m20 = _mm_setr_epi8(-128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128, -128);
+    const __m128i m21 = _mm_setr_epi8(-128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128);
+    const __m128i m22 = _mm_setr_epi8(10, -128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15);
+
+    o0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m00), _mm_shuffle_epi8(c1, m01)), _mm_shuffle_epi8(c2, m02));
+    o1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m10), _mm_shuffle_epi8(c1, m11)), _mm_shuffle_epi8(c2, m12));
+    o2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m20), _mm_shuffle_epi8(c1, m21)), _mm_shuffle_epi8(c2, m22));
+
+}
+
+// 8 pixels of 3 planes -> 24 uint16 of c0 c1 c2 c0 c1 c2 ... in o0, o1, o2
+static inline void interleaveWords3(__m128i c0, __m128i c1, __m128i c2, __m128i &o0, __m128i &o1, __m128i &o2)
+{
+    const __m128i m00 = _mm_setr_epi8(0, 1, -128, -128, -128, -128, 2, 3, -128, -128, -128, -128, 4, 5, -128, -128);
+    const __m128i m01 = _mm_setr_epi8(-128, -128, 0, 1, -128, -128, -128, -128, 2, 3, -128, -128, -128, -128, 4, 5);
+    const __m128i m02 = _mm_setr_epi8(-128, -128, -128, -128, 0, 1, -128, -128, -128, -128, 2, 3, -128, -128, -128, -128);
+    const __m128i m10 = _mm_setr_epi8(-128, -128, 6, 7, -128, -128, -128, -128, 8, 9, -128, -128, -128, -128, 10, 11);
+    const __m128i m11 = _mm_setr_epi8(-128, -128, -128, -128, 6, 7, -128, -128, -128, -128, 8, 9, -128, -128, -128, -128);
+    const __m128i m12 = _mm_setr_epi8(4, 5, -128, -128, -128, -128, 6, 7, -128, -128, -128, -128, 8, 9, -128, -128);
+    const __m128i m20 = _mm_setr_epi8(-128, -128, -128, -128, 12, 13, -128, -128, -128, -128, 14, 15, -128, -128, -128, -128);
+    const __m128i m21 = _mm_setr_epi8(10, 11, -128, -128, -128, -128, 12, 13, -128, -128, -128, -128, 14, 15, -128, -128);
+    const __m128i m22 = _mm_setr_epi8(-128, -128, 10, 11, -128, -128, -128, -128, 12, 13, -128, -128, -128, -128, 14, 15);
+
+    o0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m00), _mm_shuffle_epi8(c1, m01)), _mm_shuffle_epi8(c2, m02));
+    o1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m10), _mm_shuffle_epi8(c1, m11)), _mm_shuffle_epi8(c2, m12));
+    o2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, m20), _mm_shuffle_epi8(c1, m21)), _mm_shuffle_epi8(c2, m22));
+
+}
+
+static inline void interleave3(unsigned char *pDst, __m128i c0, __m128i c1, __m128i c2)
+{
+    __m128i o0, o1, o2;
+    interleaveBytes3(c0, c1, c2, o0, o1, o2);
+
+    _mm_storeu_si128((__m128i *)pDst, o0);
+    _mm_storeu_si128((__m128i *)(pDst + 16), o1);
+    _mm_storeu_si128((__m128i *)(pDst + 32), o2);
+}
+
+static inline void interleave3(uint16_t *pDst, __m128i c0, __m128i c1, __m128i c2)
+{
+    __m128i o0, o1, o2;
+    interleaveWords3(c0, c1, c2, o0, o1, o2);
+
+    _mm_storeu_si128((__m128i *)pDst, o0);
+    _mm_storeu_si128((__m128i *)(pDst + 8), o1);
+    _mm_storeu_si128((__m128i *)(pDst + 16), o2);
+}
+
+static inline __m128i loadLow32(const void *p)
+{
+    int value;
+    memcpy(&value, p, sizeof(value));
+    return _mm_cvtsi32_si128(value);
+}
+
+#if defined(POA_SIMD_AVX512)
+
+struct VecU8
+{
+    typedef unsigned char T;
+    typedef __m512i V;
+    enum { LANES = 64 };
+
+    static V load(const T *p) { return _mm512_loadu_si512((const void *)p); }
+    static V avg(V a, V b) { return _mm512_avg_epu8(a, b); }
+    static V blendOdd(V even, V odd) { return _mm512_mask_blend_epi8(0xAAAAAAAAAAAAAAAAull, even, odd); }
+    static void store3(T *pDst, V c0, V c1, V c2)
+    {
+        interleave3(pDst, _mm512_extracti32x4_epi32(c0, 0), _mm512_extracti32x4_epi32(c1, 0), _mm512_extracti32x4_epi32(c2, 0));
+        interleave3(pDst + 48, _mm512_extracti32x4_epi32(c0, 1), _mm512_extracti32x4_epi32(c1, 1), _mm512_extracti32x4_epi32(c2, 1));
+        interleave3(pDst + 96, _mm512_extracti32x4_epi32(c0, 2), _mm512_extracti32x4_epi32(c1, 2), _mm512_extracti32x4_epi32(c2, 2));
+        interleave3(pDst + 144, _mm512_extracti32x4_epi32(c0, 3), _mm512_extracti32x4_epi32(c1, 3), _mm512_extracti32x4_epi32(c2, 3));
+    }
+};
+
+struct VecU16
+{
+    typedef uint16_t T;
+    typedef __m512i V;
+    enum { LANES = 32 };
+
+    static V load(const T *p) { return _mm512_loadu_si512((const void *)p); }
+    static V avg(V a, V b) { return _mm512_avg_epu16(a, b); }
+    static V blendOdd(V even, V odd) { return _mm512_mask_blend_epi16(0xAAAAAAAAu, even, odd); }
+    static V set1(int value) { return _mm512_set1_epi16((short)value); }
+    static V bitXor(V a, V b) { return _mm512_xor_si512(a, b); }
+    static V swapBytes(V a) { return _mm512_or_si512(_mm512_slli_epi16(a, 8), _mm512_srli_epi16(a, 8)); }
+    static void store(T *pDst, V a) { _mm512_storeu_si512((void *)pDst, a); }
+    static void store3(T *pDst, V c0, V c1, V c2)
+    {
+        interleave3(pDst, _mm512_extracti32x4_epi32(c0, 0), _mm512_extracti32x4_epi32(c1, 0), _mm512_extracti32x4_epi32(c2, 0));
+        interleave3(pDst + 24, _mm512_extracti32x4_epi32(c0, 1), _mm512_extracti32x4_epi32(c1, 1), _mm512_extracti32x4_epi32(c2, 1));
+        interleave3(pDst + 48, _mm512_extracti32x4_epi32(c0, 2), _mm512_extracti32x4_epi32(c1, 2), _mm512_extracti32x4_epi32(c2, 2));
+        interleave3(pDst + 72, _mm512_extracti32x4_epi32(c0, 3), _mm512_extracti32x4_epi32(c1, 3), _mm512_extracti32x4_epi32(c2, 3));
+    }
+};
+
+struct VecI32
+{
+    typedef __m512i V;
+    typedef __mmask16 M;
+    enum { LANES = 16 };
+
+    static V load(const unsigned char *p) { return _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)p)); }
+    static V load(const uint16_t *p) { return _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)p)); }
+    static V set1(int value) { return _mm512_set1_epi32(value); }
+    static V add(V a, V b) { return _mm512_add_epi32(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_epi32(a, b); }
+    static V abs(V a) { return _mm512_abs_epi32(a); }
+    static V min(V a, V b) { return _mm512_min_epi32(a, b); }
+    static V max(V a, V b) { return _mm512_max_epi32(a, b); }
+    template <int N> static V shl(V a) { return _mm512_slli_epi32(a, N); }
+    template <int N> static V sar(V a) { return _mm512_srai_epi32(a, N); }
+    static M lessThan(V a, V b) { return _mm512_cmplt_epi32_mask(a, b); }
+    static V select(M mask, V a, V b) { return _mm512_mask_blend_epi32(mask, b, a); } //mask ? a : b
+    static V blendOdd(V even, V odd) { return _mm512_mask_blend_epi32(0xAAAA, even, odd); }
+    // the sums of the adjacent lanes of a then b, and of the lanes 2 apart(x[4i] + x[4i + 2], x[4i + 1] + x[4i + 3])
+    static V hadd(V a, V b)
+    {
+        const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+        const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+        return _mm512_add_epi32(_mm512_permutex2var_epi32(a, even, b), _mm512_permutex2var_epi32(a, odd, b));
+    }
+    static V hadd2(V a, V b)
+    {
+        const __m512i low = _mm512_setr_epi32(0, 1, 4, 5, 8, 9, 12, 13, 16, 17, 20, 21, 24, 25, 28, 29);
+        const __m512i high = _mm512_setr_epi32(2, 3, 6, 7, 10, 11, 14, 15, 18, 19, 22, 23, 26, 27, 30, 31);
+        return _mm512_add_epi32(_mm512_permutex2var_epi32(a, low, b), _mm512_permutex2var_epi32(a, high, b));
+    }
+    // the sums of 3 adjacent lanes of a, b then c(x[3i] + x[3i + 1] + x[3i + 2]), and of the lanes 2 apart
+    // (x[6(i / 2) + i % 2] + x[6(i / 2) + i % 2 + 2] + x[6(i / 2) + i % 2 + 4]): blend the lanes which go to the
+    // same sum together, then move them to their output lane
+    static V hadd3(V a, V b, V c)
+    {
+        const __m512i perm0 = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 2, 5, 8, 11, 14, 1, 4, 7, 10, 13);
+        const __m512i perm1 = _mm512_setr_epi32(1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2, 5, 8, 11, 14);
+        const __m512i perm2 = _mm512_setr_epi32(2, 5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15);
+        V sum = _mm512_permutexvar_epi32(perm0, _mm512_mask_blend_epi32(0x2492, _mm512_mask_blend_epi32(0x4924, a, b), c));
+        sum = _mm512_add_epi32(sum, _mm512_permutexvar_epi32(perm1, _mm512_mask_blend_epi32(0x4924, _mm512_mask_blend_epi32(0x9249, a, b), c)));
+        return _mm512_add_epi32(sum, _mm512_permutexvar_epi32(perm2, _mm512_mask_blend_epi32(0x9249, _mm512_mask_blend_epi32(0x2492, a, b), c)));
+    }
+    static V hadd3Pairs(V a, V b, V c)
+    {
+        const __m512i perm0 = _mm512_setr_epi32(0, 1, 6, 7, 12, 13, 2, 3, 8, 9, 14, 15, 4, 5, 10, 11);
+        const __m512i perm1 = _mm512_setr_epi32(2, 3, 8, 9, 14, 15, 4, 5, 10, 11, 0, 1, 6, 7, 12, 13);
+        const __m512i perm2 = _mm512_setr_epi32(4, 5, 10, 11, 0, 1, 6, 7, 12, 13, 2, 3, 8, 9, 14, 15);
+        V sum = _mm512_permutexvar_epi32(perm0, _mm512_mask_blend_epi32(0x0C30, _mm512_mask_blend_epi32(0xC30C, a, b), c));
+        sum = _mm512_add_epi32(sum, _mm512_permutexvar_epi32(perm1, _mm512_mask_blend_epi32(0x30C3, _mm512_mask_blend_epi32(0x0C30, a, b), c)));
+        return _mm512_add_epi32(sum, _mm512_permutexvar_epi32(perm2, _mm512_mask_blend_epi32(0xC30C, _mm512_mask_blend_epi32(0x30C3, a, b), c)));
+    }
+    static V div9(V a) //a must be in [0, 9 * 65535], exact: the fraction of (a + 0.5) / 9 is far from 0 and 1
+    {
+        return _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_add_ps(_mm512_cvtepi32_ps(a), _mm512_set1_ps(0.5f)), _mm512_set1_ps(1.0f / 9.0f)));
+    }
+    static void store(int *p, V a) { _mm512_storeu_si512((void *)p, a); }
+    static void storeU8(unsigned char *p, V a) { _mm_storeu_si128((__m128i *)p, _mm512_cvtusepi32_epi8(a)); } //a must be in [0, 255]
+    static void storeU16(uint16_t *p, V a) { _mm256_storeu_si256((__m256i *)p, _mm512_cvtusepi32_epi16(a)); } //a must be in [0, 65535]
+    static void store3(unsigned char *pDst, V c0, V c1, V c2) //c0, c1, c2 must be in [0, 255]
+    {
+        interleave3(pDst, _mm512_cvtepi32_epi8(c0), _mm512_cvtepi32_epi8(c1), _mm512_cvtepi32_epi8(c2));
+    }
+    static void store3(uint16_t *pDst, V c0, V c1, V c2) //c0, c1, c2 must be in [0, 65535]
+    {
+        __m256i w0 = _mm512_cvtepi32_epi16(c0);
+        __m256i w1 = _mm512_cvtepi32_epi16(c1);
+        __m256i w2 = _mm512_cvtepi32_epi16(c2);
+        interleave3(pDst, _mm256_castsi256_si128(w0), _mm256_castsi256_si128(w1), _mm256_castsi256_si128(w2));
+        interleave3(pDst + 24, _mm256_extracti128_si256(w0, 1), _mm256_extracti128_si256(w1, 1), _mm256_extracti128_si256(w2, 1));
+    }
+};
+
+struct VecF32
+{
+    typedef __m512 V;
+    enum { LANES = 16 };
+
+    static V load(const unsigned char *p) { return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)p))); }
+    static V load(const uint16_t *p) { return _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)p))); }
+    static V load(const int16_t *p) { return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)p))); }
+    static V load(const float *p) { return _mm512_loadu_ps(p); }
+    static V set1(float value) { return _mm512_set1_ps(value); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static float sum(V a) { return _mm512_reduce_add_ps(a); }
+    static V min(V a, V b) { return _mm512_min_ps(a, b); }
+    static V max(V a, V b) { return _mm512_max_ps(a, b); }
+    // rounded to the nearest, a must be in [0, 255] or [0, 65535]
+    static void store(unsigned char *p, V a) { _mm_storeu_si128((__m128i *)p, _mm512_cvtusepi32_epi8(_mm512_cvtps_epi32(a))); }
+    static void store(uint16_t *p, V a) { _mm256_storeu_si256((__m256i *)p, _mm512_cvtusepi32_epi16(_mm512_cvtps_epi32(a))); }
+    static void store(float *p, V a) { _mm512_storeu_ps(p, a); }
+};
+
+#elif defined(POA_SIMD_AVX2)
+
+struct VecU8
+{
+    typedef unsigned char T;
+    typedef __m256i V;
+    enum { LANES = 32 };
+
+    static V load(const T *p) { return _mm256_loadu_si256((const __m256i *)p); }
+    static V avg(V a, V b) { return _mm256_avg_epu8(a, b); }
+    static V blendOdd(V even, V odd) { return _mm256_blendv_epi8(even, odd, _mm256_set1_epi16((short)0xFF00)); }
+    static void store3(T *pDst, V c0, V c1, V c2)
+    {
+        interleave3(pDst, _mm256_castsi256_si128(c0), _mm256_castsi256_si128(c1), _mm256_castsi256_si128(c2));
+        interleave3(pDst + 48, _mm256_extracti128_si256(c0, 1), _mm256_extracti128_si256(c1, 1), _mm256_extracti128_si256(c2, 1));
+    }
+};
+
+struct VecU16
+{
+    typedef uint16_t T;
+    typedef __m256i V;
+    enum { LANES = 16 };
+
+    static V load(const T *p) { return _mm256_loadu_si256((const __m256i *)p); }
+    static V avg(V a, V b) { return _mm256_avg_epu16(a, b); }
+    static V blendOdd(V even, V odd) { return _mm256_blend_epi16(even, odd, 0xAA); }
+    static V set1(int value) { return _mm256_set1_epi16((short)value); }
+    static V bitXor(V a, V b) { return _mm256_xor_si256(a, b); }
+    static V swapBytes(V a) { return _mm256_or_si256(_mm256_slli_epi16(a, 8), _mm256_srli_epi16(a, 8)); }
+    static void store(T *pDst, V a) { _mm256_storeu_si256((__m256i *)pDst, a); }
+    static void store3(T *pDst, V c0, V c1, V c2)
+    {
+        interleave3(pDst, _mm256_castsi256_si128(c0), _mm256_castsi256_si128(c1), _mm256_castsi256_si128(c2));
+        interleave3(pDst + 24, _mm256_extracti128_si256(c0, 1), _mm256_extracti128_si256(c1, 1), _mm256_extracti128_si256(c2, 1));
+    }
+};
+
+struct VecI32
+{
+    typedef __m256i V;
+    typedef __m256i M;
+    enum { LANES = 8 };
+
+    static V load(const unsigned char *p) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)); }
+    static V load(const uint16_t *p) { return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p)); }
+    static V set1(int value) { return _mm256_set1_epi32(value); }
+    static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_epi32(a, b); }
+    static V abs(V a) { return _mm256_abs_epi32(a); }
+    static V min(V a, V b) { return _mm256_min_epi32(a, b); }
+    static V max(V a, V b) { return _mm256_max_epi32(a, b); }
+    template <int N> static V shl(V a) { return _mm256_slli_epi32(a, N); }
+    template <int N> static V sar(V a) { return _mm256_srai_epi32(a, N); }
+    static M lessThan(V a, V b) { return _mm256_cmpgt_epi32(b, a); }
+    static V select(M mask, V a, V b) { return _mm256_blendv_epi8(b, a, mask); } //mask ? a : b
+    static V blendOdd(V even, V odd) { return _mm256_blend_epi32(even, odd, 0xAA); }
+    static __m128i packU16(V a) //8 uint16, a must be in [0, 65535]
+    {
+        return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(a, a), 0x08));
+    }
+    // the sums of the adjacent lanes of a then b, and of the lanes 2 apart(x[4i] + x[4i + 2], x[4i + 1] + x[4i + 3])
+    static V hadd(V a, V b) { return _mm256_permute4x64_epi64(_mm256_hadd_epi32(a, b), 0xD8); }
+    static V hadd2(V a, V b)
+    {
+        return _mm256_permute4x64_epi64(_mm256_add_epi32(_mm256_unpacklo_epi64(a, b), _mm256_unpackhi_epi64(a, b)), 0xD8);
+    }
+    // the sums of 3 adjacent lanes of a, b then c(x[3i] + x[3i + 1] + x[3i + 2]), and of the lanes 2 apart
+    // (x[6(i / 2) + i % 2] + x[6(i / 2) + i % 2 + 2] + x[6(i / 2) + i % 2 + 4]): blend the lanes which go to the
+    // same sum together, then move them to their output lane
+    static V hadd3(V a, V b, V c)
+    {
+        const __m256i perm0 = _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5);
+        const __m256i perm1 = _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6);
+        const __m256i perm2 = _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7);
+        V sum = _mm256_permutevar8x32_epi32(_mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x92), c, 0x24), perm0);
+        sum = _mm256_add_epi32(sum, _mm256_permutevar8x32_epi32(_mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x24), c, 0x49), perm1));
+        return _mm256_add_epi32(sum, _mm256_permutevar8x32_epi32(_mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x49), c, 0x92), perm2));
+    }
+    static V hadd3Pairs(V a, V b, V c)
+    {
+        V sum = _mm256_permute4x64_epi64(_mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x30), c, 0x0C), 0x6C);
+        sum = _mm256_add_epi32(sum, _mm256_permute4x64_epi64(_mm256_blend_epi32(_mm256_blend_epi32(a, b, 0xC3), c, 0x30), 0xB1));
+        return _mm256_add_epi32(sum, _mm256_permute4x64_epi64(_mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x0C), c, 0xC3), 0xC6));
+    }
+    static V div9(V a) //a must be in [0, 9 * 65535], exact: the fraction of (a + 0.5) / 9 is far from 0 and 1
+    {
+        return _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(a), _mm256_set1_ps(0.5f)), _mm256_set1_ps(1.0f / 9.0f)));
+    }
+    static void store(int *p, V a) { _mm256_storeu_si256((__m256i *)p, a); }
+    static void storeU8(unsigned char *p, V a) //a must be in [0, 255]
+    {
+        __m128i w = packU16(a);
+        _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(w, w));
+    }
+    static void storeU16(uint16_t *p, V a) { _mm_storeu_si128((__m128i *)p, packU16(a)); }
+    static void store3(unsigned char *pDst, V c0, V c1, V c2) //8 pixels, 24 bytes
+    {
+        __m128i b0 = packU16(c0);
+        __m128i b1 = packU16(c1);
+        __m128i b2 = packU16(c2);
+        __m128i o0, o1, o2;
+        interleaveBytes3(_mm_packus_epi16(b0, b0), _mm_packus_epi16(b1, b1), _mm_packus_epi16(b2, b2), o0, o1, o2);
+        _mm_storeu_si128((__m128i *)pDst, o0);
+        _mm_storel_epi64((__m128i *)(pDst + 16), o1);
+    }
+    static void store3(uint16_t *pDst, V c0, V c1, V c2) { interleave3(pDst, packU16(c0), packU16(c1), packU16(c2)); }
+};
+
+struct VecF32
+{
+    typedef __m256 V;
+    enum { LANES = 8 };
+
+    static V load(const unsigned char *p) { return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p))); }
+    static V load(const uint16_t *p) { return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p))); }
+    static V load(const int16_t *p) { return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)p))); }
+    static V load(const float *p) { return _mm256_loadu_ps(p); }
+    static V set1(float value) { return _mm256_set1_ps(value); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static float sum(V a)
+    {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+    static V min(V a, V b) { return _mm256_min_ps(a, b); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+    // rounded to the nearest, a must be in [0, 255] or [0, 65535]
+    static void store(unsigned char *p, V a)
+    {
+        __m128i w = VecI32::packU16(_mm256_cvtps_epi32(a));
+        _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(w, w));
+    }
+    static void store(uint16_t *p, V a) { VecI32::storeU16(p, _mm256_cvtps_epi32(a)); }
+    static void store(float *p, V a) { _mm256_storeu_ps(p, a); }
+};
+
+#else // POA_SIMD_SSE41
+
+struct VecU8
+{
+    typedef unsigned char T;
+    typedef __m128i V;
+    enum { LANES = 16 };
+
+    static V load(const T *p) { return _mm_loadu_si128((const __m128i *)p); }
+    static V avg(V a, V b) { return _mm_avg_epu8(a, b); }
+    static V blendOdd(V even, V odd) { return _mm_blendv_epi8(even, odd, _mm_set1_epi16((short)0xFF00)); }
+    static void store3(T *pDst, V c0, V c1, V c2) { interleave3(pDst, c0, c1, c2); }
+};
+
+struct VecU16
+{
+    typedef uint16_t T;
+    typedef __m128i V;
+    enum { LANES = 8 };
+
+    static V load(const T *p) { return _mm_loadu_si128((const __m128i *)p); }
+    static V avg(V a, V b) { return _mm_avg_epu16(a, b); }
+    static V blendOdd(V even, V odd) { return _mm_blend_epi16(even, odd, 0xAA); }
+    static V set1(int value) { return _mm_set1_epi16((short)value); }
+    static V bitXor(V a, V b) { return _mm_xor_si128(a, b); }
+    static V swapBytes(V a) { return _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8)); }
+    static void store(T *pDst, V a) { _mm_storeu_si128((__m128i *)pDst, a); }
+    static void store3(T *pDst, V c0, V c1, V c2) { interleave3(pDst, c0, c1, c2); }
+};
+
+struct VecI32
+{
+    typedef __m128i V;
+    typedef __m128i M;
+    enum { LANES = 4 };
+
+    static V load(const unsigned char *p) { return _mm_cvtepu8_epi32(loadLow32(p)); }
+    static V load(const uint16_t *p) { return _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)p)); }
+    static V set1(int value) { return _mm_set1_epi32(value); }
+    static V add(V a, V b) { return _mm_add_epi32(a, b); }
+    static V sub(V a, V b) { return _mm_sub_epi32(a, b); }
+    static V abs(V a) { return _mm_abs_epi32(a); }
+    static V min(V a, V b) { return _mm_min_epi32(a, b); }
+    static V max(V a, V b) { return _mm_max_epi32(a, b); }
+    template <int N> static V shl(V a) { return _mm_slli_epi32(a, N); }
+    template <int N> static V sar(V a) { return _mm_srai_epi32(a, N); }
+    static M lessThan(V a, V b) { return _mm_cmplt_epi32(a, b); }
+    static V select(M mask, V a, V b) { return _mm_blendv_epi8(b, a, mask); } //mask ? a : b
+    static V blendOdd(V even, V odd) { return _mm_blend_epi16(even, odd, 0xCC); }
+    // the sums of the adjacent lanes of a then b, and of the lanes 2 apart(x[4i] + x[4i + 2], x[4i + 1] + x[4i + 3])
+    static V hadd(V a, V b) { return _mm_hadd_epi32(a, b); }
+    static V hadd2(V a, V b) { return _mm_add_epi32(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b)); }
+    // the sums of 3 adjacent lanes of a, b then c(x[3i] + x[3i + 1] + x[3i + 2]), and of the lanes 2 apart
+    // (x[6(i / 2) + i % 2] + x[6(i / 2) + i % 2 + 2] + x[6(i / 2) + i % 2 + 4]): blend the lanes which go to the
+    // same sum together, then move them to their output lane
+    static V hadd3(V a, V b, V c)
+    {
+        V sum = _mm_shuffle_epi32(_mm_blend_epi16(_mm_blend_epi16(a, b, 0x30), c, 0x0C), 0x6C);
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(_mm_blend_epi16(_mm_blend_epi16(a, b, 0xC3), c, 0x30), 0xB1));
+        return _mm_add_epi32(sum, _mm_shuffle_epi32(_mm_blend_epi16(_mm_blend_epi16(a, b, 0x0C), c, 0xC3), 0xC6));
+    }
+    static V hadd3Pairs(V a, V b, V c)
+    {
+        V sum = _mm_add_epi32(_mm_blend_epi16(a, b, 0xF0), _mm_blend_epi16(b, c, 0xF0));
+        return _mm_add_epi32(sum, _mm_shuffle_epi32(_mm_blend_epi16(a, c, 0x0F), 0x4E));
+    }
+    static V div9(V a) //a must be in [0, 9 * 65535], exact: the fraction of (a + 0.5) / 9 is far from 0 and 1
+    {
+        return _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(a), _mm_set1_ps(0.5f)), _mm_set1_ps(1.0f / 9.0f)));
+    }
+    static void store(int *p, V a) { _mm_storeu_si128((__m128i *)p, a); }
+    static void storeU8(unsigned char *p, V a) //a must be in [0, 255]
+    {
+        __m128i w = _mm_packus_epi32(a, a);
+        int value = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+        memcpy(p, &value, sizeof(value));
+    }
+    static void storeU16(uint16_t *p, V a) { _mm_storel_epi64((__m128i *)p, _mm_packus_epi32(a, a)); } //a must be in [0, 65535]
+    static void store3(unsigned char *pDst, V c0, V c1, V c2) //4 pixels, 12 bytes
+    {
+        __m128i b0 = _mm_packus_epi32(c0, c0);
+        __m128i b1 = _mm_packus_epi32(c1, c1);
+        __m128i b2 = _mm_packus_epi32(c2, c2);
+        __m128i o0, o1, o2;
+        interleaveBytes3(_mm_packus_epi16(b0, b0), _mm_packus_epi16(b1, b1), _mm_packus_epi16(b2, b2), o0, o1, o2);
+        _mm_storel_epi64((__m128i *)pDst, o0);
+        int tail = _mm_extract_epi32(o0, 2);
+        memcpy(pDst + 8, &tail, sizeof(tail));
+    }
+    static void store3(uint16_t *pDst, V c0, V c1, V c2) //4 pixels, 12 uint16
+    {
+        __m128i o0, o1, o2;
+        interleaveWords3(_mm_packus_epi32(c0, c0), _mm_packus_epi32(c1, c1), _mm_packus_epi32(c2, c2), o0, o1, o2);
+        _mm_storeu_si128((__m128i *)pDst, o0);
+        _mm_storel_epi64((__m128i *)(pDst + 8), o1);
+    }
+};
+
+struct VecF32
+{
+    typedef __m128 V;
+    enum { LANES = 4 };
+
+    static V load(const unsigned char *p) { return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(loadLow32(p))); }
+    static V load(const uint16_t *p) { return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)p))); }
+    static V load(const int16_t *p) { return _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)p))); }
+    static V load(const float *p) { return _mm_loadu_ps(p); }
+    static V set1(float value) { return _mm_set1_ps(value); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static float sum(V a)
+    {
+        __m128 s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+    static V min(V a, V b) { return _mm_min_ps(a, b); }
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+    // rounded to the nearest, a must be in [0, 255] or [0, 65535]
+    static void store(unsigned char *p, V a)
+    {
+        __m128i w = _mm_packus_epi32(_mm_cvtps_epi32(a), _mm_setzero_si128());
+        int value = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+        memcpy(p, &value, sizeof(value));
+    }
+    static void store(uint16_t *p, V a) { VecI32::storeU16(p, _mm_cvtps_epi32(a)); }
+    static void store(float *p, V a) { _mm_storeu_ps(p, a); }
+};
+
+#endif
+
+} // namespace POA_SIMD_NAMESPACE
+
+#endif // SIMDOPS_H
@@ -0,0 +1,199 @@
+#include <iostream>
+
+#include "SoftwareBin.h"
+#include "SoftwareBinKernels.h"
+
+using namespace std;
+
+static const int BIN_TILE_ROWS = 16; //output rows
+
+static const SoftwareBinKernelTable SCALAR_TABLE =
+{
+    {
+        {
+            { binRowScalarKernel<unsigned char, 2, false>, binRowScalarKernel<unsigned char, 2, true> },
+            { binRowScalarKernel<unsigned char, 3, false>, binRowScalarKernel<unsigned char, 3, true> },
+            { binRowScalarKernel<unsigned char, 4, false>, binRowScalarKernel<unsigned char, 4, true> }
+        },
+        {
+            { binRowScalarKernel<uint16_t, 2, false>, binRowScalarKernel<uint16_t, 2, true> },
+            { binRowScalarKernel<uint16_t, 3, false>, binRowScalarKernel<uint16_t, 3, true> },
+            { binRowScalarKernel<uint16_t, 4, false>, binRowScalarKernel<uint16_t, 4, true> }
+        }
+    }
+};
+
+static const SoftwareBinKernelTable *kernels(SimdLevel level)
+{
+    switch (level)
+    {
+    case SIMD_SSE41:
+        return softwareBinKernelsSSE41();
+    case SIMD_AVX2:
+        return softwareBinKernelsAVX2();
+    case SIMD_AVX512:
+        return softwareBinKernelsAVX512();
+    default:
+        return nullptr;
+    }
+}
+
+SoftwareBin::SoftwareBin(int threadCount)
+    : m_parallel(threadCount), m_nBin(2), m_bSum(false), m_bMonoBin(false), m_simdLevel(SIMD_SCALAR), m_pTable(&SCALAR_TABLE)
+{
+    for(int level = CpuFeatures::bestLevel(); level > SIMD_SCALAR; level--)
+    {
+        if(isAvailable((SimdLevel)level))
+        {
+            m_simdLevel = (SimdLevel)level;
+            m_pTable = kernels(m_simdLevel);
+            break;
+        }
+    }
+}
+
+bool SoftwareBin::setBin(int bin)
+{
+    if(bin < 2 || bin > 4)
+    {
+        cerr << "set software bin failed, bin must be 2, 3 or 4" << endl;
+        return false;
+    }
+
+    m_nBin = bin;
+
+    return true;
+}
+
+int SoftwareBin::getBin() const
+{
+    return m_nBin;
+}
+
+void SoftwareBin::setPixelBinSum(bool isSum)
+{
+    m_bSum = isSum;
+}
+
+bool SoftwareBin::isPixelBinSum() const
+{
+    return m_bSum;
+}
+
+void SoftwareBin::setMonoBin(bool isMonoBin)
+{
+    m_bMonoBin = isMonoBin;
+}
+
+bool SoftwareBin::isMonoBin() const
+{
+    return m_bMonoBin;
+}
+
+bool SoftwareBin::setSimdLevel(SimdLevel level)
+{
+    if(!isAvailable(level))
+    {
+        return false;
+    }
+
+    m_simdLevel = level;
+    m_pTable = level == SIMD_SCALAR ? &SCALAR_TABLE : kernels(level);
+
+    return true;
+}
+
+SimdLevel SoftwareBin::getSimdLevel() const
+{
+    return m_simdLevel;
+}
+
+bool SoftwareBin::isAvailable(SimdLevel level)
+{
+    if(level == SIMD_SCALAR)
+    {
+        return true;
+    }
+
+    return CpuFeatures::isSupported(level) && kernels(level) != nullptr;
+}
+
+bool SoftwareBin::isBayerOutput(const Frame &src) const
+{
+    return !m_bMonoBin && src.imgFormat() != POA_MONO8 && src.bayerPattern() != POA_BAYER_MONO;
+}
+
+bool SoftwareBin::outputSize(const Frame &src, int &width, int &height, POABayerPattern &bayerPattern) const
+{
+    POAImgFormat imgFormat = src.imgFormat();
+    if(!src.isValid() || (imgFormat != POA_RAW8 && imgFormat != POA_RAW16 && imgFormat != POA_MONO8))
+    {
+        return false;
+    }
+
+    if(isBayerOutput(src))
+    {
+        width = src.width() / (2 * m_nBin) * 2;
+        height = src.height() / (2 * m_nBin) * 2;
+        bayerPattern = src.bayerPattern();
+    }
+    else
+    {
+        width = src.width() / m_nBin;
+        height = src.height() / m_nBin;
+        bayerPattern = POA_BAYER_MONO;
+    }
+
+    return width > 0 && height > 0;
+}
+
+bool SoftwareBin::process(const Frame &src, Frame &dst)
+{
+    int width = 0, height = 0;
+    POABayerPattern bayerPattern = POA_BAYER_MONO;
+    if(!outputSize(src, width, height, bayerPattern))
+    {
+        cerr << "software bin failed, the frame must be RAW8, RAW16 or MONO8 and at least a block of the bin" << endl;
+        return false;
+    }
+
+    if(!dst.isValid() || dst.width() != width || dst.height() != height || dst.imgFormat() != src.imgFormat() || dst.bayerPattern() != bayerPattern)
+    {
+        cerr << "software bin failed, the output must be " << width << " x " << height << " in the format of the source, bayer pattern "
+             << bayerPattern << endl;
+        return false;
+    }
+
+    const int bin = m_nBin;
+    const bool isBayer = isBayerOutput(src);
+    const BinRowFunc rowFunc = m_pTable->row[src.imgFormat() == POA_RAW16 ? 1 : 0][bin - 2][isBayer ? 1 : 0];
+    const bool isSum = m_bSum;
+
+    m_parallel.run(height, [&](int rowBegin, int rowEnd)
+    {
+        BinRowArgs args;
+        args.width = width;
+        args.isSum = isSum;
+        for(int y = rowBegin; y < rowEnd; y++)
+        {
+            // the source rows: bin neighbours, or the rows of the same color in a block of 2 * bin rows
+            int y0 = isBayer ? 2 * bin * (y >> 1) + (y & 1) : bin * y;
+            int step = isBayer ? 2 : 1;
+            for(int k = 0; k < bin; k++)
+            {
+                args.rows[k] = src.row(y0 + k * step);
+            }
+            args.dst = dst.row(y);
+            rowFunc(args);
+        }
+    }, BIN_TILE_ROWS);
+
+    dst.bin = src.bin * bin;
+    dst.startX = src.startX / bin;
+    dst.startY = src.startY / bin;
+    dst.exposureUs = src.exposureUs;
+    dst.timestampUs = src.timestampUs;
+    dst.seq = src.seq;
+
+    return true;
+}
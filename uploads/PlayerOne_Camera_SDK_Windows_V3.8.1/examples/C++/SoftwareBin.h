@@ -0,0 +1,76 @@
+#ifndef SOFTWAREBIN_H
+#define SOFTWAREBIN_H
+
+#include "PlayerOneCamera.h"
+#include "CpuFeatures.h"
+#include "Frame.h"
+#include "ParallelRows.h"
+
+struct SoftwareBinKernelTable;
+
+/*******************************************************************************
+Host side binning of the RAW8 / RAW16 / MONO8 frames, with the modes of the camera
+bin(POASetImageBin, POA_PIXEL_BIN_SUM, POA_MONO_BIN), so the camera keeps sending
+the full resolution(changing the bin of the camera stops the exposure) and one
+capture feeds both the writer of the full frames and a binned preview or analysis.
+bin 2, 3 or 4, a binned pixel is made of bin x bin pixels of the source:
+pixel bin sum(POA_PIXEL_BIN_SUM true): the sum, saturated at 255(8 bit) or 65535(16
+bit), otherwise the average: the sum / (bin x bin), truncated.
+mono bin(POA_MONO_BIN true) or a mono frame: the bin x bin neighbours, the colors of
+a bayer frame are mixed, the output is mono(POA_BAYER_MONO).
+otherwise(a bayer frame): the bayer pattern is kept, every pixel is the sum of the
+bin x bin pixels of its color in a block of 2bin x 2bin, the output has the pattern
+of the source.
+The output has width / bin x height / bin pixels(rounded down to even for a bayer
+output), the last columns and rows which don't fill a block are dropped, the format
+of the source, and the description of a frame binned by the camera: bin, startX and
+startY in the binned pixels, the exposure, timestamp and seq of the source.
+The rows are binned by the SIMD kernels of the best level of the CPU(see
+SoftwareBinKernels.h) on all cores(ParallelRows), the results are integers, every
+level gives exactly the same pixels as the scalar code.
+*******************************************************************************/
+
+class SoftwareBin
+{
+public:
+    explicit SoftwareBin(int threadCount = 0); //0: all cores
+
+    bool setBin(int bin); //2, 3 or 4, default is 2
+
+    int getBin() const;
+
+    void setPixelBinSum(bool isSum); //true: the sum, false: the average(default)
+
+    bool isPixelBinSum() const;
+
+    void setMonoBin(bool isMonoBin); //true: the bayer frames are binned to mono, default is false
+
+    bool isMonoBin() const;
+
+    bool setSimdLevel(SimdLevel level); //eg: SIMD_SCALAR to compare with the reference, return false if it's not available
+
+    SimdLevel getSimdLevel() const;
+
+    // the size, bayer pattern of the output of a source frame, false if the source can't be binned
+    bool outputSize(const Frame &src, int &width, int &height, POABayerPattern &bayerPattern) const;
+
+    // dst has the output size, the bayer pattern(see outputSize) and the format of src, the rest of its description is set
+    bool process(const Frame &src, Frame &dst);
+
+    static bool isAvailable(SimdLevel level); //supported by the CPU and the kernels are built in
+
+private:
+    SoftwareBin(const SoftwareBin &);
+    SoftwareBin &operator=(const SoftwareBin &);
+
+    bool isBayerOutput(const Frame &src) const;
+
+    ParallelRows m_parallel;
+    int m_nBin;
+    bool m_bSum;
+    bool m_bMonoBin;
+    SimdLevel m_simdLevel;
+    const SoftwareBinKernelTable *m_pTable; //of m_simdLevel, the scalar table for SIMD_SCALAR
+};
+
+#endif // SOFTWAREBIN_H
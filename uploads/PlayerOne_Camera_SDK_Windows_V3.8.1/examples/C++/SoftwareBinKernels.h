@@ -0,0 +1,198 @@
+#ifndef SOFTWAREBINKERNELS_H
+#define SOFTWAREBINKERNELS_H
+
+#include <algorithm>
+#include <cstdint>
+
+/*******************************************************************************
+The row kernels of SoftwareBin, one table per SIMD level.
+A kernel makes one row of the binned frame from the BIN rows of the source which
+make it(args.rows), the pixel x of the row is the sum of BIN x BIN source pixels:
+mono: the block of the neighbours, source columns BIN * x ... BIN * x + BIN - 1
+bayer: the pixels of the same color, source columns 2 * BIN * (x / 2) + x % 2 + 2k
+The sum saturates at the maximum of the pixel(255 or 65535), the average is the sum
+divided by BIN * BIN, truncated. All the values are exact integers, so every level
+gives the same bits as binRowScalar().
+The SIMD kernels add the rows in 32 bit lanes, then the columns by the horizontal
+adds of the lanes: 2x2 and 4x4 by VecI32::hadd(hadd2 for the bayer pairs), 3x3 by
+VecI32::hadd3(hadd3Pairs), whose average is VecI32::div9.
+*******************************************************************************/
+
+struct BinRowArgs
+{
+    const void *rows[4];    //the source rows of the output row, bin rows are used, unsigned char or uint16_t
+    void *dst;              //the output row
+    int width;              //of the output row
+    bool isSum;             //false: the average
+};
+
+typedef int (*BinRowFunc)(const BinRowArgs &args);
+
+struct SoftwareBinKernelTable
+{
+    BinRowFunc row[2][3][2]; //[0: 8 bit, 1: 16 bit][bin - 2][0: mono, 1: bayer]
+};
+
+// nullptr if the file was built without the flags of the level
+const SoftwareBinKernelTable *softwareBinKernelsSSE41();
+
+const SoftwareBinKernelTable *softwareBinKernelsAVX2();
+
+const SoftwareBinKernelTable *softwareBinKernelsAVX512();
+
+template <typename T>
+static inline int binMaxValue()
+{
+    return sizeof(T) == 1 ? 255 : 65535;
+}
+
+template <typename T, int BIN, bool IS_BAYER>
+static inline void binRowScalar(const BinRowArgs &args, int xBegin)
+{
+    const int step = IS_BAYER ? 2 : 1;
+    T *pDst = (T *)args.dst;
+
+    for(int x = xBegin; x < args.width; x++)
+    {
+        int x0 = IS_BAYER ? 2 * BIN * (x >> 1) + (x & 1) : BIN * x;
+        int sum = 0;
+        for(int k = 0; k < BIN; k++)
+        {
+            const T *pRow = (const T *)args.rows[k] + x0;
+            for(int i = 0; i < BIN; i++)
+            {
+                sum += pRow[i * step];
+            }
+        }
+        pDst[x] = (T)(args.isSum ? std::min(sum, binMaxValue<T>()) : sum / (BIN * BIN));
+    }
+}
+
+template <typename T, int BIN, bool IS_BAYER>
+static int binRowScalarKernel(const BinRowArgs &args)
+{
+    binRowScalar<T, BIN, IS_BAYER>(args, 0);
+
+    return args.width;
+}
+
+#ifdef POA_SIMD_NAMESPACE // included by SoftwareBin_<level>.cpp after SimdOps.h
+
+namespace POA_SIMD_NAMESPACE
+{
+
+// the sums of the rows at the column x of the source
+template <class Ops, typename T, int BIN>
+static inline typename Ops::V rowSums(const BinRowArgs &args, int x)
+{
+    typename Ops::V sum = Ops::load((const T *)args.rows[0] + x);
+    for(int k = 1; k < BIN; k++)
+    {
+        sum = Ops::add(sum, Ops::load((const T *)args.rows[k] + x));
+    }
+
+    return sum;
+}
+
+template <class Ops>
+static inline void storeBinned(unsigned char *p, typename Ops::V a)
+{
+    Ops::storeU8(p, a);
+}
+
+template <class Ops>
+static inline void storeBinned(uint16_t *p, typename Ops::V a)
+{
+    Ops::storeU16(p, a);
+}
+
+template <class Ops, bool IS_BAYER>
+static inline typename Ops::V columnPairs(typename Ops::V a, typename Ops::V b)
+{
+    return IS_BAYER ? Ops::hadd2(a, b) : Ops::hadd(a, b);
+}
+
+// 2x2 and 4x4, the average is a shift
+template <class Ops, typename T, int BIN, bool IS_BAYER>
+static int binRow(const BinRowArgs &args)
+{
+    typedef typename Ops::V V;
+    const int LANES = Ops::LANES;
+    const V maxValue = Ops::set1(binMaxValue<T>());
+    T *pDst = (T *)args.dst;
+
+    int x = 0;
+    for(; x + LANES <= args.width; x += LANES)
+    {
+        const int sx = BIN * x;
+        V sum = columnPairs<Ops, IS_BAYER>(rowSums<Ops, T, BIN>(args, sx), rowSums<Ops, T, BIN>(args, sx + LANES));
+        if(BIN == 4)
+        {
+            V right = columnPairs<Ops, IS_BAYER>(rowSums<Ops, T, BIN>(args, sx + 2 * LANES), rowSums<Ops, T, BIN>(args, sx + 3 * LANES));
+            sum = columnPairs<Ops, IS_BAYER>(sum, right);
+        }
+
+        if(args.isSum)
+        {
+            sum = Ops::min(sum, maxValue);
+        }
+        else
+        {
+            sum = BIN == 4 ? Ops::template sar<4>(sum) : Ops::template sar<2>(sum);
+        }
+        storeBinned<Ops>(pDst + x, sum);
+    }
+
+    binRowScalar<T, BIN, IS_BAYER>(args, x);
+
+    return args.width;
+}
+
+// 3x3, the average is an exact float division
+template <class Ops, typename T, bool IS_BAYER>
+static int binRow3(const BinRowArgs &args)
+{
+    typedef typename Ops::V V;
+    const int LANES = Ops::LANES;
+    const V maxValue = Ops::set1(binMaxValue<T>());
+    T *pDst = (T *)args.dst;
+
+    int x = 0;
+    for(; x + LANES <= args.width; x += LANES)
+    {
+        const int sx = 3 * x;
+        V a = rowSums<Ops, T, 3>(args, sx);
+        V b = rowSums<Ops, T, 3>(args, sx + LANES);
+        V c = rowSums<Ops, T, 3>(args, sx + 2 * LANES);
+        V sum = IS_BAYER ? Ops::hadd3Pairs(a, b, c) : Ops::hadd3(a, b, c);
+
+        sum = args.isSum ? Ops::min(sum, maxValue) : Ops::div9(sum);
+        storeBinned<Ops>(pDst + x, sum);
+    }
+
+    binRowScalar<T, 3, IS_BAYER>(args, x);
+
+    return args.width;
+}
+
+static const SoftwareBinKernelTable KERNEL_TABLE =
+{
+    {
+        {
+            { binRow<VecI32, unsigned char, 2, false>, binRow<VecI32, unsigned char, 2, true> },
+            { binRow3<VecI32, unsigned char, false>, binRow3<VecI32, unsigned char, true> },
+            { binRow<VecI32, unsigned char, 4, false>, binRow<VecI32, unsigned char, 4, true> }
+        },
+        {
+            { binRow<VecI32, uint16_t, 2, false>, binRow<VecI32, uint16_t, 2, true> },
+            { binRow3<VecI32, uint16_t, false>, binRow3<VecI32, uint16_t, true> },
+            { binRow<VecI32, uint16_t, 4, false>, binRow<VecI32, uint16_t, 4, true> }
+        }
+    }
+};
+
+} // namespace POA_SIMD_NAMESPACE
+
+#endif // POA_SIMD_NAMESPACE
+
+#endif // SOFTWAREBINKERNELS_H
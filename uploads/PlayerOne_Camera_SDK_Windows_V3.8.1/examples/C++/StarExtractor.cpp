@@ -0,0 +1,638 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include "StarExtractor.h"
+
+using namespace std;
+
+static const float MAD_TO_SIGMA = 1.4826f;
+static const float FIT_SIGMA = 3.0f;        //the pixels of the FWHM fit are above 3 sigma
+static const int SKIP_BLOCK = 32;           //the pixels of the background tested at once by the detection
+static const double GAUSSIAN_FWHM = 2.35482004503; //FWHM / sigma of a gaussian
+
+static double elapsedUs(chrono::steady_clock::time_point beginTime)
+{
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - beginTime).count();
+}
+
+static bool isBrighter(const ExtractedStar &left, const ExtractedStar &right)
+{
+    if(left.flux != right.flux)
+    {
+        return left.flux > right.flux;
+    }
+    return left.y != right.y ? left.y < right.y : left.x < right.x; //the same order whatever the order of the tiles
+}
+
+// the rows of the detection row y: the 2 rows of the 2x2 cells of a bayer frame
+template<typename T>
+static inline void rowsAt(const Frame &frame, int y, bool isBayer, const T *&pRow0, const T *&pRow1)
+{
+    pRow0 = (const T *)frame.row(isBayer ? y * 2 : y);
+    pRow1 = isBayer ? (const T *)frame.row(y * 2 + 1) : pRow0;
+}
+
+// the pixel of the detection: the sum of the 2x2 cell of a bayer frame
+template<typename T>
+static inline float pixelAt(const T *pRow0, const T *pRow1, int x, bool isBayer)
+{
+    if(isBayer)
+    {
+        return (float)((int)pRow0[x * 2] + pRow0[x * 2 + 1] + pRow1[x * 2] + pRow1[x * 2 + 1]);
+    }
+
+    return (float)pRow0[x];
+}
+
+StarExtractor::StarExtractor(int threadCount)
+    : m_parallel(threadCount), m_detectSigma(5.0), m_nMeshSize(64), m_nMinArea(3), m_nMaxStars(0),
+      m_bBayer(false), m_nWidth(0), m_nHeight(0), m_nMeshColumns(0), m_nMeshRows(0)
+{
+}
+
+void StarExtractor::setDetectSigma(double detectSigma)
+{
+    m_detectSigma = detectSigma;
+}
+
+void StarExtractor::setMeshSize(int meshSize)
+{
+    m_nMeshSize = std::max(meshSize, 8);
+}
+
+void StarExtractor::setMinArea(int minArea)
+{
+    m_nMinArea = std::max(minArea, 1);
+}
+
+void StarExtractor::setMaxStars(int maxStars)
+{
+    m_nMaxStars = std::max(maxStars, 0);
+}
+
+const StarExtractorStats &StarExtractor::getLastStats() const
+{
+    return m_lastStats;
+}
+
+template<typename T>
+void StarExtractor::buildMesh(const Frame &frame)
+{
+    m_nMeshColumns = (m_nWidth + m_nMeshSize - 1) / m_nMeshSize;
+    m_nMeshRows = (m_nHeight + m_nMeshSize - 1) / m_nMeshSize;
+    const int sampleStep = std::max(1, m_nMeshSize / 12); //about 150 samples per cell
+    const int cellSamples = (m_nMeshSize + sampleStep - 1) / sampleStep * ((m_nMeshSize + sampleStep - 1) / sampleStep);
+    const size_t cellCount = (size_t)m_nMeshColumns * m_nMeshRows;
+    m_meshBackground.resize(cellCount);
+    m_meshNoise.resize(cellCount);
+    m_samples.resize((size_t)m_nMeshRows * cellSamples);
+
+    m_parallel.run(m_nMeshRows, [&](int rowBegin, int rowEnd)
+    {
+        for(int row = rowBegin; row < rowEnd; row++)
+        {
+            float *pSamples = &m_samples[(size_t)row * cellSamples];
+            int yBegin = row * m_nMeshSize;
+            int yEnd = std::min(yBegin + m_nMeshSize, m_nHeight);
+            for(int column = 0; column < m_nMeshColumns; column++)
+            {
+                int xBegin = column * m_nMeshSize;
+                int xEnd = std::min(xBegin + m_nMeshSize, m_nWidth);
+                int count = 0;
+                for(int y = yBegin + sampleStep / 2; y < yEnd; y += sampleStep)
+                {
+                    const T *pRow0, *pRow1;
+                    rowsAt<T>(frame, y, m_bBayer, pRow0, pRow1);
+                    for(int x = xBegin + sampleStep / 2; x < xEnd; x += sampleStep)
+                    {
+                        pSamples[count++] = pixelAt<T>(pRow0, pRow1, x, m_bBayer);
+                    }
+                }
+
+                float background = 0.0f, noise = 0.0f;
+                if(count > 0)
+                {
+                    std::nth_element(pSamples, pSamples + count / 2, pSamples + count);
+                    background = pSamples[count / 2];
+                    for(int i = 0; i < count; i++)
+                    {
+                        pSamples[i] = std::fabs(pSamples[i] - background);
+                    }
+                    std::nth_element(pSamples, pSamples + count / 2, pSamples + count);
+                    noise = pSamples[count / 2] * MAD_TO_SIGMA;
+                }
+                m_meshBackground[(size_t)row * m_nMeshColumns + column] = background;
+                m_meshNoise[(size_t)row * m_nMeshColumns + column] = std::max(noise, 0.5f); //a clipped or synthetic frame has no noise
+            }
+        }
+    }, 1);
+
+    // the 3x3 median of the mesh, a cell covered by a big star takes the value of its neighbours
+    m_meshSmoothed.resize(cellCount * 2);
+    for(int row = 0; row < m_nMeshRows; row++)
+    {
+        for(int column = 0; column < m_nMeshColumns; column++)
+        {
+            float backgrounds[9], noises[9];
+            int count = 0;
+            for(int dy = -1; dy <= 1; dy++)
+            {
+                for(int dx = -1; dx <= 1; dx++)
+                {
+                    int r = row + dy, c = column + dx;
+                    if(r >= 0 && r < m_nMeshRows && c >= 0 && c < m_nMeshColumns)
+                    {
+                        backgrounds[count] = m_meshBackground[(size_t)r * m_nMeshColumns + c];
+                        noises[count] = m_meshNoise[(size_t)r * m_nMeshColumns + c];
+                        count++;
+                    }
+                }
+            }
+            std::nth_element(backgrounds, backgrounds + count / 2, backgrounds + count);
+            std::nth_element(noises, noises + count / 2, noises + count);
+            m_meshSmoothed[(size_t)row * m_nMeshColumns + column] = backgrounds[count / 2];
+            m_meshSmoothed[cellCount + (size_t)row * m_nMeshColumns + column] = noises[count / 2];
+        }
+    }
+    std::copy(m_meshSmoothed.begin(), m_meshSmoothed.begin() + cellCount, m_meshBackground.begin());
+    std::copy(m_meshSmoothed.begin() + cellCount, m_meshSmoothed.end(), m_meshNoise.begin());
+
+    // the median of the mesh for the stats
+    std::copy(m_meshBackground.begin(), m_meshBackground.end(), m_meshSmoothed.begin());
+    std::copy(m_meshNoise.begin(), m_meshNoise.end(), m_meshSmoothed.begin() + cellCount);
+    std::nth_element(m_meshSmoothed.begin(), m_meshSmoothed.begin() + cellCount / 2, m_meshSmoothed.begin() + cellCount);
+    std::nth_element(m_meshSmoothed.begin() + cellCount, m_meshSmoothed.begin() + cellCount + cellCount / 2, m_meshSmoothed.end());
+    m_lastStats.background = m_meshSmoothed[cellCount / 2];
+    m_lastStats.noise = m_meshSmoothed[cellCount + cellCount / 2];
+}
+
+void StarExtractor::meshAt(double x, double y, float &background, float &noise) const
+{
+    // the values of the cells are at their centers
+    double fx = std::min(std::max((x + 0.5) / m_nMeshSize - 0.5, 0.0), (double)(m_nMeshColumns - 1));
+    double fy = std::min(std::max((y + 0.5) / m_nMeshSize - 0.5, 0.0), (double)(m_nMeshRows - 1));
+    int c0 = std::min((int)fx, m_nMeshColumns - 1), r0 = std::min((int)fy, m_nMeshRows - 1);
+    int c1 = std::min(c0 + 1, m_nMeshColumns - 1), r1 = std::min(r0 + 1, m_nMeshRows - 1);
+    float tx = (float)(fx - c0), ty = (float)(fy - r0);
+
+    const float *pB0 = &m_meshBackground[(size_t)r0 * m_nMeshColumns];
+    const float *pB1 = &m_meshBackground[(size_t)r1 * m_nMeshColumns];
+    const float *pN0 = &m_meshNoise[(size_t)r0 * m_nMeshColumns];
+    const float *pN1 = &m_meshNoise[(size_t)r1 * m_nMeshColumns];
+    background = (pB0[c0] * (1 - tx) + pB0[c1] * tx) * (1 - ty) + (pB1[c0] * (1 - tx) + pB1[c1] * tx) * ty;
+    noise = (pN0[c0] * (1 - tx) + pN0[c1] * tx) * (1 - ty) + (pN1[c0] * (1 - tx) + pN1[c1] * tx) * ty;
+}
+
+template<typename T, bool IS_BAYER>
+void StarExtractor::findRuns(const Frame &frame, int rowBegin, int rowEnd, vector<Run> &runs) const
+{
+    const float sigma = (float)m_detectSigma;
+    const int mesh = m_nMeshSize;
+
+    for(int y = rowBegin; y < rowEnd; y++)
+    {
+        const T *pRow0, *pRow1;
+        rowsAt<T>(frame, y, IS_BAYER, pRow0, pRow1);
+
+        // the mesh rows around y
+        double fy = std::min(std::max((y + 0.5) / mesh - 0.5, 0.0), (double)(m_nMeshRows - 1));
+        int r0 = std::min((int)fy, m_nMeshRows - 1);
+        int r1 = std::min(r0 + 1, m_nMeshRows - 1);
+        float ty = (float)(fy - r0);
+        const float *pB0 = &m_meshBackground[(size_t)r0 * m_nMeshColumns];
+        const float *pB1 = &m_meshBackground[(size_t)r1 * m_nMeshColumns];
+        const float *pN0 = &m_meshNoise[(size_t)r0 * m_nMeshColumns];
+        const float *pN1 = &m_meshNoise[(size_t)r1 * m_nMeshColumns];
+
+        Run run;
+        run.y = y;
+        run.xBegin = -1;
+        run.peak = 0.0f;
+        run.peakX = 0;
+
+        // segment k is between the centers of the mesh columns k - 1 and k((k + 0.5) * mesh - 0.5), the threshold is linear in it
+        float lastThreshold = 0.0f;
+        for(int k = 0; k <= m_nMeshColumns; k++)
+        {
+            int xBegin = k == 0 ? 0 : std::min((k - 1) * mesh + mesh / 2, m_nWidth);
+            int xEnd = k == m_nMeshColumns ? m_nWidth : std::min(k * mesh + mesh / 2, m_nWidth);
+            int column = std::min(k, m_nMeshColumns - 1);
+            float threshold = (pB0[column] + sigma * pN0[column]) * (1 - ty) + (pB1[column] + sigma * pN1[column]) * ty;
+
+            float slope = 0.0f;
+            float value0 = threshold; //the first and the last half cells are flat
+            if(k > 0 && k < m_nMeshColumns)
+            {
+                slope = (threshold - lastThreshold) / mesh;
+                value0 = lastThreshold + slope * (float)(xBegin - ((k - 0.5) * mesh - 0.5));
+            }
+            lastThreshold = threshold;
+
+            for(int blockBegin = xBegin; blockBegin < xEnd; blockBegin += SKIP_BLOCK)
+            {
+                int blockEnd = std::min(blockBegin + SKIP_BLOCK, xEnd);
+                float blockThreshold = value0 + slope * (blockBegin - xBegin);
+                if(run.xBegin < 0) //the background is skipped a block at a time, the max of the block is vectorized
+                {
+                    int blockMax = 0;
+                    for(int x = blockBegin; x < blockEnd; x++)
+                    {
+                        blockMax = std::max(blockMax, IS_BAYER ? (int)pRow0[x * 2] + pRow0[x * 2 + 1] + pRow1[x * 2] + pRow1[x * 2 + 1] : (int)pRow0[x]);
+                    }
+                    if((float)blockMax <= std::min(blockThreshold, blockThreshold + slope * (blockEnd - blockBegin - 1)))
+                    {
+                        continue;
+                    }
+                }
+
+                for(int x = blockBegin; x < blockEnd; x++)
+                {
+                    float value = IS_BAYER ? (float)((int)pRow0[x * 2] + pRow0[x * 2 + 1] + pRow1[x * 2] + pRow1[x * 2 + 1]) : (float)pRow0[x];
+                    if(value > blockThreshold + slope * (x - blockBegin))
+                    {
+                        if(run.xBegin < 0)
+                        {
+                            run.xBegin = x;
+                            run.peak = value;
+                            run.peakX = x;
+                        }
+                        else if(value > run.peak)
+                        {
+                            run.peak = value;
+                            run.peakX = x;
+                        }
+                    }
+                    else if(run.xBegin >= 0)
+                    {
+                        run.xEnd = x;
+                        runs.push_back(run);
+                        run.xBegin = -1;
+                    }
+                }
+            }
+        }
+
+        if(run.xBegin >= 0)
+        {
+            run.xEnd = m_nWidth;
+            runs.push_back(run);
+        }
+    }
+}
+
+template<typename T>
+void StarExtractor::findRuns(const Frame &frame, int rowBegin, int rowEnd, vector<Run> &runs) const
+{
+    if(m_bBayer)
+    {
+        findRuns<T, true>(frame, rowBegin, rowEnd, runs);
+    }
+    else
+    {
+        findRuns<T, false>(frame, rowBegin, rowEnd, runs);
+    }
+}
+
+int StarExtractor::findRoot(int run)
+{
+    int root = run;
+    while(m_runs[root].parent != root)
+    {
+        root = m_runs[root].parent;
+    }
+
+    while(m_runs[run].parent != root) //path compression
+    {
+        int next = m_runs[run].parent;
+        m_runs[run].parent = root;
+        run = next;
+    }
+
+    return root;
+}
+
+void StarExtractor::joinRuns(int first, int second)
+{
+    int firstRoot = findRoot(first);
+    int secondRoot = findRoot(second);
+    if(firstRoot < secondRoot) //the root is the first run of the component, whatever the order of the joins
+    {
+        m_runs[secondRoot].parent = firstRoot;
+    }
+    else if(secondRoot < firstRoot)
+    {
+        m_runs[firstRoot].parent = secondRoot;
+    }
+}
+
+void StarExtractor::joinRows(int aboveBegin, int aboveEnd, int belowBegin, int belowEnd)
+{
+    int above = aboveBegin, below = belowBegin;
+    while(above < aboveEnd && below < belowEnd)
+    {
+        const Run &runAbove = m_runs[above];
+        const Run &runBelow = m_runs[below];
+        if(runAbove.xEnd < runBelow.xBegin) //8-connected: the runs touch if they overlap or meet at a corner
+        {
+            above++;
+        }
+        else if(runBelow.xEnd < runAbove.xBegin)
+        {
+            below++;
+        }
+        else
+        {
+            joinRuns(above, below);
+            if(runAbove.xEnd < runBelow.xEnd)
+            {
+                above++;
+            }
+            else
+            {
+                below++;
+            }
+        }
+    }
+}
+
+template<typename T>
+bool StarExtractor::measure(const Frame &frame, const Component &component, ExtractedStar &star) const
+{
+    float background, noise;
+    meshAt(component.peakX, component.peakY, background, noise);
+
+    // the centroid of the box of the component
+    double sum = 0.0, sumX = 0.0, sumY = 0.0;
+    int xBegin = std::max(component.xMin - 1, 0), xEnd = std::min(component.xMax + 2, m_nWidth);
+    int yBegin = std::max(component.yMin - 1, 0), yEnd = std::min(component.yMax + 2, m_nHeight);
+    for(int y = yBegin; y < yEnd; y++)
+    {
+        const T *pRow0, *pRow1;
+        rowsAt<T>(frame, y, m_bBayer, pRow0, pRow1);
+        for(int x = xBegin; x < xEnd; x++)
+        {
+            double weight = std::max(pixelAt<T>(pRow0, pRow1, x, m_bBayer) - background, 0.0f);
+            sum += weight;
+            sumX += weight * x;
+            sumY += weight * y;
+        }
+    }
+    if(sum <= 0.0)
+    {
+        return false;
+    }
+    double centerX = sumX / sum, centerY = sumY / sum;
+
+    // the aperture: the centroid again, then the flux, the HFR and the FWHM around it
+    const double radius = 1.5 * std::sqrt(component.area / 3.14159265358979323846) + 2.0;
+    double flux = 0.0, sumR = 0.0;
+    double fitW = 0.0, fitWT = 0.0, fitWL = 0.0, fitWTT = 0.0, fitWTL = 0.0; //log(value) = a + b * r^2
+    int fitCount = 0;
+    for(int pass = 0; pass < 2; pass++)
+    {
+        sum = sumX = sumY = 0.0;
+        xBegin = std::max((int)std::floor(centerX - radius), 0);
+        xEnd = std::min((int)std::ceil(centerX + radius) + 1, m_nWidth);
+        yBegin = std::max((int)std::floor(centerY - radius), 0);
+        yEnd = std::min((int)std::ceil(centerY + radius) + 1, m_nHeight);
+        for(int y = yBegin; y < yEnd; y++)
+        {
+            const T *pRow0, *pRow1;
+            rowsAt<T>(frame, y, m_bBayer, pRow0, pRow1);
+            double dy = y - centerY;
+            for(int x = xBegin; x < xEnd; x++)
+            {
+                double dx = x - centerX;
+                double r2 = dx * dx + dy * dy;
+                if(r2 > radius * radius)
+                {
+                    continue;
+                }
+
+                double weight = pixelAt<T>(pRow0, pRow1, x, m_bBayer) - background;
+                if(pass == 0)
+                {
+                    weight = std::max(weight, 0.0);
+                    sum += weight;
+                    sumX += weight * x;
+                    sumY += weight * y;
+                }
+                else
+                {
+                    flux += weight; //the noise below the background too, so the flux is not biased
+                    sumR += std::max(weight, 0.0) * std::sqrt(r2);
+                    sum += std::max(weight, 0.0);
+                    if(weight > FIT_SIGMA * noise)
+                    {
+                        double logValue = std::log(weight);
+                        fitW += weight;
+                        fitWT += weight * r2;
+                        fitWL += weight * logValue;
+                        fitWTT += weight * r2 * r2;
+                        fitWTL += weight * r2 * logValue;
+                        fitCount++;
+                    }
+                }
+            }
+        }
+
+        if(pass == 0)
+        {
+            if(sum <= 0.0)
+            {
+                return false;
+            }
+            centerX = sumX / sum;
+            centerY = sumY / sum;
+        }
+    }
+    if(sum <= 0.0 || flux <= 0.0)
+    {
+        return false;
+    }
+
+    // the gaussian: log(value) = log(peak) - r^2 / (2 * sigma^2)
+    double sigma2 = 0.0;
+    double determinant = fitW * fitWTT - fitWT * fitWT;
+    if(fitCount >= 4 && determinant > 0.0)
+    {
+        double slope = (fitW * fitWTL - fitWT * fitWL) / determinant;
+        if(slope < 0.0)
+        {
+            sigma2 = -0.5 / slope;
+        }
+    }
+
+    const double scale = m_bBayer ? 2.0 : 1.0;
+    star.x = (float)(m_bBayer ? centerX * 2.0 + 0.5 : centerX); //the center of a cell is between 2 pixels
+    star.y = (float)(m_bBayer ? centerY * 2.0 + 0.5 : centerY);
+    star.sensorX = (float)((frame.startX + star.x + 0.5) * frame.bin - 0.5);
+    star.sensorY = (float)((frame.startY + star.y + 0.5) * frame.bin - 0.5);
+    star.flux = (float)flux;
+    star.peak = (float)(m_bBayer ? (component.peak - background) / 4.0 : component.peak - background);
+    star.background = (float)(m_bBayer ? background / 4.0 : background);
+    star.hfr = (float)(sumR / sum * scale);
+    // a 2x2 cell adds 4 / 12 pixel^2 to the variance of the profile
+    double frameSigma2 = sigma2 * scale * scale - (m_bBayer ? 4.0 / 12.0 : 0.0);
+    star.fwhm = sigma2 > 0.0 ? (float)(GAUSSIAN_FWHM * std::sqrt(std::max(frameSigma2, 0.0))) : 0.0f;
+    star.area = m_bBayer ? component.area * 4 : component.area;
+
+    return true;
+}
+
+template<typename T>
+void StarExtractor::extractFrame(const Frame &frame, vector<ExtractedStar> &stars)
+{
+    chrono::steady_clock::time_point stepTime = chrono::steady_clock::now();
+    buildMesh<T>(frame);
+    m_lastStats.backgroundUs = elapsedUs(stepTime);
+
+    // the runs of every tile
+    stepTime = chrono::steady_clock::now();
+    const int tileCount = (m_nHeight + TILE_ROWS - 1) / TILE_ROWS;
+    if((int)m_tileRuns.size() < tileCount)
+    {
+        m_tileRuns.resize(tileCount);
+    }
+    m_parallel.run(m_nHeight, [&](int rowBegin, int rowEnd)
+    {
+        vector<Run> &runs = m_tileRuns[rowBegin / TILE_ROWS];
+        runs.clear();
+        findRuns<T>(frame, rowBegin, rowEnd, runs);
+    }, TILE_ROWS);
+
+    m_runs.clear();
+    m_rowRuns.assign(m_nHeight + 1, 0);
+    for(int tile = 0; tile < tileCount; tile++)
+    {
+        m_runs.insert(m_runs.end(), m_tileRuns[tile].begin(), m_tileRuns[tile].end());
+    }
+    for(size_t i = 0; i < m_runs.size(); i++)
+    {
+        m_runs[i].parent = (int)i;
+        m_rowRuns[m_runs[i].y + 1]++;
+    }
+    for(int y = 0; y < m_nHeight; y++)
+    {
+        m_rowRuns[y + 1] += m_rowRuns[y];
+    }
+
+    // the components inside the tiles, a tile only joins its own runs, then across the edges of the tiles
+    m_parallel.run(m_nHeight, [&](int rowBegin, int rowEnd)
+    {
+        for(int y = rowBegin + 1; y < rowEnd; y++)
+        {
+            joinRows(m_rowRuns[y - 1], m_rowRuns[y], m_rowRuns[y], m_rowRuns[y + 1]);
+        }
+    }, TILE_ROWS);
+    for(int y = TILE_ROWS; y < m_nHeight; y += TILE_ROWS)
+    {
+        joinRows(m_rowRuns[y - 1], m_rowRuns[y], m_rowRuns[y], m_rowRuns[y + 1]);
+    }
+
+    m_components.clear();
+    m_componentOf.assign(m_runs.size(), -1);
+    for(size_t i = 0; i < m_runs.size(); i++)
+    {
+        const Run &run = m_runs[i];
+        int root = findRoot((int)i);
+        if(m_componentOf[root] < 0)
+        {
+            m_componentOf[root] = (int)m_components.size();
+            Component component;
+            component.area = 0;
+            component.xMin = run.xBegin;
+            component.xMax = run.xEnd - 1;
+            component.yMin = run.y;
+            component.yMax = run.y;
+            component.peakX = run.peakX;
+            component.peakY = run.y;
+            component.peak = run.peak;
+            m_components.push_back(component);
+        }
+
+        Component &component = m_components[m_componentOf[root]];
+        component.area += run.xEnd - run.xBegin;
+        component.xMin = std::min(component.xMin, run.xBegin);
+        component.xMax = std::max(component.xMax, run.xEnd - 1);
+        component.yMax = std::max(component.yMax, run.y); //the runs are in the order of the rows
+        if(run.peak > component.peak)
+        {
+            component.peak = run.peak;
+            component.peakX = run.peakX;
+            component.peakY = run.y;
+        }
+    }
+    m_lastStats.componentCount = (int)m_components.size();
+    m_lastStats.labelUs = elapsedUs(stepTime);
+
+    // measure the components large enough
+    stepTime = chrono::steady_clock::now();
+    const int componentCount = (int)m_components.size();
+    m_measured.resize(componentCount);
+    m_isStar.assign(componentCount, 0);
+    if(componentCount > 0)
+    {
+        m_parallel.run(componentCount, [&](int begin, int end)
+        {
+            for(int i = begin; i < end; i++)
+            {
+                m_isStar[i] = m_components[i].area >= m_nMinArea && measure<T>(frame, m_components[i], m_measured[i]);
+            }
+        });
+    }
+
+    stars.clear();
+    for(int i = 0; i < componentCount; i++)
+    {
+        if(m_isStar[i])
+        {
+            stars.push_back(m_measured[i]);
+        }
+    }
+    std::sort(stars.begin(), stars.end(), isBrighter);
+    if(m_nMaxStars > 0 && stars.size() > (size_t)m_nMaxStars)
+    {
+        stars.resize(m_nMaxStars);
+    }
+    m_lastStats.starCount = (int)stars.size();
+    m_lastStats.measureUs = elapsedUs(stepTime);
+}
+
+bool StarExtractor::extract(const Frame &frame, vector<ExtractedStar> &stars)
+{
+    chrono::steady_clock::time_point beginTime = chrono::steady_clock::now();
+    stars.clear();
+
+    POAImgFormat imgFormat = frame.imgFormat();
+    if(!frame.isValid() || (imgFormat != POA_RAW8 && imgFormat != POA_RAW16 && imgFormat != POA_MONO8))
+    {
+        cerr << "extract stars failed, the format must be RAW8, RAW16 or MONO8" << endl;
+        return false;
+    }
+
+    m_bBayer = frame.bayerPattern() != POA_BAYER_MONO && imgFormat != POA_MONO8;
+    m_nWidth = m_bBayer ? frame.width() / 2 : frame.width();
+    m_nHeight = m_bBayer ? frame.height() / 2 : frame.height();
+    if(m_nWidth < 3 || m_nHeight < 3)
+    {
+        cerr << "extract stars failed, the frame is too small, " << frame.width() << " x " << frame.height() << endl;
+        return false;
+    }
+
+    m_lastStats = StarExtractorStats();
+    if(imgFormat == POA_RAW16)
+    {
+        extractFrame<uint16_t>(frame, stars);
+    }
+    else
+    {
+        extractFrame<unsigned char>(frame, stars);
+    }
+    m_lastStats.totalUs = elapsedUs(beginTime);
+
+    return true;
+}
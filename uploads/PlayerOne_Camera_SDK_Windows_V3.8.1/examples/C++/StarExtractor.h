@@ -0,0 +1,185 @@
+#ifndef STAREXTRACTOR_H
+#define STAREXTRACTOR_H
+
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "Frame.h"
+#include "ParallelRows.h"
+
+/*******************************************************************************
+Finds the stars of a frame and measures them, for the focusing, the guiding and the
+stacking(see LiveStacker).
+Background: the frame is cut into a coarse mesh of cells(64 x 64 pixels by default),
+the background and the noise of a cell are the median and the MAD of a grid of
+samples of the cell, so the stars in it don't count, then the mesh is smoothed by a
+3x3 median(a cell filled by a big star or a galaxy takes the value of its
+neighbours) and interpolated bilinearly between the centers of the cells.
+Detection: the pixels above the background + detectSigma * noise are cut into runs
+of every row, the runs which touch(8-connected) are joined into components by a
+union-find, a component of less than minArea pixels is a hot pixel or noise. The
+stars closer than their wings are one component(there is no deblending).
+Measure: the centroid is weighted by the intensity above the background, first on
+the box of the component, then in a circular aperture around it(1.5 times the
+radius of the component + 2 pixels), which has the flux, the HFR(the flux weighted
+mean distance to the centroid, as the focusers use it) and the FWHM(a gaussian
+fitted by least squares on the log of the pixels above 3 sigma, so the threshold
+doesn't cut the profile).
+The bayer frames(RAW8 / RAW16 of a color camera) are measured on the 2x2 cells(the
+sum of a cell is the luminance, the mosaic would split the stars), the positions and
+sizes are given in the pixels of the frame, the FWHM without the width of the cell.
+The frame can be a view(Frame::view) or a binned frame, the positions are in its
+pixels, ExtractedStar::sensorX / sensorY in the pixels of the sensor(Frame::startX,
+startY and bin).
+The rows are split into tiles run on all cores(ParallelRows): the mesh, the runs and
+the components of every tile, the components cut by the edges of the tiles are
+joined afterwards.
+*******************************************************************************/
+
+struct ExtractedStar
+{
+    float x;            //the centroid, pixels of the frame(the center of the pixel x is x)
+    float y;
+    float sensorX;      //the centroid on the sensor, unbinned pixels
+    float sensorY;
+    float flux;         //the sum above the background in the aperture, ADU
+    float peak;         //the brightest pixel above the background
+    float background;   //the local background per pixel
+    float hfr;          //half flux radius, pixels of the frame
+    float fwhm;         //pixels of the frame, 0 if the profile can't be fitted
+    int area;           //the pixels of the component above the threshold
+
+    ExtractedStar()
+    {
+        x = 0.0f;
+        y = 0.0f;
+        sensorX = 0.0f;
+        sensorY = 0.0f;
+        flux = 0.0f;
+        peak = 0.0f;
+        background = 0.0f;
+        hfr = 0.0f;
+        fwhm = 0.0f;
+        area = 0;
+    }
+};
+
+struct StarExtractorStats
+{
+    double background;      //the median of the mesh, ADU per pixel(per 2x2 cell of a bayer frame)
+    double noise;           //the median noise of the mesh
+    int componentCount;     //above the threshold, the small ones included
+    int starCount;
+    double backgroundUs;    //the mesh
+    double labelUs;         //the runs and the components
+    double measureUs;       //the centroids, HFR and FWHM
+    double totalUs;
+
+    StarExtractorStats()
+    {
+        background = 0.0;
+        noise = 0.0;
+        componentCount = 0;
+        starCount = 0;
+        backgroundUs = 0.0;
+        labelUs = 0.0;
+        measureUs = 0.0;
+        totalUs = 0.0;
+    }
+};
+
+class StarExtractor
+{
+public:
+    explicit StarExtractor(int threadCount = 0); //0: all cores
+
+    void setDetectSigma(double detectSigma); //the threshold above the background, default is 5 sigma
+
+    void setMeshSize(int meshSize); //the cells of the background, pixels(2x2 cells of a bayer frame), default is 64
+
+    void setMinArea(int minArea); //the smallest component, default is 3 pixels
+
+    void setMaxStars(int maxStars); //the brightest stars kept, 0: all(default)
+
+    // RAW8, RAW16 or MONO8, the stars sorted by flux, the brightest first
+    bool extract(const Frame &frame, std::vector<ExtractedStar> &stars);
+
+    const StarExtractorStats &getLastStats() const;
+
+    static const int TILE_ROWS = 64; //the rows of a tile of the detection
+
+private:
+    StarExtractor(const StarExtractor &);
+    StarExtractor &operator=(const StarExtractor &);
+
+    struct Run
+    {
+        int y;
+        int xBegin;
+        int xEnd;   //exclusive
+        int peakX;  //the brightest pixel of the run
+        float peak;
+        int parent; //union-find, the index in m_runs
+    };
+
+    struct Component
+    {
+        int area;
+        int xMin;
+        int xMax;
+        int yMin;
+        int yMax;
+        int peakX;
+        int peakY;
+        float peak;
+    };
+
+    template<typename T>
+    void buildMesh(const Frame &frame);
+
+    void meshAt(double x, double y, float &background, float &noise) const; //bilinear
+
+    template<typename T, bool IS_BAYER>
+    void findRuns(const Frame &frame, int rowBegin, int rowEnd, std::vector<Run> &runs) const;
+
+    template<typename T>
+    void findRuns(const Frame &frame, int rowBegin, int rowEnd, std::vector<Run> &runs) const;
+
+    int findRoot(int run);
+
+    void joinRuns(int first, int second);
+
+    void joinRows(int aboveBegin, int aboveEnd, int belowBegin, int belowEnd); //the runs of 2 adjacent rows
+
+    template<typename T>
+    bool measure(const Frame &frame, const Component &component, ExtractedStar &star) const;
+
+    template<typename T>
+    void extractFrame(const Frame &frame, std::vector<ExtractedStar> &stars);
+
+    ParallelRows m_parallel;
+    double m_detectSigma;
+    int m_nMeshSize;
+    int m_nMinArea;
+    int m_nMaxStars;
+    StarExtractorStats m_lastStats;
+
+    bool m_bBayer;
+    int m_nWidth;   //of the detection: the 2x2 cells of a bayer frame
+    int m_nHeight;
+    int m_nMeshColumns;
+    int m_nMeshRows;
+    std::vector<float> m_meshBackground;
+    std::vector<float> m_meshNoise;
+    std::vector<float> m_meshSmoothed; //the 3x3 median of the mesh
+    std::vector<float> m_samples;       //per mesh row, reused from frame to frame
+    std::vector<std::vector<Run> > m_tileRuns;
+    std::vector<Run> m_runs;
+    std::vector<int> m_rowRuns;         //the first run of every row, m_nHeight + 1
+    std::vector<int> m_componentOf;     //the component of a root run
+    std::vector<Component> m_components;
+    std::vector<ExtractedStar> m_measured;  //per component
+    std::vector<char> m_isStar;
+};
+
+#endif // STAREXTRACTOR_H
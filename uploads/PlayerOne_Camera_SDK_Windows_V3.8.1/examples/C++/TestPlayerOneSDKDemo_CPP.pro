@@ -4,13 +4,81 @@ CONFIG -= app_bundle
 CONFIG -= qt
 
 SOURCES += \
+        AsyncWriter.cpp \
+        AutoExposure.cpp \
+        BayerKernels.cpp \
+        ByteSwap.cpp \
+        CalibrationBuilder.cpp \
+        Calibrator.cpp \
+        CameraConfigTransaction.cpp \
+        CpuFeatures.cpp \
+        DarkLibrary.cpp \
+        Debayer.cpp \
+        Fft.cpp \
+        FitsWriter.cpp \
+        FocusMonitor.cpp \
+        Frame.cpp \
+        FramePool.cpp \
+        FrameQuality.cpp \
+        LiveStacker.cpp \
+        LuckySelector.cpp \
         POACamera.cpp \
+        ParallelRows.cpp \
+        PhaseCorrelator.cpp \
+        SerWriter.cpp \
+        SoftwareBin.cpp \
+        StarExtractor.cpp \
         main.cpp
 
 HEADERS += \
-    POACamera.h
+    AsyncWriter.h \
+    AutoExposure.h \
+    AutoExposureKernels.h \
+    BayerKernels.h \
+    ByteSwap.h \
+    CalibrationBuilder.h \
+    Calibrator.h \
+    CalibratorKernels.h \
+    CameraConfigTransaction.h \
+    CpuFeatures.h \
+    DarkLibrary.h \
+    Debayer.h \
+    DebayerKernels.h \
+    Fft.h \
+    FftKernels.h \
+    FitsWriter.h \
+    FocusMonitor.h \
+    Frame.h \
+    FramePool.h \
+    FrameQuality.h \
+    FrameQualityKernels.h \
+    FrameRing.h \
+    LiveStacker.h \
+    LuckySelector.h \
+    POACamera.h \
+    ParallelRows.h \
+    PhaseCorrelator.h \
+    SerWriter.h \
+    SimdOps.h \
+    SoftwareBin.h \
+    SoftwareBinKernels.h \
+    StarExtractor.h
 
-win32: {
+# the SIMD kernels are built with the flags of their instruction set(qmake simd feature)
+CONFIG += simd
+!msvc: QMAKE_CXXFLAGS += -ffp-contract=off # no fused multiply-add, the kernels give the same results as the scalar code
+SSE4_1_SOURCES += ByteSwap_SSE41.cpp Calibrator_SSE41.cpp Debayer_SSE41.cpp Fft_SSE41.cpp FrameQuality_SSE41.cpp SoftwareBin_SSE41.cpp
+AVX2_SOURCES += ByteSwap_AVX2.cpp Calibrator_AVX2.cpp Debayer_AVX2.cpp Fft_AVX2.cpp FrameQuality_AVX2.cpp SoftwareBin_AVX2.cpp
+AVX512BW_SOURCES += ByteSwap_AVX512.cpp Calibrator_AVX512.cpp Debayer_AVX512.cpp Fft_AVX512.cpp FrameQuality_AVX512.cpp SoftwareBin_AVX512.cpp
+
+# qmake CONFIG+=simulator: the simulated camera(../Simulator) is built in instead of the PlayerOneCamera library
+simulator {
+    SOURCES += ../Simulator/PlayerOneCameraSim.cpp ../Simulator/SimScene.cpp
+    HEADERS += ../Simulator/PlayerOneCameraSim.h ../Simulator/SimScene.h
+    INCLUDEPATH += $$PWD/../Simulator
+    unix: LIBS += -lpthread
+}
+else:win32: {
     contains(QT_ARCH, i386) {
         LIBS += -L$$PWD/../../lib/x86/ -lPlayerOneCamera
     } else {
@@ -18,7 +86,7 @@ win32: {
     }
 
 }
-else:unix: LIBS += -L$$PWD/../../lib/ -lPlayerOneCamera
+else:unix: LIBS += -L$$PWD/../../lib/ -lPlayerOneCamera -lpthread
 
 INCLUDEPATH += $$PWD/../../include
 DEPENDPATH += $$PWD/../../include
@@ -1,8 +1,13 @@
 #include <iostream>
 #include <sstream>
-#include <fstream>
+#include <thread>
+#include <chrono>
 
 #include "POACamera.h"
+#include "Debayer.h"
+#include "FitsWriter.h"
+#include "SerWriter.h"
+#include "AsyncWriter.h"
 
 /******************************************************************
  * if want to run this code,
@@ -75,43 +80,140 @@ int main()
             std::cout << "start exposure failed!" << std::endl;
         }
 
-        unsigned char *pDataBuffer = new  unsigned char[800 * 480]; // width * height *1(RAW8)
+        // the buffer comes from the frame pool of the camera, its slabs fit any format and ROI of this camera,
+        // 18 slabs: 1 for pDataBuffer, 8 * 2 + 1 for the capture thread mode below(see startCapture)
+        if(!pCamera->initFramePool(18))
+        {
+            std::cout << "init frame pool failed!" << std::endl;
+        }
+
+        unsigned long frameBytes = pCamera->getFrameBytes(); // width * height * 1(RAW8)
+        unsigned char *pDataBuffer = pCamera->getFramePool().acquire();
+
+        POACameraProperties cameraProp;
+        bool isPropOK = pCamera->getCameraProperties(cameraProp);
+        POABayerPattern bayerPattern = (isPropOK && cameraProp.isColorCamera) ? cameraProp.bayerPattern : POA_BAYER_MONO;
+
+        FitsWriter fitsWriter; //save the images as FITS, no 3rdparty lib needed
+        fitsWriter.readCameraState(*pCamera); //INSTRUME, GAIN, OFFSET and CCD-TEMP of the header
 
         //get image data
         int img_cout = 10; //get image count
 
         while(img_cout > 0) //or while(true),this is recommended to do in another thread,eg: std::thread(c++11)
         {
-            while(!pCamera->isImgDataAvailable())
+            // sleep most of the exposure, then poll POAImageReady more and more tightly, don't spin on it
+            if(!pCamera->waitImageReady(100000 / 1000 + 500))
             {
-                // better to sleep
-                //sleep(exposure_us /1000 / 10); //ms
+                std::cout << "wait image data timeout!" << std::endl;
+                continue;
             }
 
-            if(!pCamera->getImageData(pDataBuffer, 800 * 480))
+            if(!pCamera->getImageData(pDataBuffer, frameBytes))
             {
                 std::cout << "get image data failed!" << std::endl;
                 continue;
             }
 
+            // describe the data for the FITS header, the getters return the cached camera state
+            ROIArea roiArea = pCamera->getROIArea();
+            Frame image = Frame::wrap(pDataBuffer, roiArea.width, roiArea.height, roiArea.width, POA_RAW8, bayerPattern);
+            image.bin = pCamera->getImageBin();
+            image.startX = roiArea.startX;
+            image.startY = roiArea.startY;
+            image.exposureUs = pCamera->getExposure();
+            image.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+
             std::stringstream fileNameStream;
-            fileNameStream << img_cout << "_raw8_image_data.bin";
+            fileNameStream << img_cout << "_raw8_image.fits";
             std::string fileName = fileNameStream.str();
 
-            //write the data as a binary file, you can use 3rdparty lib(opencv, libtiff or cfitsio) save data to a image
-            std::ofstream outFile(fileName, std::ios::out | std::ios::binary);
             std::cout << "writing: " << fileName << std::endl;
-            outFile.write(reinterpret_cast<char*>(pDataBuffer), 800 * 480);
-            outFile.close();
+            if(!fitsWriter.write(fileName, image))
+            {
+                std::cout << "write image failed!" << std::endl;
+            }
 
             img_cout--;
         }
 
+        pCamera->stopExposure();
+
+        //capture thread mode: the camera keeps draining the frames into a ring, here just pop them
+        if(pCamera->startCapture(8))
+        {
+            Debayer debayer; //the color camera sends RAW, debayer it here
+            if(isPropOK)
+            {
+                debayer.setCameraProperties(cameraProp); //the kernels of the bayer pattern of this camera
+            }
+            std::vector<unsigned char> colorBuffer;
+
+            // all the frames of the capture go into one SER file, written straight from the frame buffers
+            ROIArea roiArea = pCamera->getROIArea();
+            SerWriter serWriter;
+            serWriter.setInstrument(isPropOK ? cameraProp.cameraModelName : "");
+            if(!serWriter.open("capture.ser", roiArea.width, roiArea.height, POA_RAW8, bayerPattern, 10))
+            {
+                std::cout << "open ser file failed!" << std::endl;
+            }
+
+            // the frames are written by an I/O thread, a slow disk never delays popFrame, if the queue is full
+            // the oldest frame is dropped(1 thread: the SER frames must be written in order)
+            AsyncWriter asyncWriter;
+            asyncWriter.start([&serWriter](const Frame &frame, int) { return serWriter.write(frame); }, 16, 1, AsyncWriter::DROP_OLDEST);
+
+            int pop_count = 10;
+            while(pop_count > 0)
+            {
+                Frame frame; //no copy, the frame shares the buffer filled by the capture thread
+                if(!pCamera->popFrame(frame))
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10)); //no frame yet, do other things
+                    continue;
+                }
+
+                // a view of the center, it shares the same buffer too, rows are addressed by frame.stride()
+                Frame center = frame.view(frame.width() / 4, frame.height() / 4, frame.width() / 2, frame.height() / 2);
+                std::cout << "frame " << frame.seq << ": " << frame.width() << " x " << frame.height()
+                          << ", center: " << center.width() << " x " << center.height() << std::endl;
+
+                asyncWriter.push(frame); //no copy, the queue holds a reference of the frame
+
+                if(frame.bayerPattern() != POA_BAYER_MONO)
+                {
+                    size_t colorStride = frame.width() * Debayer::outputBytesPerPixel(frame.imgFormat());
+                    colorBuffer.resize(colorStride * frame.height());
+                    debayer.process(frame, colorBuffer.data(), colorStride); //B G R
+                }
+
+                pop_count--;
+            } //the frames are released here, the buffer goes back to the pool
+
+            asyncWriter.stop(); //write the queued frames
+            AsyncWriterStats writerStats = asyncWriter.getStats();
+            std::cout << "written: " << writerStats.framesWritten << ", dropped: " << writerStats.framesDropped
+                      << ", max queue depth: " << writerStats.maxQueueDepth << ", " << writerStats.bytesPerSecond / 1e6 << " MB/s" << std::endl;
+
+            serWriter.close(); //the timestamps of the frames and the final header
+            std::cout << "capture.ser: " << serWriter.frameCount() << " frames" << std::endl;
+
+            WaitStats waitStats = pCamera->getWaitStats();
+            std::cout << "polls per frame: " << (waitStats.waits > 0 ? waitStats.polls / waitStats.waits : 0)
+                      << ", average wake-up latency: " << waitStats.avgWakeLatencyUs << "us" << std::endl;
+
+            CaptureStats stats = pCamera->getCaptureStats();
+            std::cout << "captured: " << stats.framesCaptured << ", overrun: " << stats.framesOverrun << ", dropped: " << stats.sdkDroppedFrames << std::endl;
+
+            pCamera->stopCapture();
+        }
+
         pCamera->closeCamera();
 
         std::cout << "camera closed!" << std::endl;
 
-        delete [] pDataBuffer;
+        pCamera->getFramePool().recycle(pDataBuffer);
         pDataBuffer = nullptr;
 
         delete pCamera;
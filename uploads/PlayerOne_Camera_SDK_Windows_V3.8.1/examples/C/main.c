@@ -1,6 +1,18 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 199309L // nanosleep
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#define SLEEP_MS(ms) Sleep(ms)
+#else
+#include <time.h>
+#define SLEEP_MS(ms) do { struct timespec ts = { (ms) / 1000, ((ms) % 1000) * 1000000L }; nanosleep(&ts, NULL); } while(0)
+#endif
+
 #include "PlayerOneCamera.h"
 
 /******************************************************************
@@ -234,7 +246,7 @@ int main()
             POABool pIsReady = POA_FALSE;
             while(pIsReady == POA_FALSE)
             {
-                //sleep(exposure_us /1000 / 10); //ms
+                SLEEP_MS(exposure_us /1000 / 10); //sleep 1/10 exposure between polls, spinning here takes a whole CPU core
                 POAImageReady(ppPOACamProp[0]->cameraID, &pIsReady);
             }
 
@@ -284,7 +296,7 @@ int main()
         POACameraState cmeraState;
         do
         {
-            //sleep(exposure_us / 10);
+            SLEEP_MS(exposure_us /1000 / 10); //ms
 //            if(breakTrigger)
 //            {
 //                break;
@@ -319,9 +331,8 @@ int main()
         error = POAStartExposure(ppPOACamProp[0]->cameraID, POA_FALSE); //continuously exposure(Video Mode)
 		if(error == POA_OK)
 		{
-            int pixelBytes = 2; //POA_RAW8, POA_MONO8: pixelBytes = 1, POA_RAW16: pixelBytes = 2, POA_RGB24: pixelBytes = 3
-            unsigned long buffer_size = width * height * pixelBytes;
-			unsigned char* data_buffer = (unsigned char*) malloc(buffer_size); //Memory must be allocated first
+            //POA_RAW8, POA_MONO8: pixelBytes = 1, POA_RAW16: pixelBytes = 2, POA_RGB24: pixelBytes = 3
+            //the image size and format are not changed, so reuse the data_buffer(width * height * 2) allocated above
 			
 			int count = 0; //if get image count > 20, will exit loop
 			while(1) 
@@ -336,7 +347,7 @@ int main()
 				 {
 					 //if(bIsStop) //Triggered by external conditions, such as clicking a button
 					 //{break;}
-					 //sleep(exposure_us /1000 / 10); //ms
+					 SLEEP_MS(exposure_us /1000 / 10); //ms
 					 POAImageReady(ppPOACamProp[0]->cameraID, &pIsReady);
 				 }
 				 //if(bIsStop) ////Triggered by external conditions, such as clicking a button
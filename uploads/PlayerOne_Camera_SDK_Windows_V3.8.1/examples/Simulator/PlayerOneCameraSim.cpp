@@ -0,0 +1,1419 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "PlayerOneCameraSim.h"
+#include "SimScene.h"
+
+using namespace std;
+
+typedef std::chrono::steady_clock SimClock;
+
+static std::atomic<unsigned long long> g_callCount(0);
+static std::atomic<unsigned long long> g_getConfigCount(0);
+
+#define COUNT_CALL() g_callCount++
+
+static const int CONFIG_COUNT = POA_EXP + 1;
+static const int SENSOR_MODE_COUNT = 2;
+static const double AMBIENT_TEMPERATURE = 20.0;
+static const double COOLER_DELTA = 35.0;    //the most the cooler can cool below the ambient
+static const double COOLER_TIME_S = 30.0;   //the time constant of the sensor temperature
+static const double USB2_BANDWIDTH = 40.0;  //MB/s
+
+enum ConfigRequire //which cameras have the config
+{
+    FOR_ALL,
+    FOR_COLOR,
+    FOR_COOLER,
+    FOR_ST4,
+    FOR_HARD_BIN
+};
+
+struct ConfigInfo
+{
+    POAConfig configID;
+    POAValueType valueType;
+    bool isWritable;
+    bool isSupportAuto;
+    double minValue;
+    double maxValue;
+    double defaultValue;
+    ConfigRequire require;
+    const char *name;
+    const char *description;
+};
+
+// ordered by POAConfig, so g_configInfos[confID] is the info of confID
+static const ConfigInfo g_configInfos[CONFIG_COUNT] =
+{
+    {POA_EXPOSURE, VAL_INT, true, true, 10, 2000000000, 10000, FOR_ALL, "Exposure", "Exposure Time(us)"},
+    {POA_GAIN, VAL_INT, true, true, 0, 500, 100, FOR_ALL, "Gain", "Gain"},
+    {POA_HARDWARE_BIN, VAL_BOOL, true, false, 0, 1, 0, FOR_HARD_BIN, "HardwareBin", "Hardware Bin"},
+    {POA_TEMPERATURE, VAL_FLOAT, false, false, -50, 100, AMBIENT_TEMPERATURE, FOR_ALL, "Temperature", "Sensor Temperature(C)"},
+    {POA_WB_R, VAL_INT, true, false, -1200, 1200, 0, FOR_COLOR, "WB_Red", "Red Pixels Coefficient of White Balance"},
+    {POA_WB_G, VAL_INT, true, false, -1200, 1200, 0, FOR_COLOR, "WB_Green", "Green Pixels Coefficient of White Balance"},
+    {POA_WB_B, VAL_INT, true, false, -1200, 1200, 0, FOR_COLOR, "WB_Blue", "Blue Pixels Coefficient of White Balance"},
+    {POA_OFFSET, VAL_INT, true, false, 0, 300, 30, FOR_ALL, "Offset", "Offset(ADU of the ADC)"},
+    {POA_AUTOEXPO_MAX_GAIN, VAL_INT, true, false, 0, 500, 250, FOR_ALL, "AutoExpMaxGain", "Maximum Gain of Auto Exposure"},
+    {POA_AUTOEXPO_MAX_EXPOSURE, VAL_INT, true, false, 1, 60000, 1000, FOR_ALL, "AutoExpMaxExpMS", "Maximum Exposure of Auto Exposure(ms)"},
+    {POA_AUTOEXPO_BRIGHTNESS, VAL_INT, true, false, 50, 200, 100, FOR_ALL, "AutoExpTargetBrightness", "Target Brightness of Auto Exposure"},
+    {POA_GUIDE_NORTH, VAL_BOOL, true, false, 0, 1, 0, FOR_ST4, "GuideNorth", "ST4 Guide North"},
+    {POA_GUIDE_SOUTH, VAL_BOOL, true, false, 0, 1, 0, FOR_ST4, "GuideSouth", "ST4 Guide South"},
+    {POA_GUIDE_EAST, VAL_BOOL, true, false, 0, 1, 0, FOR_ST4, "GuideEast", "ST4 Guide East"},
+    {POA_GUIDE_WEST, VAL_BOOL, true, false, 0, 1, 0, FOR_ST4, "GuideWest", "ST4 Guide West"},
+    {POA_EGAIN, VAL_FLOAT, false, false, 0, 100, 1, FOR_ALL, "eGain", "e/ADU of the ADC at the Gain"},
+    {POA_COOLER_POWER, VAL_INT, false, false, 0, 100, 0, FOR_COOLER, "CoolPower", "Cooler Power(%)"},
+    {POA_TARGET_TEMP, VAL_INT, true, false, -50, 50, 0, FOR_COOLER, "TargetTemp", "Target Temperature(C)"},
+    {POA_COOLER, VAL_BOOL, true, false, 0, 1, 0, FOR_COOLER, "CoolerOn", "Turn the Cooler(and the Fan) On or Off"},
+    {POA_HEATER, VAL_BOOL, false, false, 0, 1, 0, FOR_COOLER, "LensHeaterOn", "The Lens Heater is On or Off"},
+    {POA_HEATER_POWER, VAL_INT, true, false, 0, 100, 0, FOR_COOLER, "LensHeaterPower", "Lens Heater Power(%)"},
+    {POA_FAN_POWER, VAL_INT, true, false, 0, 100, 70, FOR_COOLER, "FanPower", "Radiator Fan Power(%)"},
+    {POA_FLIP_NONE, VAL_BOOL, true, false, 0, 1, 1, FOR_ALL, "FlipNone", "No Flip"},
+    {POA_FLIP_HORI, VAL_BOOL, true, false, 0, 1, 0, FOR_ALL, "FlipHori", "Flip the Image Horizontally"},
+    {POA_FLIP_VERT, VAL_BOOL, true, false, 0, 1, 0, FOR_ALL, "FlipVert", "Flip the Image Vertically"},
+    {POA_FLIP_BOTH, VAL_BOOL, true, false, 0, 1, 0, FOR_ALL, "FlipBoth", "Flip the Image Horizontally and Vertically"},
+    {POA_FRAME_LIMIT, VAL_INT, true, false, 0, 2000, 0, FOR_ALL, "FrameRateLimit", "Frame Rate Limit, 0: no limit"},
+    {POA_HQI, VAL_BOOL, true, false, 0, 1, 0, FOR_ALL, "HQI", "High Quality Image"},
+    {POA_USB_BANDWIDTH_LIMIT, VAL_INT, true, false, 35, 100, 90, FOR_ALL, "USBBandWidthLimit", "USB Bandwidth Limit(%)"},
+    {POA_PIXEL_BIN_SUM, VAL_BOOL, true, false, 0, 1, 0, FOR_ALL, "PixelBinSum", "Sum of the Binned Pixels, else the Average"},
+    {POA_MONO_BIN, VAL_BOOL, true, false, 0, 1, 0, FOR_COLOR, "MonoBin", "Bin the Neighbour Pixels, the Bayer Pattern is Lost"},
+    {POA_EXP, VAL_FLOAT, true, true, 0.00001, 7200.0, 0.01, FOR_ALL, "Exposure(s)", "Exposure Time(s)"}
+};
+
+static const char *g_errorStrings[] =
+{
+    "Operation successful",
+    "Invalid index",
+    "Invalid camera ID",
+    "Invalid config",
+    "Invalid argument",
+    "Camera not opened",
+    "Camera not found",
+    "Value out of limit",
+    "Exposure failed",
+    "Timeout",
+    "Buffer size is not enough",
+    "Camera is exposing",
+    "Invalid pointer",
+    "Config is not writable",
+    "Config is not readable",
+    "Access denied",
+    "Operation failed",
+    "Memory allocation failed"
+};
+
+static const char *g_sensorModeNames[SENSOR_MODE_COUNT][2] =
+{
+    {"Normal", "Normal mode"},
+    {"LowNoise", "Low noise mode, lower read noise and half the frame rate"}
+};
+
+struct SimCamera
+{
+    std::mutex mutex;
+    std::condition_variable frameReady; //notified when the exposure is stopped or restarted
+
+    POACameraProperties prop;
+    POASimSettings settings;
+    std::shared_ptr<const SimScene> pScene; //built at the start of the exposure, again if the settings change
+
+    POACameraState state;
+    POAConfigValue configs[CONFIG_COUNT];
+    POABool configAutos[CONFIG_COUNT];
+    int startX;
+    int startY;
+    int width;
+    int height;
+    int bin;
+    POAImgFormat imgFormat;
+    int sensorMode;
+
+    // the timing of the frames since the last (re)start: frame k(1, 2, ...) is ready at
+    // startTime + firstUs + (k - 1) * periodUs, taken frames are delivered or dropped
+    bool isSingleFrame;
+    SimClock::time_point startTime;
+    double firstUs;
+    double periodUs;
+    long long framesTaken;
+    long long frameNumber;   //frames delivered or dropped since open, for the motion and the noise
+    double sceneTimeUs;      //the time of the scene at the start
+    int droppedCount;
+
+    // the cooler, the temperature goes from coolerFromTemp to the goal exponentially
+    SimClock::time_point coolerTime;
+    double coolerFromTemp;
+
+    // POA_SIM_RENDER_CACHED
+    std::mutex cacheMutex;
+    SimFrameParams cacheKey;
+    std::vector<std::vector<unsigned char> > cachedFrames;
+
+    SimCamera()
+    {
+        memset(&prop, 0, sizeof(prop));
+        POASimGetDefaultProperties(&prop);
+        POASimGetDefaultSettings(&settings);
+        state = STATE_CLOSED;
+        memset(&cacheKey, 0, sizeof(cacheKey));
+        resetConfigs();
+    }
+
+    void resetConfigs()
+    {
+        for(int i = 0; i < CONFIG_COUNT; i++)
+        {
+            const ConfigInfo &info = g_configInfos[i];
+            memset(&configs[i], 0, sizeof(POAConfigValue));
+            if(info.valueType == VAL_INT)
+            {
+                configs[i].intValue = (long)info.defaultValue;
+            }
+            else if(info.valueType == VAL_FLOAT)
+            {
+                configs[i].floatValue = info.defaultValue;
+            }
+            else
+            {
+                configs[i].boolValue = info.defaultValue != 0.0 ? POA_TRUE : POA_FALSE;
+            }
+            configAutos[i] = POA_FALSE;
+        }
+
+        startX = startY = 0;
+        bin = 1;
+        width = prop.maxWidth / 4 * 4;
+        height = prop.maxHeight / 2 * 2;
+        imgFormat = prop.imgFormats[0] != POA_END ? prop.imgFormats[0] : POA_RAW8;
+        sensorMode = 0;
+
+        isSingleFrame = false;
+        firstUs = periodUs = 0.0;
+        framesTaken = 0;
+        frameNumber = 0;
+        sceneTimeUs = 0.0;
+        droppedCount = 0;
+
+        coolerTime = SimClock::now();
+        coolerFromTemp = AMBIENT_TEMPERATURE;
+    }
+
+    bool hasConfig(POAConfig confID) const
+    {
+        if(confID < 0 || confID >= CONFIG_COUNT)
+        {
+            return false;
+        }
+
+        switch (g_configInfos[confID].require)
+        {
+        case FOR_COLOR:
+            return prop.isColorCamera == POA_TRUE;
+        case FOR_COOLER:
+            return prop.isHasCooler == POA_TRUE;
+        case FOR_ST4:
+            return prop.isHasST4Port == POA_TRUE;
+        case FOR_HARD_BIN:
+            return prop.isSupportHardBin == POA_TRUE;
+        default:
+            return true;
+        }
+    }
+
+    int bitDepth() const
+    {
+        return std::min(std::max(prop.bitDepth, 8), 16);
+    }
+
+    long frameBytes() const
+    {
+        long pixelBytes = imgFormat == POA_RAW16 ? 2 : (imgFormat == POA_RGB24 ? 3 : 1);
+        return (long)width * height * pixelBytes;
+    }
+
+    double eGain() const //e-/ADU, the gain is in 0.1dB
+    {
+        return settings.fullWell / (1 << bitDepth()) * pow(10.0, -configs[POA_GAIN].intValue / 200.0);
+    }
+
+    int unityGain() const
+    {
+        return (int)(200.0 * log10(settings.fullWell / (1 << bitDepth())) + 0.5);
+    }
+
+    double coolerGoal() const
+    {
+        if(prop.isHasCooler && configs[POA_COOLER].boolValue)
+        {
+            return std::max((double)configs[POA_TARGET_TEMP].intValue, AMBIENT_TEMPERATURE - COOLER_DELTA);
+        }
+        return AMBIENT_TEMPERATURE;
+    }
+
+    double temperature() const
+    {
+        double seconds = std::chrono::duration<double>(SimClock::now() - coolerTime).count();
+        double goal = coolerGoal();
+        return goal + (coolerFromTemp - goal) * exp(-seconds / COOLER_TIME_S);
+    }
+
+    void changeCooler() //call it before the cooler or the target changes
+    {
+        coolerFromTemp = temperature();
+        coolerTime = SimClock::now();
+    }
+
+    // the frame period of the video mode
+    double framePeriodUs() const
+    {
+        double exposureUs = (double)configs[POA_EXPOSURE].intValue;
+        double readoutUs = settings.readoutUs * height * bin / std::max(prop.maxHeight, 1) * (sensorMode == 1 ? 2.0 : 1.0);
+        double bandwidth = (prop.isUSB3Speed ? settings.usbBandwidth : USB2_BANDWIDTH) * configs[POA_USB_BANDWIDTH_LIMIT].intValue / 100.0;
+        double transferUs = bandwidth > 0.0 ? frameBytes() / bandwidth : 0.0; //bytes / (MB/s) = us
+        double limitUs = configs[POA_FRAME_LIMIT].intValue > 0 ? 1000000.0 / configs[POA_FRAME_LIMIT].intValue : 0.0;
+
+        return std::max(std::max(std::max(exposureUs, readoutUs), std::max(transferUs, limitUs)), 1.0);
+    }
+
+    // the exposure, ROI, format... changed: the next frame comes after a full exposure
+    void restartTiming()
+    {
+        if(state == STATE_EXPOSING && framesTaken > 0)
+        {
+            sceneTimeUs += firstUs + (framesTaken - 1) * periodUs;
+        }
+
+        startTime = SimClock::now();
+        periodUs = framePeriodUs();
+        double readoutUs = settings.readoutUs * height * bin / std::max(prop.maxHeight, 1);
+        firstUs = std::max(periodUs, (double)configs[POA_EXPOSURE].intValue + readoutUs);
+        framesTaken = 0;
+        frameReady.notify_all();
+    }
+
+    // the frames ready and not taken, the frames beyond the buffer of the camera are dropped
+    long long framesAvailable(SimClock::time_point now)
+    {
+        if(state != STATE_EXPOSING)
+        {
+            return 0;
+        }
+
+        if(!settings.isRealTime)
+        {
+            return isSingleFrame && framesTaken > 0 ? 0 : 1;
+        }
+
+        double elapsedUs = std::chrono::duration<double, std::micro>(now - startTime).count();
+        long long produced = elapsedUs < firstUs ? 0 : 1 + (long long)((elapsedUs - firstUs) / periodUs);
+        if(isSingleFrame)
+        {
+            produced = std::min(produced, 1LL);
+        }
+
+        long long available = produced - framesTaken;
+        long long bufferFrames = std::max(settings.bufferFrames, 1);
+        if(available > bufferFrames)
+        {
+            long long dropped = available - bufferFrames;
+            droppedCount += (int)dropped;
+            framesTaken += dropped;
+            frameNumber += dropped;
+            available = bufferFrames;
+        }
+
+        return available;
+    }
+
+    SimClock::time_point nextFrameTime() const
+    {
+        double us = firstUs + framesTaken * periodUs;
+        return startTime + std::chrono::duration_cast<SimClock::duration>(std::chrono::duration<double, std::micro>(us));
+    }
+
+    void ensureScene()
+    {
+        if(!pScene)
+        {
+            pScene = std::make_shared<SimScene>(settings, prop.maxWidth, prop.maxHeight, prop.isColorCamera == POA_TRUE);
+        }
+    }
+
+    // the parameters of the frame taken now(framesTaken was just incremented)
+    void frameParams(SimFrameParams &params) const
+    {
+        memset(&params, 0, sizeof(params)); //the cache compares the parameters with memcmp
+
+        params.startX = startX;
+        params.startY = startY;
+        params.width = width;
+        params.height = height;
+        params.bin = bin;
+        params.imgFormat = imgFormat;
+        bool isMonoBin = bin > 1 && prop.isColorCamera && configs[POA_MONO_BIN].boolValue;
+        params.bayerPattern = prop.isColorCamera && !isMonoBin ? prop.bayerPattern : POA_BAYER_MONO;
+        params.isBinSum = configs[POA_PIXEL_BIN_SUM].boolValue == POA_TRUE;
+        params.isFlipHori = configs[POA_FLIP_HORI].boolValue || configs[POA_FLIP_BOTH].boolValue;
+        params.isFlipVert = configs[POA_FLIP_VERT].boolValue || configs[POA_FLIP_BOTH].boolValue;
+        params.bitDepth = bitDepth();
+
+        params.exposureS = configs[POA_EXPOSURE].intValue / 1000000.0;
+        params.eGain = eGain();
+        params.offset = (double)configs[POA_OFFSET].intValue;
+        double gainFactor = std::max(0.3, 1.0 / (1.0 + configs[POA_GAIN].intValue / 200.0)); //the read noise in e- goes down with the gain
+        params.readNoise = settings.readNoise * gainFactor * (sensorMode == 1 ? 0.6 : 1.0);
+        double sensorTemperature = floor(temperature() * 10.0 + 0.5) / 10.0; //as reported, so the cached frames stay valid
+        params.darkCurrent = settings.darkCurrent * pow(2.0, (sensorTemperature - AMBIENT_TEMPERATURE) / 6.0);
+        params.whiteBalance[0] = std::max(0.0, 1.0 + configs[POA_WB_R].intValue / 1200.0);
+        params.whiteBalance[1] = std::max(0.0, 1.0 + configs[POA_WB_G].intValue / 1200.0);
+        params.whiteBalance[2] = std::max(0.0, 1.0 + configs[POA_WB_B].intValue / 1200.0);
+    }
+
+    void frameMotion(SimFrameParams &params) const
+    {
+        double timeS = (sceneTimeUs + firstUs + (framesTaken - 1) * periodUs) / 1000000.0;
+
+        uint64_t state = (uint64_t)settings.seed * 0x9E3779B97F4A7C15ULL + (uint64_t)frameNumber;
+        uint64_t z = state;
+        double jitter[3];
+        for(int i = 0; i < 3; i++) //two gaussian numbers for the motion, one uniform for the blur
+        {
+            z += 0x9E3779B97F4A7C15ULL;
+            uint64_t r = z;
+            r = (r ^ (r >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            r = (r ^ (r >> 27)) * 0x94D049BB133111EBULL;
+            r ^= r >> 31;
+            jitter[i] = ((r >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+        }
+        double radius = sqrt(-2.0 * log(jitter[0]));
+        double gx = radius * cos(6.283185307179586 * jitter[1]);
+        double gy = radius * sin(6.283185307179586 * jitter[1]);
+
+        params.shiftX = (int)floor(settings.driftX * timeS + settings.seeing * gx + 0.5);
+        params.shiftY = (int)floor(settings.driftY * timeS + settings.seeing * gy + 0.5);
+        params.blurLevel = pScene ? std::min((int)(jitter[2] * pScene->levelCount()), pScene->levelCount() - 1) : 0;
+        params.noiseSeed = state * 0xD1B54A32D192ED03ULL;
+    }
+};
+
+static std::mutex g_camerasMutex;
+static std::vector<std::unique_ptr<SimCamera> > g_cameras;
+static bool g_isCamerasCreated = false;
+
+static void createCameras(int count) //g_camerasMutex is locked
+{
+    g_cameras.clear();
+    for(int i = 0; i < count; i++)
+    {
+        g_cameras.push_back(std::unique_ptr<SimCamera>(new SimCamera()));
+        POACameraProperties &prop = g_cameras.back()->prop;
+        prop.cameraID = i;
+        snprintf(prop.SN, sizeof(prop.SN), "SIM%08d", i);
+        snprintf(prop.localPath, sizeof(prop.localPath), "sim://%d", i);
+    }
+    g_isCamerasCreated = true;
+}
+
+static SimCamera *findCamera(int nCameraID)
+{
+    std::lock_guard<std::mutex> lock(g_camerasMutex);
+    if(!g_isCamerasCreated)
+    {
+        createCameras(1);
+    }
+
+    return nCameraID >= 0 && nCameraID < (int)g_cameras.size() ? g_cameras[nCameraID].get() : nullptr;
+}
+
+// looks up the camera and locks it
+class CameraLock
+{
+public:
+    explicit CameraLock(int nCameraID, bool isOpenRequired = true)
+        : m_pCamera(findCamera(nCameraID)), m_error(POA_OK)
+    {
+        if(!m_pCamera)
+        {
+            m_error = POA_ERROR_INVALID_ID;
+            return;
+        }
+
+        m_lock = std::unique_lock<std::mutex>(m_pCamera->mutex);
+        if(isOpenRequired && m_pCamera->state == STATE_CLOSED)
+        {
+            m_error = POA_ERROR_NOT_OPENED;
+        }
+    }
+
+    POAErrors error() const
+    {
+        return m_error;
+    }
+
+    SimCamera *operator->() const
+    {
+        return m_pCamera;
+    }
+
+    std::unique_lock<std::mutex> &lock()
+    {
+        return m_lock;
+    }
+
+private:
+    SimCamera *m_pCamera;
+    POAErrors m_error;
+    std::unique_lock<std::mutex> m_lock;
+};
+
+static bool isSceneChanged(const POASimSettings &a, const POASimSettings &b)
+{
+    return a.scene != b.scene || a.seed != b.seed || a.starCount != b.starCount || a.starFwhm != b.starFwhm
+            || a.planetRadius != b.planetRadius || a.seeingBlur != b.seeingBlur || a.hotPixelRatio != b.hotPixelRatio
+            || a.darkCurrent != b.darkCurrent;
+}
+
+void POASimGetDefaultSettings(POASimSettings *pSettings)
+{
+    if(!pSettings)
+    { return; }
+
+    memset(pSettings, 0, sizeof(POASimSettings));
+    pSettings->scene = POA_SIM_STARS;
+    pSettings->render = POA_SIM_RENDER_FULL;
+    pSettings->isRealTime = POA_TRUE;
+    pSettings->seed = 1;
+    pSettings->starCount = 500;
+    pSettings->starFwhm = 3.0;
+    pSettings->planetRadius = 0.0;
+    pSettings->seeing = 0.5;
+    pSettings->seeingBlur = 0.0;
+    pSettings->driftX = 0.0;
+    pSettings->driftY = 0.0;
+    pSettings->readNoise = 3.0;
+    pSettings->darkCurrent = 0.05;
+    pSettings->hotPixelRatio = 0.0001;
+    pSettings->fullWell = 14000.0;
+    pSettings->usbBandwidth = 350.0;
+    pSettings->readoutUs = 8000.0;
+    pSettings->bufferFrames = 8;
+    pSettings->cachedFrames = 16;
+}
+
+void POASimGetDefaultProperties(POACameraProperties *pProp)
+{
+    if(!pProp)
+    { return; }
+
+    memset(pProp, 0, sizeof(POACameraProperties));
+    strcpy(pProp->cameraModelName, "Simulator Camera");
+    strcpy(pProp->sensorModelName, "SIM1920");
+    strcpy(pProp->SN, "SIM00000000");
+    strcpy(pProp->localPath, "sim://0");
+    pProp->cameraID = 0;
+    pProp->maxWidth = 1920;
+    pProp->maxHeight = 1080;
+    pProp->bitDepth = 12;
+    pProp->isColorCamera = POA_TRUE;
+    pProp->isHasST4Port = POA_TRUE;
+    pProp->isHasCooler = POA_TRUE;
+    pProp->isUSB3Speed = POA_TRUE;
+    pProp->bayerPattern = POA_BAYER_RG;
+    pProp->pixelSize = 2.9;
+    pProp->bins[0] = 1;
+    pProp->bins[1] = 2;
+    pProp->bins[2] = 3;
+    pProp->bins[3] = 4;
+    pProp->imgFormats[0] = POA_RAW8;
+    pProp->imgFormats[1] = POA_RAW16;
+    pProp->imgFormats[2] = POA_RGB24;
+    pProp->imgFormats[3] = POA_MONO8;
+    for(int i = 4; i < 8; i++)
+    {
+        pProp->imgFormats[i] = POA_END;
+    }
+    pProp->isSupportHardBin = POA_FALSE;
+    pProp->pID = 0;
+}
+
+POAErrors POASimSetCameraCount(int count)
+{
+    if(count < 0)
+    { return POA_ERROR_INVALID_ARGU; }
+
+    std::lock_guard<std::mutex> lock(g_camerasMutex);
+    for(size_t i = 0; i < g_cameras.size(); i++)
+    {
+        if(g_cameras[i]->state != STATE_CLOSED)
+        { return POA_ERROR_ACCESS_DENIED; }
+    }
+
+    createCameras(count);
+    return POA_OK;
+}
+
+POAErrors POASimSetCameraProperties(int nIndex, const POACameraProperties *pProp)
+{
+    if(!pProp)
+    { return POA_ERROR_POINTER; }
+
+    if(pProp->maxWidth < 4 || pProp->maxHeight < 2)
+    { return POA_ERROR_INVALID_ARGU; }
+
+    CameraLock camera(nIndex, false);
+    if(camera.error() != POA_OK)
+    { return POA_ERROR_INVALID_INDEX; }
+
+    if(camera->state != STATE_CLOSED)
+    { return POA_ERROR_ACCESS_DENIED; }
+
+    camera->prop = *pProp;
+    camera->prop.cameraID = nIndex;
+    camera->pScene.reset();
+    camera->resetConfigs();
+    return POA_OK;
+}
+
+POAErrors POASimSetSettings(int nCameraID, const POASimSettings *pSettings)
+{
+    if(!pSettings)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID, false);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(isSceneChanged(camera->settings, *pSettings))
+    {
+        camera->pScene.reset();
+    }
+    camera->settings = *pSettings;
+    if(camera->state == STATE_EXPOSING)
+    {
+        camera->ensureScene();
+        camera->restartTiming();
+    }
+
+    std::lock_guard<std::mutex> cacheLock(camera->cacheMutex);
+    camera->cachedFrames.clear();
+    return POA_OK;
+}
+
+POAErrors POASimGetSettings(int nCameraID, POASimSettings *pSettings)
+{
+    if(!pSettings)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID, false);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pSettings = camera->settings;
+    return POA_OK;
+}
+
+unsigned long long POASimGetCallCount()
+{
+    return g_callCount;
+}
+
+unsigned long long POASimGetConfigCallCount()
+{
+    return g_getConfigCount;
+}
+
+void POASimResetCallCount()
+{
+    g_callCount = 0;
+    g_getConfigCount = 0;
+}
+
+int POAGetCameraCount()
+{
+    COUNT_CALL();
+    std::lock_guard<std::mutex> lock(g_camerasMutex);
+    if(!g_isCamerasCreated)
+    {
+        createCameras(1);
+    }
+    return (int)g_cameras.size();
+}
+
+POAErrors POAGetCameraProperties(int nIndex, POACameraProperties *pProp)
+{
+    COUNT_CALL();
+    if(!pProp)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nIndex, false);
+    if(camera.error() != POA_OK)
+    { return POA_ERROR_INVALID_INDEX; }
+
+    *pProp = camera->prop;
+    return POA_OK;
+}
+
+POAErrors POAGetCameraPropertiesByID(int nCameraID, POACameraProperties *pProp)
+{
+    COUNT_CALL();
+    if(!pProp)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID, false);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pProp = camera->prop;
+    return POA_OK;
+}
+
+POAErrors POAOpenCamera(int nCameraID)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID, false);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(camera->state == STATE_CLOSED)
+    {
+        camera->resetConfigs();
+        camera->state = STATE_OPENED;
+    }
+    return POA_OK;
+}
+
+POAErrors POAInitCamera(int nCameraID)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(camera->state == STATE_EXPOSING)
+    { return POA_ERROR_EXPOSING; }
+
+    camera->resetConfigs();
+    return POA_OK;
+}
+
+POAErrors POACloseCamera(int nCameraID)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID, false);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    camera->state = STATE_CLOSED;
+    camera->frameReady.notify_all();
+    return POA_OK;
+}
+
+POAErrors POAGetConfigsCount(int nCameraID, int *pConfCount)
+{
+    COUNT_CALL();
+    if(!pConfCount)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    int count = 0;
+    for(int i = 0; i < CONFIG_COUNT; i++)
+    {
+        count += camera->hasConfig((POAConfig)i) ? 1 : 0;
+    }
+    *pConfCount = count;
+    return POA_OK;
+}
+
+static void fillConfigAttributes(const SimCamera &camera, POAConfig confID, POAConfigAttributes *pConfAttr)
+{
+    const ConfigInfo &info = g_configInfos[confID];
+
+    memset(pConfAttr, 0, sizeof(POAConfigAttributes));
+    pConfAttr->configID = confID;
+    pConfAttr->valueType = info.valueType;
+    pConfAttr->isReadable = POA_TRUE;
+    pConfAttr->isWritable = info.isWritable ? POA_TRUE : POA_FALSE;
+    pConfAttr->isSupportAuto = info.isSupportAuto ? POA_TRUE : POA_FALSE;
+
+    if(info.valueType == VAL_FLOAT)
+    {
+        pConfAttr->minValue.floatValue = info.minValue;
+        pConfAttr->maxValue.floatValue = info.maxValue;
+        pConfAttr->defaultValue.floatValue = info.defaultValue;
+    }
+    else if(info.valueType == VAL_BOOL)
+    {
+        pConfAttr->minValue.boolValue = POA_FALSE;
+        pConfAttr->maxValue.boolValue = POA_TRUE;
+        pConfAttr->defaultValue.boolValue = info.defaultValue != 0.0 ? POA_TRUE : POA_FALSE;
+    }
+    else
+    {
+        pConfAttr->minValue.intValue = (long)info.minValue;
+        pConfAttr->maxValue.intValue = (long)info.maxValue;
+        pConfAttr->defaultValue.intValue = (long)info.defaultValue;
+    }
+
+    if(confID == POA_EGAIN)
+    {
+        pConfAttr->defaultValue.floatValue = camera.settings.fullWell / (1 << camera.bitDepth());
+    }
+
+    strncpy(pConfAttr->szConfName, info.name, sizeof(pConfAttr->szConfName) - 1);
+    strncpy(pConfAttr->szDescription, info.description, sizeof(pConfAttr->szDescription) - 1);
+}
+
+POAErrors POAGetConfigAttributes(int nCameraID, int nConfIndex, POAConfigAttributes *pConfAttr)
+{
+    COUNT_CALL();
+    if(!pConfAttr)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    // the index counts the configs of this camera only
+    int index = 0;
+    for(int i = 0; i < CONFIG_COUNT; i++)
+    {
+        if(!camera->hasConfig((POAConfig)i))
+        { continue; }
+
+        if(index == nConfIndex)
+        {
+            fillConfigAttributes(*camera.operator->(), (POAConfig)i, pConfAttr);
+            return POA_OK;
+        }
+        index++;
+    }
+
+    return POA_ERROR_INVALID_INDEX;
+}
+
+POAErrors POAGetConfigAttributesByConfigID(int nCameraID, POAConfig confID, POAConfigAttributes *pConfAttr)
+{
+    COUNT_CALL();
+    if(!pConfAttr)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(!camera->hasConfig(confID))
+    { return POA_ERROR_INVALID_CONFIG; }
+
+    fillConfigAttributes(*camera.operator->(), confID, pConfAttr);
+    return POA_OK;
+}
+
+POAErrors POASetConfig(int nCameraID, POAConfig confID, POAConfigValue confValue, POABool isAuto)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(!camera->hasConfig(confID))
+    { return POA_ERROR_INVALID_CONFIG; }
+
+    const ConfigInfo &info = g_configInfos[confID];
+    if(!info.isWritable)
+    { return POA_ERROR_CONF_CANNOT_WRITE; }
+
+    // the values out of the range are clamped as the camera does
+    if(info.valueType == VAL_INT)
+    {
+        confValue.intValue = (long)std::min(std::max((double)confValue.intValue, info.minValue), info.maxValue);
+    }
+    else if(info.valueType == VAL_FLOAT)
+    {
+        confValue.floatValue = std::min(std::max(confValue.floatValue, info.minValue), info.maxValue);
+    }
+    else
+    {
+        confValue.boolValue = confValue.boolValue ? POA_TRUE : POA_FALSE;
+    }
+
+    if(confID == POA_COOLER || confID == POA_TARGET_TEMP)
+    {
+        camera->changeCooler();
+    }
+
+    switch (confID)
+    {
+    case POA_FLIP_NONE:
+    case POA_FLIP_HORI:
+    case POA_FLIP_VERT:
+    case POA_FLIP_BOTH:
+        // the value is ignored, the flip set is the one on
+        for(int i = POA_FLIP_NONE; i <= POA_FLIP_BOTH; i++)
+        {
+            camera->configs[i].boolValue = i == confID ? POA_TRUE : POA_FALSE;
+        }
+        break;
+    case POA_EXP: //POA_EXPOSURE and POA_EXP are the same exposure in different unit
+        camera->configs[POA_EXP] = confValue;
+        camera->configs[POA_EXPOSURE].intValue = std::max(10L, (long)(confValue.floatValue * 1000000.0 + 0.5));
+        camera->configAutos[POA_EXPOSURE] = isAuto;
+        break;
+    case POA_EXPOSURE:
+        camera->configs[POA_EXPOSURE] = confValue;
+        camera->configs[POA_EXP].floatValue = confValue.intValue / 1000000.0;
+        camera->configAutos[POA_EXP] = isAuto;
+        break;
+    default:
+        camera->configs[confID] = confValue;
+        break;
+    }
+    camera->configAutos[confID] = info.isSupportAuto ? isAuto : POA_FALSE;
+
+    if(camera->state == STATE_EXPOSING && (confID == POA_EXPOSURE || confID == POA_EXP || confID == POA_FRAME_LIMIT || confID == POA_USB_BANDWIDTH_LIMIT))
+    {
+        camera->restartTiming();
+    }
+
+    return POA_OK;
+}
+
+POAErrors POAGetConfig(int nCameraID, POAConfig confID, POAConfigValue *pConfValue, POABool *pIsAuto)
+{
+    COUNT_CALL();
+    g_getConfigCount++;
+    if(!pConfValue || !pIsAuto)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(!camera->hasConfig(confID))
+    { return POA_ERROR_INVALID_CONFIG; }
+
+    *pConfValue = camera->configs[confID];
+    *pIsAuto = camera->configAutos[confID];
+
+    // the values measured by the camera
+    switch (confID)
+    {
+    case POA_TEMPERATURE:
+        pConfValue->floatValue = floor(camera->temperature() * 10.0 + 0.5) / 10.0;
+        break;
+    case POA_EGAIN:
+        pConfValue->floatValue = camera->eGain();
+        break;
+    case POA_COOLER_POWER:
+        pConfValue->intValue = (long)((AMBIENT_TEMPERATURE - camera->coolerGoal()) / COOLER_DELTA * 100.0 + 0.5);
+        break;
+    case POA_HEATER:
+        pConfValue->boolValue = camera->configs[POA_HEATER_POWER].intValue > 0 ? POA_TRUE : POA_FALSE;
+        break;
+    default:
+        break;
+    }
+
+    return POA_OK;
+}
+
+POAErrors POAGetConfigValueType(POAConfig confID, POAValueType *pConfValueType)
+{
+    COUNT_CALL();
+    if(!pConfValueType)
+    { return POA_ERROR_POINTER; }
+
+    if(confID < 0 || confID >= CONFIG_COUNT)
+    { return POA_ERROR_INVALID_CONFIG; }
+
+    *pConfValueType = g_configInfos[confID].valueType;
+    return POA_OK;
+}
+
+POAErrors POAGetImageStartPos(int nCameraID, int *pStartX, int *pStartY)
+{
+    COUNT_CALL();
+    if(!pStartX || !pStartY)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pStartX = camera->startX;
+    *pStartY = camera->startY;
+    return POA_OK;
+}
+
+POAErrors POASetImageStartPos(int nCameraID, int startX, int startY)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(startX < 0 || startY < 0)
+    { return POA_ERROR_INVALID_ARGU; }
+
+    // the start is even, so the bayer pattern of the ROI is the one of the sensor
+    int maxWidth = camera->prop.maxWidth / camera->bin;
+    int maxHeight = camera->prop.maxHeight / camera->bin;
+    camera->startX = std::min(startX, maxWidth - camera->width) / 2 * 2;
+    camera->startY = std::min(startY, maxHeight - camera->height) / 2 * 2;
+
+    if(camera->state == STATE_EXPOSING)
+    {
+        camera->restartTiming();
+    }
+    return POA_OK;
+}
+
+POAErrors POAGetImageSize(int nCameraID, int *pWidth, int *pHeight)
+{
+    COUNT_CALL();
+    if(!pWidth || !pHeight)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pWidth = camera->width;
+    *pHeight = camera->height;
+    return POA_OK;
+}
+
+POAErrors POASetImageSize(int nCameraID, int width, int height)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(width <= 0 || height <= 0)
+    { return POA_ERROR_INVALID_ARGU; }
+
+    // width % 4 == 0 and height % 2 == 0, the start moves if the ROI goes out of the sensor
+    int maxWidth = camera->prop.maxWidth / camera->bin / 4 * 4;
+    int maxHeight = camera->prop.maxHeight / camera->bin / 2 * 2;
+    camera->width = std::max(4, std::min(width, maxWidth) / 4 * 4);
+    camera->height = std::max(2, std::min(height, maxHeight) / 2 * 2);
+    camera->startX = std::min(camera->startX, camera->prop.maxWidth / camera->bin - camera->width) / 2 * 2;
+    camera->startY = std::min(camera->startY, camera->prop.maxHeight / camera->bin - camera->height) / 2 * 2;
+
+    if(camera->state == STATE_EXPOSING)
+    {
+        camera->restartTiming();
+    }
+    return POA_OK;
+}
+
+POAErrors POAGetImageBin(int nCameraID, int *pBin)
+{
+    COUNT_CALL();
+    if(!pBin)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pBin = camera->bin;
+    return POA_OK;
+}
+
+POAErrors POASetImageBin(int nCameraID, int bin)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    bool isSupported = false;
+    for(int i = 0; i < 8 && camera->prop.bins[i] != 0; i++)
+    {
+        isSupported = isSupported || camera->prop.bins[i] == bin;
+    }
+    if(!isSupported)
+    { return POA_ERROR_INVALID_ARGU; }
+
+    // the ROI is reset to the full sensor at the new bin
+    camera->bin = bin;
+    camera->startX = camera->startY = 0;
+    camera->width = camera->prop.maxWidth / bin / 4 * 4;
+    camera->height = camera->prop.maxHeight / bin / 2 * 2;
+
+    if(camera->state == STATE_EXPOSING)
+    {
+        camera->restartTiming();
+    }
+    return POA_OK;
+}
+
+POAErrors POAGetImageFormat(int nCameraID, POAImgFormat *pImgFormat)
+{
+    COUNT_CALL();
+    if(!pImgFormat)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pImgFormat = camera->imgFormat;
+    return POA_OK;
+}
+
+POAErrors POASetImageFormat(int nCameraID, POAImgFormat imgFormat)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    bool isSupported = false;
+    for(int i = 0; i < 8 && camera->prop.imgFormats[i] != POA_END; i++)
+    {
+        isSupported = isSupported || camera->prop.imgFormats[i] == imgFormat;
+    }
+    if(!isSupported)
+    { return POA_ERROR_INVALID_ARGU; }
+
+    camera->imgFormat = imgFormat;
+
+    if(camera->state == STATE_EXPOSING)
+    {
+        camera->restartTiming();
+    }
+    return POA_OK;
+}
+
+POAErrors POAStartExposure(int nCameraID, POABool bSingleFrame)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(camera->state == STATE_EXPOSING)
+    { return POA_ERROR_EXPOSING; }
+
+    camera->ensureScene(); //before the timing starts, building the scene may take a while
+    camera->isSingleFrame = bSingleFrame == POA_TRUE;
+    camera->state = STATE_EXPOSING;
+    camera->restartTiming();
+    return POA_OK;
+}
+
+POAErrors POAStopExposure(int nCameraID)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(camera->state == STATE_EXPOSING)
+    {
+        camera->restartTiming(); //the scene time goes on
+        camera->state = STATE_OPENED;
+    }
+    camera->droppedCount = 0;
+    return POA_OK;
+}
+
+POAErrors POAGetCameraState(int nCameraID, POACameraState *pCameraState)
+{
+    COUNT_CALL();
+    if(!pCameraState)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID, false);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pCameraState = camera->state;
+    return POA_OK;
+}
+
+POAErrors POAImageReady(int nCameraID, POABool *pIsReady)
+{
+    COUNT_CALL();
+    if(!pIsReady)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pIsReady = camera->framesAvailable(SimClock::now()) > 0 ? POA_TRUE : POA_FALSE;
+    return POA_OK;
+}
+
+POAErrors POAGetImageData(int nCameraID, unsigned char *pBuf, long lBufSize, int nTimeoutms)
+{
+    COUNT_CALL();
+    if(!pBuf)
+    { return POA_ERROR_POINTER; }
+
+    if(lBufSize < 0)
+    { return POA_ERROR_INVALID_ARGU; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(camera->state != STATE_EXPOSING)
+    { return POA_ERROR_EXPOSURE_FAILED; }
+
+    long size = camera->frameBytes();
+    if(lBufSize < size)
+    { return POA_ERROR_SIZE_LESS; }
+
+    // wait for the next frame, the exposure may be stopped or restarted meanwhile
+    SimClock::time_point deadline = SimClock::now() + std::chrono::milliseconds(nTimeoutms >= 0 ? nTimeoutms : 0);
+    while(camera->framesAvailable(SimClock::now()) == 0)
+    {
+        if(camera->state != STATE_EXPOSING)
+        { return camera->state == STATE_CLOSED ? POA_ERROR_NOT_OPENED : POA_ERROR_EXPOSURE_FAILED; }
+
+        SimClock::time_point readyTime = camera->isSingleFrame && camera->framesTaken > 0 ? SimClock::time_point::max() : camera->nextFrameTime();
+        if(nTimeoutms >= 0 && readyTime > deadline)
+        {
+            if(SimClock::now() >= deadline)
+            { return POA_ERROR_TIMEOUT; }
+
+            camera->frameReady.wait_until(camera.lock(), deadline);
+        }
+        else
+        {
+            camera->frameReady.wait_until(camera.lock(), readyTime);
+        }
+    }
+
+    size = camera->frameBytes(); //the format or the ROI may have changed while waiting
+    if(lBufSize < size)
+    { return POA_ERROR_SIZE_LESS; }
+
+    camera->framesTaken++;
+    camera->frameNumber++;
+    if(camera->isSingleFrame)
+    {
+        camera->state = STATE_OPENED;
+    }
+
+    POASimRender render = camera->settings.render;
+    long long frameNumber = camera->frameNumber;
+    if(render == POA_SIM_RENDER_NONE)
+    {
+        // touch the first bytes only, the simulator should cost as little as possible
+        memset(pBuf, (int)(frameNumber & 0xFF), (size_t)(size < 4096 ? size : 4096));
+        return POA_OK;
+    }
+
+    SimFrameParams params;
+    camera->frameParams(params);
+    SimFrameParams frameParams = params;
+    camera->frameMotion(frameParams);
+    std::shared_ptr<const SimScene> pScene = camera->pScene;
+    int cachedFrames = std::max(camera->settings.cachedFrames, 1);
+    SimCamera *pCamera = camera.operator->();
+    camera.lock().unlock(); //render without the lock, the camera can be controlled meanwhile
+
+    if(render == POA_SIM_RENDER_CACHED)
+    {
+        // a cycle of frames for the parameters without the motion, rendered at their first use
+        std::lock_guard<std::mutex> cacheLock(pCamera->cacheMutex);
+        if(memcmp(&params, &pCamera->cacheKey, sizeof(params)) != 0 || (int)pCamera->cachedFrames.size() != cachedFrames)
+        {
+            pCamera->cacheKey = params;
+            pCamera->cachedFrames.assign(cachedFrames, std::vector<unsigned char>());
+        }
+
+        std::vector<unsigned char> &cached = pCamera->cachedFrames[frameNumber % cachedFrames];
+        if(cached.empty())
+        {
+            cached.resize((size_t)size);
+            pScene->renderFrame(frameParams, cached.data());
+        }
+        memcpy(pBuf, cached.data(), (size_t)size);
+        return POA_OK;
+    }
+
+    pScene->renderFrame(frameParams, pBuf);
+    return POA_OK;
+}
+
+POAErrors POAGetDroppedImagesCount(int nCameraID, int *pDroppedCount)
+{
+    COUNT_CALL();
+    if(!pDroppedCount)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    camera->framesAvailable(SimClock::now()); //count the frames dropped until now
+    *pDroppedCount = camera->droppedCount;
+    return POA_OK;
+}
+
+POAErrors POAGetSensorModeCount(int nCameraID, int *pModeCount)
+{
+    COUNT_CALL();
+    if(!pModeCount)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pModeCount = SENSOR_MODE_COUNT;
+    return POA_OK;
+}
+
+POAErrors POAGetSensorModeInfo(int nCameraID, int modeIndex, POASensorModeInfo *pSenModeInfo)
+{
+    COUNT_CALL();
+    if(!pSenModeInfo)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(modeIndex < 0 || modeIndex >= SENSOR_MODE_COUNT)
+    { return POA_ERROR_INVALID_INDEX; }
+
+    memset(pSenModeInfo, 0, sizeof(POASensorModeInfo));
+    strncpy(pSenModeInfo->name, g_sensorModeNames[modeIndex][0], sizeof(pSenModeInfo->name) - 1);
+    strncpy(pSenModeInfo->desc, g_sensorModeNames[modeIndex][1], sizeof(pSenModeInfo->desc) - 1);
+    return POA_OK;
+}
+
+POAErrors POASetSensorMode(int nCameraID, int modeIndex)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(camera->state == STATE_EXPOSING)
+    { return POA_ERROR_EXPOSING; }
+
+    if(modeIndex < 0 || modeIndex >= SENSOR_MODE_COUNT)
+    { return POA_ERROR_INVALID_INDEX; }
+
+    camera->sensorMode = modeIndex;
+    return POA_OK;
+}
+
+POAErrors POAGetSensorMode(int nCameraID, int *pModeIndex)
+{
+    COUNT_CALL();
+    if(!pModeIndex)
+    { return POA_ERROR_POINTER; }
+
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    *pModeIndex = camera->sensorMode;
+    return POA_OK;
+}
+
+POAErrors POASetUserCustomID(int nCameraID, const char* pCustomID, int len)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    if(camera->state == STATE_EXPOSING)
+    { return POA_ERROR_EXPOSING; }
+
+    // NULL or 0 clears it, the extra part is cut off(the last byte is kept for the terminator)
+    char *pDst = camera->prop.userCustomID;
+    memset(pDst, 0, sizeof(camera->prop.userCustomID));
+    if(pCustomID && len > 0)
+    {
+        strncpy(pDst, pCustomID, std::min((size_t)len, sizeof(camera->prop.userCustomID) - 1));
+    }
+    return POA_OK;
+}
+
+POAErrors POAGetGainOffset(int nCameraID, int *pOffsetHighestDR, int *pOffsetUnityGain, int *pGainLowestRN, int *pOffsetLowestRN, int *pHCGain)
+{
+    return POAGetGainsAndOffsets(nCameraID, nullptr, pHCGain, nullptr, pGainLowestRN, pOffsetHighestDR, nullptr, pOffsetUnityGain, pOffsetLowestRN);
+}
+
+POAErrors POAGetGainsAndOffsets(int nCameraID, int *pGainHighestDR, int *pHCGain, int *pUnityGain, int *pGainLowestRN,
+                                int *pOffsetHighestDR, int *pOffsetHCGain, int *pOffsetUnityGain, int *pOffsetLowestRN)
+{
+    COUNT_CALL();
+    CameraLock camera(nCameraID, false);
+    if(camera.error() != POA_OK)
+    { return camera.error(); }
+
+    // the simulated sensor has no HCG mode, the HCG presets are the unity gain
+    int unityGain = camera->unityGain();
+    int offset = (int)g_configInfos[POA_OFFSET].defaultValue;
+    if(pGainHighestDR) { *pGainHighestDR = 0; }
+    if(pHCGain) { *pHCGain = unityGain; }
+    if(pUnityGain) { *pUnityGain = unityGain; }
+    if(pGainLowestRN) { *pGainLowestRN = 350; }
+    if(pOffsetHighestDR) { *pOffsetHighestDR = offset; }
+    if(pOffsetHCGain) { *pOffsetHCGain = offset; }
+    if(pOffsetUnityGain) { *pOffsetUnityGain = offset; }
+    if(pOffsetLowestRN) { *pOffsetLowestRN = offset * 2; }
+
+    return POA_OK;
+}
+
+const char* POAGetErrorString(POAErrors err)
+{
+    COUNT_CALL();
+    if(err < 0 || err >= (int)(sizeof(g_errorStrings) / sizeof(g_errorStrings[0])))
+    { return "Unknown error"; }
+
+    return g_errorStrings[err];
+}
+
+int POAGetAPIVersion()
+{
+    COUNT_CALL();
+    return 20250101;
+}
+
+const char* POAGetSDKVersion()
+{
+    COUNT_CALL();
+    return "3.8.1-sim";
+}
+
+POAErrors POASetConfig_M(int nCameraID, POAConfig confID, double cfgVal, POABool isAuto)
+{
+    POAValueType valueType = VAL_INT;
+    if(confID >= 0 && confID < CONFIG_COUNT)
+    { valueType = g_configInfos[confID].valueType; }
+
+    POAConfigValue confValue;
+    if(valueType == VAL_FLOAT)
+    { confValue.floatValue = cfgVal; }
+    else if(valueType == VAL_BOOL)
+    { confValue.boolValue = cfgVal != 0.0 ? POA_TRUE : POA_FALSE; }
+    else
+    { confValue.intValue = (long)cfgVal; }
+
+    return POASetConfig(nCameraID, confID, confValue, isAuto);
+}
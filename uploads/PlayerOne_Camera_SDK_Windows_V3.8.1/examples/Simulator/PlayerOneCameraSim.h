@@ -0,0 +1,103 @@
+#ifndef PLAYERONECAMERASIM_H
+#define PLAYERONECAMERASIM_H
+
+#include "PlayerOneCamera.h"
+
+/*******************************************************************************
+A simulated PlayerOneCamera library: every function of PlayerOneCamera.h is
+implemented without a camera, so the wrapper, the examples and the benchmarks can
+be built and profiled on any machine(eg: a headless Linux box). Link it instead of
+the PlayerOneCamera library, the camera ID of a simulated camera is its index.
+The frames are rendered from a deterministic scene(a star field, a planetary disc,
+an evenly lit field or no light) with the model of a CMOS sensor: gain, offset, bin,
+ROI, read noise, shot noise, dark current(with the temperature), hot pixels, column
+bias and the ADC depth.
+The frame timing is modelled too: in video mode a frame is ready every
+max(exposure, readout, USB transfer, frame rate limit), the camera buffers some
+frames(DDR) and drops the next ones if the host doesn't take them in time
+(see POAGetDroppedImagesCount). Without real time(isRealTime == POA_FALSE) the
+frames are ready at once, the rate is only limited by the caller and the rendering.
+The functions below configure the simulation, call them before POAOpenCamera.
+*******************************************************************************/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum _POASimScene
+{
+    POA_SIM_STARS = 0,          ///< gaussian stars on a sky background
+    POA_SIM_PLANET,             ///< a planetary disc with limb darkening and bands
+    POA_SIM_FLAT,               ///< an evenly lit field with vignetting and dust shadows, for the flat frames
+    POA_SIM_DARK                ///< no light, only bias, dark current and hot pixels, for the bias and dark frames
+} POASimScene;
+
+typedef enum _POASimRender
+{
+    POA_SIM_RENDER_FULL = 0,    ///< every frame is rendered: scene motion, seeing, noise
+    POA_SIM_RENDER_CACHED,      ///< a cycle of frames is rendered once and copied, a frame costs a memcpy
+    POA_SIM_RENDER_NONE         ///< the pixels are not written(only the first bytes), to profile the caller
+} POASimRender;
+
+typedef struct _POASimSettings
+{
+    POASimScene scene;
+    POASimRender render;
+    POABool isRealTime;         ///< POA_TRUE: the frames are ready at the frame rate of the camera, POA_FALSE: at once
+    unsigned int seed;          ///< the scene, the sensor defects and the noise depend on it only
+
+    int starCount;              ///< POA_SIM_STARS
+    double starFwhm;            ///< pixels
+    double planetRadius;        ///< POA_SIM_PLANET, pixels, 0: 1/6 of the smaller side of the sensor
+
+    double seeing;              ///< rms of the random image motion, pixels per frame
+    double seeingBlur;          ///< the most blur of a frame by the seeing(gaussian sigma, pixels), 0: every frame is sharp
+    double driftX;              ///< the image motion, pixels per second(eg: a mount without tracking)
+    double driftY;
+
+    double readNoise;           ///< e-, at gain 0
+    double darkCurrent;         ///< e-/s/pixel at 20C, doubles every 6C
+    double hotPixelRatio;       ///< hot pixels / all pixels
+    double fullWell;            ///< e-, the full well is the ADC range at gain 0
+
+    double usbBandwidth;        ///< MB/s with USB3 at POA_USB_BANDWIDTH_LIMIT 100(USB2: 40MB/s), 0: not limited
+    double readoutUs;           ///< the time to read all the rows of the sensor, us
+    int bufferFrames;           ///< the frames the camera can hold(DDR) before it drops frames
+    int cachedFrames;           ///< the frames of POA_SIM_RENDER_CACHED
+} POASimSettings;
+
+POACAMERA_API void POASimGetDefaultSettings(POASimSettings *pSettings);
+
+POACAMERA_API void POASimGetDefaultProperties(POACameraProperties *pProp); //a 1920x1080 12 bit color camera with cooler and ST4
+
+/**
+ * POASimSetCameraCount: set the count of simulated cameras(default: 1), the cameras get the default properties and settings
+ * return POA_ERROR_ACCESS_DENIED if a camera is open
+ */
+POACAMERA_API POAErrors POASimSetCameraCount(int count);
+
+/**
+ * POASimSetCameraProperties: the properties of the camera at nIndex(maxWidth, bitDepth, bins, imgFormats...),
+ * the cameraID is kept(== nIndex), return POA_ERROR_ACCESS_DENIED if the camera is open
+ */
+POACAMERA_API POAErrors POASimSetCameraProperties(int nIndex, const POACameraProperties *pProp);
+
+/**
+ * POASimSetSettings: the settings of the simulation, they can be changed at any time,
+ * the scene is built again at the next frame if it changed
+ */
+POACAMERA_API POAErrors POASimSetSettings(int nCameraID, const POASimSettings *pSettings);
+
+POACAMERA_API POAErrors POASimGetSettings(int nCameraID, POASimSettings *pSettings);
+
+POACAMERA_API unsigned long long POASimGetCallCount();       //calls of all functions of PlayerOneCamera.h since the last reset
+
+POACAMERA_API unsigned long long POASimGetConfigCallCount(); //calls of POAGetConfig since the last reset
+
+POACAMERA_API void POASimResetCallCount();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PLAYERONECAMERASIM_H
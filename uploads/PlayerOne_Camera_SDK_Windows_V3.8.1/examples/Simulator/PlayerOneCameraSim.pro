@@ -0,0 +1,18 @@
+TEMPLATE = lib
+TARGET = PlayerOneCamera
+CONFIG += c++11 release
+CONFIG -= qt
+
+# the simulated camera, the library has the name of the real one, so it's a drop-in replacement
+SOURCES += \
+        PlayerOneCameraSim.cpp \
+        SimScene.cpp
+
+HEADERS += \
+    PlayerOneCameraSim.h \
+    SimScene.h
+
+unix: LIBS += -lpthread
+
+INCLUDEPATH += $$PWD/../../include
+DEPENDPATH += $$PWD/../../include
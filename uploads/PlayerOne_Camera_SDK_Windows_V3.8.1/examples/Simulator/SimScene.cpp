@@ -0,0 +1,492 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "SimScene.h"
+
+using namespace std;
+
+static const double PI = 3.14159265358979323846;
+static const int MAX_SCENE_PIXELS = 16 * 1024 * 1024;
+static const int NOISE_TABLE_SIZE = 65536; //indexed by the high 16 bits of a xorshift32
+
+static uint64_t splitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double uniform(uint64_t &state) //(0, 1]
+{
+    return ((splitMix64(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double gaussian(uint64_t &state)
+{
+    double u1 = uniform(state);
+    double u2 = uniform(state);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2);
+}
+
+static vector<float> makeNoiseTable()
+{
+    vector<float> table(NOISE_TABLE_SIZE);
+    uint64_t state = 0x5EED;
+    for(int i = 0; i < NOISE_TABLE_SIZE; i++)
+    {
+        table[i] = (float)gaussian(state);
+    }
+    return table;
+}
+
+static const float *noiseTable()
+{
+    static const vector<float> table = makeNoiseTable(); //thread safe since C++11
+    return table.data();
+}
+
+static inline uint32_t xorShift32(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// the color(0: R, 1: G, 2: B) of the pixel at(x, y)
+static inline int bayerChannel(POABayerPattern bayerPattern, int x, int y)
+{
+    static const int channels[4][4] = { {0, 1, 1, 2},   //RG
+                                        {2, 1, 1, 0},   //BG
+                                        {1, 0, 2, 1},   //GR
+                                        {1, 2, 0, 1} }; //GB
+    return channels[bayerPattern][(y & 1) * 2 + (x & 1)];
+}
+
+SimScene::SimScene(const POASimSettings &settings, int sensorWidth, int sensorHeight, bool isColor)
+    : m_nSensorWidth(sensorWidth), m_nSensorHeight(sensorHeight), m_nStep(1), m_nSeed(settings.seed), m_sky(0.0f)
+{
+    while((long long)(sensorWidth / m_nStep) * (sensorHeight / m_nStep) > MAX_SCENE_PIXELS)
+    {
+        m_nStep *= 2;
+    }
+    m_nWidth = (sensorWidth + m_nStep - 1) / m_nStep;
+    m_nHeight = (sensorHeight + m_nStep - 1) / m_nStep;
+
+    m_colorWeights[0] = m_colorWeights[1] = m_colorWeights[2] = 1.0f;
+
+    switch (settings.scene)
+    {
+    case POA_SIM_STARS:
+        buildStars(settings);
+        break;
+    case POA_SIM_PLANET:
+        buildPlanet(settings);
+        break;
+    case POA_SIM_FLAT:
+        buildFlat();
+        break;
+    default:
+        break; //POA_SIM_DARK: no plane, no light
+    }
+
+    if(!isColor)
+    {
+        m_colorWeights[0] = m_colorWeights[1] = m_colorWeights[2] = 1.0f;
+    }
+    m_grayWeight = (m_colorWeights[0] + 2.0f * m_colorWeights[1] + m_colorWeights[2]) / 4.0f;
+
+    if(!m_levels.empty() && settings.seeingBlur > 0.0)
+    {
+        buildBlurLevels(settings.seeingBlur);
+    }
+
+    buildDefects(settings);
+}
+
+int SimScene::sensorWidth() const
+{
+    return m_nSensorWidth;
+}
+
+int SimScene::sensorHeight() const
+{
+    return m_nSensorHeight;
+}
+
+int SimScene::levelCount() const
+{
+    return m_levels.empty() ? 1 : (int)m_levels.size();
+}
+
+uint64_t SimScene::seed() const
+{
+    return m_nSeed;
+}
+
+void SimScene::buildStars(const POASimSettings &settings)
+{
+    m_levels.assign(1, vector<float>((size_t)m_nWidth * m_nHeight, 0.0f));
+    vector<float> &plane = m_levels[0];
+
+    m_sky = 20.0f;
+    std::fill(plane.begin(), plane.end(), m_sky);
+
+    uint64_t state = m_nSeed * 2654435761ULL + 1;
+    double sigma = (settings.starFwhm > 0.0 ? settings.starFwhm : 3.0) / 2.3548;
+    double sigmaScene = sigma / m_nStep;
+    int radius = (int)ceil(4.0 * sigmaScene);
+
+    for(int i = 0; i < settings.starCount; i++)
+    {
+        double cx = uniform(state) * m_nWidth;
+        double cy = uniform(state) * m_nHeight;
+        double flux = std::min(300.0 * pow(uniform(state), -1.0 / 0.6), 3.0e6); //e-/s, many faint stars and a few bright ones
+        double peak = flux / (2.0 * PI * sigma * sigma);
+
+        int x0 = std::max(0, (int)cx - radius), x1 = std::min(m_nWidth - 1, (int)cx + radius);
+        int y0 = std::max(0, (int)cy - radius), y1 = std::min(m_nHeight - 1, (int)cy + radius);
+        for(int y = y0; y <= y1; y++)
+        {
+            double dy = y + 0.5 - cy;
+            for(int x = x0; x <= x1; x++)
+            {
+                double dx = x + 0.5 - cx;
+                plane[(size_t)y * m_nWidth + x] += (float)(peak * exp(-(dx * dx + dy * dy) / (2.0 * sigmaScene * sigmaScene)));
+            }
+        }
+    }
+}
+
+void SimScene::buildPlanet(const POASimSettings &settings)
+{
+    m_levels.assign(1, vector<float>((size_t)m_nWidth * m_nHeight, 0.0f));
+    vector<float> &plane = m_levels[0];
+
+    m_sky = 3.0f;
+    m_colorWeights[0] = 1.0f;
+    m_colorWeights[1] = 0.85f;
+    m_colorWeights[2] = 0.62f;
+
+    double radius = settings.planetRadius > 0.0 ? settings.planetRadius : std::min(m_nSensorWidth, m_nSensorHeight) / 6.0;
+    radius /= m_nStep;
+    double cx = m_nWidth / 2.0, cy = m_nHeight / 2.0;
+
+    // a storm at a place given by the seed
+    uint64_t state = m_nSeed * 2654435761ULL + 7;
+    double spotX = cx + (uniform(state) - 0.5) * radius;
+    double spotY = cy + (uniform(state) - 0.5) * radius;
+    double spotSize = 0.12 * radius;
+
+    for(int y = 0; y < m_nHeight; y++)
+    {
+        double dy = y + 0.5 - cy;
+        double latitude = dy / radius;
+        double bands = 1.0 + 0.15 * sin(latitude * PI * 4.5) + 0.05 * sin(latitude * PI * 13.0);
+        for(int x = 0; x < m_nWidth; x++)
+        {
+            double dx = x + 0.5 - cx;
+            double d = sqrt(dx * dx + dy * dy);
+            double coverage = std::min(1.0, std::max(0.0, radius - d + 0.5)); //the edge is antialiased
+            float value = m_sky;
+            if(coverage > 0.0)
+            {
+                double r = std::min(d / radius, 1.0);
+                double mu = sqrt(1.0 - r * r);
+                double limb = 0.4 + 0.6 * mu;
+                double sx = x + 0.5 - spotX, sy = y + 0.5 - spotY;
+                double spot = 1.0 - 0.3 * exp(-(sx * sx + sy * sy) / (2.0 * spotSize * spotSize));
+                value += (float)(coverage * 1.5e5 * limb * bands * spot);
+            }
+            plane[(size_t)y * m_nWidth + x] = value;
+        }
+    }
+}
+
+void SimScene::buildFlat()
+{
+    m_levels.assign(1, vector<float>((size_t)m_nWidth * m_nHeight, 0.0f));
+    vector<float> &plane = m_levels[0];
+
+    m_colorWeights[0] = 0.75f;
+    m_colorWeights[1] = 1.0f;
+    m_colorWeights[2] = 0.65f;
+
+    // the shadows of the dust on the sensor window, fixed by the seed
+    const int DUST_COUNT = 3;
+    double dustX[DUST_COUNT], dustY[DUST_COUNT], dustR[DUST_COUNT];
+    uint64_t state = m_nSeed * 2654435761ULL + 13;
+    for(int i = 0; i < DUST_COUNT; i++)
+    {
+        dustX[i] = uniform(state) * m_nWidth;
+        dustY[i] = uniform(state) * m_nHeight;
+        dustR[i] = (20.0 + uniform(state) * 40.0) / m_nStep;
+    }
+
+    double cx = m_nWidth / 2.0, cy = m_nHeight / 2.0;
+    double corner2 = cx * cx + cy * cy;
+    for(int y = 0; y < m_nHeight; y++)
+    {
+        double dy = y + 0.5 - cy;
+        for(int x = 0; x < m_nWidth; x++)
+        {
+            double dx = x + 0.5 - cx;
+            double value = 3.0e4 * (1.0 - 0.35 * (dx * dx + dy * dy) / corner2); //vignetting
+            for(int i = 0; i < DUST_COUNT; i++)
+            {
+                double ddx = x + 0.5 - dustX[i], ddy = y + 0.5 - dustY[i];
+                double d = sqrt(ddx * ddx + ddy * ddy);
+                double ring = (d - dustR[i]) / (0.2 * dustR[i]);
+                value *= 1.0 - 0.06 * exp(-ring * ring) - (d < dustR[i] ? 0.03 : 0.0);
+            }
+            plane[(size_t)y * m_nWidth + x] = (float)value;
+        }
+    }
+}
+
+void SimScene::buildDefects(const POASimSettings &settings)
+{
+    uint64_t state = m_nSeed * 2654435761ULL + 29;
+
+    m_columnBias.resize(m_nSensorWidth);
+    for(int x = 0; x < m_nSensorWidth; x++)
+    {
+        m_columnBias[x] = (float)(0.6 * gaussian(state));
+    }
+
+    long long hotCount = (long long)(std::max(0.0, settings.hotPixelRatio) * m_nSensorWidth * m_nSensorHeight);
+    double baseCurrent = std::max(settings.darkCurrent, 0.01);
+    m_hotPixels.resize((size_t)hotCount);
+    for(size_t i = 0; i < m_hotPixels.size(); i++)
+    {
+        m_hotPixels[i].x = std::min((int)(uniform(state) * m_nSensorWidth), m_nSensorWidth - 1);
+        m_hotPixels[i].y = std::min((int)(uniform(state) * m_nSensorHeight), m_nSensorHeight - 1);
+        double u = uniform(state);
+        m_hotPixels[i].current = (float)(baseCurrent * (20.0 + 480.0 * u * u));
+    }
+    std::sort(m_hotPixels.begin(), m_hotPixels.end(), [](const HotPixel &a, const HotPixel &b) { return a.y < b.y || (a.y == b.y && a.x < b.x); });
+
+    m_hotRowBegin.assign(m_nSensorHeight + 1, 0);
+    size_t index = 0;
+    for(int y = 0; y <= m_nSensorHeight; y++)
+    {
+        while(index < m_hotPixels.size() && m_hotPixels[index].y < y)
+        {
+            index++;
+        }
+        m_hotRowBegin[y] = (int)index;
+    }
+}
+
+void SimScene::buildBlurLevels(double maxSigma)
+{
+    m_levels.reserve(BLUR_LEVELS); //sharp stays valid while the levels are added
+    const vector<float> &sharp = m_levels[0];
+    vector<float> temp(sharp.size());
+
+    for(int level = 1; level < BLUR_LEVELS; level++)
+    {
+        double sigma = maxSigma * level / (BLUR_LEVELS - 1) / m_nStep;
+        int radius = std::max(1, (int)ceil(3.0 * sigma));
+        vector<float> kernel(2 * radius + 1);
+        float sum = 0.0f;
+        for(int i = -radius; i <= radius; i++)
+        {
+            kernel[i + radius] = (float)exp(-i * i / (2.0 * sigma * sigma));
+            sum += kernel[i + radius];
+        }
+        for(size_t i = 0; i < kernel.size(); i++)
+        {
+            kernel[i] /= sum;
+        }
+
+        // separable, the edges are clamped
+        for(int y = 0; y < m_nHeight; y++)
+        {
+            const float *pSrc = &sharp[(size_t)y * m_nWidth];
+            float *pDst = &temp[(size_t)y * m_nWidth];
+            for(int x = 0; x < m_nWidth; x++)
+            {
+                float value = 0.0f;
+                for(int i = -radius; i <= radius; i++)
+                {
+                    value += kernel[i + radius] * pSrc[std::min(std::max(x + i, 0), m_nWidth - 1)];
+                }
+                pDst[x] = value;
+            }
+        }
+
+        vector<float> blurred(sharp.size());
+        for(int y = 0; y < m_nHeight; y++)
+        {
+            float *pDst = &blurred[(size_t)y * m_nWidth];
+            for(int x = 0; x < m_nWidth; x++)
+            {
+                pDst[x] = 0.0f;
+            }
+            for(int i = -radius; i <= radius; i++)
+            {
+                const float *pSrc = &temp[(size_t)std::min(std::max(y + i, 0), m_nHeight - 1) * m_nWidth];
+                float k = kernel[i + radius];
+                for(int x = 0; x < m_nWidth; x++)
+                {
+                    pDst[x] += k * pSrc[x];
+                }
+            }
+        }
+
+        m_levels.push_back(std::move(blurred));
+    }
+}
+
+void SimScene::renderFrame(const SimFrameParams &params, unsigned char *pBuf) const
+{
+    const int width = params.width, height = params.height, bin = params.bin;
+    const int pixelCount = bin * bin;
+    const float *pPlane = m_levels.empty() ? nullptr : m_levels[std::min(std::max(params.blurLevel, 0), (int)m_levels.size() - 1)].data();
+    const float *pNoise = noiseTable();
+
+    // the scratch of the rendering thread, allocated at the first frame of a size only
+    thread_local vector<int> sceneColumns;  //the scene column of every sensor pixel of a row, -1 out of the sensor
+    thread_local vector<int> sensorColumns; //the first sensor column of every frame column
+    thread_local vector<float> rowLight;    //e-/s of the binned pixels
+    thread_local vector<float> rowDark;
+    thread_local vector<int> rowAdc;        //the ADC value of every sample
+    const int channelCount = params.imgFormat == POA_RGB24 ? 3 : 1;
+    sceneColumns.resize((size_t)width * bin);
+    sensorColumns.resize(width);
+    rowLight.resize(width);
+    rowDark.resize(width);
+    rowAdc.resize((size_t)width * channelCount);
+    int *pSceneColumns = sceneColumns.data(); //the thread local vectors are not accessed in the loops
+    int *pSensorColumns = sensorColumns.data();
+    float *pLight = rowLight.data();
+    float *pDark = rowDark.data();
+    int *pRowAdc = rowAdc.data();
+
+    for(int x = 0; x < width; x++)
+    {
+        int frameX = params.isFlipHori ? width - 1 - x : x;
+        int sensorX = (params.startX + frameX) * bin;
+        pSensorColumns[x] = std::min(sensorX, m_nSensorWidth - 1);
+        for(int bx = 0; bx < bin; bx++)
+        {
+            int sceneX = sensorX + bx - params.shiftX;
+            pSceneColumns[(size_t)x * bin + bx] = sceneX >= 0 && sceneX < m_nSensorWidth ? sceneX / m_nStep : -1;
+        }
+    }
+
+    const float exposure = (float)params.exposureS;
+    const float readVariance = (float)(pixelCount * params.readNoise * params.readNoise);
+    const float adcPerE = (float)(1.0 / (params.eGain * (params.isBinSum ? 1 : pixelCount)));
+    const float offset = (float)params.offset;
+    const int maxAdc = (1 << params.bitDepth) - 1;
+    const int shift16 = 16 - params.bitDepth;
+    const int shift8 = params.bitDepth - 8;
+
+    const bool isRGB = params.imgFormat == POA_RGB24;
+    const bool isBayer = !isRGB && params.imgFormat != POA_MONO8 && params.bayerPattern != POA_BAYER_MONO;
+    float channelWeights[3];
+    for(int c = 0; c < 3; c++)
+    {
+        channelWeights[c] = m_colorWeights[c] * (isRGB ? (float)params.whiteBalance[c] : 1.0f);
+    }
+
+    for(int y = 0; y < height; y++)
+    {
+        int frameY = params.isFlipVert ? height - 1 - y : y;
+        int sensorY = (params.startY + frameY) * bin;
+
+        // the light, summed over the binned pixels
+        std::fill(pLight, pLight + width, 0.0f);
+        for(int by = 0; by < bin; by++)
+        {
+            int sceneY = sensorY + by - params.shiftY;
+            const float *pRow = pPlane && sceneY >= 0 && sceneY < m_nSensorHeight ? pPlane + (size_t)(sceneY / m_nStep) * m_nWidth : nullptr;
+            if(!pRow)
+            {
+                for(int x = 0; x < width; x++)
+                {
+                    pLight[x] += m_sky * bin;
+                }
+                continue;
+            }
+
+            const int *pColumns = pSceneColumns;
+            for(int x = 0; x < width; x++)
+            {
+                float value = 0.0f;
+                for(int bx = 0; bx < bin; bx++)
+                {
+                    int column = *pColumns++;
+                    value += column >= 0 ? pRow[column] : m_sky;
+                }
+                pLight[x] += value;
+            }
+        }
+
+        // the dark current, the hot pixels stay on the sensor
+        std::fill(pDark, pDark + width, (float)(pixelCount * params.darkCurrent));
+        for(int by = 0; by < bin && sensorY + by < m_nSensorHeight; by++)
+        {
+            for(int i = m_hotRowBegin[sensorY + by]; i < m_hotRowBegin[sensorY + by + 1]; i++)
+            {
+                int frameX = m_hotPixels[i].x / bin - params.startX;
+                if(frameX >= 0 && frameX < width)
+                {
+                    pDark[params.isFlipHori ? width - 1 - frameX : frameX] += m_hotPixels[i].current;
+                }
+            }
+        }
+
+        // the weight of the light of every sample: the bayer color by the column parity, RGB24 has 3 samples per pixel(B G R)
+        float sampleWeights[2][3];
+        for(int parity = 0; parity < 2; parity++)
+        {
+            for(int c = 0; c < 3; c++)
+            {
+                sampleWeights[parity][c] = isRGB ? channelWeights[2 - c] : (isBayer ? channelWeights[bayerChannel(params.bayerPattern, parity, y)] : m_grayWeight);
+            }
+        }
+
+        uint64_t rowState = params.noiseSeed + (uint64_t)y;
+        uint32_t noiseState = (uint32_t)splitMix64(rowState) | 1;
+
+        // the noise and the ADC, into the row of ADC values first, the pixels are not aliased by the output
+        const float *pColumnBias = m_columnBias.data();
+        int *pAdc = pRowAdc;
+        for(int x = 0; x < width; x++)
+        {
+            float light = pLight[x] * exposure;
+            float dark = pDark[x] * exposure;
+            float bias = offset + pColumnBias[pSensorColumns[x]] + 0.5f;
+            const float *pWeights = sampleWeights[x & 1];
+            for(int c = 0; c < channelCount; c++)
+            {
+                float electrons = light * pWeights[c] + dark;
+                float noise = pNoise[xorShift32(noiseState) >> 16] * std::sqrt(electrons + readVariance);
+                int adc = (int)((electrons + noise) * adcPerE + bias);
+                *pAdc++ = adc < 0 ? 0 : (adc > maxAdc ? maxAdc : adc);
+            }
+        }
+
+        const int sampleCount = width * channelCount;
+        if(params.imgFormat == POA_RAW16)
+        {
+            uint16_t *pDst = (uint16_t *)pBuf + (size_t)y * width;
+            for(int i = 0; i < sampleCount; i++)
+            {
+                pDst[i] = (uint16_t)(pRowAdc[i] << shift16);
+            }
+        }
+        else
+        {
+            unsigned char *pDst = pBuf + (size_t)y * sampleCount;
+            for(int i = 0; i < sampleCount; i++)
+            {
+                pDst[i] = (unsigned char)(shift8 >= 0 ? pRowAdc[i] >> shift8 : pRowAdc[i] << -shift8);
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef SIMSCENE_H
+#define SIMSCENE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "PlayerOneCamera.h"
+#include "PlayerOneCameraSim.h"
+
+/*******************************************************************************
+The scene of a simulated camera and the renderer of its frames.
+SimScene is built once for a seed and a sensor: the light of the scene in e-/s per
+sensor pixel(a float plane, sensors above 16M pixels get a plane of 2x2 or more
+pixels per value), the same plane blurred at some levels for the seeing, and the
+defects of the sensor(the bias of every column, the hot pixels).
+renderFrame() makes a frame of the ROI, bin and format from the scene: the scene
+moves by the shift of the frame, the light of the binned pixels is summed, the
+color comes from the bayer pattern, then the dark current, the shot noise and the
+read noise(gaussian) are added and the electrons are converted by the gain and the
+offset to the ADC value, which is aligned to the format(RAW16 is left aligned as
+the camera sends it).
+The frames depend on the scene and SimFrameParams only, so they are deterministic.
+*******************************************************************************/
+
+struct SimFrameParams
+{
+    int startX;                     //the ROI, binned pixels
+    int startY;
+    int width;
+    int height;
+    int bin;
+    POAImgFormat imgFormat;
+    POABayerPattern bayerPattern;   //POA_BAYER_MONO for a mono camera or a color camera with mono bin
+    bool isBinSum;                  //sum of the binned pixels, else the average
+    bool isFlipHori;
+    bool isFlipVert;
+    int bitDepth;                   //ADC depth
+
+    double exposureS;
+    double eGain;                   //e-/ADU of the ADC
+    double offset;                  //ADU of the ADC
+    double readNoise;               //e-
+    double darkCurrent;             //e-/s/pixel at the temperature of the sensor
+    double whiteBalance[3];         //R G B multipliers of RGB24
+
+    int shiftX;                     //the motion of the scene, sensor pixels
+    int shiftY;
+    int blurLevel;                  //0: sharp, up to SimScene::levelCount() - 1
+    uint64_t noiseSeed;
+};
+
+class SimScene
+{
+public:
+    SimScene(const POASimSettings &settings, int sensorWidth, int sensorHeight, bool isColor);
+
+    int sensorWidth() const;
+
+    int sensorHeight() const;
+
+    int levelCount() const; //1 if every frame is sharp
+
+    uint64_t seed() const;
+
+    // write the frame into pBuf, the buffer must have width * height * bytes per pixel
+    void renderFrame(const SimFrameParams &params, unsigned char *pBuf) const;
+
+    static const int BLUR_LEVELS = 4;
+
+private:
+    struct HotPixel
+    {
+        int x;
+        int y;
+        float current; //e-/s more than the dark current
+    };
+
+    void buildStars(const POASimSettings &settings);
+
+    void buildPlanet(const POASimSettings &settings);
+
+    void buildFlat();
+
+    void buildDefects(const POASimSettings &settings);
+
+    void buildBlurLevels(double maxSigma);
+
+    int m_nSensorWidth;
+    int m_nSensorHeight;
+    int m_nStep;                      //sensor pixels per scene value in each direction
+    int m_nWidth;                     //the scene plane
+    int m_nHeight;
+    uint64_t m_nSeed;
+
+    float m_sky;                      //e-/s outside of the plane
+    float m_colorWeights[3];          //R G B of the light
+    float m_grayWeight;
+
+    std::vector<std::vector<float> > m_levels;
+    std::vector<float> m_columnBias;  //ADU, for every sensor column
+    std::vector<HotPixel> m_hotPixels; //sorted by y
+    std::vector<int> m_hotRowBegin;   //the first hot pixel of every sensor row, sensorHeight + 1
+};
+
+#endif // SIMSCENE_H
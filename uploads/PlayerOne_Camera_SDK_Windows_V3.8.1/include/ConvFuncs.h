@@ -3,11 +3,15 @@
 
 /***********************************************************************************************************
  * These are convenience functions, may possibly increase development efficiency, hope to help you.
- * These functions are independent of each other, you can copy any function into your code.
+ * These functions are independent of each other, but the functions of a POAConfig use GetConfigInfo() of
+ * POAConfigTraits.h, copy that header together with any function you copy into your code.
+ * The value type of a POAConfig comes from the table of POAConfigTraits.h(C++11), not from the SDK, so the
+ * typed get and set are one SDK call, the range is one POAGetConfigAttributesByConfigID call.
  * If you have any problems, please contact me: lei.zhang@player-one-astronomy.com
 ***********************************************************************************************************/
 
 #include "PlayerOneCamera.h"
+#include "POAConfigTraits.h"
 
 /***********************************************************************
 *some instructions
@@ -22,20 +26,12 @@
 //Get the current value of POAConfig with POAValueType is VAL_INT, eg: POA_EXPOSURE, POA_GAIN
 POAErrors POAGetConfig(int nCameraID, POAConfig confID, long *pValue, POABool *pIsAuto)
 {
-    POAValueType pConfValueType;
-    POAErrors error = POAGetConfigValueType(confID, &pConfValueType);
-    if (error == POA_OK)
-    {
-        if (pConfValueType != VAL_INT)
-        { return POA_ERROR_INVALID_CONFIG; }
-    }
-    else
-    {
-        return error;
-    }
+    const POAConfigInfo *pConfInfo = GetConfigInfo(confID);
+    if (!pConfInfo || pConfInfo->valueType != VAL_INT)
+    { return POA_ERROR_INVALID_CONFIG; }
 
     POAConfigValue confValue;
-    error = POAGetConfig(nCameraID, confID, &confValue, pIsAuto);
+    POAErrors error = POAGetConfig(nCameraID, confID, &confValue, pIsAuto);
 
     if(error == POA_OK)
     { *pValue = confValue.intValue; }
@@ -47,20 +43,12 @@ POAErrors POAGetConfig(int nCameraID, POAConfig confID, long *pValue, POABool *p
 //Get the current value of POAConfig with POAValueType is VAL_FLOAT, eg: POA_EXP, POA_TEMPERATURE, POA_EGAIN
 POAErrors POAGetConfig(int nCameraID, POAConfig confID, double *pValue, POABool *pIsAuto)
 {
-    POAValueType pConfValueType;
-    POAErrors error = POAGetConfigValueType(confID, &pConfValueType);
-    if (error == POA_OK)
-    {
-        if (pConfValueType != VAL_FLOAT)
-        { return POA_ERROR_INVALID_CONFIG; }
-    }
-    else
-    {
-        return error;
-    }
+    const POAConfigInfo *pConfInfo = GetConfigInfo(confID);
+    if (!pConfInfo || pConfInfo->valueType != VAL_FLOAT)
+    { return POA_ERROR_INVALID_CONFIG; }
 
     POAConfigValue confValue;
-    error = POAGetConfig(nCameraID, confID, &confValue, pIsAuto);
+    POAErrors error = POAGetConfig(nCameraID, confID, &confValue, pIsAuto);
 
     if(error == POA_OK)
     { *pValue = confValue.floatValue; }
@@ -72,23 +60,13 @@ POAErrors POAGetConfig(int nCameraID, POAConfig confID, double *pValue, POABool
 //Get the current value of POAConfig with POAValueType is VAL_BOOL, eg: POA_COOLER, POA_PIXEL_BIN_SUM
 POAErrors POAGetConfig(int nCameraID, POAConfig confID, POABool *pIsEnable)
 {
-    POAValueType pConfValueType;
-    POAErrors error = POAGetConfigValueType(confID, &pConfValueType);
-    if (error == POA_OK)
-    {
-        if (pConfValueType != VAL_BOOL)
-        {
-            return POA_ERROR_INVALID_CONFIG;
-        }
-    }
-    else
-    {
-        return error;
-    }
+    const POAConfigInfo *pConfInfo = GetConfigInfo(confID);
+    if (!pConfInfo || pConfInfo->valueType != VAL_BOOL)
+    { return POA_ERROR_INVALID_CONFIG; }
 
     POAConfigValue confValue;
     POABool boolValue;
-    error = POAGetConfig(nCameraID, confID, &confValue, &boolValue);
+    POAErrors error = POAGetConfig(nCameraID, confID, &confValue, &boolValue);
 
     if (error == POA_OK)
     { *pIsEnable = confValue.boolValue; }
@@ -100,19 +78,12 @@ POAErrors POAGetConfig(int nCameraID, POAConfig confID, POABool *pIsEnable)
 //Set the POAConfig value, the POAValueType of POAConfig is VAL_INT, eg: POA_TARGET_TEMP, POA_OFFSET
 POAErrors POASetConfig(int nCameraID, POAConfig confID, long nValue, POABool isAuto)
 {
-    POAValueType pConfValueType;
-    POAErrors error = POAGetConfigValueType(confID, &pConfValueType);
-    if (error == POA_OK)
-    {
-        if (pConfValueType != VAL_INT)
-        {
-            return POA_ERROR_INVALID_CONFIG;
-        }
-    }
-    else
-    {
-        return error;
-    }
+    const POAConfigInfo *pConfInfo = GetConfigInfo(confID);
+    if (!pConfInfo || pConfInfo->valueType != VAL_INT)
+    { return POA_ERROR_INVALID_CONFIG; }
+
+    if (!pConfInfo->isWritable)
+    { return POA_ERROR_CONF_CANNOT_WRITE; }
 
     POAConfigValue confValue;
     confValue.intValue = nValue;
@@ -124,19 +95,12 @@ POAErrors POASetConfig(int nCameraID, POAConfig confID, long nValue, POABool isA
 //Set the POAConfig value, the POAValueType of POAConfig is VAL_FLOAT, eg: POA_EXP
 POAErrors POASetConfig(int nCameraID, POAConfig confID, double fValue, POABool isAuto)
 {
-    POAValueType pConfValueType;
-    POAErrors error = POAGetConfigValueType(confID, &pConfValueType);
-    if (error == POA_OK)
-    {
-        if (pConfValueType != VAL_FLOAT)
-        {
-            return POA_ERROR_INVALID_CONFIG;
-        }
-    }
-    else
-    {
-        return error;
-    }
+    const POAConfigInfo *pConfInfo = GetConfigInfo(confID);
+    if (!pConfInfo || pConfInfo->valueType != VAL_FLOAT)
+    { return POA_ERROR_INVALID_CONFIG; }
+
+    if (!pConfInfo->isWritable)
+    { return POA_ERROR_CONF_CANNOT_WRITE; }
 
     POAConfigValue confValue;
     confValue.floatValue = fValue;
@@ -148,19 +112,12 @@ POAErrors POASetConfig(int nCameraID, POAConfig confID, double fValue, POABool i
 //Set the POAConfig value, the POAValueType of POAConfig is VAL_BOOL, eg: POA_HARDWARE_BIN, POA_GUIDE_NORTH
 POAErrors POASetConfig(int nCameraID, POAConfig confID, POABool isEnable)
 {
-    POAValueType pConfValueType;
-    POAErrors error = POAGetConfigValueType(confID, &pConfValueType);
-    if (error == POA_OK)
-    {
-        if (pConfValueType != VAL_BOOL)
-        {
-            return POA_ERROR_INVALID_CONFIG;
-        }
-    }
-    else
-    {
-        return error;
-    }
+    const POAConfigInfo *pConfInfo = GetConfigInfo(confID);
+    if (!pConfInfo || pConfInfo->valueType != VAL_BOOL)
+    { return POA_ERROR_INVALID_CONFIG; }
+
+    if (!pConfInfo->isWritable)
+    { return POA_ERROR_CONF_CANNOT_WRITE; }
 
     POAConfigValue confValue;
     confValue.boolValue = isEnable;
@@ -175,20 +132,12 @@ POAErrors GetConfigRange(int nCameraID, POAConfig confID, long *pMax, long *pMin
     if(!pMax || !pMin || !pDefult)
     { return POA_ERROR_POINTER; }
 
-    POAValueType pConfValueType;
-    POAErrors error = POAGetConfigValueType(confID, &pConfValueType);
-    if (error == POA_OK)
-    {
-        if (pConfValueType != VAL_INT)
-        { return POA_ERROR_INVALID_CONFIG; }
-    }
-    else
-    {
-        return error;
-    }
+    const POAConfigInfo *pConfInfo = GetConfigInfo(confID);
+    if (!pConfInfo || pConfInfo->valueType != VAL_INT)
+    { return POA_ERROR_INVALID_CONFIG; }
 
     POAConfigAttributes confAttri;
-    error = POAGetConfigAttributesByConfigID(nCameraID, confID, &confAttri);
+    POAErrors error = POAGetConfigAttributesByConfigID(nCameraID, confID, &confAttri);
     if(error == POA_OK)
     {
         *pMax = confAttri.maxValue.intValue;
@@ -205,20 +154,12 @@ POAErrors GetConfigRange(int nCameraID, POAConfig confID, double *pMax, double *
     if(!pMax || !pMin || !pDefult)
     { return POA_ERROR_POINTER; }
 
-    POAValueType pConfValueType;
-    POAErrors error = POAGetConfigValueType(confID, &pConfValueType);
-    if (error == POA_OK)
-    {
-        if (pConfValueType != VAL_FLOAT)
-        { return POA_ERROR_INVALID_CONFIG; }
-    }
-    else
-    {
-        return error;
-    }
+    const POAConfigInfo *pConfInfo = GetConfigInfo(confID);
+    if (!pConfInfo || pConfInfo->valueType != VAL_FLOAT)
+    { return POA_ERROR_INVALID_CONFIG; }
 
     POAConfigAttributes confAttri;
-    error = POAGetConfigAttributesByConfigID(nCameraID, confID, &confAttri);
+    POAErrors error = POAGetConfigAttributesByConfigID(nCameraID, confID, &confAttri);
     if(error == POA_OK)
     {
         *pMax = confAttri.maxValue.floatValue;
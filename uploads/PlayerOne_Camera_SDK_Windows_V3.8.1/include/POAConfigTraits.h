@@ -0,0 +1,166 @@
+#ifndef POACONFIGTRAITS_H
+#define POACONFIGTRAITS_H
+
+/***********************************************************************************************************
+ * The value type, access and unit of every POAConfig at compile time(C++11), as documented in the POAConfig
+ * enum of PlayerOneCamera.h, so the member of the POAConfigValue union is picked by the compiler instead of
+ * asking the SDK(POAGetConfigValueType) on every call, and writing intValue into POA_EXP can't compile:
+ *     long gain = 0;
+ *     POAGetConfigValue<POA_GAIN>(nCameraID, &gain);      //POAConfigTraits<POA_GAIN>::Type is long
+ *     POASetConfigValue<POA_EXP>(nCameraID, 0.5);          //POAConfigTraits<POA_EXP>::Type is double, seconds
+ *     POASetConfigValue<POA_TEMPERATURE>(nCameraID, 0.0);  //error: the POAConfig is read-only
+ * GetConfigInfo(confID) is the same table for a POAConfig known at run time only.
+ * Note: the camera may not have all the configs(eg: POA_COOLER), POAGetConfigAttributes lists them.
+***********************************************************************************************************/
+
+#include "PlayerOneCamera.h"
+
+typedef struct _POAConfigInfo
+{
+    POAConfig configID;
+    POAValueType valueType;
+    bool isWritable;
+    bool isSupportAuto;
+    const char *unit;                   //"" if none
+} POAConfigInfo;
+
+static constexpr POAConfigInfo POA_CONFIG_INFOS[POA_EXP + 1] =
+{
+    {POA_EXPOSURE,              VAL_INT,   true,  true,  "us"},
+    {POA_GAIN,                  VAL_INT,   true,  true,  ""},
+    {POA_HARDWARE_BIN,          VAL_BOOL,  true,  false, ""},
+    {POA_TEMPERATURE,           VAL_FLOAT, false, false, "C"},
+    {POA_WB_R,                  VAL_INT,   true,  false, ""},
+    {POA_WB_G,                  VAL_INT,   true,  false, ""},
+    {POA_WB_B,                  VAL_INT,   true,  false, ""},
+    {POA_OFFSET,                VAL_INT,   true,  false, ""},
+    {POA_AUTOEXPO_MAX_GAIN,     VAL_INT,   true,  false, ""},
+    {POA_AUTOEXPO_MAX_EXPOSURE, VAL_INT,   true,  false, "ms"},
+    {POA_AUTOEXPO_BRIGHTNESS,   VAL_INT,   true,  false, ""},
+    {POA_GUIDE_NORTH,           VAL_BOOL,  true,  false, ""},
+    {POA_GUIDE_SOUTH,           VAL_BOOL,  true,  false, ""},
+    {POA_GUIDE_EAST,            VAL_BOOL,  true,  false, ""},
+    {POA_GUIDE_WEST,            VAL_BOOL,  true,  false, ""},
+    {POA_EGAIN,                 VAL_FLOAT, false, false, "e/ADU"},
+    {POA_COOLER_POWER,          VAL_INT,   false, false, "%"},
+    {POA_TARGET_TEMP,           VAL_INT,   true,  false, "C"},
+    {POA_COOLER,                VAL_BOOL,  true,  false, ""},
+    {POA_HEATER,                VAL_BOOL,  false, false, ""},
+    {POA_HEATER_POWER,          VAL_INT,   true,  false, "%"},
+    {POA_FAN_POWER,             VAL_INT,   true,  false, "%"},
+    {POA_FLIP_NONE,             VAL_BOOL,  true,  false, ""},
+    {POA_FLIP_HORI,             VAL_BOOL,  true,  false, ""},
+    {POA_FLIP_VERT,             VAL_BOOL,  true,  false, ""},
+    {POA_FLIP_BOTH,             VAL_BOOL,  true,  false, ""},
+    {POA_FRAME_LIMIT,           VAL_INT,   true,  false, "fps"},
+    {POA_HQI,                   VAL_BOOL,  true,  false, ""},
+    {POA_USB_BANDWIDTH_LIMIT,   VAL_INT,   true,  false, "%"},
+    {POA_PIXEL_BIN_SUM,         VAL_BOOL,  true,  false, ""},
+    {POA_MONO_BIN,              VAL_BOOL,  true,  false, ""},
+    {POA_EXP,                   VAL_FLOAT, true,  true,  "s"}
+};
+
+constexpr bool IsConfigInfoOrdered(int index)
+{
+    return index > POA_EXP || (POA_CONFIG_INFOS[index].configID == index && IsConfigInfoOrdered(index + 1));
+}
+
+static_assert(IsConfigInfoOrdered(0), "POA_CONFIG_INFOS must list every POAConfig in the order of the enum");
+
+//The info of a POAConfig, nullptr if it's not a POAConfig of this SDK version
+constexpr const POAConfigInfo *GetConfigInfo(POAConfig confID)
+{
+    return (confID >= 0 && confID <= POA_EXP) ? &POA_CONFIG_INFOS[confID] : nullptr;
+}
+
+//The C++ type of a POAValueType and the member of POAConfigValue which holds it
+template<POAValueType VALUE_TYPE>
+struct POAConfigValueOf;
+
+template<>
+struct POAConfigValueOf<VAL_INT>
+{
+    typedef long Type;
+
+    static long get(const POAConfigValue &confValue) { return confValue.intValue; }
+
+    static POAConfigValue make(long value)
+    {
+        POAConfigValue confValue;
+        confValue.intValue = value;
+        return confValue;
+    }
+};
+
+template<>
+struct POAConfigValueOf<VAL_FLOAT>
+{
+    typedef double Type;
+
+    static double get(const POAConfigValue &confValue) { return confValue.floatValue; }
+
+    static POAConfigValue make(double value)
+    {
+        POAConfigValue confValue;
+        confValue.floatValue = value;
+        return confValue;
+    }
+};
+
+template<>
+struct POAConfigValueOf<VAL_BOOL>
+{
+    typedef bool Type;
+
+    static bool get(const POAConfigValue &confValue) { return confValue.boolValue == POA_TRUE; }
+
+    static POAConfigValue make(bool value)
+    {
+        POAConfigValue confValue;
+        confValue.boolValue = value ? POA_TRUE : POA_FALSE;
+        return confValue;
+    }
+};
+
+//The traits of a POAConfig known at compile time: Type, get(confValue), make(value), valueType, isWritable, isSupportAuto, unit()
+template<POAConfig CONF>
+struct POAConfigTraits : POAConfigValueOf<POA_CONFIG_INFOS[CONF].valueType>
+{
+    static constexpr POAValueType valueType = POA_CONFIG_INFOS[CONF].valueType;
+    static constexpr bool isWritable = POA_CONFIG_INFOS[CONF].isWritable;
+    static constexpr bool isSupportAuto = POA_CONFIG_INFOS[CONF].isSupportAuto;
+
+    static const char *unit() { return POA_CONFIG_INFOS[CONF].unit; }
+};
+
+//Get the value of a POAConfig, one SDK call
+template<POAConfig CONF>
+inline POAErrors POAGetConfigValue(int nCameraID, typename POAConfigTraits<CONF>::Type *pValue, POABool *pIsAuto = nullptr)
+{
+    if(!pValue)
+    { return POA_ERROR_POINTER; }
+
+    POAConfigValue confValue;
+    POABool isAuto = POA_FALSE;
+    POAErrors error = POAGetConfig(nCameraID, CONF, &confValue, &isAuto);
+
+    if(error == POA_OK)
+    {
+        *pValue = POAConfigTraits<CONF>::get(confValue);
+        if(pIsAuto)
+        { *pIsAuto = isAuto; }
+    }
+
+    return error;
+}
+
+//Set the value of a writable POAConfig, one SDK call
+template<POAConfig CONF>
+inline POAErrors POASetConfigValue(int nCameraID, typename POAConfigTraits<CONF>::Type value, POABool isAuto = POA_FALSE)
+{
+    static_assert(POAConfigTraits<CONF>::isWritable, "the POAConfig is read-only");
+
+    return POASetConfig(nCameraID, CONF, POAConfigTraits<CONF>::make(value), isAuto);
+}
+
+#endif // POACONFIGTRAITS_H